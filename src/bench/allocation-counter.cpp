@@ -0,0 +1,57 @@
+// Copyright 2024, Fred Emmott
+// SPDX-License-Identifier: ISC
+
+#include "allocation-counter.hpp"
+
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+namespace {
+std::atomic<uint64_t> sAllocationCount {0};
+std::atomic<uint64_t> sAllocatedBytes {0};
+}// namespace
+
+// Array and nothrow forms are implemented in terms of these by the standard
+// library, so are counted too
+void* operator new(std::size_t size) {
+  sAllocationCount.fetch_add(1, std::memory_order_relaxed);
+  sAllocatedBytes.fetch_add(size, std::memory_order_relaxed);
+  if (const auto ret = std::malloc(size ? size : 1)) {
+    return ret;
+  }
+  throw std::bad_alloc {};
+}
+
+void operator delete(void* p) noexcept {
+  std::free(p);
+}
+
+void operator delete(void* p, std::size_t) noexcept {
+  std::free(p);
+}
+
+namespace FredEmmott::MonitorTool::Benchmarks {
+
+AllocationStats GetAllocationStats() noexcept {
+  return {
+    .mCount = sAllocationCount.load(std::memory_order_relaxed),
+    .mBytes = sAllocatedBytes.load(std::memory_order_relaxed),
+  };
+}
+
+ScopedAllocationCounter::ScopedAllocationCounter(benchmark::State& state)
+  : mState(state), mStart(GetAllocationStats()) {
+}
+
+ScopedAllocationCounter::~ScopedAllocationCounter() {
+  const auto end = GetAllocationStats();
+  mState.counters["allocs/op"] = benchmark::Counter(
+    static_cast<double>(end.mCount - mStart.mCount),
+    benchmark::Counter::kAvgIterations);
+  mState.counters["alloc_bytes/op"] = benchmark::Counter(
+    static_cast<double>(end.mBytes - mStart.mBytes),
+    benchmark::Counter::kAvgIterations);
+}
+
+}// namespace FredEmmott::MonitorTool::Benchmarks
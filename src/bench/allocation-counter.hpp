@@ -0,0 +1,36 @@
+// Copyright 2024, Fred Emmott
+// SPDX-License-Identifier: ISC
+#pragma once
+
+#include <benchmark/benchmark.h>
+
+#include <cstdint>
+
+namespace FredEmmott::MonitorTool::Benchmarks {
+
+/// Since the process started, from the replaced global `operator new`
+struct AllocationStats {
+  uint64_t mCount {};
+  uint64_t mBytes {};
+};
+
+AllocationStats GetAllocationStats() noexcept;
+
+/** Reports allocations per iteration as benchmark counters.
+ *
+ * Create just before the benchmark loop; counters are set on destruction.
+ */
+class ScopedAllocationCounter final {
+ public:
+  explicit ScopedAllocationCounter(benchmark::State&);
+  ~ScopedAllocationCounter();
+
+  ScopedAllocationCounter(const ScopedAllocationCounter&) = delete;
+  ScopedAllocationCounter& operator=(const ScopedAllocationCounter&) = delete;
+
+ private:
+  benchmark::State& mState;
+  AllocationStats mStart;
+};
+
+}// namespace FredEmmott::MonitorTool::Benchmarks
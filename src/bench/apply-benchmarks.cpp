@@ -0,0 +1,95 @@
+// Copyright 2024, Fred Emmott
+// SPDX-License-Identifier: ISC
+
+#include "allocation-counter.hpp"
+
+#include <FredEmmott/MonitorTool/ApplyProfile.hpp>
+#include <FredEmmott/MonitorTool/SimulatedDisplayBackend.hpp>
+
+#include <memory>
+
+using namespace FredEmmott::MonitorTool;
+using namespace FredEmmott::MonitorTool::Benchmarks;
+
+namespace {
+
+/// `state.range(0)` adapters, with two targets each
+SyntheticTopologyOptions GetTopology(const benchmark::State& state) {
+  const auto adapters = static_cast<std::size_t>(state.range(0));
+  return {
+    .mAdapterCount = adapters,
+    .mTargetCount = adapters * 2,
+  };
+}
+
+/** Installs a simulated backend for the duration of the benchmark.
+ *
+ * There's no latency, so only our own overhead is measured.
+ */
+class ScopedSimulatedBackend final {
+ public:
+  explicit ScopedSimulatedBackend(const SyntheticTopologyOptions& topology)
+    : mBackend(std::make_shared<SimulatedDisplayBackend>(
+        SimulatedDisplayOptions {.mTopology = topology})) {
+    SetDisplayBackend(mBackend);
+  }
+
+  ~ScopedSimulatedBackend() {
+    SetDisplayBackend(nullptr);
+  }
+
+  SimulatedDisplayBackend* operator->() const noexcept {
+    return mBackend.get();
+  }
+
+ private:
+  std::shared_ptr<SimulatedDisplayBackend> mBackend;
+};
+
+void BM_GatherSystemState(benchmark::State& state) {
+  ScopedSimulatedBackend backend {GetTopology(state)};
+  ScopedAllocationCounter allocations {state};
+  for (auto _: state) {
+    auto system = ApplySystemState::GetCurrent();
+    benchmark::DoNotOptimize(system);
+  }
+}
+BENCHMARK(BM_GatherSystemState)->RangeMultiplier(2)->Range(1, 16);
+
+/// The profile is already active, so nothing is validated
+void BM_PlanApplyActive(benchmark::State& state) {
+  const auto topology = GetTopology(state);
+  ScopedSimulatedBackend backend {topology};
+  const auto profile = CreateSyntheticProfile(topology, "Benchmark");
+  const auto system = ApplySystemState::GetCurrent();
+  ScopedAllocationCounter allocations {state};
+  for (auto _: state) {
+    auto plan = PlanApply(profile, system, false);
+    benchmark::DoNotOptimize(plan);
+  }
+}
+BENCHMARK(BM_PlanApplyActive)->RangeMultiplier(2)->Range(1, 16);
+
+/** The saved LUIDs are stale, so the profile must be remapped and validated.
+ *
+ * Includes storing the winner in the validation cache, as a real apply would.
+ */
+void BM_PlanApplyAfterReboot(benchmark::State& state) {
+  const auto topology = GetTopology(state);
+  ScopedSimulatedBackend backend {topology};
+  const auto profile = CreateSyntheticProfile(topology, "Benchmark");
+  backend->Reboot();
+  const auto system = ApplySystemState::GetCurrent();
+  ScopedAllocationCounter allocations {state};
+  for (auto _: state) {
+    auto plan = PlanApply(profile, system, false);
+    benchmark::DoNotOptimize(plan);
+  }
+  if (PlanApply(profile, system, false).mStrategy
+      != ApplyPlan::Strategy::RemappedLUIDs) {
+    state.SkipWithError("Profile was not remapped");
+  }
+}
+BENCHMARK(BM_PlanApplyAfterReboot)->RangeMultiplier(2)->Range(1, 16);
+
+}// namespace
@@ -0,0 +1,156 @@
+// Copyright 2024, Fred Emmott
+// SPDX-License-Identifier: ISC
+
+#include "allocation-counter.hpp"
+
+#include <FredEmmott/MonitorTool/DisplayConfigDiff.hpp>
+#include <FredEmmott/MonitorTool/DisplayConfigFingerprint.hpp>
+#include <FredEmmott/MonitorTool/SimdJSONProfileParser.hpp>
+#include <FredEmmott/MonitorTool/SyntheticDisplayConfig.hpp>
+#include <FredEmmott/MonitorTool/json.hpp>
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+using namespace FredEmmott::MonitorTool;
+using namespace FredEmmott::MonitorTool::Benchmarks;
+
+namespace {
+
+/// `state.range(0)` targets, two per source where possible
+SyntheticTopologyOptions GetOptions(const benchmark::State& state) {
+  const auto targets = static_cast<std::size_t>(state.range(0));
+  return {
+    .mAdapterCount = std::max<std::size_t>(1, targets / 4),
+    .mTargetCount = targets,
+    .mTargetsPerSource = 2,
+  };
+}
+
+enum class Serializer {
+  /// `nlohmann::ordered_json`, then `dump(2)`, as before `JSONWriter`
+  DOM,
+  /// `JSONWriter`, via `Profile::ToJSON()`
+  Streaming,
+};
+
+enum class Parser {
+  NlohmannJSON,
+  /// Only registered if built with `WITH_SIMDJSON`
+  SimdJSON,
+};
+
+/// `state.range(0)` targets, serialized with `state.range(1)`
+const std::vector<std::vector<int64_t>> SerializerArgs {
+  benchmark::CreateRange(1, 64, 4),
+  {static_cast<int64_t>(Serializer::DOM),
+   static_cast<int64_t>(Serializer::Streaming)},
+};
+
+/// `state.range(0)` targets, parsed with `state.range(1)`
+const std::vector<std::vector<int64_t>> ParserArgs {
+  benchmark::CreateRange(1, 64, 4),
+  {
+    static_cast<int64_t>(Parser::NlohmannJSON),
+#ifdef FMT_WITH_SIMDJSON
+    static_cast<int64_t>(Parser::SimdJSON),
+#endif
+  },
+};
+
+std::string ToJSONWithDOM(const Profile& profile) {
+  const nlohmann::ordered_json j {
+    {"Name", profile.mName},
+    {"GUID", nlohmann::json(profile.mGuid)},
+    {"Fingerprint", profile.GetFingerprint().ToString()},
+    {"Adapters", nlohmann::json(profile.mAdapters)},
+    {"Modes", nlohmann::json(profile.mDisplayConfig.mModes)},
+    {"Paths", nlohmann::json(profile.mDisplayConfig.mPaths)},
+  };
+  return j.dump(2);
+}
+
+/// As the fallback in `Profile::FromJSON()`
+Profile FromJSONWithNlohmannJSON(std::string_view json) {
+  const auto j = nlohmann::json::parse(json);
+  return {
+    .mName = j.at("Name"),
+    .mAdapters = j.value("Adapters", std::vector<DXGI_ADAPTER_DESC1> {}),
+    .mDisplayConfig = {
+      .mPaths = j.at("Paths"),
+      .mModes = j.at("Modes"),
+    },
+    .mGuid = j.at("GUID"),
+  };
+}
+
+void BM_ProfileToJSON(benchmark::State& state) {
+  const auto profile = CreateSyntheticProfile(GetOptions(state), "Benchmark");
+  const auto serializer = static_cast<Serializer>(state.range(1));
+  if (ToJSONWithDOM(profile) != profile.ToJSON()) {
+    state.SkipWithError("Profile::ToJSON() differs from nlohmann::json");
+    return;
+  }
+  std::size_t bytes = 0;
+  ScopedAllocationCounter allocations {state};
+  for (auto _: state) {
+    const auto json = (serializer == Serializer::DOM) ? ToJSONWithDOM(profile)
+                                                      : profile.ToJSON();
+    bytes += json.size();
+    benchmark::DoNotOptimize(json.data());
+  }
+  state.SetBytesProcessed(static_cast<int64_t>(bytes));
+}
+BENCHMARK(BM_ProfileToJSON)->ArgsProduct(SerializerArgs);
+
+void BM_ProfileFromJSON(benchmark::State& state) {
+  const auto json
+    = CreateSyntheticProfile(GetOptions(state), "Benchmark").ToJSON();
+  [[maybe_unused]] const auto parser = static_cast<Parser>(state.range(1));
+  ScopedAllocationCounter allocations {state};
+  for (auto _: state) {
+#ifdef FMT_WITH_SIMDJSON
+    if (parser == Parser::SimdJSON) {
+      auto profile = ParseProfileWithSimdJSON(json);
+      if (!profile) {
+        state.SkipWithError("simdjson rejected the profile");
+        break;
+      }
+      benchmark::DoNotOptimize(profile);
+      continue;
+    }
+#endif
+    auto profile = FromJSONWithNlohmannJSON(json);
+    benchmark::DoNotOptimize(profile);
+  }
+  state.SetBytesProcessed(
+    static_cast<int64_t>(state.iterations() * json.size()));
+}
+BENCHMARK(BM_ProfileFromJSON)->ArgsProduct(ParserArgs);
+
+void BM_DisplayConfigFingerprint(benchmark::State& state) {
+  const auto config = CreateSyntheticDisplayConfig(GetOptions(state));
+  ScopedAllocationCounter allocations {state};
+  for (auto _: state) {
+    auto fingerprint = GetDisplayConfigFingerprint(config);
+    benchmark::DoNotOptimize(fingerprint);
+  }
+}
+BENCHMARK(BM_DisplayConfigFingerprint)->RangeMultiplier(4)->Range(1, 64);
+
+void BM_DiffDisplayConfig(benchmark::State& state) {
+  auto options = GetOptions(state);
+  const auto current = CreateSyntheticDisplayConfig(options);
+  ++options.mSeed;
+  const auto target = CreateSyntheticDisplayConfig(options);
+  ScopedAllocationCounter allocations {state};
+  for (auto _: state) {
+    auto differences = DiffDisplayConfig(current, target);
+    benchmark::DoNotOptimize(differences);
+  }
+}
+BENCHMARK(BM_DiffDisplayConfig)->RangeMultiplier(4)->Range(1, 64);
+
+}// namespace
@@ -0,0 +1,63 @@
+// Copyright 2024, Fred Emmott
+// SPDX-License-Identifier: ISC
+
+#include <FredEmmott/MonitorTool/SyntheticDisplayConfig.hpp>
+#include <FredEmmott/MonitorTool/json.hpp>
+#include <benchmark/benchmark.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <random>
+#include <vector>
+
+using namespace FredEmmott::MonitorTool;
+
+namespace {
+
+/** `JSONWriter` alone, for each type.
+ *
+ * `fmt-tests` checks that the output matches `nlohmann::json`;
+ * `BM_ProfileToJSON` compares the speed of the two.
+ */
+template <class T>
+void BM_JSONWriter(benchmark::State& state) {
+  std::mt19937_64 engine {static_cast<uint64_t>(state.range(0))};
+  std::vector<T> values;
+  for (int64_t i = 0; i < state.range(0); ++i) {
+    values.push_back(CreateRandomStruct<T>(engine));
+  }
+
+  std::size_t size = 0;
+  {
+    JSONWriter writer;
+    writer.Write(values);
+    size = writer.GetView().size();
+  }
+
+  for (auto _: state) {
+    JSONWriter w {size};
+    w.Write(values);
+    benchmark::DoNotOptimize(w.GetView().data());
+  }
+  state.SetBytesProcessed(static_cast<int64_t>(state.iterations() * size));
+}
+
+#define FMT_JSON_WRITER_BENCHMARK(T) \
+  BENCHMARK_TEMPLATE(BM_JSONWriter, T)->Arg(1)->Arg(64);
+
+FMT_JSON_WRITER_BENCHMARK(LUID)
+FMT_JSON_WRITER_BENCHMARK(POINTL)
+FMT_JSON_WRITER_BENCHMARK(RECTL)
+FMT_JSON_WRITER_BENCHMARK(DISPLAYCONFIG_RATIONAL)
+FMT_JSON_WRITER_BENCHMARK(DISPLAYCONFIG_2DREGION)
+FMT_JSON_WRITER_BENCHMARK(DISPLAYCONFIG_PATH_SOURCE_INFO)
+FMT_JSON_WRITER_BENCHMARK(DISPLAYCONFIG_PATH_TARGET_INFO)
+FMT_JSON_WRITER_BENCHMARK(DXGI_ADAPTER_DESC1)
+FMT_JSON_WRITER_BENCHMARK(DISPLAYCONFIG_VIDEO_SIGNAL_INFO)
+FMT_JSON_WRITER_BENCHMARK(DISPLAYCONFIG_TARGET_MODE)
+FMT_JSON_WRITER_BENCHMARK(DISPLAYCONFIG_SOURCE_MODE)
+FMT_JSON_WRITER_BENCHMARK(DISPLAYCONFIG_DESKTOP_IMAGE_INFO)
+FMT_JSON_WRITER_BENCHMARK(DISPLAYCONFIG_MODE_INFO)
+FMT_JSON_WRITER_BENCHMARK(DISPLAYCONFIG_PATH_INFO)
+
+}// namespace
@@ -0,0 +1,73 @@
+// Copyright 2024, Fred Emmott
+// SPDX-License-Identifier: ISC
+
+#include "allocation-counter.hpp"
+
+#include <FredEmmott/MonitorTool/AdapterMatcher.hpp>
+#include <FredEmmott/MonitorTool/SyntheticDisplayConfig.hpp>
+
+#include <algorithm>
+
+using namespace FredEmmott::MonitorTool;
+using namespace FredEmmott::MonitorTool::Benchmarks;
+
+namespace {
+
+enum class AdapterChange {
+  /// New LUIDs, e.g. after a reboot; uses the indexed fast path
+  LUIDs,
+  /// New LUIDs, reported memory, and order; every adapter is scored
+  Everything,
+};
+
+/// `state.range(0)` adapters, changed as in `state.range(1)`
+std::pair<std::vector<DXGI_ADAPTER_DESC1>, std::vector<DXGI_ADAPTER_DESC1>>
+CreateAdapterSets(const benchmark::State& state) {
+  const auto saved = CreateSyntheticAdapters({
+    .mAdapterCount = static_cast<std::size_t>(state.range(0)),
+  });
+  auto current = saved;
+  for (auto& it: current) {
+    it.AdapterLuid.HighPart = 1;
+  }
+  if (static_cast<AdapterChange>(state.range(1)) == AdapterChange::Everything) {
+    for (auto& it: current) {
+      it.DedicatedVideoMemory += 1;
+    }
+    std::ranges::reverse(current);
+  }
+  return {saved, current};
+}
+
+void BM_CreateAdapterRemapTable(benchmark::State& state) {
+  const auto [saved, current] = CreateAdapterSets(state);
+  ScopedAllocationCounter allocations {state};
+  for (auto _: state) {
+    auto table = CreateAdapterRemapTable(saved, current);
+    benchmark::DoNotOptimize(table);
+  }
+}
+BENCHMARK(BM_CreateAdapterRemapTable)
+  ->ArgsProduct({
+    benchmark::CreateRange(1, 64, 2),
+    {static_cast<int64_t>(AdapterChange::LUIDs),
+     static_cast<int64_t>(AdapterChange::Everything)},
+  });
+
+void BM_MatchAdaptersCached(benchmark::State& state) {
+  const auto [saved, current] = CreateAdapterSets(state);
+  // Populate the cache
+  MatchAdapters(saved, current);
+  ScopedAllocationCounter allocations {state};
+  for (auto _: state) {
+    auto table = MatchAdapters(saved, current);
+    benchmark::DoNotOptimize(table);
+  }
+}
+BENCHMARK(BM_MatchAdaptersCached)
+  ->ArgsProduct({
+    benchmark::CreateRange(1, 64, 2),
+    {static_cast<int64_t>(AdapterChange::Everything)},
+  });
+
+}// namespace
@@ -0,0 +1,90 @@
+// Copyright 2024, Fred Emmott
+// SPDX-License-Identifier: ISC
+
+#include "allocation-counter.hpp"
+
+#include <FredEmmott/MonitorTool/ApplyProfile.hpp>
+#include <FredEmmott/MonitorTool/DisplayRecording.hpp>
+
+#include <cstdlib>
+#include <filesystem>
+#include <format>
+#include <memory>
+
+using namespace FredEmmott::MonitorTool;
+using namespace FredEmmott::MonitorTool::Benchmarks;
+
+namespace {
+
+/** Plan a recorded apply, with the recorded answers from Windows.
+ *
+ * `state.range(0)` is a `ReplayTiming`; with `Recorded`, this shows how long
+ * planning took on the recording system, and with `Instant`, how much of that
+ * is our own overhead.
+ */
+void BM_Replay(
+  benchmark::State& state,
+  const std::shared_ptr<const DisplayRecording>& recording,
+  const Profile& profile) {
+  const auto timing = static_cast<ReplayTiming>(state.range(0));
+  ScopedAllocationCounter allocations {state};
+  ApplyPlan plan;
+  for (auto _: state) {
+    state.PauseTiming();
+    SetDisplayBackend(
+      std::make_shared<ReplayDisplayBackend>(recording, timing));
+    state.ResumeTiming();
+
+    plan = PlanApply(profile, false);
+    benchmark::DoNotOptimize(plan);
+  }
+  SetDisplayBackend(nullptr);
+
+  state.SetLabel(std::string {ToString(plan.mStrategy)});
+  state.counters["validations"]
+    = static_cast<double>(plan.mValidationCount);
+}
+
+/** Register `BM_Replay` for every recording in `FMT_BENCHMARK_RECORDINGS`.
+ *
+ * Recordings are made with `fmt-apply-profile --record PATH`, which saves the
+ * profile as `PATH`, with the extension replaced by `.json`.
+ */
+bool RegisterReplays() {
+  const auto root = std::getenv("FMT_BENCHMARK_RECORDINGS");
+  if (!root) {
+    return false;
+  }
+
+  std::error_code ec;
+  for (const auto& entry: std::filesystem::directory_iterator(root, ec)) {
+    auto path = entry.path();
+    if (path.extension() != ".fmtr") {
+      continue;
+    }
+    const auto name = std::format("BM_Replay/{}", path.stem().string());
+    try {
+      const auto recording = std::make_shared<const DisplayRecording>(
+        DisplayRecording::Load(path));
+      const auto profile = Profile::Load(path.replace_extension(".json"));
+      benchmark::RegisterBenchmark(
+        name.c_str(), &BM_Replay, recording, profile)
+        ->Arg(static_cast<int64_t>(ReplayTiming::Instant))
+        ->Arg(static_cast<int64_t>(ReplayTiming::Recorded))
+        ->UseRealTime();
+    } catch (const RuntimeError& e) {
+      const std::string error {e.what()};
+      benchmark::RegisterBenchmark(
+        name.c_str(), [error](benchmark::State& state) {
+          state.SkipWithError(error.c_str());
+          for (auto _: state) {
+          }
+        });
+    }
+  }
+  return true;
+}
+
+[[maybe_unused]] const auto sReplaysRegistered = RegisterReplays();
+
+}// namespace
@@ -0,0 +1,156 @@
+// Copyright 2024, Fred Emmott
+// SPDX-License-Identifier: ISC
+
+#include <benchmark/benchmark.h>
+#include <winrt/base.h>
+
+#include <cstdlib>
+#include <filesystem>
+#include <format>
+#include <string>
+
+#ifdef _WIN32
+#include <Windows.h>
+#else
+#include <fcntl.h>
+#include <spawn.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+extern char** environ;
+#endif
+
+namespace {
+
+#ifdef _WIN32
+constexpr auto ExecutableExtension = ".exe";
+#else
+constexpr auto ExecutableExtension = "";
+#endif
+
+/** Run `PATH --help` to completion, discarding its output.
+ *
+ * This is dominated by creating the process, loading DLLs, and static
+ * initialization. Every version of every tool supports `--help`, so results
+ * from different builds are comparable.
+ */
+void BM_Startup(benchmark::State& state, const std::filesystem::path& path) {
+#ifdef _WIN32
+  SECURITY_ATTRIBUTES inheritable {
+    .nLength = sizeof(SECURITY_ATTRIBUTES),
+    .bInheritHandle = TRUE,
+  };
+  const winrt::file_handle nul {CreateFileW(
+    L"NUL",
+    GENERIC_READ | GENERIC_WRITE,
+    FILE_SHARE_READ | FILE_SHARE_WRITE,
+    &inheritable,
+    OPEN_EXISTING,
+    FILE_ATTRIBUTE_NORMAL,
+    NULL)};
+  const auto commandLine = std::format(L"\"{}\" --help", path.wstring());
+
+  for (auto _: state) {
+    STARTUPINFOW startupInfo {
+      .cb = sizeof(STARTUPINFOW),
+      .dwFlags = STARTF_USESTDHANDLES,
+      .hStdInput = nul.get(),
+      .hStdOutput = nul.get(),
+      .hStdError = nul.get(),
+    };
+    PROCESS_INFORMATION processInfo {};
+    // `CreateProcessW()` may modify the command line
+    auto buffer = commandLine;
+    if (!CreateProcessW(
+          path.c_str(),
+          buffer.data(),
+          nullptr,
+          nullptr,
+          /* inherit handles = */ TRUE,
+          CREATE_NO_WINDOW,
+          nullptr,
+          nullptr,
+          &startupInfo,
+          &processInfo)) {
+      state.SkipWithError(
+        std::format("CreateProcessW() failed: {}", GetLastError()).c_str());
+      break;
+    }
+    const winrt::handle process {processInfo.hProcess};
+    const winrt::handle thread {processInfo.hThread};
+
+    WaitForSingleObject(process.get(), INFINITE);
+    DWORD exitCode {};
+    GetExitCodeProcess(process.get(), &exitCode);
+    if (exitCode != 0) {
+      state.SkipWithError(std::format("Exited with {}", exitCode).c_str());
+      break;
+    }
+  }
+#else
+  posix_spawn_file_actions_t actions;
+  posix_spawn_file_actions_init(&actions);
+  for (const auto fd: {STDIN_FILENO, STDOUT_FILENO, STDERR_FILENO}) {
+    posix_spawn_file_actions_addopen(&actions, fd, "/dev/null", O_RDWR, 0);
+  }
+  auto program = path.string();
+  std::string help {"--help"};
+  char* const argv[] = {program.data(), help.data(), nullptr};
+
+  for (auto _: state) {
+    pid_t pid {};
+    if (const auto error = posix_spawn(
+          &pid, program.c_str(), &actions, nullptr, argv, environ)) {
+      state.SkipWithError(
+        std::format("posix_spawn() failed: {}", error).c_str());
+      break;
+    }
+
+    int status {};
+    waitpid(pid, &status, 0);
+    if (!WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+      state.SkipWithError(std::format("Exited with {}", status).c_str());
+      break;
+    }
+  }
+  posix_spawn_file_actions_destroy(&actions);
+#endif
+}
+
+/** Register `BM_Startup` for every tool.
+ *
+ * Tools are found in `FMT_BENCHMARK_BINARIES` if it's set, e.g. an older
+ * release for comparison, or in the build directory otherwise.
+ */
+bool RegisterStartups() {
+  std::filesystem::path root;
+  if (const auto env = std::getenv("FMT_BENCHMARK_BINARIES")) {
+    root = env;
+  } else {
+#ifdef FMT_BENCHMARK_BINARIES_DIR
+    root = FMT_BENCHMARK_BINARIES_DIR;
+#else
+    return false;
+#endif
+  }
+
+  std::error_code ec;
+  for (const auto& entry: std::filesystem::directory_iterator(root, ec)) {
+    const auto& path = entry.path();
+    const auto name = path.stem().string();
+    if (
+      path.extension() != ExecutableExtension || !name.starts_with("fmt")
+      || name == "fmt-benchmarks") {
+      continue;
+    }
+    benchmark::RegisterBenchmark(
+      std::format("BM_Startup/{}", name).c_str(), &BM_Startup, path)
+      ->Unit(benchmark::kMillisecond)
+      ->UseRealTime();
+  }
+  return true;
+}
+
+[[maybe_unused]] const auto sStartupsRegistered = RegisterStartups();
+
+}// namespace
@@ -0,0 +1,161 @@
+// Copyright 2024, Fred Emmott
+// SPDX-License-Identifier: ISC
+
+#include "allocation-counter.hpp"
+
+#include <FredEmmott/MonitorTool/ProfileCache.hpp>
+#include <FredEmmott/MonitorTool/ProfileStore.hpp>
+#include <FredEmmott/MonitorTool/SyntheticDisplayConfig.hpp>
+
+#include <cstdint>
+#include <filesystem>
+#include <format>
+#include <map>
+#include <memory>
+
+using namespace FredEmmott::MonitorTool;
+using namespace FredEmmott::MonitorTool::Benchmarks;
+
+namespace {
+
+enum class StoreKind {
+  Directory,
+  Bundle,
+};
+
+constexpr SyntheticTopologyOptions StoreProfileOptions {
+  .mAdapterCount = 2,
+  .mTargetCount = 4,
+  .mTargetsPerSource = 1,
+};
+
+std::filesystem::path GetBenchmarkRoot() {
+  return std::filesystem::temp_directory_path() / "fmt-benchmarks";
+}
+
+std::filesystem::path GetStorePath(const benchmark::State& state) {
+  return GetBenchmarkRoot()
+    / std::format("{}-{}", state.range(0), state.range(1));
+}
+
+/// Total size of the store's files
+uint64_t GetStoreSize(const benchmark::State& state) {
+  uint64_t ret = 0;
+  for (const auto& it:
+       std::filesystem::recursive_directory_iterator(GetStorePath(state))) {
+    if (it.is_regular_file()) {
+      ret += it.file_size();
+    }
+  }
+  return ret;
+}
+
+/** A store of `state.range(0)` profiles, of the kind in `state.range(1)`.
+ *
+ * Created on first use, in a temporary directory that's removed when the
+ * process exits. Loading profiles from a directory store also populates the
+ * decoded profile cache, as it would in normal use; the cache is in the same
+ * temporary directory, rather than the user's.
+ */
+ProfileStore& GetStore(const benchmark::State& state) {
+  struct Root {
+    Root() {
+      std::filesystem::remove_all(GetBenchmarkRoot());
+      SetProfileCacheRoot(GetBenchmarkRoot() / "Cache");
+    }
+    ~Root() {
+      SetProfileCacheRoot({});
+      std::error_code ec;
+      std::filesystem::remove_all(GetBenchmarkRoot(), ec);
+    }
+  };
+  static Root sRoot;
+  static std::map<std::pair<int64_t, int64_t>, std::unique_ptr<ProfileStore>>
+    sStores;
+
+  const auto key = std::pair {state.range(0), state.range(1)};
+  auto& store = sStores[key];
+  if (store) {
+    return *store;
+  }
+
+  const auto path = GetStorePath(state);
+  if (static_cast<StoreKind>(state.range(1)) == StoreKind::Bundle) {
+    std::filesystem::create_directories(path);
+    store = std::make_unique<BundleProfileStore>(path / "Profiles.fmtbundle");
+  } else {
+    store = std::make_unique<DirectoryProfileStore>(path);
+  }
+  PopulateSyntheticProfileStore(
+    *store, static_cast<std::size_t>(state.range(0)), StoreProfileOptions);
+  return *store;
+}
+
+const std::vector<std::vector<int64_t>> StoreArgs {
+  benchmark::CreateRange(1, 4096, 4),
+  {static_cast<int64_t>(StoreKind::Directory),
+   static_cast<int64_t>(StoreKind::Bundle)},
+};
+
+/// `StoreArgs`, then `maxThreads`: 1 is serial, 0 is one per core
+const std::vector<std::vector<int64_t>> EnumerateArgs {
+  StoreArgs.at(0),
+  StoreArgs.at(1),
+  {1, 0},
+};
+
+void BM_StoreEnumerate(benchmark::State& state) {
+  auto& store = GetStore(state);
+  const auto maxThreads = static_cast<std::size_t>(state.range(2));
+  ScopedAllocationCounter allocations {state};
+  for (auto _: state) {
+    auto profiles = store.Enumerate(maxThreads);
+    benchmark::DoNotOptimize(profiles);
+  }
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+  state.counters["store_bytes"] = static_cast<double>(GetStoreSize(state));
+}
+BENCHMARK(BM_StoreEnumerate)->ArgsProduct(EnumerateArgs);
+
+void BM_StoreEnumerateSummaries(benchmark::State& state) {
+  auto& store = GetStore(state);
+  ScopedAllocationCounter allocations {state};
+  for (auto _: state) {
+    auto summaries = store.EnumerateSummaries();
+    benchmark::DoNotOptimize(summaries);
+  }
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_StoreEnumerateSummaries)->ArgsProduct(StoreArgs);
+
+void BM_StoreFindByName(benchmark::State& state) {
+  auto& store = GetStore(state);
+  // Last, so that linear searches are as slow as they get
+  const auto name = std::format("Synthetic {}", state.range(0) - 1);
+  ScopedAllocationCounter allocations {state};
+  for (auto _: state) {
+    auto profile = store.FindByName(name);
+    benchmark::DoNotOptimize(profile);
+  }
+}
+BENCHMARK(BM_StoreFindByName)->ArgsProduct(StoreArgs);
+
+void BM_StoreFindByGUID(benchmark::State& state) {
+  auto& store = GetStore(state);
+  const auto guid = CreateSyntheticProfile(
+                      {
+                        .mAdapterCount = StoreProfileOptions.mAdapterCount,
+                        .mTargetCount = StoreProfileOptions.mTargetCount,
+                        .mSeed = static_cast<uint32_t>(state.range(0) - 1),
+                      },
+                      std::format("Synthetic {}", state.range(0) - 1))
+                      .mGuid;
+  ScopedAllocationCounter allocations {state};
+  for (auto _: state) {
+    auto profile = store.FindByGUID(guid);
+    benchmark::DoNotOptimize(profile);
+  }
+}
+BENCHMARK(BM_StoreFindByGUID)->ArgsProduct(StoreArgs);
+
+}// namespace
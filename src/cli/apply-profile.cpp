@@ -1,16 +1,25 @@
 // Copyright 2024, Fred Emmott
 // SPDX-License-Identifier: ISC
 
+#include "commands.hpp"
 #include "console.hpp"
 
+#include <FredEmmott/MonitorTool/ActiveProfile.hpp>
+#include <FredEmmott/MonitorTool/ApplyProfile.hpp>
 #include <FredEmmott/MonitorTool/Config.hpp>
-#include <FredEmmott/MonitorTool/EnumAdapterDescs.hpp>
+#include <FredEmmott/MonitorTool/DisplayRecording.hpp>
 #include <FredEmmott/MonitorTool/Profile.hpp>
+#include <FredEmmott/MonitorTool/ProfileStore.hpp>
+#include <FredEmmott/MonitorTool/Service.hpp>
 #include <FredEmmott/MonitorTool/except.hpp>
+#include <FredEmmott/MonitorTool/json.hpp>
 #include <winrt/base.h>
 
 #include <algorithm>
+#include <chrono>
+#include <filesystem>
 #include <format>
+#include <memory>
 #include <optional>
 #include <ranges>
 
@@ -22,248 +31,199 @@ using namespace FredEmmott::MonitorTool::CLI;
 using namespace FredEmmott::MonitorTool;
 
 namespace {
-const auto HelpText = std::format(
-  "Freds Monitor Tool v{}\n"
-  "\n"
-  "USAGE:\n"
-  "  fmt-apply-profile [--update] [--path|--guid] PROFILE_NAME\n"
-  "  fmt-apply-profile --help\n"
-  "\n"
-  "OPTIONS:\n"
-  "  --path: the following argument is a JSON file path, not a profile name\n"
-  "  --guid: the following argument is a profile GUID, not a profile name\n"
-  "  --update: update the graphics adapter list saved in the profile\n"
-  "  --temporary: tell Windows to apply the configuration without saving\n"
-  "  --help: show this text\n"
-  "---\n"
-  "{}",
-  VersionString,
-  LicenseText);
+std::string GetHelpText() {
+  return std::format(
+    "Freds Monitor Tool v{}\n"
+    "\n"
+    "USAGE:\n"
+    "  fmt-apply-profile [--update] [--path|--guid] PROFILE_NAME\n"
+    "  fmt-apply-profile [--update] --next PROFILE_NAME,PROFILE_NAME[,...]\n"
+    "  fmt-apply-profile --help\n"
+    "\n"
+    "OPTIONS:\n"
+    "  --path: the following argument is a JSON file path, not a profile name\n"
+    "  --guid: the following argument is a profile GUID, not a profile name\n"
+    "  --next: apply the profile after the active one in the comma-separated\n"
+    "    list, or the first if none of them are active\n"
+    "  --update: update the graphics adapter list saved in the profile\n"
+    "  --temporary: tell Windows to apply the configuration without saving\n"
+    "  --timings: show how long each stage of applying the profile took\n"
+    "  --trace PATH: write a Chrome trace of this run to PATH\n"
+    "  --record PATH: apply without the service or the validation cache,\n"
+    "    recording every display API call to PATH, and saving the profile\n"
+    "    next to it with a .json extension; replay them with fmt-benchmarks\n"
+    "  --help: show this text\n"
+    "---\n"
+    "{}",
+    VersionString,
+    LicenseText);
+}
 
 enum class ProfileParamKind {
   ProfileName,
   ProfileGUID,
   FilePath,
+  NextProfileName,
 };
 
 }// namespace
 
-inline bool operator==(const LUID& a, const LUID& b) {
-  return memcmp(&a, &b, sizeof(LUID)) == 0;
-}
-
-static bool IsLikelySameModelGPU(
-  const DXGI_ADAPTER_DESC1& a,
-  const DXGI_ADAPTER_DESC1& b) {
-  return (a.VendorId == b.VendorId) && (a.DeviceId == b.DeviceId)
-    && (a.DedicatedVideoMemory == b.DedicatedVideoMemory)
-    && (a.Flags == b.Flags);
-}
-
-static std::optional<LUID> GetUpdatedLUID(
-  const LUID& in,
-  const Profile& profile,
-  const std::vector<DXGI_ADAPTER_DESC1> currentAdapters) {
-  for (const auto& it: currentAdapters) {
-    if (it.AdapterLuid == in) {
-      return in;
-    }
-  }
-
-  if (profile.mAdapters.empty()) {
-    return {};
+static std::optional<winrt::guid> ParseGUID(const std::string& guidStrIn) {
+  std::string_view guidStr {guidStrIn};
+  if (
+    guidStr.size() == 38 && (guidStr.front() == '{')
+    && (guidStr.back() == '}')) {
+    guidStr.remove_prefix(1);
+    guidStr.remove_suffix(1);
   }
-
-  const auto oldIt = std::ranges::find(
-    profile.mAdapters, in, &DXGI_ADAPTER_DESC1::AdapterLuid);
-  if (oldIt == profile.mAdapters.end()) {
+  try {
+    return winrt::guid {guidStr};
+  } catch (const std::invalid_argument&) {
     return {};
   }
+}
 
-  size_t oldIdxForModel = 0;
-  for (const auto& it: profile.mAdapters) {
-    if (it.AdapterLuid == in) {
-      break;
-    }
-    if (IsLikelySameModelGPU(it, *oldIt)) {
-      ++oldIdxForModel;
-    }
+static void PrintApplyResult(const ApplyResult& result) {
+  if (!result.mChanged) {
+    PrintCOUT("Profile is already active; nothing to do");
+    return;
   }
-
-  for (const auto& it: currentAdapters) {
-    if (IsLikelySameModelGPU(it, *oldIt)) {
-      if (oldIdxForModel == 0) {
-        return it.AdapterLuid;
-      }
-      --oldIdxForModel;
-    }
+  std::string message = "Applied profile; changed:";
+  for (const auto& it: result.mDifferences) {
+    message += std::format("\n- {}", it);
   }
-
-  return {};
+  PrintCOUT(message);
 }
 
-template <>
-struct std::hash<LUID> {
-  std::size_t operator()(const LUID& v) const noexcept {
-    return std::hash<uint64_t> {}(std::bit_cast<uint64_t>(v));
-  }
-};
-
-const std::optional<Profile> UpdateLUIDs(
-  const Profile& in,
-  const std::vector<DXGI_ADAPTER_DESC1>& currentAdapters) {
-  Profile ret {in};
-  ret.mAdapters = currentAdapters;
-  std::unordered_map<LUID, LUID> luids;
+static void PrintTimings(
+  std::string_view strategy,
+  bool fromCache,
+  std::size_t validationCount,
+  const nlohmann::json& timingsUS) {
+  PrintCOUT(std::format(
+    "Strategy: {}{}; {} validation(s)\n"
+    "Timings: gather {}us, plan {}us, validate {}us, apply {}us",
+    strategy,
+    fromCache ? " (cached)" : "",
+    validationCount,
+    timingsUS.value("Gather", 0),
+    timingsUS.value("Plan", 0),
+    timingsUS.value("Validate", 0),
+    timingsUS.value("Apply", 0)));
+}
 
-  auto map = [&](const LUID& luid) -> std::optional<LUID> {
-    if (luids.contains(luid)) {
-      return luids.at(luid);
-    }
-    const auto ret = GetUpdatedLUID(luid, in, currentAdapters);
-    if (ret) {
-      luids.emplace(luid, *ret);
-    }
-    return ret;
+static void PrintTimings(const ApplyPlan& plan) {
+  const auto us = [](ApplyTimings::Duration duration) {
+    return std::chrono::duration_cast<std::chrono::microseconds>(duration)
+      .count();
   };
+  PrintTimings(
+    ToString(plan.mStrategy),
+    plan.mFromCache,
+    plan.mValidationCount,
+    {
+      {"Gather", us(plan.mTimings.mGather)},
+      {"Plan", us(plan.mTimings.mPlan)},
+      {"Validate", us(plan.mTimings.mValidate)},
+      {"Apply", us(plan.mTimings.mApply)},
+    });
+}
 
-  for (auto& mode: ret.mDisplayConfig.mModes) {
-    const auto it = map(mode.adapterId);
-    if (!it) {
-      return {};
-    }
-
-    mode.adapterId = *it;
+/// Uses `fmt-service` if it's running
+static std::vector<ProfileSummary> GetActiveProfiles() {
+  const auto response = SendServiceRequest({{"Command", "Current"}});
+  if (!response || response->value("Status", "") != "OK") {
+    return FindActiveProfiles();
   }
 
-  for (auto& path: ret.mDisplayConfig.mPaths) {
-    {
-      const auto it = map(path.sourceInfo.adapterId);
-      if (!it) {
-        return {};
-      }
-      path.sourceInfo.adapterId = *it;
-    }
-    {
-      const auto it = map(path.targetInfo.adapterId);
-      if (!it) {
-        return {};
-      }
-      path.targetInfo.adapterId = *it;
-    }
+  std::vector<ProfileSummary> ret;
+  for (const auto& it: response->at("Profiles")) {
+    ret.push_back({
+      .mName = it.at("Name").get<std::string>(),
+      .mGuid = it.at("GUID").get<winrt::guid>(),
+    });
   }
-
   return ret;
 }
 
-static bool ApplyAdapterlessProfileWithCurrentSingleGPU(
-  const Profile& in,
-  ApplyMode applyMode,
-  const std::vector<DXGI_ADAPTER_DESC1>& allAdapters,
-  bool saveUpdates) {
-  if (!in.mAdapters.empty()) {
-    return false;
-  }
-  const auto badFlags = DXGI_ADAPTER_FLAG_REMOTE | DXGI_ADAPTER_FLAG_SOFTWARE;
-  std::vector<DXGI_ADAPTER_DESC1> realAdapters;
-  for (const auto& it: allAdapters) {
-    if ((it.Flags & badFlags) == 0) {
-      realAdapters.push_back(it);
+static std::vector<std::string> SplitProfileNames(std::string_view list) {
+  std::vector<std::string> ret;
+  for (auto&& name: std::views::split(list, ',')) {
+    if (!std::ranges::empty(name)) {
+      ret.emplace_back(std::ranges::begin(name), std::ranges::end(name));
     }
   }
-  if (realAdapters.size() != 1) {
-    return false;
-  }
-
-  const auto replacement = realAdapters.front().AdapterLuid;
-  Profile profile {in};
-
-  for (auto& path: profile.mDisplayConfig.mPaths) {
-    path.sourceInfo.adapterId = replacement;
-    path.targetInfo.adapterId = replacement;
-  }
-  for (auto& mode: profile.mDisplayConfig.mModes) {
-    mode.adapterId = replacement;
-  }
-
-  if (!profile.CanApply()) {
-    return false;
-  }
-  profile.Apply(applyMode);
-  if (saveUpdates) {
-    profile.mAdapters = allAdapters;
-    profile.Save();
-  }
-  return true;
+  return ret;
 }
 
-static std::optional<Profile> FindProfileByName(const std::string& name) {
-  const auto profiles = Profile::Enumerate();
-  // Try an exact match first, then fall back to case-insensitive
-  auto it = std::ranges::find(profiles, name, &Profile::mName);
-  if (it != profiles.end()) {
-    return *it;
-  }
-
-  it = std::ranges::find_if(profiles, [a = name](const auto& b) {
-    return _stricmp(a.c_str(), b.mName.c_str()) == 0;
-  });
-  if (it != profiles.end()) {
-    return *it;
+/** Ask `fmt-service` to apply the profile.
+ *
+ * Returns the exit code, or nothing if the service isn't available or
+ * doesn't know about the profile.
+ */
+static std::optional<int> ApplyWithService(
+  nlohmann::json request,
+  ApplyMode applyMode,
+  bool saveUpdates,
+  bool showTimings) {
+  request["Command"] = "Apply";
+  request["Temporary"] = (applyMode == ApplyMode::Temporary);
+  request["Update"] = saveUpdates;
+  const auto response = SendServiceRequest(std::move(request));
+  if (!response) {
+    return {};
   }
 
-  return {};
-}
-
-static std::optional<Profile> FindProfileByGUID(const std::string& guidStrIn) {
-  std::string_view guidStr {guidStrIn};
-  if (
-    guidStr.size() == 38 && (guidStr.front() == '{')
-    && (guidStr.back() == '}')) {
-    guidStr.remove_prefix(1);
-    guidStr.remove_suffix(1);
+  const auto status = response->value("Status", "");
+  if (status == "OK") {
+    PrintApplyResult({
+      .mChanged = response->value("Changed", true),
+      .mDifferences
+      = response->value("Differences", std::vector<std::string> {}),
+    });
+    if (showTimings) {
+      PrintTimings(
+        response->value("Strategy", "unknown"),
+        response->value("Cached", false),
+        response->value("Validations", std::size_t {0}),
+        response->value("TimingsUS", nlohmann::json::object()));
+    }
+    return 0;
   }
-  winrt::guid guid;
-  try {
-    guid = winrt::guid {guidStr};
-  } catch (const std::invalid_argument&) {
+  if (status == "NotFound") {
+    // The service only reloads profiles after they've stopped changing, so it
+    // may not have seen a profile that was just created
     return {};
   }
-
-  const auto profiles = Profile::Enumerate();
-  auto it = std::ranges::find(profiles, guid, &Profile::mGuid);
-  if (it != profiles.end()) {
-    return *it;
+  if (status == "CannotApply") {
+    PrintCERR("Profile can't be applied due to a configuration change");
+  } else {
+    PrintCERR(std::format(
+      "Fatal error: {}", response->value("Message", "unknown error")));
   }
-
-  return {};
+  return 1;
 }
 
-int WINAPI wWinMain(
-  [[maybe_unused]] HINSTANCE hInstance,
-  [[maybe_unused]] HINSTANCE hPrevInstance,
-  [[maybe_unused]] PWSTR pCmdLine,
-  [[maybe_unused]] int nCmdShow) {
-  // Using `GetCommandLineW()` instead of `pCmdLine` as `pCmdLine` varies in
-  // whether or not argv[0] is the process, depending on how it's launched.
-  int argc {};
-  const auto argv = CommandLineToArgvW(GetCommandLineW(), &argc);
+namespace FredEmmott::MonitorTool::CLI {
 
+int ApplyProfileMain(int argc, wchar_t** argv) {
   std::optional<ProfileParamKind> profileParamKind;
   bool saveUpdates = false;
+  bool showTimings = false;
   auto applyMode = ApplyMode::Persistent;
   std::string profileParam;
+  std::filesystem::path recordPath;
 
   for (int i = 1; i < argc; ++i) {
     const std::wstring_view arg {argv[i]};
     if (arg.starts_with(L"-")) {
       if (arg == L"--help") {
-        PrintCOUT(HelpText);
+        PrintCOUT(GetHelpText());
         return 0;
       }
       if (arg == L"--path") {
         if (profileParamKind) {
-          PrintCERR(HelpText);
+          PrintCERR(GetHelpText());
           return 1;
         }
 
@@ -272,13 +232,22 @@ int WINAPI wWinMain(
       }
       if (arg == L"--guid") {
         if (profileParamKind) {
-          PrintCERR(HelpText);
+          PrintCERR(GetHelpText());
           return 1;
         }
 
         profileParamKind = ProfileParamKind::ProfileGUID;
         continue;
       }
+      if (arg == L"--next") {
+        if (profileParamKind) {
+          PrintCERR(GetHelpText());
+          return 1;
+        }
+
+        profileParamKind = ProfileParamKind::NextProfileName;
+        continue;
+      }
       if (arg == L"--update") {
         saveUpdates = true;
         continue;
@@ -287,7 +256,29 @@ int WINAPI wWinMain(
         applyMode = ApplyMode::Temporary;
         continue;
       }
-      PrintCERR(HelpText);
+      if (arg == L"--timings") {
+        showTimings = true;
+        continue;
+      }
+      if (arg == L"--trace") {
+        if (i + 1 >= argc) {
+          PrintCERR(GetHelpText());
+          return 1;
+        }
+        if (!TryStartTracing(argv[++i])) {
+          return 1;
+        }
+        continue;
+      }
+      if (arg == L"--record") {
+        if (i + 1 >= argc) {
+          PrintCERR(GetHelpText());
+          return 1;
+        }
+        recordPath = argv[++i];
+        continue;
+      }
+      PrintCERR(GetHelpText());
       return 1;
     }
 
@@ -297,7 +288,7 @@ int WINAPI wWinMain(
         "First: {}\nNext: {}\n{}",
         profileParam,
         winrt::to_string(arg),
-        HelpText));
+        GetHelpText()));
       return 1;
     }
     profileParam = winrt::to_string(arg);
@@ -305,21 +296,73 @@ int WINAPI wWinMain(
 
   if (profileParam.empty()) {
     PrintCERR(
-      std::format("Profile name was empty or not provided\n{}", HelpText));
+      std::format("Profile name was empty or not provided\n{}", GetHelpText()));
+    return 1;
+  }
+
+  auto kind = profileParamKind.value_or(ProfileParamKind::ProfileName);
+  if (kind == ProfileParamKind::NextProfileName) {
+    const auto names = SplitProfileNames(profileParam);
+    if (names.empty()) {
+      PrintCERR(std::format("No profile names provided\n{}", GetHelpText()));
+      return 1;
+    }
+    try {
+      profileParam = GetNextProfileName(names, GetActiveProfiles());
+    } catch (const RuntimeError& e) {
+      PrintCERR(std::format("Fatal error: {}", e.what()));
+      return 1;
+    }
+    kind = ProfileParamKind::ProfileName;
+  }
+
+  std::optional<winrt::guid> guid;
+  if (kind == ProfileParamKind::ProfileGUID) {
+    guid = ParseGUID(profileParam);
+  }
+  const auto notFoundMessage = (kind == ProfileParamKind::ProfileGUID)
+    ? std::format("Couldn't find a profile with GUID '{}'", profileParam)
+    : std::format("Couldn't find a profile called '{}'", profileParam);
+  if (kind == ProfileParamKind::ProfileGUID && !guid) {
+    PrintCERR(notFoundMessage);
     return 1;
   }
 
+  // Files are always loaded in-process, as the service only knows about the
+  // profile store; recordings need the calls to be made in this process
+  if (kind != ProfileParamKind::FilePath && recordPath.empty()) {
+    nlohmann::json request;
+    if (guid) {
+      request["GUID"] = *guid;
+    } else {
+      request["Name"] = profileParam;
+    }
+    if (const auto exitCode = ApplyWithService(
+          std::move(request),
+          applyMode,
+          saveUpdates,
+          showTimings)) {
+      return *exitCode;
+    }
+  }
+
   try {
+    if (!recordPath.empty()) {
+      SetDisplayBackend(std::make_shared<RecordingDisplayBackend>(
+        GetDisplayBackend(), recordPath));
+    }
+
     Profile profile {};
-    switch (profileParamKind.value_or(ProfileParamKind::ProfileName)) {
+    switch (kind) {
       case ProfileParamKind::FilePath:
         profile = Profile::Load(profileParam);
         break;
+      // `--next` has been resolved to a name above
+      case ProfileParamKind::NextProfileName:
       case ProfileParamKind::ProfileName: {
-        auto it = FindProfileByName(profileParam);
+        auto it = GetProfileStore().FindByName(profileParam);
         if (!it) {
-          PrintCERR(
-            std::format("Couldn't find a profile called '{}'", profileParam));
+          PrintCERR(notFoundMessage);
           return 1;
         }
 
@@ -327,10 +370,9 @@ int WINAPI wWinMain(
         break;
       }
       case ProfileParamKind::ProfileGUID: {
-        auto it = FindProfileByGUID(profileParam);
+        auto it = GetProfileStore().FindByGUID(*guid);
         if (!it) {
-          PrintCERR(std::format(
-            "Couldn't find a profile with GUID '{}'", profileParam));
+          PrintCERR(notFoundMessage);
           return 1;
         }
         profile = *it;
@@ -338,28 +380,28 @@ int WINAPI wWinMain(
       }
     }
 
-    if (!profile.CanApply()) {
-      const auto allAdapters = EnumAdapterDescs();
-      if (ApplyAdapterlessProfileWithCurrentSingleGPU(
-            profile, applyMode, allAdapters, saveUpdates)) {
-        return 0;
-      }
-      const auto updated = UpdateLUIDs(profile, allAdapters);
-      if (updated && updated->CanApply()) {
-        updated->Apply(applyMode);
-        if (saveUpdates) {
-          updated->Save();
-        }
-        return 0;
-      }
+    if (!recordPath.empty()) {
+      auto profilePath = recordPath;
+      profile.Save(profilePath.replace_extension(".json"));
+    }
+
+    // A cache hit would skip the validations that the recording is for
+    auto plan = PlanApply(profile, recordPath.empty());
+    const auto result = ExecuteApplyPlan(plan, applyMode, saveUpdates);
+    if (showTimings) {
+      PrintTimings(plan);
+    }
+    if (!result) {
       PrintCERR("Profile can't be applied due to a configuration change");
       return 1;
     }
-    profile.Apply(applyMode);
+    PrintApplyResult(*result);
   } catch (const RuntimeError& e) {
     PrintCERR(std::format("Fatal error: {}", e.what()).c_str());
     return 1;
   }
 
   return 0;
-}
\ No newline at end of file
+}
+
+}// namespace FredEmmott::MonitorTool::CLI
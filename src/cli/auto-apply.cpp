@@ -0,0 +1,160 @@
+// Copyright 2024, Fred Emmott
+// SPDX-License-Identifier: ISC
+
+#include "commands.hpp"
+#include "console.hpp"
+
+#include <FredEmmott/MonitorTool/Config.hpp>
+#include <FredEmmott/MonitorTool/TopologyRulesEngine.hpp>
+#include <FredEmmott/MonitorTool/except.hpp>
+#include <winrt/base.h>
+
+#include <chrono>
+#include <charconv>
+#include <filesystem>
+#include <format>
+#include <memory>
+
+#include <Windows.h>
+
+using namespace FredEmmott::MonitorTool::CLI;
+using namespace FredEmmott::MonitorTool::Config;
+using namespace FredEmmott::MonitorTool;
+
+namespace {
+
+#ifndef _WIN32
+// There are no window messages to wait for
+constexpr std::chrono::milliseconds DefaultPollInterval {1000};
+#endif
+
+std::string GetHelpText() {
+  return std::format(
+    "Freds Monitor Tool v{}\n"
+    "\n"
+    "USAGE:\n"
+    "  fmt-auto-apply [--rules PATH] [--poll MILLISECONDS]\n"
+    "  fmt-auto-apply --print-fingerprint\n"
+    "  fmt-auto-apply --help\n"
+    "\n"
+    "Applies a profile whenever displays are connected or removed, using the\n"
+    "first matching rule in the rules file. Runs until it is terminated.\n"
+    "\n"
+    "OPTIONS:\n"
+    "  --rules: the rules file; defaults to Rules.json in the data folder\n"
+    "  --poll: check for changes this often, instead of waiting for window\n"
+    "    messages; required on platforms other than Windows, where it\n"
+    "    defaults to 1000\n"
+    "  --print-fingerprint: show the fingerprint of the connected displays,\n"
+    "    for use in the rules file\n"
+    "  --trace PATH: write a Chrome trace of this run to PATH\n"
+    "  --help: show this text\n"
+    "---\n"
+    "{}",
+    VersionString,
+    LicenseText);
+}
+
+void PrintResult(const TopologyRulesEngineResult& result) {
+  const auto fingerprint = result.mTopology.GetFingerprintString();
+  const auto latency
+    = std::chrono::duration_cast<std::chrono::milliseconds>(result.mLatency);
+  if (!result.mRule) {
+    PrintCOUT(std::format(
+      "No rule matches topology {}; {}ms", fingerprint, latency.count()));
+    return;
+  }
+  const auto& name = result.mRule->mProfileName;
+  if (result.mApplyResult) {
+    PrintCOUT(std::format(
+      "{} '{}' for topology {}; {}ms",
+      result.mApplyResult->mChanged ? "Applied" : "Already using",
+      name,
+      fingerprint,
+      latency.count()));
+    return;
+  }
+  PrintCOUT(std::format(
+    "Failed to apply '{}' for topology {}: {}",
+    name,
+    fingerprint,
+    result.mError));
+}
+
+}// namespace
+
+namespace FredEmmott::MonitorTool::CLI {
+
+int AutoApplyMain(int argc, wchar_t** argv) {
+  std::filesystem::path rulesPath;
+  std::optional<std::chrono::milliseconds> pollInterval;
+
+  for (int i = 1; i < argc; ++i) {
+    const std::wstring_view arg {argv[i]};
+    if (arg == L"--help") {
+      PrintCOUT(GetHelpText());
+      return 0;
+    }
+    if (arg == L"--print-fingerprint") {
+      try {
+        PrintCOUT(Topology::GetCurrent().GetFingerprintString());
+      } catch (const RuntimeError& e) {
+        PrintCERR(std::format("Fatal error: {}", e.what()).c_str());
+        return 1;
+      }
+      return 0;
+    }
+    if (arg == L"--rules" && i + 1 < argc) {
+      rulesPath = argv[++i];
+      continue;
+    }
+    if (arg == L"--poll" && i + 1 < argc) {
+      const auto value = winrt::to_string(argv[++i]);
+      uint32_t milliseconds {};
+      const auto end = value.data() + value.size();
+      const auto [ptr, ec] = std::from_chars(value.data(), end, milliseconds);
+      if (ec != std::errc {} || ptr != end || milliseconds == 0) {
+        PrintCERR(GetHelpText());
+        return 1;
+      }
+      pollInterval = std::chrono::milliseconds {milliseconds};
+      continue;
+    }
+    if (arg == L"--trace" && i + 1 < argc) {
+      if (!TryStartTracing(argv[++i])) {
+        return 1;
+      }
+      continue;
+    }
+
+    PrintCERR(GetHelpText());
+    return 1;
+  }
+
+  if (rulesPath.empty()) {
+    rulesPath = TopologyRules::GetDefaultPath();
+  }
+
+  try {
+    std::unique_ptr<TopologyEventSource> events;
+    if (pollInterval) {
+      events = std::make_unique<PollingTopologyEventSource>(*pollInterval);
+    } else {
+#ifdef _WIN32
+      events = std::make_unique<WindowMessageTopologyEventSource>();
+#else
+      events
+        = std::make_unique<PollingTopologyEventSource>(DefaultPollInterval);
+#endif
+    }
+
+    TopologyRulesEngine engine {
+      TopologyRules::Load(rulesPath), std::move(events), &PrintResult};
+    engine.Run();
+  } catch (const RuntimeError& e) {
+    PrintCERR(std::format("Fatal error: {}", e.what()).c_str());
+    return 1;
+  }
+}
+
+}// namespace FredEmmott::MonitorTool::CLI
@@ -0,0 +1,147 @@
+// Copyright 2024, Fred Emmott
+// SPDX-License-Identifier: ISC
+
+#include "commands.hpp"
+#include "console.hpp"
+
+#include <FredEmmott/MonitorTool/Config.hpp>
+#include <FredEmmott/MonitorTool/ProfileCheck.hpp>
+#include <FredEmmott/MonitorTool/except.hpp>
+#include <FredEmmott/MonitorTool/json.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <format>
+
+#include <Windows.h>
+
+using namespace FredEmmott::MonitorTool::CLI;
+using namespace FredEmmott::MonitorTool::Config;
+using namespace FredEmmott::MonitorTool;
+
+namespace {
+std::string GetHelpText() {
+  return std::format(
+    "Freds Monitor Tool v{}\n"
+    "\n"
+    "USAGE:\n"
+    "  fmt-check-profiles [--json]\n"
+    "  fmt-check-profiles --help\n"
+    "\n"
+    "Checks whether each saved profile can still be applied, e.g. after a\n"
+    "driver update, without applying any of them. Exits with status 1 if any\n"
+    "profile is invalid or can't be loaded.\n"
+    "\n"
+    "OPTIONS:\n"
+    "  --json: print the report as JSON instead of a table\n"
+    "  --trace PATH: write a Chrome trace of this run to PATH\n"
+    "  --help: show this text\n"
+    "---\n"
+    "{}",
+    VersionString,
+    LicenseText);
+}
+
+int64_t GetMilliseconds(const ProfileCheckResult& result) {
+  return std::chrono::duration_cast<std::chrono::milliseconds>(
+           result.mDuration)
+    .count();
+}
+
+std::string FormatJSON(const std::vector<ProfileCheckResult>& results) {
+  auto profiles = nlohmann::json::array();
+  for (const auto& it: results) {
+    profiles.push_back({
+      {"Name", it.mName},
+      {"GUID", it.mGuid},
+      {"Status", ToString(it.mStatus)},
+      {"Reason", it.mReason},
+      {"Active", it.mActive},
+      {"Milliseconds", GetMilliseconds(it)},
+    });
+  }
+  return nlohmann::json {{"Profiles", std::move(profiles)}}.dump(2);
+}
+
+std::string FormatTable(const std::vector<ProfileCheckResult>& results) {
+  if (results.empty()) {
+    return "No profiles have been saved yet.";
+  }
+
+  std::size_t nameWidth = std::string_view {"Name"}.size();
+  std::size_t statusWidth = std::string_view {"Status"}.size();
+  for (const auto& it: results) {
+    nameWidth = std::max(nameWidth, it.mName.size());
+    statusWidth = std::max(statusWidth, ToString(it.mStatus).size());
+  }
+
+  auto ret = std::format(
+    "{:<{}}  {:<{}}  {:>6}  {}",
+    "Name",
+    nameWidth,
+    "Status",
+    statusWidth,
+    "Time",
+    "Details");
+  for (const auto& it: results) {
+    auto details = it.mReason;
+    if (it.mActive) {
+      details = details.empty() ? "active" : std::format("active; {}", details);
+    }
+    ret += std::format(
+      "\n{:<{}}  {:<{}}  {:>4}ms  {}",
+      it.mName,
+      nameWidth,
+      ToString(it.mStatus),
+      statusWidth,
+      GetMilliseconds(it),
+      details);
+  }
+  return ret;
+}
+
+}// namespace
+
+namespace FredEmmott::MonitorTool::CLI {
+
+int CheckProfilesMain(int argc, wchar_t** argv) {
+  bool json = false;
+  for (int i = 1; i < argc; ++i) {
+    const std::wstring_view arg {argv[i]};
+    if (arg == L"--help") {
+      PrintCOUT(GetHelpText());
+      return 0;
+    }
+    if (arg == L"--json") {
+      json = true;
+      continue;
+    }
+    if (arg == L"--trace" && i + 1 < argc) {
+      if (!TryStartTracing(argv[++i])) {
+        return 1;
+      }
+      continue;
+    }
+
+    PrintCERR(GetHelpText());
+    return 1;
+  }
+
+  std::vector<ProfileCheckResult> results;
+  try {
+    results = CheckProfiles();
+  } catch (const RuntimeError& e) {
+    PrintCERR(std::format("Fatal error: {}", e.what()));
+    return 1;
+  }
+
+  PrintCOUT(json ? FormatJSON(results) : FormatTable(results));
+
+  const auto failed = std::ranges::any_of(results, [](const auto& it) {
+    return it.mStatus == ProfileCheckResult::Status::Invalid
+      || it.mStatus == ProfileCheckResult::Status::Error;
+  });
+  return failed ? 1 : 0;
+}
+
+}// namespace FredEmmott::MonitorTool::CLI
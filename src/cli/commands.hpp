@@ -0,0 +1,24 @@
+// Copyright 2024, Fred Emmott
+// SPDX-License-Identifier: ISC
+#pragma once
+
+namespace FredEmmott::MonitorTool::CLI {
+
+/** The tools, which are all in `fmt.exe`.
+ *
+ * `argv[0]` is the tool's name, e.g. `fmt-apply-profile` or `apply-profile`,
+ * and the options follow it.
+ */
+using CommandMain = int (*)(int argc, wchar_t** argv);
+
+int ApplyProfileMain(int argc, wchar_t** argv);
+int AutoApplyMain(int argc, wchar_t** argv);
+int CheckProfilesMain(int argc, wchar_t** argv);
+int CreateProfileMain(int argc, wchar_t** argv);
+int CurrentProfileMain(int argc, wchar_t** argv);
+int ListProfilesMain(int argc, wchar_t** argv);
+int RunMain(int argc, wchar_t** argv);
+int ServiceMain(int argc, wchar_t** argv);
+int StatsMain(int argc, wchar_t** argv);
+
+}// namespace FredEmmott::MonitorTool::CLI
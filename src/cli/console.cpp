@@ -3,8 +3,13 @@
 
 #include "console.hpp"
 
+#include <FredEmmott/MonitorTool/Trace.hpp>
+
+#include <mutex>
+
 namespace FredEmmott::MonitorTool::CLI {
 
+#ifdef _WIN32
 bool AttachToParentConsole() {
   static bool sAttached;
   static std::once_flag sOnce;
@@ -28,5 +33,24 @@ bool HaveConsole() {
   });
   return sHaveConsole;
 }
+#else
+bool AttachToParentConsole() {
+  return true;
+}
+
+bool HaveConsole() {
+  return true;
+}
+#endif
+
+bool TryStartTracing(const std::filesystem::path& path) {
+  try {
+    StartTracing(path);
+    return true;
+  } catch (const TraceFileError& e) {
+    PrintCERR(std::format("Fatal error: {}", e.what()));
+    return false;
+  }
+}
 
 }
\ No newline at end of file
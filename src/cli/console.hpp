@@ -4,20 +4,31 @@
 
 #include <FredEmmott/MonitorTool/Config.hpp>
 
+#include <filesystem>
 #include <format>
 #include <iostream>
 
+#ifdef _WIN32
 #include <Windows.h>
+#endif
 
 namespace FredEmmott::MonitorTool::CLI {
 
 bool AttachToParentConsole();
+/// Always true on other platforms, as there's no GUI subsystem
 bool HaveConsole();
 
+/** Handle `--trace PATH`, which every tool supports.
+ *
+ * Returns false after printing an error if the trace file can't be created.
+ */
+bool TryStartTracing(const std::filesystem::path& path);
+
 void PrintCERR(auto message) {
   if (HaveConsole()) {
     std::cerr << message << std::endl;
   } else {
+#ifdef _WIN32
     const std::string buf {message};
     OutputDebugStringA(buf.c_str());
     MessageBoxA(
@@ -25,6 +36,7 @@ void PrintCERR(auto message) {
       buf.c_str(),
       std::format("Freds Monitor Tool v{}", Config::VersionString).c_str(),
       MB_ICONERROR | MB_OK);
+#endif
   }
 }
 
@@ -32,7 +44,9 @@ void PrintCOUT(auto message) {
   if (HaveConsole()) {
     std::cout << message << std::endl;
   } else {
+#ifdef _WIN32
     OutputDebugStringA(std::string(message).c_str());
+#endif
   }
 }
 
@@ -1,6 +1,7 @@
 // Copyright 2024, Fred Emmott
 // SPDX-License-Identifier: ISC
 
+#include "commands.hpp"
 #include "console.hpp"
 
 #include <FredEmmott/MonitorTool/Config.hpp>
@@ -19,37 +20,35 @@ using namespace FredEmmott::MonitorTool::Config;
 
 namespace {
 
-const auto HelpText = std::format(
-  "Freds Monitor Tool v{}\n"
-  "\n"
-  "USAGE: \n"
-  "  fmt-create-profile PROFILE_NAME [--path PATH] [--force]\n"
-  "  fmt-create-profile --help\n"
-  "\n"
-  "---\n"
-  "{}",
-  VersionString,
-  LicenseText);
+std::string GetHelpText() {
+  return std::format(
+    "Freds Monitor Tool v{}\n"
+    "\n"
+    "USAGE: \n"
+    "  fmt-create-profile PROFILE_NAME [--path PATH] [--force]\n"
+    "  fmt-create-profile --help\n"
+    "\n"
+    "OPTIONS:\n"
+    "  --trace PATH: write a Chrome trace of this run to PATH\n"
+    "\n"
+    "---\n"
+    "{}",
+    VersionString,
+    LicenseText);
+}
 
 void HelpCERR() {
-  PrintCERR(HelpText);
+  PrintCERR(GetHelpText());
 }
 
 void HelpCOUT() {
-  PrintCOUT(HelpText);
+  PrintCOUT(GetHelpText());
 }
 }// namespace
 
-int WINAPI wWinMain(
-  [[maybe_unused]] HINSTANCE hInstance,
-  [[maybe_unused]] HINSTANCE hPrevInstance,
-  [[maybe_unused]] PWSTR pCmdLine,
-  [[maybe_unused]] int nCmdShow) {
-  // Using `GetCommandLineW()` instead of `pCmdLine` as `pCmdLine` varies in
-  // whether or not argv[0] is the process, depending on how it's launched.
-  int argc {};
-  const auto argv = CommandLineToArgvW(GetCommandLineW(), &argc);
+namespace FredEmmott::MonitorTool::CLI {
 
+int CreateProfileMain(int argc, wchar_t** argv) {
   bool force = false;
   std::wstring_view profilePath;
   std::string profileName;
@@ -73,7 +72,17 @@ int WINAPI wWinMain(
         profilePath = {argv[++i]};
         continue;
       }
-      PrintCERR(HelpText);
+      if (arg == L"--trace") {
+        if (i + 1 >= argc) {
+          HelpCERR();
+          return 1;
+        }
+        if (!TryStartTracing(argv[++i])) {
+          return 1;
+        }
+        continue;
+      }
+      PrintCERR(GetHelpText());
       return 1;
     }
 
@@ -83,7 +92,7 @@ int WINAPI wWinMain(
         "First: {}\nNext: {}\n{}",
         profileName,
         winrt::to_string(arg),
-        HelpText));
+        GetHelpText()));
       return 1;
     }
     profileName = winrt::to_string(arg);
@@ -91,14 +100,14 @@ int WINAPI wWinMain(
 
   if (profileName.empty()) {
     PrintCERR(
-      std::format("Profile name was empty or not provided\n{}", HelpText));
+      std::format("Profile name was empty or not provided\n{}", GetHelpText()));
     return 1;
   }
 
   try {
     using Profile = FredEmmott::MonitorTool::Profile;
     if (!force) {
-      const auto profiles = Profile::Enumerate();
+      const auto profiles = Profile::EnumerateSummaries();
       const auto it
         = std::ranges::find_if(profiles, [&a = profileName](const auto& b) {
             return _stricmp(a.c_str(), b.mName.c_str()) == 0;
@@ -111,21 +120,22 @@ int WINAPI wWinMain(
             "`--force` to create a duplicate.",
             it->mName));
           return 1;
-        } else {
-          const auto result = MessageBoxA(
-            NULL,
-            std::format(
-              "A similarly named profile already exists (`{})`; Would you like "
-              "to create this profile anyway?\nRe-run with `--force` to skip "
-              "this message in the future.",
-              it->mName)
-              .c_str(),
-            std::format("Freds Monitor Tool v{}", VersionString).c_str(),
-            MB_ICONWARNING | MB_YESNO);
-          if (result != IDYES) {
-            return 0;
-          }
         }
+#ifdef _WIN32
+        const auto result = MessageBoxA(
+          NULL,
+          std::format(
+            "A similarly named profile already exists (`{})`; Would you like "
+            "to create this profile anyway?\nRe-run with `--force` to skip "
+            "this message in the future.",
+            it->mName)
+            .c_str(),
+          std::format("Freds Monitor Tool v{}", VersionString).c_str(),
+          MB_ICONWARNING | MB_YESNO);
+        if (result != IDYES) {
+          return 0;
+        }
+#endif
       }
     }
 
@@ -141,4 +151,6 @@ int WINAPI wWinMain(
   }
 
   return 0;
-}
\ No newline at end of file
+}
+
+}// namespace FredEmmott::MonitorTool::CLI
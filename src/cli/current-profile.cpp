@@ -0,0 +1,124 @@
+// Copyright 2024, Fred Emmott
+// SPDX-License-Identifier: ISC
+
+#include "commands.hpp"
+#include "console.hpp"
+
+#include <FredEmmott/MonitorTool/ActiveProfile.hpp>
+#include <FredEmmott/MonitorTool/Config.hpp>
+#include <FredEmmott/MonitorTool/QueryDisplayConfig.hpp>
+#include <FredEmmott/MonitorTool/Service.hpp>
+#include <FredEmmott/MonitorTool/json.hpp>
+
+#include <format>
+
+#include <Windows.h>
+
+using namespace FredEmmott::MonitorTool::CLI;
+using namespace FredEmmott::MonitorTool::Config;
+using namespace FredEmmott::MonitorTool;
+
+namespace {
+std::string GetHelpText() {
+  return std::format(
+    "Freds Monitor Tool v{}\n"
+    "\n"
+    "USAGE: \n"
+    "  fmt-current-profile [--fingerprint] [--help]\n"
+    "\n"
+    "Shows the saved profiles matching the active display configuration;\n"
+    "exits with status 1 if there are none.\n"
+    "\n"
+    "OPTIONS:\n"
+    "  --fingerprint: also show the active configuration's fingerprint\n"
+    "  --trace PATH: write a Chrome trace of this run to PATH\n"
+    "  --help: show this text\n"
+    "---\n"
+    "{}",
+    VersionString,
+    LicenseText);
+}
+
+struct ActiveProfiles {
+  std::string mFingerprint;
+  std::vector<ProfileSummary> mProfiles;
+};
+
+/// Uses `fmt-service` if it's running
+ActiveProfiles GetActiveProfiles() {
+  const auto response = SendServiceRequest({{"Command", "Current"}});
+  if (!response || response->value("Status", "") != "OK") {
+    const auto fingerprint = GetDisplayConfigFingerprint(QueryDisplayConfig());
+    return {
+      fingerprint.ToString(),
+      FindProfilesByFingerprint(fingerprint),
+    };
+  }
+
+  ActiveProfiles ret {response->value("Fingerprint", "")};
+  for (const auto& it: response->at("Profiles")) {
+    ret.mProfiles.push_back({
+      .mName = it.at("Name").get<std::string>(),
+      .mGuid = it.at("GUID").get<winrt::guid>(),
+    });
+  }
+  return ret;
+}
+
+}// namespace
+
+namespace FredEmmott::MonitorTool::CLI {
+
+int CurrentProfileMain(int argc, wchar_t** argv) {
+  bool showFingerprint = false;
+  for (int i = 1; i < argc; ++i) {
+    const std::wstring_view arg {argv[i]};
+    if (arg == L"--help") {
+      PrintCOUT(GetHelpText());
+      return 0;
+    }
+    if (arg == L"--fingerprint") {
+      showFingerprint = true;
+      continue;
+    }
+    if (arg == L"--trace" && i + 1 < argc) {
+      if (!TryStartTracing(argv[++i])) {
+        return 1;
+      }
+      continue;
+    }
+
+    PrintCERR(GetHelpText());
+    return 1;
+  }
+
+  ActiveProfiles active;
+  try {
+    active = GetActiveProfiles();
+  } catch (const RuntimeError& e) {
+    PrintCERR(std::format("Fatal error: {}", e.what()));
+    return 1;
+  }
+
+  std::string message;
+  if (showFingerprint) {
+    message = std::format("Fingerprint: {}\n", active.mFingerprint);
+  }
+  if (active.mProfiles.empty()) {
+    message += "No saved profile matches the active configuration.";
+    PrintCOUT(message);
+    return 1;
+  }
+
+  message += "Active profile:";
+  for (const auto& profile: active.mProfiles) {
+    message += std::format(
+      "\n- '{}'\t{}",
+      profile.mName,
+      winrt::to_string(winrt::to_hstring(profile.mGuid)));
+  }
+  PrintCOUT(message);
+  return 0;
+}
+
+}// namespace FredEmmott::MonitorTool::CLI
@@ -0,0 +1,216 @@
+// Copyright 2024, Fred Emmott
+// SPDX-License-Identifier: ISC
+
+#include "commands.hpp"
+#include "console.hpp"
+
+#include <FredEmmott/MonitorTool/Config.hpp>
+#include <winrt/base.h>
+
+#include <filesystem>
+#include <format>
+#include <string>
+#include <string_view>
+
+#ifdef _WIN32
+#include <Windows.h>
+#include <string.h>
+#else
+#include <FredEmmott/MonitorTool/DisplayRecording.hpp>
+#include <FredEmmott/MonitorTool/SimulatedDisplayBackend.hpp>
+
+#include <cstdlib>
+#include <memory>
+#include <vector>
+#endif
+
+using namespace FredEmmott::MonitorTool::CLI;
+using namespace FredEmmott::MonitorTool::Config;
+using namespace FredEmmott::MonitorTool;
+
+namespace {
+
+struct Command {
+  std::wstring_view mName;
+  std::string_view mDescription;
+  CommandMain mMain;
+};
+
+// Constant-initialized, so nothing runs before `wWinMain()` or `main()`
+constexpr Command Commands[] {
+  {
+    L"apply-profile",
+    "apply a saved profile",
+    &ApplyProfileMain,
+  },
+  {
+    L"auto-apply",
+    "apply profiles when displays are connected or removed",
+    &AutoApplyMain,
+  },
+  {
+    L"check-profiles",
+    "check which profiles can be applied, without applying them",
+    &CheckProfilesMain,
+  },
+  {
+    L"create-profile",
+    "save the active display configuration as a profile",
+    &CreateProfileMain,
+  },
+  {
+    L"current-profile",
+    "show the profiles matching the active display configuration",
+    &CurrentProfileMain,
+  },
+  {
+    L"list-profiles",
+    "list the saved profiles",
+    &ListProfilesMain,
+  },
+  {
+    L"run",
+    "run a script of commands in a single process",
+    &RunMain,
+  },
+  {
+    L"service",
+    "keep the profiles loaded, so the other commands are faster",
+    &ServiceMain,
+  },
+  {
+    L"stats",
+    "show how long each profile has taken to apply",
+    &StatsMain,
+  },
+};
+
+std::string GetHelpText() {
+  std::string commands;
+  for (const auto& command: Commands) {
+    commands += std::format(
+      "  {}: {}\n", winrt::to_string(command.mName), command.mDescription);
+  }
+  return std::format(
+    "Freds Monitor Tool v{}\n"
+    "\n"
+    "USAGE:\n"
+    "  fmt COMMAND [OPTIONS...]\n"
+    "  fmt COMMAND --help\n"
+    "  fmt --help\n"
+    "\n"
+    "Each command can also be run as fmt-COMMAND, e.g. fmt-apply-profile.\n"
+    "\n"
+    "COMMANDS:\n"
+    "{}"
+#ifndef _WIN32
+    "\n"
+    "ENVIRONMENT:\n"
+    "  FMT_DISPLAY_RECORDING: replay this recording, e.g. from\n"
+    "    `fmt apply-profile --record`, instead of simulating a system with\n"
+    "    two displays\n"
+#endif
+    "---\n"
+    "{}",
+    VersionString,
+    commands,
+    LicenseText);
+}
+
+bool IsSameName(std::wstring_view a, std::wstring_view b) {
+  return a.size() == b.size() && _wcsnicmp(a.data(), b.data(), a.size()) == 0;
+}
+
+const Command* FindCommand(std::wstring_view name) {
+  for (const auto& command: Commands) {
+    if (IsSameName(command.mName, name)) {
+      return &command;
+    }
+  }
+  return nullptr;
+}
+
+#ifndef _WIN32
+/// There's no display API to call, so simulate or replay one
+void SetDefaultDisplayBackend() {
+  if (const auto path = std::getenv("FMT_DISPLAY_RECORDING"); path && *path) {
+    SetDisplayBackend(std::make_shared<ReplayDisplayBackend>(
+      std::make_shared<const DisplayRecording>(DisplayRecording::Load(path)),
+      ReplayTiming::Recorded));
+    return;
+  }
+  SetDisplayBackend(
+    std::make_shared<SimulatedDisplayBackend>(SimulatedDisplayOptions {}));
+}
+#endif
+
+int Main(int argc, wchar_t** argv) {
+  // `fmt-apply-profile.exe` and friends are links to this executable
+  constexpr std::wstring_view prefix {L"fmt-"};
+  const auto stem = std::filesystem::path {argv[0]}.stem().wstring();
+  const std::wstring_view program {stem};
+  if (
+    program.size() > prefix.size()
+    && IsSameName(program.substr(0, prefix.size()), prefix)) {
+    if (const auto command = FindCommand(program.substr(prefix.size()))) {
+      return command->mMain(argc, argv);
+    }
+  }
+
+  if (argc < 2) {
+    PrintCERR(GetHelpText());
+    return 1;
+  }
+
+  const std::wstring_view name {argv[1]};
+  if (name == L"--help" || name == L"help") {
+    PrintCOUT(GetHelpText());
+    return 0;
+  }
+  if (const auto command = FindCommand(name)) {
+    return command->mMain(argc - 1, argv + 1);
+  }
+
+  PrintCERR(std::format(
+    "Unknown command '{}'\n{}", winrt::to_string(name), GetHelpText()));
+  return 1;
+}
+
+}// namespace
+
+#ifdef _WIN32
+int WINAPI wWinMain(
+  [[maybe_unused]] HINSTANCE hInstance,
+  [[maybe_unused]] HINSTANCE hPrevInstance,
+  [[maybe_unused]] PWSTR pCmdLine,
+  [[maybe_unused]] int nCmdShow) {
+  // Using `GetCommandLineW()` instead of `pCmdLine` as `pCmdLine` varies in
+  // whether or not argv[0] is the process, depending on how it's launched.
+  int argc {};
+  const auto argv = CommandLineToArgvW(GetCommandLineW(), &argc);
+  return Main(argc, argv);
+}
+#else
+int main(int argc, char** argv) {
+  // The tools take UTF-32 `wchar_t` arguments, as they're UTF-16 on Windows
+  std::vector<std::wstring> args;
+  args.reserve(argc);
+  for (int i = 0; i < argc; ++i) {
+    args.emplace_back(winrt::to_hstring(argv[i]));
+  }
+  std::vector<wchar_t*> wideArgv;
+  wideArgv.reserve(argc + 1);
+  for (auto& arg: args) {
+    wideArgv.push_back(arg.data());
+  }
+  wideArgv.push_back(nullptr);
+
+  try {
+    SetDefaultDisplayBackend();
+  } catch (const RuntimeError& e) {
+    PrintCERR(std::format("Fatal error: {}", e.what()));
+    return 1;
+  }
+  return Main(argc, wideArgv.data());
+}
+#endif
@@ -1,10 +1,13 @@
 // Copyright 2024, Fred Emmott
 // SPDX-License-Identifier: ISC
 
+#include "commands.hpp"
 #include "console.hpp"
 
 #include <FredEmmott/MonitorTool/Config.hpp>
 #include <FredEmmott/MonitorTool/Profile.hpp>
+#include <FredEmmott/MonitorTool/Service.hpp>
+#include <FredEmmott/MonitorTool/json.hpp>
 
 #include <format>
 
@@ -14,41 +17,67 @@ using namespace FredEmmott::MonitorTool::CLI;
 using namespace FredEmmott::MonitorTool::Config;
 
 namespace {
-const auto HelpText = std::format(
-  "Freds Monitor Tool v{}\n"
-  "\n"
-  "USAGE: \n"
-  "  fmt-list-profiles [--help]\n"
-  "\n"
-  "---\n"
-  "{}",
-  VersionString,
-  LicenseText);
+std::string GetHelpText() {
+  return std::format(
+    "Freds Monitor Tool v{}\n"
+    "\n"
+    "USAGE: \n"
+    "  fmt-list-profiles [--help]\n"
+    "\n"
+    "OPTIONS:\n"
+    "  --trace PATH: write a Chrome trace of this run to PATH\n"
+    "\n"
+    "---\n"
+    "{}",
+    VersionString,
+    LicenseText);
+}
+
+/// Uses `fmt-service` if it's running
+std::vector<FredEmmott::MonitorTool::ProfileSummary> GetProfiles() {
+  using namespace FredEmmott::MonitorTool;
+  const auto response = SendServiceRequest({{"Command", "List"}});
+  if (!response || response->value("Status", "") != "OK") {
+    return Profile::EnumerateSummaries();
+  }
+
+  std::vector<ProfileSummary> ret;
+  for (const auto& it: response->at("Profiles")) {
+    ret.push_back({
+      .mName = it.at("Name").get<std::string>(),
+      .mGuid = it.at("GUID").get<winrt::guid>(),
+    });
+  }
+  return ret;
+}
 
 }// namespace
 
-int WINAPI wWinMain(
-  [[maybe_unused]] HINSTANCE hInstance,
-  [[maybe_unused]] HINSTANCE hPrevInstance,
-  [[maybe_unused]] PWSTR pCmdLine,
-  [[maybe_unused]] int nCmdShow) {
-  // Using `GetCommandLineW()` instead of `pCmdLine` as `pCmdLine` varies in
-  // whether or not argv[0] is the process, depending on how it's launched.
-  int argc {};
-  const auto argv = CommandLineToArgvW(GetCommandLineW(), &argc);
+namespace FredEmmott::MonitorTool::CLI {
 
+int ListProfilesMain(int argc, wchar_t** argv) {
   for (int i = 1; i < argc; ++i) {
     const std::wstring_view arg {argv[i]};
     if (arg == L"--help") {
-      PrintCOUT(HelpText);
+      PrintCOUT(GetHelpText());
       return 0;
     }
+    if (arg == L"--trace") {
+      if (i + 1 >= argc) {
+        PrintCERR(GetHelpText());
+        return 1;
+      }
+      if (!TryStartTracing(argv[++i])) {
+        return 1;
+      }
+      continue;
+    }
 
-    PrintCERR(HelpText);
+    PrintCERR(GetHelpText());
     return 1;
   }
 
-  const auto profiles = FredEmmott::MonitorTool::Profile::Enumerate();
+  const auto profiles = GetProfiles();
   std::string message;
   if (profiles.empty()) {
     message = "No profiles have been saved yet.";
@@ -64,12 +93,16 @@ int WINAPI wWinMain(
 
   if (HaveConsole()) {
     std::cout << message << std::endl;
-  } else {
-    MessageBoxA(
-      NULL,
-      message.c_str(),
-      std::format("Freds Monitor Tool v{}", VersionString).c_str(),
-      MB_OK | MB_ICONINFORMATION);
+    return 0;
   }
+#ifdef _WIN32
+  MessageBoxA(
+    NULL,
+    message.c_str(),
+    std::format("Freds Monitor Tool v{}", VersionString).c_str(),
+    MB_OK | MB_ICONINFORMATION);
+#endif
   return 0;
-}
\ No newline at end of file
+}
+
+}// namespace FredEmmott::MonitorTool::CLI
@@ -0,0 +1,392 @@
+// Copyright 2024, Fred Emmott
+// SPDX-License-Identifier: ISC
+
+#include "commands.hpp"
+#include "console.hpp"
+
+#include <FredEmmott/MonitorTool/ApplyProfile.hpp>
+#include <FredEmmott/MonitorTool/Config.hpp>
+#include <FredEmmott/MonitorTool/Profile.hpp>
+#include <FredEmmott/MonitorTool/ProfileStoreWatcher.hpp>
+#include <FredEmmott/MonitorTool/except.hpp>
+#include <winrt/base.h>
+
+#include <charconv>
+#include <chrono>
+#include <filesystem>
+#include <format>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#include <Windows.h>
+
+using namespace FredEmmott::MonitorTool::CLI;
+using namespace FredEmmott::MonitorTool::Config;
+using namespace FredEmmott::MonitorTool;
+
+namespace {
+
+std::string GetHelpText() {
+  return std::format(
+    "Freds Monitor Tool v{}\n"
+    "\n"
+    "USAGE:\n"
+    "  fmt run [--keep-going] [SCRIPT]\n"
+    "  fmt run --help\n"
+    "\n"
+    "Runs a script of commands in a single process, reusing the loaded\n"
+    "profiles and the graphics adapter list between them, and shows how long\n"
+    "each command took. The script is read from standard input if SCRIPT is\n"
+    "'-' or not given.\n"
+    "\n"
+    "SCRIPT COMMANDS:\n"
+    "  apply [--temporary] [--update] PROFILE_NAME\n"
+    "  create [--force] PROFILE_NAME\n"
+    "  list\n"
+    "  wait DURATION: e.g. 2s or 500ms; seconds if there's no unit\n"
+    "\n"
+    "One command per line, with the same options as the fmt-* tools, and the\n"
+    "same quoting as the command prompt. Blank lines and lines starting with\n"
+    "# are ignored.\n"
+    "\n"
+    "OPTIONS:\n"
+    "  --keep-going: run the rest of the script after a command fails; the\n"
+    "    exit code is still 1\n"
+    "  --trace PATH: write a Chrome trace of this run to PATH\n"
+    "  --help: show this text\n"
+    "---\n"
+    "{}",
+    VersionString,
+    LicenseText);
+}
+
+using Clock = std::chrono::steady_clock;
+
+class ScriptError final : public RuntimeError {
+ public:
+  using RuntimeError::RuntimeError;
+};
+
+std::string FormatDuration(Clock::duration duration) {
+  return std::format(
+    "{:.1f}ms", std::chrono::duration<double, std::milli>(duration).count());
+}
+
+/// Split a script line like a command line, with the command first
+std::vector<std::string> SplitLine(std::string_view line) {
+  // `CommandLineToArgvW()` parses the first argument as a program path
+  const auto commandLine = L"fmt " + std::wstring {winrt::to_hstring(line)};
+  int argc {};
+  const auto argv = CommandLineToArgvW(commandLine.c_str(), &argc);
+  if (!argv) {
+    throw ScriptError("Couldn't split the line into arguments");
+  }
+  std::vector<std::string> ret;
+  for (int i = 1; i < argc; ++i) {
+    ret.push_back(winrt::to_string(argv[i]));
+  }
+  LocalFree(argv);
+  return ret;
+}
+
+std::optional<std::chrono::milliseconds> ParseDuration(std::string_view arg) {
+  uint32_t value {};
+  const auto end = arg.data() + arg.size();
+  const auto [ptr, ec] = std::from_chars(arg.data(), end, value);
+  if (ec != std::errc {}) {
+    return {};
+  }
+  const std::string_view unit {ptr, end};
+  if (unit.empty() || unit == "s") {
+    return std::chrono::seconds {value};
+  }
+  if (unit == "ms") {
+    return std::chrono::milliseconds {value};
+  }
+  return {};
+}
+
+/** Runs script commands, keeping what they load for the next one.
+ *
+ * Profiles are loaded when first needed, then kept up to date by a
+ * `ProfileStoreWatcher`, as in `fmt-service`.
+ */
+class ScriptRunner final {
+ public:
+  /// Throws `RuntimeError` if the command fails
+  void Run(const std::vector<std::string>& args);
+
+ private:
+  ApplySession mApplySession;
+  std::unique_ptr<ProfileStoreWatcher> mWatcher;
+  /// Created by this script; the watcher may not have seen them yet
+  ProfileStoreSnapshot mCreated;
+
+  std::shared_ptr<const ProfileStoreSnapshot> GetSnapshot();
+  std::optional<Profile> FindByName(std::string_view name);
+
+  void Apply(const std::vector<std::string>& args);
+  void Create(const std::vector<std::string>& args);
+  void List(const std::vector<std::string>& args);
+  void Wait(const std::vector<std::string>& args);
+};
+
+void ScriptRunner::Run(const std::vector<std::string>& args) {
+  if (args.empty()) {
+    throw ScriptError("No command provided");
+  }
+  const auto& command = args.front();
+  if (command == "apply") {
+    this->Apply(args);
+  } else if (command == "create") {
+    this->Create(args);
+  } else if (command == "list") {
+    this->List(args);
+  } else if (command == "wait") {
+    this->Wait(args);
+  } else {
+    throw ScriptError(std::format("Unknown command '{}'", command));
+  }
+}
+
+std::shared_ptr<const ProfileStoreSnapshot> ScriptRunner::GetSnapshot() {
+  if (!mWatcher) {
+    mWatcher = std::make_unique<ProfileStoreWatcher>();
+  }
+  return mWatcher->GetSnapshot();
+}
+
+std::optional<Profile> ScriptRunner::FindByName(std::string_view name) {
+  if (const auto it = mCreated.FindByName(name)) {
+    return *it;
+  }
+  if (const auto it = this->GetSnapshot()->FindByName(name)) {
+    return *it;
+  }
+  return {};
+}
+
+void ScriptRunner::Apply(const std::vector<std::string>& args) {
+  auto applyMode = ApplyMode::Persistent;
+  bool saveUpdates = false;
+  std::string name;
+  for (std::size_t i = 1; i < args.size(); ++i) {
+    const auto& arg = args.at(i);
+    if (arg == "--temporary") {
+      applyMode = ApplyMode::Temporary;
+    } else if (arg == "--update") {
+      saveUpdates = true;
+    } else if (arg.starts_with("-") || !name.empty()) {
+      throw ScriptError(std::format("Unexpected argument '{}'", arg));
+    } else {
+      name = arg;
+    }
+  }
+  if (name.empty()) {
+    throw ScriptError("No profile name provided");
+  }
+
+  const auto profile = this->FindByName(name);
+  if (!profile) {
+    throw ScriptError(std::format("Couldn't find a profile called '{}'", name));
+  }
+
+  auto plan = mApplySession.Plan(*profile);
+  const auto result = ExecuteApplyPlan(plan, applyMode, saveUpdates);
+  if (!result) {
+    throw ScriptError(
+      "Profile can't be applied due to a configuration change");
+  }
+
+  std::string message = result->mChanged
+    ? "Applied profile; changed:"
+    : "Profile is already active; nothing to do";
+  for (const auto& it: result->mDifferences) {
+    message += std::format("\n- {}", it);
+  }
+  message += std::format(
+    "\nStrategy: {}{}; {} validation(s)",
+    ToString(plan.mStrategy),
+    plan.mFromCache ? " (cached)" : "",
+    plan.mValidationCount);
+  PrintCOUT(message);
+}
+
+void ScriptRunner::Create(const std::vector<std::string>& args) {
+  bool force = false;
+  std::string name;
+  for (std::size_t i = 1; i < args.size(); ++i) {
+    const auto& arg = args.at(i);
+    if (arg == "--force") {
+      force = true;
+    } else if (arg.starts_with("-") || !name.empty()) {
+      throw ScriptError(std::format("Unexpected argument '{}'", arg));
+    } else {
+      name = arg;
+    }
+  }
+  if (name.empty()) {
+    throw ScriptError("No profile name provided");
+  }
+
+  if (!force) {
+    if (const auto existing = this->FindByName(name)) {
+      throw ScriptError(std::format(
+        "A similarly named profile already exists (`{}`); use "
+        "`create --force` to create a duplicate.",
+        existing->mName));
+    }
+  }
+
+  auto profile = Profile::CreateFromActiveConfiguration(name);
+  profile.Save();
+  mCreated.mProfiles.push_back(std::move(profile));
+  PrintCOUT(std::format("Created profile '{}'", name));
+}
+
+void ScriptRunner::List(const std::vector<std::string>& args) {
+  if (args.size() != 1) {
+    throw ScriptError("`list` doesn't take any arguments");
+  }
+
+  const auto snapshot = this->GetSnapshot();
+  std::vector<const Profile*> profiles;
+  for (const auto& profile: snapshot->mProfiles) {
+    profiles.push_back(&profile);
+  }
+  for (const auto& profile: mCreated.mProfiles) {
+    if (!snapshot->FindByGUID(profile.mGuid)) {
+      profiles.push_back(&profile);
+    }
+  }
+
+  if (profiles.empty()) {
+    PrintCOUT("No profiles have been saved yet.");
+    return;
+  }
+  std::string message = "Profiles:";
+  for (const auto profile: profiles) {
+    message += std::format(
+      "\n- '{}'\t{}",
+      profile->mName,
+      winrt::to_string(winrt::to_hstring(profile->mGuid)));
+  }
+  PrintCOUT(message);
+}
+
+void ScriptRunner::Wait(const std::vector<std::string>& args) {
+  const auto duration
+    = (args.size() == 2) ? ParseDuration(args.at(1)) : std::nullopt;
+  if (!duration) {
+    throw ScriptError("`wait` takes a duration, e.g. 2s or 500ms");
+  }
+  std::this_thread::sleep_for(*duration);
+}
+
+/// Returns the exit code
+int RunScript(std::istream& script, bool keepGoing) {
+  ScriptRunner runner;
+  const auto scriptStart = Clock::now();
+  std::size_t lineNumber = 0;
+  std::size_t commandCount = 0;
+  std::size_t failureCount = 0;
+
+  std::string line;
+  while (std::getline(script, line)) {
+    ++lineNumber;
+    if (lineNumber == 1 && line.starts_with("\xef\xbb\xbf")) {
+      line.erase(0, 3);
+    }
+    if (line.ends_with('\r')) {
+      line.pop_back();
+    }
+    const auto first = line.find_first_not_of(" \t");
+    if (first == std::string::npos || line.at(first) == '#') {
+      continue;
+    }
+
+    ++commandCount;
+    const auto start = Clock::now();
+    try {
+      runner.Run(SplitLine(line));
+      PrintCOUT(std::format(
+        "line {}: `{}` took {}",
+        lineNumber,
+        line.substr(first),
+        FormatDuration(Clock::now() - start)));
+    } catch (const RuntimeError& e) {
+      ++failureCount;
+      PrintCERR(std::format(
+        "line {}: `{}` failed after {}: {}",
+        lineNumber,
+        line.substr(first),
+        FormatDuration(Clock::now() - start),
+        e.what()));
+      if (!keepGoing) {
+        return 1;
+      }
+    }
+  }
+
+  PrintCOUT(std::format(
+    "Ran {} command(s) in {}; {} failed",
+    commandCount,
+    FormatDuration(Clock::now() - scriptStart),
+    failureCount));
+  return (failureCount == 0) ? 0 : 1;
+}
+
+}// namespace
+
+namespace FredEmmott::MonitorTool::CLI {
+
+int RunMain(int argc, wchar_t** argv) {
+  bool keepGoing = false;
+  std::filesystem::path scriptPath;
+
+  for (int i = 1; i < argc; ++i) {
+    const std::wstring_view arg {argv[i]};
+    if (arg == L"--help") {
+      PrintCOUT(GetHelpText());
+      return 0;
+    }
+    if (arg == L"--keep-going") {
+      keepGoing = true;
+      continue;
+    }
+    if (arg == L"--trace") {
+      if (i + 1 >= argc) {
+        PrintCERR(GetHelpText());
+        return 1;
+      }
+      if (!TryStartTracing(argv[++i])) {
+        return 1;
+      }
+      continue;
+    }
+    if ((arg.starts_with(L"-") && arg != L"-") || !scriptPath.empty()) {
+      PrintCERR(GetHelpText());
+      return 1;
+    }
+    scriptPath = arg;
+  }
+
+  if (scriptPath.empty() || scriptPath == "-") {
+    return RunScript(std::cin, keepGoing);
+  }
+
+  std::ifstream script(scriptPath);
+  if (!script) {
+    PrintCERR(std::format("Couldn't open script '{}'", scriptPath.string()));
+    return 1;
+  }
+  return RunScript(script, keepGoing);
+}
+
+}// namespace FredEmmott::MonitorTool::CLI
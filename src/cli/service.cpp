@@ -0,0 +1,73 @@
+// Copyright 2024, Fred Emmott
+// SPDX-License-Identifier: ISC
+
+#include "commands.hpp"
+#include "console.hpp"
+
+#include <FredEmmott/MonitorTool/Config.hpp>
+#include <FredEmmott/MonitorTool/Service.hpp>
+#include <FredEmmott/MonitorTool/except.hpp>
+
+#include <format>
+
+#include <Windows.h>
+
+using namespace FredEmmott::MonitorTool::CLI;
+using namespace FredEmmott::MonitorTool::Config;
+using namespace FredEmmott::MonitorTool;
+
+namespace {
+std::string GetHelpText() {
+  return std::format(
+    "Freds Monitor Tool v{}\n"
+    "\n"
+    "USAGE: \n"
+    "  fmt-service [--help]\n"
+    "\n"
+    "Keeps your profiles loaded, so that the other tools can apply and list\n"
+    "them faster. Runs until it is terminated.\n"
+    "\n"
+    "OPTIONS:\n"
+    "  --trace PATH: write a Chrome trace of this run to PATH\n"
+    "\n"
+    "---\n"
+    "{}",
+    VersionString,
+    LicenseText);
+}
+
+}// namespace
+
+namespace FredEmmott::MonitorTool::CLI {
+
+int ServiceMain(int argc, wchar_t** argv) {
+  for (int i = 1; i < argc; ++i) {
+    const std::wstring_view arg {argv[i]};
+    if (arg == L"--help") {
+      PrintCOUT(GetHelpText());
+      return 0;
+    }
+    if (arg == L"--trace") {
+      if (i + 1 >= argc) {
+        PrintCERR(GetHelpText());
+        return 1;
+      }
+      if (!TryStartTracing(argv[++i])) {
+        return 1;
+      }
+      continue;
+    }
+
+    PrintCERR(GetHelpText());
+    return 1;
+  }
+
+  try {
+    RunService();
+  } catch (const RuntimeError& e) {
+    PrintCERR(std::format("Fatal error: {}", e.what()).c_str());
+    return 1;
+  }
+}
+
+}// namespace FredEmmott::MonitorTool::CLI
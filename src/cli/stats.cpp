@@ -0,0 +1,199 @@
+// Copyright 2024, Fred Emmott
+// SPDX-License-Identifier: ISC
+
+#include "commands.hpp"
+#include "console.hpp"
+
+#include <FredEmmott/MonitorTool/ApplyStats.hpp>
+#include <FredEmmott/MonitorTool/Config.hpp>
+#include <FredEmmott/MonitorTool/Profile.hpp>
+#include <FredEmmott/MonitorTool/except.hpp>
+#include <FredEmmott/MonitorTool/json.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <format>
+#include <unordered_map>
+
+#include <Windows.h>
+
+using namespace FredEmmott::MonitorTool::CLI;
+using namespace FredEmmott::MonitorTool::Config;
+using namespace FredEmmott::MonitorTool;
+
+namespace {
+std::string GetHelpText() {
+  return std::format(
+    "Freds Monitor Tool v{}\n"
+    "\n"
+    "USAGE:\n"
+    "  fmt-stats [--json]\n"
+    "  fmt-stats --help\n"
+    "\n"
+    "Shows how long each profile has taken to apply, as percentiles for each\n"
+    "stage. Statistics are kept separately for each version of Windows and\n"
+    "the graphics drivers, oldest first, so slowdowns after an update stand\n"
+    "out. Percentiles are accurate to within 25%.\n"
+    "\n"
+    "OPTIONS:\n"
+    "  --json: print the statistics as JSON instead of a table\n"
+    "  --trace PATH: write a Chrome trace of this run to PATH\n"
+    "  --help: show this text\n"
+    "---\n"
+    "{}",
+    VersionString,
+    LicenseText);
+}
+
+constexpr double Percentiles[] {50, 95, 99};
+
+struct NamedStats {
+  std::string mName;
+  ApplyStats mStats;
+};
+
+std::vector<NamedStats> GetStats() {
+  std::unordered_map<std::string, std::string> names;
+  for (auto&& it: Profile::EnumerateSummaries()) {
+    names.emplace(winrt::to_string(winrt::to_hstring(it.mGuid)), it.mName);
+  }
+
+  std::vector<NamedStats> ret;
+  for (auto&& stats: LoadApplyStats()) {
+    const auto guid = winrt::to_string(winrt::to_hstring(stats.mGuid));
+    const auto it = names.find(guid);
+    ret.push_back({
+      .mName = (it == names.end()) ? "(deleted profile)" : it->second,
+      .mStats = std::move(stats),
+    });
+  }
+  // Stable, so each profile's driver versions stay oldest-first
+  std::ranges::stable_sort(ret, {}, &NamedStats::mName);
+  return ret;
+}
+
+std::string FormatDuration(LatencyHistogram::Duration duration) {
+  const auto us = duration.count();
+  if (us < 1000) {
+    return std::format("{}us", us);
+  }
+  if (us < 10'000'000) {
+    return std::format("{:.1f}ms", us / 1000.0);
+  }
+  return std::format("{:.1f}s", us / 1'000'000.0);
+}
+
+int64_t ToUnixTime(ApplyStats::TimePoint time) {
+  return std::chrono::duration_cast<std::chrono::seconds>(
+           time.time_since_epoch())
+    .count();
+}
+
+std::string FormatJSON(const std::vector<NamedStats>& all) {
+  auto profiles = nlohmann::json::array();
+  for (const auto& [name, stats]: all) {
+    nlohmann::json outcomes;
+    for (std::size_t i = 0; i < ApplyOutcomeCount; ++i) {
+      outcomes[ToString(static_cast<ApplyOutcome>(i))] = stats.mOutcomes[i];
+    }
+    nlohmann::json phases;
+    for (std::size_t i = 0; i < ApplyPhaseCount; ++i) {
+      const auto& histogram = stats.mPhases[i];
+      nlohmann::json phase {{"Count", histogram.GetCount()}};
+      for (const auto percentile: Percentiles) {
+        phase[std::format("P{}US", percentile)]
+          = histogram.GetPercentile(percentile).count();
+      }
+      phases[ToString(static_cast<ApplyPhase>(i))] = std::move(phase);
+    }
+    profiles.push_back({
+      {"Name", name},
+      {"GUID", stats.mGuid},
+      {"DriverVersionHash", std::format("{:016x}", stats.mDriverVersionHash)},
+      {"FirstApplied", ToUnixTime(stats.mFirstApplied)},
+      {"LastApplied", ToUnixTime(stats.mLastApplied)},
+      {"Outcomes", std::move(outcomes)},
+      {"Phases", std::move(phases)},
+    });
+  }
+  return nlohmann::json {{"Profiles", std::move(profiles)}}.dump(2);
+}
+
+std::string FormatTable(const std::vector<NamedStats>& all) {
+  if (all.empty()) {
+    return "No profiles have been applied since statistics were enabled.";
+  }
+
+  std::string ret;
+  for (const auto& [name, stats]: all) {
+    if (!ret.empty()) {
+      ret += "\n\n";
+    }
+    std::string outcomes;
+    for (std::size_t i = 0; i < ApplyOutcomeCount; ++i) {
+      outcomes += std::format(
+        "{}{} {}",
+        outcomes.empty() ? "" : ", ",
+        stats.mOutcomes[i],
+        ToString(static_cast<ApplyOutcome>(i)));
+    }
+    ret += std::format(
+      "'{}' since {:%F} ({})\n  {:<10}{:>10}{:>10}{:>10}",
+      name,
+      std::chrono::floor<std::chrono::days>(stats.mFirstApplied),
+      outcomes,
+      "Stage",
+      "p50",
+      "p95",
+      "p99");
+    for (std::size_t i = 0; i < ApplyPhaseCount; ++i) {
+      const auto& histogram = stats.mPhases[i];
+      ret += std::format(
+        "\n  {:<10}{:>10}{:>10}{:>10}",
+        ToString(static_cast<ApplyPhase>(i)),
+        FormatDuration(histogram.GetPercentile(50)),
+        FormatDuration(histogram.GetPercentile(95)),
+        FormatDuration(histogram.GetPercentile(99)));
+    }
+  }
+  return ret;
+}
+
+}// namespace
+
+namespace FredEmmott::MonitorTool::CLI {
+
+int StatsMain(int argc, wchar_t** argv) {
+  bool json = false;
+  for (int i = 1; i < argc; ++i) {
+    const std::wstring_view arg {argv[i]};
+    if (arg == L"--help") {
+      PrintCOUT(GetHelpText());
+      return 0;
+    }
+    if (arg == L"--json") {
+      json = true;
+      continue;
+    }
+    if (arg == L"--trace" && i + 1 < argc) {
+      if (!TryStartTracing(argv[++i])) {
+        return 1;
+      }
+      continue;
+    }
+
+    PrintCERR(GetHelpText());
+    return 1;
+  }
+
+  try {
+    const auto stats = GetStats();
+    PrintCOUT(json ? FormatJSON(stats) : FormatTable(stats));
+  } catch (const RuntimeError& e) {
+    PrintCERR(std::format("Fatal error: {}", e.what()));
+    return 1;
+  }
+  return 0;
+}
+
+}// namespace FredEmmott::MonitorTool::CLI
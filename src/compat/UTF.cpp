@@ -0,0 +1,114 @@
+// Copyright 2024, Fred Emmott
+// SPDX-License-Identifier: ISC
+
+#include "UTF.hpp"
+
+namespace FredEmmott::MonitorTool::Compat {
+
+namespace {
+constexpr char32_t ReplacementCharacter {0xfffd};
+
+constexpr bool IsValid(const char32_t codePoint) {
+  return codePoint <= 0x10ffff
+    && !(codePoint >= 0xd800 && codePoint <= 0xdfff);
+}
+}// namespace
+
+std::optional<std::string> ToUTF8(const std::wstring_view in, const bool strict) {
+  std::string out;
+  out.reserve(in.size());
+  for (const auto c: in) {
+    auto codePoint = static_cast<char32_t>(c);
+    if (!IsValid(codePoint)) {
+      if (strict) {
+        return std::nullopt;
+      }
+      codePoint = ReplacementCharacter;
+    }
+
+    if (codePoint < 0x80) {
+      out.push_back(static_cast<char>(codePoint));
+    } else if (codePoint < 0x800) {
+      out.push_back(static_cast<char>(0xc0 | (codePoint >> 6)));
+      out.push_back(static_cast<char>(0x80 | (codePoint & 0x3f)));
+    } else if (codePoint < 0x10000) {
+      out.push_back(static_cast<char>(0xe0 | (codePoint >> 12)));
+      out.push_back(static_cast<char>(0x80 | ((codePoint >> 6) & 0x3f)));
+      out.push_back(static_cast<char>(0x80 | (codePoint & 0x3f)));
+    } else {
+      out.push_back(static_cast<char>(0xf0 | (codePoint >> 18)));
+      out.push_back(static_cast<char>(0x80 | ((codePoint >> 12) & 0x3f)));
+      out.push_back(static_cast<char>(0x80 | ((codePoint >> 6) & 0x3f)));
+      out.push_back(static_cast<char>(0x80 | (codePoint & 0x3f)));
+    }
+  }
+  return out;
+}
+
+std::optional<std::wstring> FromUTF8(
+  const std::string_view in,
+  const bool strict) {
+  std::wstring out;
+  out.reserve(in.size());
+
+  std::size_t i = 0;
+  while (i < in.size()) {
+    const auto lead = static_cast<unsigned char>(in[i]);
+    if (lead < 0x80) {
+      out.push_back(static_cast<wchar_t>(lead));
+      ++i;
+      continue;
+    }
+
+    std::size_t length {};
+    char32_t codePoint {};
+    char32_t minimum {};
+    if ((lead & 0xe0) == 0xc0) {
+      length = 2;
+      codePoint = lead & 0x1f;
+      minimum = 0x80;
+    } else if ((lead & 0xf0) == 0xe0) {
+      length = 3;
+      codePoint = lead & 0x0f;
+      minimum = 0x800;
+    } else if ((lead & 0xf8) == 0xf0) {
+      length = 4;
+      codePoint = lead & 0x07;
+      minimum = 0x10000;
+    }
+
+    // Stop at the first byte that doesn't belong, so it's decoded next
+    std::size_t consumed = 1;
+    bool valid = (length != 0);
+    for (; valid && consumed < length; ++consumed) {
+      if (i + consumed >= in.size()) {
+        valid = false;
+        break;
+      }
+      const auto c = static_cast<unsigned char>(in[i + consumed]);
+      if ((c & 0xc0) != 0x80) {
+        valid = false;
+        break;
+      }
+      codePoint = (codePoint << 6) | (c & 0x3f);
+    }
+    // Overlong encodings are invalid too
+    if (valid && (codePoint < minimum || !IsValid(codePoint))) {
+      valid = false;
+    }
+
+    if (!valid) {
+      if (strict) {
+        return std::nullopt;
+      }
+      out.push_back(static_cast<wchar_t>(ReplacementCharacter));
+      i += consumed;
+      continue;
+    }
+    out.push_back(static_cast<wchar_t>(codePoint));
+    i += length;
+  }
+  return out;
+}
+
+}// namespace FredEmmott::MonitorTool::Compat
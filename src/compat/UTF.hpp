@@ -0,0 +1,22 @@
+// Copyright 2024, Fred Emmott
+// SPDX-License-Identifier: ISC
+#pragma once
+
+#include <optional>
+#include <string>
+#include <string_view>
+
+namespace FredEmmott::MonitorTool::Compat {
+
+static_assert(sizeof(wchar_t) == 4, "wchar_t is expected to be UTF-32");
+
+/** Conversions between UTF-8 and UTF-32 `wchar_t` strings.
+ *
+ * Invalid sequences are replaced with U+FFFD, as `MultiByteToWideChar()`
+ * and `WideCharToMultiByte()` do, unless `strict` is set, in which case
+ * nothing is returned.
+ */
+std::optional<std::string> ToUTF8(std::wstring_view, bool strict);
+std::optional<std::wstring> FromUTF8(std::string_view, bool strict);
+
+}// namespace FredEmmott::MonitorTool::Compat
@@ -0,0 +1,813 @@
+// Copyright 2024, Fred Emmott
+// SPDX-License-Identifier: ISC
+
+#include "UTF.hpp"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <cwchar>
+#include <limits>
+#include <mutex>
+#include <random>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include <Windows.h>
+#include <fcntl.h>
+#include <strings.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+using namespace FredEmmott::MonitorTool::Compat;
+
+namespace {
+
+thread_local DWORD tLastError {ERROR_SUCCESS};
+
+/// Every `HANDLE` points to one of these
+struct HandleObject {
+  virtual ~HandleObject() = default;
+};
+
+struct FileObject final : HandleObject {
+  explicit FileObject(const int fd) : mFD(fd) {
+  }
+  ~FileObject() override {
+    close(mFD);
+  }
+
+  const int mFD;
+};
+
+struct MappingObject final : HandleObject {
+  MappingObject(const int fd, const uint64_t size, const bool writable)
+    : mFD(fd), mSize(size), mWritable(writable) {
+  }
+  ~MappingObject() override {
+    close(mFD);
+  }
+
+  // Our own descriptor, so the mapping outlives the file handle, as on
+  // Windows
+  const int mFD;
+  const uint64_t mSize;
+  const bool mWritable;
+};
+
+std::mutex gViewsMutex;
+/// `munmap()` needs the size
+std::unordered_map<const void*, std::size_t> gViewSizes;
+
+DWORD ToWin32Error(const int error) {
+  switch (error) {
+    case 0:
+      return ERROR_SUCCESS;
+    case ENOENT:
+      return ERROR_FILE_NOT_FOUND;
+    case ENOTDIR:
+      return ERROR_PATH_NOT_FOUND;
+    case EMFILE:
+    case ENFILE:
+      return ERROR_TOO_MANY_OPEN_FILES;
+    case EACCES:
+    case EPERM:
+    case EROFS:
+    case EISDIR:
+      return ERROR_ACCESS_DENIED;
+    case EBADF:
+      return ERROR_INVALID_HANDLE;
+    case ENOMEM:
+      return ERROR_NOT_ENOUGH_MEMORY;
+    case EAGAIN:
+      return ERROR_LOCK_VIOLATION;
+    case EEXIST:
+      return ERROR_FILE_EXISTS;
+    case EINVAL:
+      return ERROR_INVALID_PARAMETER;
+    case ENOSPC:
+      return ERROR_DISK_FULL;
+    case ENAMETOOLONG:
+      return ERROR_FILENAME_EXCED_RANGE;
+    case ENOTSUP:
+      return ERROR_NOT_SUPPORTED;
+    default:
+      return ERROR_GEN_FAILURE;
+  }
+}
+
+BOOL Fail(const DWORD error) {
+  tLastError = error;
+  return FALSE;
+}
+
+BOOL FailWithErrno() {
+  return Fail(ToWin32Error(errno));
+}
+
+template <class T>
+T* GetObject(const HANDLE handle) {
+  if (!handle || handle == INVALID_HANDLE_VALUE) {
+    return nullptr;
+  }
+  return dynamic_cast<T*>(static_cast<HandleObject*>(handle));
+}
+
+int GetFD(const HANDLE handle) {
+  const auto file = GetObject<FileObject>(handle);
+  return file ? file->mFD : -1;
+}
+
+std::string_view StripLongPathPrefix(std::string_view path) {
+  if (path.starts_with(R"(\\?\)")) {
+    path.remove_prefix(4);
+  }
+  return path;
+}
+
+std::string ToNativePath(const LPCWSTR path) {
+  std::wstring_view view {path};
+  if (view.starts_with(LR"(\\?\)")) {
+    view.remove_prefix(4);
+  }
+  return *ToUTF8(view, /* strict = */ false);
+}
+
+// `fcntl()` offsets are signed, so drop the top bit; locks are advisory, so
+// they don't need to be beyond any data anyway
+off_t ToLockOffset(const DWORD high, const DWORD low) {
+  return static_cast<off_t>(
+    ((static_cast<uint64_t>(high) << 32) | low)
+    & std::numeric_limits<off_t>::max());
+}
+
+BOOL SetLock(
+  const HANDLE file,
+  const short type,
+  const bool wait,
+  const DWORD lengthLow,
+  const DWORD lengthHigh,
+  const OVERLAPPED* overlapped) {
+  const auto fd = GetFD(file);
+  if (fd == -1 || !overlapped) {
+    return Fail(ERROR_INVALID_PARAMETER);
+  }
+  struct flock lock {};
+  lock.l_type = type;
+  lock.l_whence = SEEK_SET;
+  lock.l_start = ToLockOffset(overlapped->OffsetHigh, overlapped->Offset);
+  lock.l_len = std::min(
+    ToLockOffset(lengthHigh, lengthLow),
+    std::numeric_limits<off_t>::max() - lock.l_start);
+  // Open file description locks belong to the handle, like Windows locks;
+  // process-associated locks would be released by closing any descriptor
+  while (fcntl(fd, wait ? F_OFD_SETLKW : F_OFD_SETLK, &lock) == -1) {
+    if (errno != EINTR) {
+      return FailWithErrno();
+    }
+  }
+  return TRUE;
+}
+
+}// namespace
+
+DWORD GetLastError() {
+  return tLastError;
+}
+
+void SetLastError(const DWORD error) {
+  tLastError = error;
+}
+
+HANDLE CreateFileW(
+  const char* fileName,
+  const DWORD desiredAccess,
+  [[maybe_unused]] const DWORD shareMode,
+  SECURITY_ATTRIBUTES*,
+  const DWORD creationDisposition,
+  [[maybe_unused]] const DWORD flagsAndAttributes,
+  [[maybe_unused]] const HANDLE templateFile) {
+  const auto path = std::string {StripLongPathPrefix(fileName)};
+
+  int flags = O_CLOEXEC;
+  const bool read = desiredAccess & GENERIC_READ;
+  const bool write = desiredAccess & GENERIC_WRITE;
+  if (read && write) {
+    flags |= O_RDWR;
+  } else if (write) {
+    flags |= O_WRONLY;
+  } else {
+    flags |= O_RDONLY;
+  }
+
+  bool existed = false;
+  int fd = -1;
+  switch (creationDisposition) {
+    case CREATE_NEW:
+      fd = open(path.c_str(), flags | O_CREAT | O_EXCL, 0666);
+      break;
+    case CREATE_ALWAYS:
+    case OPEN_ALWAYS:
+      // Windows reports whether the file was already there
+      fd = open(path.c_str(), flags | O_CREAT | O_EXCL, 0666);
+      if (fd == -1 && errno == EEXIST) {
+        existed = true;
+        fd = open(path.c_str(), flags, 0666);
+        if (fd != -1 && creationDisposition == CREATE_ALWAYS) {
+          if (ftruncate(fd, 0) == -1) {
+            const auto error = errno;
+            close(fd);
+            fd = -1;
+            errno = error;
+          }
+        }
+      }
+      break;
+    case OPEN_EXISTING:
+      fd = open(path.c_str(), flags);
+      break;
+    case TRUNCATE_EXISTING:
+      fd = open(path.c_str(), flags | O_TRUNC);
+      break;
+    default:
+      Fail(ERROR_INVALID_PARAMETER);
+      return INVALID_HANDLE_VALUE;
+  }
+
+  if (fd == -1) {
+    FailWithErrno();
+    return INVALID_HANDLE_VALUE;
+  }
+  tLastError = existed ? ERROR_ALREADY_EXISTS : ERROR_SUCCESS;
+  return static_cast<HandleObject*>(new FileObject(fd));
+}
+
+HANDLE CreateFileW(
+  const LPCWSTR fileName,
+  const DWORD desiredAccess,
+  const DWORD shareMode,
+  SECURITY_ATTRIBUTES* securityAttributes,
+  const DWORD creationDisposition,
+  const DWORD flagsAndAttributes,
+  const HANDLE templateFile) {
+  return CreateFileW(
+    ToNativePath(fileName).c_str(),
+    desiredAccess,
+    shareMode,
+    securityAttributes,
+    creationDisposition,
+    flagsAndAttributes,
+    templateFile);
+}
+
+BOOL CloseHandle(const HANDLE handle) {
+  if (!handle || handle == INVALID_HANDLE_VALUE) {
+    return Fail(ERROR_INVALID_HANDLE);
+  }
+  delete static_cast<HandleObject*>(handle);
+  return TRUE;
+}
+
+BOOL ReadFile(
+  const HANDLE file,
+  const LPVOID buffer,
+  const DWORD bytesToRead,
+  const LPDWORD bytesRead,
+  OVERLAPPED* overlapped) {
+  const auto fd = GetFD(file);
+  if (fd == -1 || overlapped) {
+    return Fail(fd == -1 ? ERROR_INVALID_HANDLE : ERROR_NOT_SUPPORTED);
+  }
+  ssize_t result {};
+  do {
+    result = read(fd, buffer, bytesToRead);
+  } while (result == -1 && errno == EINTR);
+  if (result == -1) {
+    return FailWithErrno();
+  }
+  if (bytesRead) {
+    *bytesRead = static_cast<DWORD>(result);
+  }
+  return TRUE;
+}
+
+BOOL WriteFile(
+  const HANDLE file,
+  const LPCVOID buffer,
+  const DWORD bytesToWrite,
+  const LPDWORD bytesWritten,
+  OVERLAPPED* overlapped) {
+  const auto fd = GetFD(file);
+  if (fd == -1 || overlapped) {
+    return Fail(fd == -1 ? ERROR_INVALID_HANDLE : ERROR_NOT_SUPPORTED);
+  }
+  // Synchronous writes to files are never partial on Windows
+  const auto bytes = static_cast<const std::byte*>(buffer);
+  DWORD written = 0;
+  while (written < bytesToWrite) {
+    const auto result = write(fd, bytes + written, bytesToWrite - written);
+    if (result == -1) {
+      if (errno == EINTR) {
+        continue;
+      }
+      if (bytesWritten) {
+        *bytesWritten = written;
+      }
+      return FailWithErrno();
+    }
+    written += static_cast<DWORD>(result);
+  }
+  if (bytesWritten) {
+    *bytesWritten = written;
+  }
+  return TRUE;
+}
+
+BOOL FlushFileBuffers(const HANDLE file) {
+  const auto fd = GetFD(file);
+  if (fd == -1) {
+    return Fail(ERROR_INVALID_HANDLE);
+  }
+  if (fsync(fd) == -1) {
+    return FailWithErrno();
+  }
+  return TRUE;
+}
+
+BOOL GetFileSizeEx(const HANDLE file, LARGE_INTEGER* size) {
+  const auto fd = GetFD(file);
+  if (fd == -1) {
+    return Fail(ERROR_INVALID_HANDLE);
+  }
+  struct stat info {};
+  if (fstat(fd, &info) == -1) {
+    return FailWithErrno();
+  }
+  size->QuadPart = info.st_size;
+  return TRUE;
+}
+
+BOOL GetFileInformationByHandle(
+  const HANDLE file,
+  BY_HANDLE_FILE_INFORMATION* out) {
+  const auto fd = GetFD(file);
+  if (fd == -1) {
+    return Fail(ERROR_INVALID_HANDLE);
+  }
+  struct stat info {};
+  if (fstat(fd, &info) == -1) {
+    return FailWithErrno();
+  }
+
+  // 100ns intervals since 1601-01-01
+  const auto toFileTime = [](const timespec& time) {
+    constexpr uint64_t SecondsFrom1601To1970 = 11644473600;
+    const auto intervals
+      = ((static_cast<uint64_t>(time.tv_sec) + SecondsFrom1601To1970)
+         * 10'000'000)
+      + (static_cast<uint64_t>(time.tv_nsec) / 100);
+    return FILETIME {
+      static_cast<DWORD>(intervals),
+      static_cast<DWORD>(intervals >> 32),
+    };
+  };
+
+  const auto size = static_cast<uint64_t>(info.st_size);
+  const auto index = static_cast<uint64_t>(info.st_ino);
+  *out = {
+    .dwFileAttributes = FILE_ATTRIBUTE_NORMAL,
+    .ftCreationTime = toFileTime(info.st_ctim),
+    .ftLastAccessTime = toFileTime(info.st_atim),
+    .ftLastWriteTime = toFileTime(info.st_mtim),
+    .dwVolumeSerialNumber = static_cast<DWORD>(info.st_dev),
+    .nFileSizeHigh = static_cast<DWORD>(size >> 32),
+    .nFileSizeLow = static_cast<DWORD>(size),
+    .nNumberOfLinks = static_cast<DWORD>(info.st_nlink),
+    .nFileIndexHigh = static_cast<DWORD>(index >> 32),
+    .nFileIndexLow = static_cast<DWORD>(index),
+  };
+  return TRUE;
+}
+
+BOOL SetFilePointerEx(
+  const HANDLE file,
+  const LARGE_INTEGER distance,
+  LARGE_INTEGER* newPosition,
+  const DWORD moveMethod) {
+  const auto fd = GetFD(file);
+  if (fd == -1) {
+    return Fail(ERROR_INVALID_HANDLE);
+  }
+  int whence {};
+  switch (moveMethod) {
+    case FILE_BEGIN:
+      whence = SEEK_SET;
+      break;
+    case FILE_CURRENT:
+      whence = SEEK_CUR;
+      break;
+    case FILE_END:
+      whence = SEEK_END;
+      break;
+    default:
+      return Fail(ERROR_INVALID_PARAMETER);
+  }
+  const auto position = lseek(fd, distance.QuadPart, whence);
+  if (position == -1) {
+    return FailWithErrno();
+  }
+  if (newPosition) {
+    newPosition->QuadPart = position;
+  }
+  return TRUE;
+}
+
+BOOL SetEndOfFile(const HANDLE file) {
+  const auto fd = GetFD(file);
+  if (fd == -1) {
+    return Fail(ERROR_INVALID_HANDLE);
+  }
+  const auto position = lseek(fd, 0, SEEK_CUR);
+  if (position == -1 || ftruncate(fd, position) == -1) {
+    return FailWithErrno();
+  }
+  return TRUE;
+}
+
+BOOL LockFileEx(
+  const HANDLE file,
+  const DWORD flags,
+  DWORD,
+  const DWORD lengthLow,
+  const DWORD lengthHigh,
+  OVERLAPPED* overlapped) {
+  return SetLock(
+    file,
+    (flags & LOCKFILE_EXCLUSIVE_LOCK) ? F_WRLCK : F_RDLCK,
+    !(flags & LOCKFILE_FAIL_IMMEDIATELY),
+    lengthLow,
+    lengthHigh,
+    overlapped);
+}
+
+BOOL UnlockFileEx(
+  const HANDLE file,
+  DWORD,
+  const DWORD lengthLow,
+  const DWORD lengthHigh,
+  OVERLAPPED* overlapped) {
+  return SetLock(file, F_UNLCK, false, lengthLow, lengthHigh, overlapped);
+}
+
+HANDLE CreateFileMappingW(
+  const HANDLE file,
+  SECURITY_ATTRIBUTES*,
+  const DWORD protect,
+  const DWORD maximumSizeHigh,
+  const DWORD maximumSizeLow,
+  const LPCWSTR name) {
+  const auto fd = GetFD(file);
+  if (fd == -1 || name) {
+    Fail(fd == -1 ? ERROR_INVALID_HANDLE : ERROR_NOT_SUPPORTED);
+    return nullptr;
+  }
+  const bool writable = (protect == PAGE_READWRITE);
+  if (!(writable || protect == PAGE_READONLY)) {
+    Fail(ERROR_NOT_SUPPORTED);
+    return nullptr;
+  }
+
+  struct stat info {};
+  if (fstat(fd, &info) == -1) {
+    FailWithErrno();
+    return nullptr;
+  }
+  const auto fileSize = static_cast<uint64_t>(info.st_size);
+  auto size = (static_cast<uint64_t>(maximumSizeHigh) << 32) | maximumSizeLow;
+  if (size == 0) {
+    size = fileSize;
+  }
+  if (size == 0) {
+    // As on Windows, empty mappings aren't allowed
+    Fail(ERROR_INVALID_PARAMETER);
+    return nullptr;
+  }
+  if (size > fileSize) {
+    // Windows grows the file, filled with zeroes
+    if (!writable) {
+      Fail(ERROR_ACCESS_DENIED);
+      return nullptr;
+    }
+    if (ftruncate(fd, static_cast<off_t>(size)) == -1) {
+      FailWithErrno();
+      return nullptr;
+    }
+  }
+
+  const auto mappingFD = fcntl(fd, F_DUPFD_CLOEXEC, 0);
+  if (mappingFD == -1) {
+    FailWithErrno();
+    return nullptr;
+  }
+  return static_cast<HandleObject*>(
+    new MappingObject(mappingFD, size, writable));
+}
+
+LPVOID MapViewOfFile(
+  const HANDLE mappingHandle,
+  const DWORD desiredAccess,
+  const DWORD fileOffsetHigh,
+  const DWORD fileOffsetLow,
+  const SIZE_T numberOfBytesToMap) {
+  const auto mapping = GetObject<MappingObject>(mappingHandle);
+  if (!mapping) {
+    Fail(ERROR_INVALID_HANDLE);
+    return nullptr;
+  }
+  const bool write = desiredAccess & FILE_MAP_WRITE;
+  if (write && !mapping->mWritable) {
+    Fail(ERROR_ACCESS_DENIED);
+    return nullptr;
+  }
+  const auto offset
+    = (static_cast<uint64_t>(fileOffsetHigh) << 32) | fileOffsetLow;
+  if (offset >= mapping->mSize) {
+    Fail(ERROR_INVALID_PARAMETER);
+    return nullptr;
+  }
+  const auto size = numberOfBytesToMap
+    ? numberOfBytesToMap
+    : static_cast<SIZE_T>(mapping->mSize - offset);
+
+  const auto view = mmap(
+    nullptr,
+    size,
+    write ? (PROT_READ | PROT_WRITE) : PROT_READ,
+    MAP_SHARED,
+    mapping->mFD,
+    static_cast<off_t>(offset));
+  if (view == MAP_FAILED) {
+    FailWithErrno();
+    return nullptr;
+  }
+  std::unique_lock lock(gViewsMutex);
+  gViewSizes.emplace(view, size);
+  return view;
+}
+
+BOOL UnmapViewOfFile(const LPCVOID view) {
+  std::size_t size {};
+  {
+    std::unique_lock lock(gViewsMutex);
+    const auto it = gViewSizes.find(view);
+    if (it == gViewSizes.end()) {
+      return Fail(ERROR_INVALID_PARAMETER);
+    }
+    size = it->second;
+    gViewSizes.erase(it);
+  }
+  if (munmap(const_cast<void*>(view), size) == -1) {
+    return FailWithErrno();
+  }
+  return TRUE;
+}
+
+BOOL DeleteFileW(const char* fileName) {
+  const auto path = std::string {StripLongPathPrefix(fileName)};
+  if (unlink(path.c_str()) == -1) {
+    return FailWithErrno();
+  }
+  return TRUE;
+}
+
+BOOL DeleteFileW(const LPCWSTR fileName) {
+  return DeleteFileW(ToNativePath(fileName).c_str());
+}
+
+BOOL MoveFileExW(const char* from, const char* to, const DWORD flags) {
+  const auto fromPath = std::string {StripLongPathPrefix(from)};
+  const auto toPath = std::string {StripLongPathPrefix(to)};
+  // `rename()` always replaces
+  const auto result = (flags & MOVEFILE_REPLACE_EXISTING)
+    ? rename(fromPath.c_str(), toPath.c_str())
+    : renameat2(
+        AT_FDCWD, fromPath.c_str(), AT_FDCWD, toPath.c_str(), RENAME_NOREPLACE);
+  if (result == -1) {
+    return (errno == EEXIST) ? Fail(ERROR_ALREADY_EXISTS) : FailWithErrno();
+  }
+  return TRUE;
+}
+
+BOOL MoveFileExW(const LPCWSTR from, const LPCWSTR to, const DWORD flags) {
+  return MoveFileExW(
+    ToNativePath(from).c_str(), ToNativePath(to).c_str(), flags);
+}
+
+DWORD GetCurrentProcessId() {
+  return static_cast<DWORD>(getpid());
+}
+
+DWORD GetCurrentThreadId() {
+  return static_cast<DWORD>(gettid());
+}
+
+HRESULT CoCreateGuid(GUID* out) {
+  // Version 4 (random), as on Windows
+  static_assert(sizeof(GUID) == 16);
+  std::random_device device;
+  uint32_t words[4];
+  for (auto& word: words) {
+    word = device();
+  }
+  std::memcpy(out, words, sizeof(GUID));
+  out->Data3 = (out->Data3 & 0x0fff) | 0x4000;
+  out->Data4[0] = (out->Data4[0] & 0x3f) | 0x80;
+  return S_OK;
+}
+
+LPWSTR* CommandLineToArgvW(const LPCWSTR commandLine, int* argc) {
+  if (!commandLine || !argc) {
+    Fail(ERROR_INVALID_PARAMETER);
+    return nullptr;
+  }
+
+  std::vector<std::wstring> args;
+  const std::wstring_view line {commandLine};
+  std::size_t i = 0;
+
+  // The program name is split differently: quotes delimit it, and
+  // backslashes are never escapes
+  {
+    std::wstring program;
+    if (i < line.size() && line[i] == L'"') {
+      ++i;
+      while (i < line.size() && line[i] != L'"') {
+        program += line[i++];
+      }
+      if (i < line.size()) {
+        ++i;
+      }
+    } else {
+      while (i < line.size() && line[i] != L' ' && line[i] != L'\t') {
+        program += line[i++];
+      }
+    }
+    args.push_back(std::move(program));
+  }
+
+  while (true) {
+    while (i < line.size() && (line[i] == L' ' || line[i] == L'\t')) {
+      ++i;
+    }
+    if (i >= line.size()) {
+      break;
+    }
+
+    std::wstring arg;
+    bool inQuotes = false;
+    while (i < line.size()) {
+      const auto c = line[i];
+      if (!inQuotes && (c == L' ' || c == L'\t')) {
+        break;
+      }
+      if (c == L'\\') {
+        std::size_t backslashes = 0;
+        while (i < line.size() && line[i] == L'\\') {
+          ++backslashes;
+          ++i;
+        }
+        if (i < line.size() && line[i] == L'"') {
+          // 2n backslashes are n backslashes and a delimiter; 2n + 1 are n
+          // backslashes and a literal quote
+          arg.append(backslashes / 2, L'\\');
+          if (backslashes % 2) {
+            arg += L'"';
+            ++i;
+          }
+        } else {
+          arg.append(backslashes, L'\\');
+        }
+        continue;
+      }
+      if (c == L'"') {
+        ++i;
+        if (inQuotes && i < line.size() && line[i] == L'"') {
+          // `""` inside quotes is a literal quote
+          arg += L'"';
+          ++i;
+        } else {
+          inQuotes = !inQuotes;
+        }
+        continue;
+      }
+      arg += c;
+      ++i;
+    }
+    args.push_back(std::move(arg));
+  }
+
+  // One allocation: the pointers, then the NUL-terminated strings
+  std::size_t size = sizeof(LPWSTR) * (args.size() + 1);
+  for (const auto& arg: args) {
+    size += sizeof(wchar_t) * (arg.size() + 1);
+  }
+  const auto ret = static_cast<LPWSTR*>(std::malloc(size));
+  if (!ret) {
+    Fail(ERROR_NOT_ENOUGH_MEMORY);
+    return nullptr;
+  }
+  auto next = reinterpret_cast<wchar_t*>(ret + args.size() + 1);
+  for (std::size_t j = 0; j < args.size(); ++j) {
+    ret[j] = next;
+    std::wmemcpy(next, args[j].c_str(), args[j].size() + 1);
+    next += args[j].size() + 1;
+  }
+  ret[args.size()] = nullptr;
+  *argc = static_cast<int>(args.size());
+  return ret;
+}
+
+HLOCAL LocalFree(const HLOCAL memory) {
+  std::free(memory);
+  return nullptr;
+}
+
+int MultiByteToWideChar(
+  const UINT codePage,
+  const DWORD flags,
+  const LPCSTR multiByteStr,
+  const int multiByteLength,
+  const LPWSTR wideCharStr,
+  const int wideCharLength) {
+  if (codePage != CP_UTF8 || multiByteLength == 0 || wideCharLength < 0) {
+    Fail(ERROR_INVALID_PARAMETER);
+    return 0;
+  }
+  // -1: NUL-terminated, and the NUL is converted too
+  const std::string_view in {
+    multiByteStr,
+    (multiByteLength < 0) ? (std::strlen(multiByteStr) + 1)
+                          : static_cast<std::size_t>(multiByteLength)};
+  const auto out = FromUTF8(in, flags & MB_ERR_INVALID_CHARS);
+  if (!out) {
+    Fail(ERROR_NO_UNICODE_TRANSLATION);
+    return 0;
+  }
+  if (wideCharLength == 0) {
+    return static_cast<int>(out->size());
+  }
+  if (out->size() > static_cast<std::size_t>(wideCharLength)) {
+    Fail(ERROR_INSUFFICIENT_BUFFER);
+    return 0;
+  }
+  std::wmemcpy(wideCharStr, out->data(), out->size());
+  return static_cast<int>(out->size());
+}
+
+int WideCharToMultiByte(
+  const UINT codePage,
+  const DWORD flags,
+  const LPCWSTR wideCharStr,
+  const int wideCharLength,
+  const LPSTR multiByteStr,
+  const int multiByteLength,
+  const LPCSTR defaultChar,
+  BOOL* usedDefaultChar) {
+  // As on Windows, `CP_UTF8` doesn't support default characters
+  if (
+    codePage != CP_UTF8 || wideCharLength == 0 || multiByteLength < 0
+    || defaultChar || usedDefaultChar) {
+    Fail(ERROR_INVALID_PARAMETER);
+    return 0;
+  }
+  const std::wstring_view in {
+    wideCharStr,
+    (wideCharLength < 0) ? (std::wcslen(wideCharStr) + 1)
+                         : static_cast<std::size_t>(wideCharLength)};
+  const auto out = ToUTF8(in, flags & WC_ERR_INVALID_CHARS);
+  if (!out) {
+    Fail(ERROR_NO_UNICODE_TRANSLATION);
+    return 0;
+  }
+  if (multiByteLength == 0) {
+    return static_cast<int>(out->size());
+  }
+  if (out->size() > static_cast<std::size_t>(multiByteLength)) {
+    Fail(ERROR_INSUFFICIENT_BUFFER);
+    return 0;
+  }
+  std::memcpy(multiByteStr, out->data(), out->size());
+  return static_cast<int>(out->size());
+}
+
+int _stricmp(const char* a, const char* b) {
+  return strcasecmp(a, b);
+}
+
+int _wcsnicmp(const wchar_t* a, const wchar_t* b, const std::size_t count) {
+  return wcsncasecmp(a, b, count);
+}
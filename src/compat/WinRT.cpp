@@ -0,0 +1,153 @@
+// Copyright 2024, Fred Emmott
+// SPDX-License-Identifier: ISC
+
+#include <winrt/base.h>
+
+#include "UTF.hpp"
+
+#include <charconv>
+#include <cstring>
+#include <format>
+#include <stdexcept>
+
+using namespace FredEmmott::MonitorTool::Compat;
+
+namespace winrt {
+
+namespace {
+
+template <class T>
+T ParseHex(const std::string_view hex) {
+  T ret {};
+  const auto end = hex.data() + hex.size();
+  const auto [ptr, ec] = std::from_chars(hex.data(), end, ret, 16);
+  if (ec != std::errc {} || ptr != end) {
+    throw std::invalid_argument("Invalid GUID string");
+  }
+  return ret;
+}
+
+}// namespace
+
+guid::guid(const GUID& value) noexcept {
+  static_assert(sizeof(guid) == sizeof(GUID));
+  std::memcpy(this, &value, sizeof(GUID));
+}
+
+guid::guid(std::string_view value) {
+  if (
+    value.size() == 38 && value.front() == '{' && value.back() == '}') {
+    value = value.substr(1, 36);
+  }
+  // xxxxxxxx-xxxx-xxxx-xxxx-xxxxxxxxxxxx
+  if (
+    value.size() != 36 || value[8] != '-' || value[13] != '-'
+    || value[18] != '-' || value[23] != '-') {
+    throw std::invalid_argument("Invalid GUID string");
+  }
+
+  // `from_chars()` rejects signs for unsigned types
+  Data1 = ParseHex<uint32_t>(value.substr(0, 8));
+  Data2 = ParseHex<uint16_t>(value.substr(9, 4));
+  Data3 = ParseHex<uint16_t>(value.substr(14, 4));
+  Data4[0] = ParseHex<uint8_t>(value.substr(19, 2));
+  Data4[1] = ParseHex<uint8_t>(value.substr(21, 2));
+  for (std::size_t i = 0; i < 6; ++i) {
+    Data4[i + 2] = ParseHex<uint8_t>(value.substr(24 + (i * 2), 2));
+  }
+}
+
+guid::guid(const std::wstring_view value) : guid(to_string(value)) {
+}
+
+guid::operator GUID() const noexcept {
+  GUID ret;
+  std::memcpy(&ret, this, sizeof(GUID));
+  return ret;
+}
+
+bool operator==(const guid& a, const guid& b) noexcept {
+  return std::memcmp(&a, &b, sizeof(guid)) == 0;
+}
+
+bool operator!=(const guid& a, const guid& b) noexcept {
+  return !(a == b);
+}
+
+bool operator<(const guid& a, const guid& b) noexcept {
+  return std::memcmp(&a, &b, sizeof(guid)) < 0;
+}
+
+std::string to_string(const std::wstring_view value) {
+  return *ToUTF8(value, /* strict = */ false);
+}
+
+hstring to_hstring(const std::string_view value) {
+  return hstring {*FromUTF8(value, /* strict = */ false)};
+}
+
+hstring to_hstring(const guid& value) {
+  const auto str = std::format(
+    "{{{:08x}-{:04x}-{:04x}-{:02x}{:02x}-{:02x}{:02x}{:02x}{:02x}{:02x}{:02x}}}",
+    value.Data1,
+    value.Data2,
+    value.Data3,
+    value.Data4[0],
+    value.Data4[1],
+    value.Data4[2],
+    value.Data4[3],
+    value.Data4[4],
+    value.Data4[5],
+    value.Data4[6],
+    value.Data4[7]);
+  return to_hstring(str);
+}
+
+hresult_error::hresult_error(const HRESULT code) noexcept : mCode(code) {
+}
+
+HRESULT hresult_error::code() const noexcept {
+  return mCode;
+}
+
+hstring hresult_error::message() const {
+  const auto code = static_cast<uint32_t>(mCode);
+  if ((code & 0xffff0000) == 0x80070000) {
+    switch (code & 0xffff) {
+      case ERROR_FILE_NOT_FOUND:
+        return L"The system cannot find the file specified.";
+      case ERROR_PATH_NOT_FOUND:
+        return L"The system cannot find the path specified.";
+      case ERROR_ACCESS_DENIED:
+        return L"Access is denied.";
+      case ERROR_INVALID_HANDLE:
+        return L"The handle is invalid.";
+      case ERROR_LOCK_VIOLATION:
+        return L"The process cannot access the file because another process "
+               L"has locked a portion of the file.";
+      case ERROR_NOT_SUPPORTED:
+        return L"The request is not supported.";
+      case ERROR_FILE_EXISTS:
+        return L"The file exists.";
+      case ERROR_INVALID_PARAMETER:
+        return L"The parameter is incorrect.";
+      case ERROR_DISK_FULL:
+        return L"There is not enough space on the disk.";
+      case ERROR_ALREADY_EXISTS:
+        return L"Cannot create a file when that file already exists.";
+    }
+  }
+  return to_hstring(std::format("Error 0x{:08X}", code));
+}
+
+void check_hresult(const HRESULT result) {
+  if (FAILED(result)) {
+    throw hresult_error(result);
+  }
+}
+
+void throw_last_error() {
+  throw hresult_error(HRESULT_FROM_WIN32(GetLastError()));
+}
+
+}// namespace winrt
@@ -0,0 +1,26 @@
+// Copyright 2024, Fred Emmott
+// SPDX-License-Identifier: ISC
+#pragma once
+
+#include <winrt/base.h>
+
+#include <unistd.h>
+
+namespace FredEmmott::MonitorTool {
+
+struct FileDescriptorTraits {
+  using type = int;
+
+  static void close(const type value) noexcept {
+    ::close(value);
+  }
+
+  static type invalid() noexcept {
+    return -1;
+  }
+};
+
+/// An owned POSIX file descriptor, like `winrt::file_handle`
+using FileDescriptor = winrt::handle_type<FileDescriptorTraits>;
+
+}// namespace FredEmmott::MonitorTool
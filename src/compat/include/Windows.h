@@ -0,0 +1,495 @@
+// Copyright 2024, Fred Emmott
+// SPDX-License-Identifier: ISC
+#pragma once
+
+/* The parts of the Windows SDK that the library uses, for other platforms.
+ *
+ * Display types have the same layout as on Windows, apart from `WCHAR`,
+ * which is `wchar_t` so that the same string code works everywhere.
+ *
+ * The file functions are implemented with POSIX calls; sharing modes are
+ * ignored, and `\\?\` path prefixes are stripped. Functions that take paths
+ * also accept `std::filesystem::path::value_type` strings. */
+
+#include <cstddef>
+#include <cstdint>
+#include <cwchar>
+
+#ifdef _WIN32
+#error "Use the real Windows.h"
+#endif
+
+#define WINAPI
+#define CALLBACK
+
+using BOOL = int;
+using BYTE = uint8_t;
+using WORD = uint16_t;
+using DWORD = uint32_t;
+using UINT = uint32_t;
+using UINT32 = uint32_t;
+using UINT64 = uint64_t;
+using INT32 = int32_t;
+using LONG = int32_t;
+using ULONG = uint32_t;
+using LONGLONG = int64_t;
+using ULONGLONG = uint64_t;
+using SIZE_T = std::size_t;
+using ULONG_PTR = uintptr_t;
+using LONG_PTR = intptr_t;
+using HRESULT = int32_t;
+using WCHAR = wchar_t;
+using PWSTR = wchar_t*;
+using LPWSTR = wchar_t*;
+using LPCWSTR = const wchar_t*;
+using LPSTR = char*;
+using LPCSTR = const char*;
+using LPVOID = void*;
+using LPCVOID = const void*;
+using LPDWORD = DWORD*;
+using HANDLE = void*;
+using HLOCAL = void*;
+
+#define TRUE 1
+#define FALSE 0
+
+#define S_OK static_cast<HRESULT>(0)
+#define E_FAIL static_cast<HRESULT>(0x80004005)
+#define FAILED(hr) (static_cast<HRESULT>(hr) < 0)
+#define SUCCEEDED(hr) (static_cast<HRESULT>(hr) >= 0)
+#define HRESULT_FROM_WIN32(x) \
+  ((x) == 0 ? S_OK \
+            : static_cast<HRESULT>(((x) & 0x0000FFFF) | 0x80070000))
+
+#define ERROR_SUCCESS 0L
+#define ERROR_FILE_NOT_FOUND 2L
+#define ERROR_PATH_NOT_FOUND 3L
+#define ERROR_TOO_MANY_OPEN_FILES 4L
+#define ERROR_ACCESS_DENIED 5L
+#define ERROR_INVALID_HANDLE 6L
+#define ERROR_NOT_ENOUGH_MEMORY 8L
+#define ERROR_GEN_FAILURE 31L
+#define ERROR_LOCK_VIOLATION 33L
+#define ERROR_HANDLE_EOF 38L
+#define ERROR_NOT_SUPPORTED 50L
+#define ERROR_FILE_EXISTS 80L
+#define ERROR_INVALID_PARAMETER 87L
+#define ERROR_DISK_FULL 112L
+#define ERROR_INSUFFICIENT_BUFFER 122L
+#define ERROR_ALREADY_EXISTS 183L
+#define ERROR_FILENAME_EXCED_RANGE 206L
+#define ERROR_NO_UNICODE_TRANSLATION 1113L
+
+#define INVALID_HANDLE_VALUE (reinterpret_cast<HANDLE>(intptr_t {-1}))
+#define INFINITE 0xFFFFFFFF
+
+#define GENERIC_READ 0x80000000
+#define GENERIC_WRITE 0x40000000
+#define FILE_SHARE_READ 0x00000001
+#define FILE_SHARE_WRITE 0x00000002
+#define FILE_SHARE_DELETE 0x00000004
+#define CREATE_NEW 1
+#define CREATE_ALWAYS 2
+#define OPEN_EXISTING 3
+#define OPEN_ALWAYS 4
+#define TRUNCATE_EXISTING 5
+#define FILE_ATTRIBUTE_NORMAL 0x00000080
+#define FILE_BEGIN 0
+#define FILE_CURRENT 1
+#define FILE_END 2
+#define PAGE_READONLY 0x02
+#define PAGE_READWRITE 0x04
+#define FILE_MAP_WRITE 0x0002
+#define FILE_MAP_READ 0x0004
+#define MOVEFILE_REPLACE_EXISTING 0x00000001
+#define MOVEFILE_WRITE_THROUGH 0x00000008
+#define LOCKFILE_FAIL_IMMEDIATELY 0x00000001
+#define LOCKFILE_EXCLUSIVE_LOCK 0x00000002
+
+#define CP_UTF8 65001
+#define MB_ERR_INVALID_CHARS 0x00000008
+#define WC_ERR_INVALID_CHARS 0x00000080
+
+struct LUID {
+  DWORD LowPart;
+  LONG HighPart;
+};
+
+struct GUID {
+  uint32_t Data1;
+  uint16_t Data2;
+  uint16_t Data3;
+  uint8_t Data4[8];
+};
+
+struct POINTL {
+  LONG x;
+  LONG y;
+};
+
+struct RECTL {
+  LONG left;
+  LONG top;
+  LONG right;
+  LONG bottom;
+};
+
+union LARGE_INTEGER {
+  struct {
+    DWORD LowPart;
+    LONG HighPart;
+  };
+  LONGLONG QuadPart;
+};
+
+struct FILETIME {
+  DWORD dwLowDateTime;
+  DWORD dwHighDateTime;
+};
+
+struct BY_HANDLE_FILE_INFORMATION {
+  DWORD dwFileAttributes;
+  FILETIME ftCreationTime;
+  FILETIME ftLastAccessTime;
+  FILETIME ftLastWriteTime;
+  DWORD dwVolumeSerialNumber;
+  DWORD nFileSizeHigh;
+  DWORD nFileSizeLow;
+  DWORD nNumberOfLinks;
+  DWORD nFileIndexHigh;
+  DWORD nFileIndexLow;
+};
+
+struct SECURITY_ATTRIBUTES {
+  DWORD nLength;
+  LPVOID lpSecurityDescriptor;
+  BOOL bInheritHandle;
+};
+
+/// Only `Offset` and `OffsetHigh` are used, by the lock functions
+struct OVERLAPPED {
+  ULONG_PTR Internal;
+  ULONG_PTR InternalHigh;
+  DWORD Offset;
+  DWORD OffsetHigh;
+  HANDLE hEvent;
+};
+
+///// Display configuration, as in wingdi.h /////
+
+enum DISPLAYCONFIG_VIDEO_OUTPUT_TECHNOLOGY : uint32_t {
+  DISPLAYCONFIG_OUTPUT_TECHNOLOGY_OTHER = 0xFFFFFFFF,
+  DISPLAYCONFIG_OUTPUT_TECHNOLOGY_HD15 = 0,
+  DISPLAYCONFIG_OUTPUT_TECHNOLOGY_SVIDEO = 1,
+  DISPLAYCONFIG_OUTPUT_TECHNOLOGY_COMPOSITE_VIDEO = 2,
+  DISPLAYCONFIG_OUTPUT_TECHNOLOGY_COMPONENT_VIDEO = 3,
+  DISPLAYCONFIG_OUTPUT_TECHNOLOGY_DVI = 4,
+  DISPLAYCONFIG_OUTPUT_TECHNOLOGY_HDMI = 5,
+  DISPLAYCONFIG_OUTPUT_TECHNOLOGY_LVDS = 6,
+  DISPLAYCONFIG_OUTPUT_TECHNOLOGY_D_JPN = 8,
+  DISPLAYCONFIG_OUTPUT_TECHNOLOGY_SDI = 9,
+  DISPLAYCONFIG_OUTPUT_TECHNOLOGY_DISPLAYPORT_EXTERNAL = 10,
+  DISPLAYCONFIG_OUTPUT_TECHNOLOGY_DISPLAYPORT_EMBEDDED = 11,
+  DISPLAYCONFIG_OUTPUT_TECHNOLOGY_UDI_EXTERNAL = 12,
+  DISPLAYCONFIG_OUTPUT_TECHNOLOGY_UDI_EMBEDDED = 13,
+  DISPLAYCONFIG_OUTPUT_TECHNOLOGY_SDTVDONGLE = 14,
+  DISPLAYCONFIG_OUTPUT_TECHNOLOGY_MIRACAST = 15,
+  DISPLAYCONFIG_OUTPUT_TECHNOLOGY_INDIRECT_WIRED = 16,
+  DISPLAYCONFIG_OUTPUT_TECHNOLOGY_INDIRECT_VIRTUAL = 17,
+  DISPLAYCONFIG_OUTPUT_TECHNOLOGY_DISPLAYPORT_USB_TUNNEL = 18,
+  DISPLAYCONFIG_OUTPUT_TECHNOLOGY_INTERNAL = 0x80000000,
+};
+
+enum DISPLAYCONFIG_SCANLINE_ORDERING : uint32_t {
+  DISPLAYCONFIG_SCANLINE_ORDERING_UNSPECIFIED = 0,
+  DISPLAYCONFIG_SCANLINE_ORDERING_PROGRESSIVE = 1,
+  DISPLAYCONFIG_SCANLINE_ORDERING_INTERLACED = 2,
+  DISPLAYCONFIG_SCANLINE_ORDERING_INTERLACED_UPPERFIELDFIRST = 2,
+  DISPLAYCONFIG_SCANLINE_ORDERING_INTERLACED_LOWERFIELDFIRST = 3,
+};
+
+enum DISPLAYCONFIG_SCALING : uint32_t {
+  DISPLAYCONFIG_SCALING_IDENTITY = 1,
+  DISPLAYCONFIG_SCALING_CENTERED = 2,
+  DISPLAYCONFIG_SCALING_STRETCHED = 3,
+  DISPLAYCONFIG_SCALING_ASPECTRATIOCENTEREDMAX = 4,
+  DISPLAYCONFIG_SCALING_CUSTOM = 5,
+  DISPLAYCONFIG_SCALING_PREFERRED = 128,
+};
+
+enum DISPLAYCONFIG_ROTATION : uint32_t {
+  DISPLAYCONFIG_ROTATION_IDENTITY = 1,
+  DISPLAYCONFIG_ROTATION_ROTATE90 = 2,
+  DISPLAYCONFIG_ROTATION_ROTATE180 = 3,
+  DISPLAYCONFIG_ROTATION_ROTATE270 = 4,
+};
+
+enum DISPLAYCONFIG_MODE_INFO_TYPE : uint32_t {
+  DISPLAYCONFIG_MODE_INFO_TYPE_SOURCE = 1,
+  DISPLAYCONFIG_MODE_INFO_TYPE_TARGET = 2,
+  DISPLAYCONFIG_MODE_INFO_TYPE_DESKTOP_IMAGE = 3,
+};
+
+enum DISPLAYCONFIG_PIXELFORMAT : uint32_t {
+  DISPLAYCONFIG_PIXELFORMAT_8BPP = 1,
+  DISPLAYCONFIG_PIXELFORMAT_16BPP = 2,
+  DISPLAYCONFIG_PIXELFORMAT_24BPP = 3,
+  DISPLAYCONFIG_PIXELFORMAT_32BPP = 4,
+  DISPLAYCONFIG_PIXELFORMAT_NONGDI = 5,
+};
+
+enum DISPLAYCONFIG_TOPOLOGY_ID : uint32_t {
+  DISPLAYCONFIG_TOPOLOGY_INTERNAL = 0x00000001,
+  DISPLAYCONFIG_TOPOLOGY_CLONE = 0x00000002,
+  DISPLAYCONFIG_TOPOLOGY_EXTEND = 0x00000004,
+  DISPLAYCONFIG_TOPOLOGY_EXTERNAL = 0x00000008,
+};
+
+struct DISPLAYCONFIG_RATIONAL {
+  UINT32 Numerator;
+  UINT32 Denominator;
+};
+
+struct DISPLAYCONFIG_2DREGION {
+  UINT32 cx;
+  UINT32 cy;
+};
+
+struct DISPLAYCONFIG_VIDEO_SIGNAL_INFO {
+  UINT64 pixelRate;
+  DISPLAYCONFIG_RATIONAL hSyncFreq;
+  DISPLAYCONFIG_RATIONAL vSyncFreq;
+  DISPLAYCONFIG_2DREGION activeSize;
+  DISPLAYCONFIG_2DREGION totalSize;
+  union {
+    struct {
+      UINT32 videoStandard : 16;
+      UINT32 vSyncFreqDivider : 6;
+      UINT32 reserved : 10;
+    } AdditionalSignalInfo;
+    UINT32 videoStandard;
+  };
+  DISPLAYCONFIG_SCANLINE_ORDERING scanLineOrdering;
+};
+
+struct DISPLAYCONFIG_TARGET_MODE {
+  DISPLAYCONFIG_VIDEO_SIGNAL_INFO targetVideoSignalInfo;
+};
+
+struct DISPLAYCONFIG_SOURCE_MODE {
+  UINT32 width;
+  UINT32 height;
+  DISPLAYCONFIG_PIXELFORMAT pixelFormat;
+  POINTL position;
+};
+
+struct DISPLAYCONFIG_DESKTOP_IMAGE_INFO {
+  POINTL PathSourceSize;
+  RECTL DesktopImageRegion;
+  RECTL DesktopImageClip;
+};
+
+struct DISPLAYCONFIG_MODE_INFO {
+  DISPLAYCONFIG_MODE_INFO_TYPE infoType;
+  UINT32 id;
+  LUID adapterId;
+  union {
+    DISPLAYCONFIG_TARGET_MODE targetMode;
+    DISPLAYCONFIG_SOURCE_MODE sourceMode;
+    DISPLAYCONFIG_DESKTOP_IMAGE_INFO desktopImageInfo;
+  };
+};
+
+struct DISPLAYCONFIG_PATH_SOURCE_INFO {
+  LUID adapterId;
+  UINT32 id;
+  union {
+    UINT32 modeInfoIdx;
+    struct {
+      UINT32 cloneGroupId : 16;
+      UINT32 sourceModeInfoIdx : 16;
+    };
+  };
+  UINT32 statusFlags;
+};
+
+struct DISPLAYCONFIG_PATH_TARGET_INFO {
+  LUID adapterId;
+  UINT32 id;
+  union {
+    UINT32 modeInfoIdx;
+    struct {
+      UINT32 desktopModeInfoIdx : 16;
+      UINT32 targetModeInfoIdx : 16;
+    };
+  };
+  DISPLAYCONFIG_VIDEO_OUTPUT_TECHNOLOGY outputTechnology;
+  DISPLAYCONFIG_ROTATION rotation;
+  DISPLAYCONFIG_SCALING scaling;
+  DISPLAYCONFIG_RATIONAL refreshRate;
+  DISPLAYCONFIG_SCANLINE_ORDERING scanLineOrdering;
+  BOOL targetAvailable;
+  UINT32 statusFlags;
+};
+
+struct DISPLAYCONFIG_PATH_INFO {
+  DISPLAYCONFIG_PATH_SOURCE_INFO sourceInfo;
+  DISPLAYCONFIG_PATH_TARGET_INFO targetInfo;
+  UINT32 flags;
+};
+
+static_assert(sizeof(DISPLAYCONFIG_MODE_INFO) == 64);
+static_assert(sizeof(DISPLAYCONFIG_PATH_INFO) == 72);
+
+#define DISPLAYCONFIG_PATH_MODE_IDX_INVALID 0xffffffff
+#define DISPLAYCONFIG_PATH_TARGET_MODE_IDX_INVALID 0xffff
+#define DISPLAYCONFIG_PATH_DESKTOP_IMAGE_IDX_INVALID 0xffff
+#define DISPLAYCONFIG_PATH_SOURCE_MODE_IDX_INVALID 0xffff
+#define DISPLAYCONFIG_PATH_CLONE_GROUP_INVALID 0xffff
+
+#define DISPLAYCONFIG_SOURCE_IN_USE 0x00000001
+
+#define DISPLAYCONFIG_TARGET_IN_USE 0x00000001
+#define DISPLAYCONFIG_TARGET_FORCIBLE 0x00000002
+#define DISPLAYCONFIG_TARGET_FORCED_AVAILABILITY_BOOT 0x00000004
+#define DISPLAYCONFIG_TARGET_FORCED_AVAILABILITY_PATH 0x00000008
+#define DISPLAYCONFIG_TARGET_FORCED_AVAILABILITY_SYSTEM 0x00000010
+#define DISPLAYCONFIG_TARGET_IS_HMD 0x00000020
+
+#define DISPLAYCONFIG_PATH_ACTIVE 0x00000001
+#define DISPLAYCONFIG_PATH_PREFERRED_UNSCALED 0x00000004
+#define DISPLAYCONFIG_PATH_SUPPORT_VIRTUAL_MODE 0x00000008
+
+#define QDC_ALL_PATHS 0x00000001
+#define QDC_ONLY_ACTIVE_PATHS 0x00000002
+#define QDC_DATABASE_CURRENT 0x00000004
+#define QDC_VIRTUAL_MODE_AWARE 0x00000010
+#define QDC_INCLUDE_HMD 0x00000020
+#define QDC_VIRTUAL_REFRESH_RATE_AWARE 0x00000040
+
+#define SDC_TOPOLOGY_INTERNAL 0x00000001
+#define SDC_TOPOLOGY_CLONE 0x00000002
+#define SDC_TOPOLOGY_EXTEND 0x00000004
+#define SDC_TOPOLOGY_EXTERNAL 0x00000008
+#define SDC_TOPOLOGY_SUPPLIED 0x00000010
+#define SDC_USE_SUPPLIED_DISPLAY_CONFIG 0x00000020
+#define SDC_VALIDATE 0x00000040
+#define SDC_APPLY 0x00000080
+#define SDC_NO_OPTIMIZATION 0x00000100
+#define SDC_SAVE_TO_DATABASE 0x00000200
+#define SDC_ALLOW_CHANGES 0x00000400
+#define SDC_PATH_PERSIST_IF_REQUIRED 0x00000800
+#define SDC_FORCE_MODE_ENUMERATION 0x00001000
+#define SDC_ALLOW_PATH_ORDER_CHANGES 0x00002000
+#define SDC_VIRTUAL_MODE_AWARE 0x00008000
+#define SDC_VIRTUAL_REFRESH_RATE_AWARE 0x00020000
+
+///// Functions /////
+
+DWORD GetLastError();
+void SetLastError(DWORD);
+
+HANDLE CreateFileW(
+  LPCWSTR fileName,
+  DWORD desiredAccess,
+  DWORD shareMode,
+  SECURITY_ATTRIBUTES*,
+  DWORD creationDisposition,
+  DWORD flagsAndAttributes,
+  HANDLE templateFile);
+HANDLE CreateFileW(
+  const char* fileName,
+  DWORD desiredAccess,
+  DWORD shareMode,
+  SECURITY_ATTRIBUTES*,
+  DWORD creationDisposition,
+  DWORD flagsAndAttributes,
+  HANDLE templateFile);
+BOOL CloseHandle(HANDLE);
+
+/// Overlapped I/O isn't supported
+BOOL ReadFile(HANDLE, LPVOID, DWORD, LPDWORD, OVERLAPPED*);
+BOOL WriteFile(HANDLE, LPCVOID, DWORD, LPDWORD, OVERLAPPED*);
+BOOL FlushFileBuffers(HANDLE);
+BOOL GetFileSizeEx(HANDLE, LARGE_INTEGER*);
+BOOL GetFileInformationByHandle(HANDLE, BY_HANDLE_FILE_INFORMATION*);
+BOOL SetFilePointerEx(HANDLE, LARGE_INTEGER, LARGE_INTEGER*, DWORD);
+BOOL SetEndOfFile(HANDLE);
+BOOL LockFileEx(HANDLE, DWORD flags, DWORD, DWORD, DWORD, OVERLAPPED*);
+BOOL UnlockFileEx(HANDLE, DWORD, DWORD, DWORD, OVERLAPPED*);
+
+/// File-backed, unnamed mappings only
+HANDLE CreateFileMappingW(
+  HANDLE file,
+  SECURITY_ATTRIBUTES*,
+  DWORD protect,
+  DWORD maximumSizeHigh,
+  DWORD maximumSizeLow,
+  LPCWSTR name);
+LPVOID MapViewOfFile(
+  HANDLE mapping,
+  DWORD desiredAccess,
+  DWORD fileOffsetHigh,
+  DWORD fileOffsetLow,
+  SIZE_T numberOfBytesToMap);
+BOOL UnmapViewOfFile(LPCVOID);
+
+BOOL DeleteFileW(LPCWSTR);
+BOOL DeleteFileW(const char*);
+BOOL MoveFileExW(LPCWSTR, LPCWSTR, DWORD flags);
+BOOL MoveFileExW(const char*, const char*, DWORD flags);
+
+DWORD GetCurrentProcessId();
+DWORD GetCurrentThreadId();
+
+HRESULT CoCreateGuid(GUID*);
+
+/** Splits a command line with the same quoting rules as Windows.
+ *
+ * The result is a single allocation, which must be freed with `LocalFree()`.
+ */
+LPWSTR* CommandLineToArgvW(LPCWSTR commandLine, int* argc);
+HLOCAL LocalFree(HLOCAL);
+
+/// `CP_UTF8` only
+int MultiByteToWideChar(
+  UINT codePage,
+  DWORD flags,
+  LPCSTR multiByteStr,
+  int multiByteLength,
+  LPWSTR wideCharStr,
+  int wideCharLength);
+/// `CP_UTF8` only
+int WideCharToMultiByte(
+  UINT codePage,
+  DWORD flags,
+  LPCWSTR wideCharStr,
+  int wideCharLength,
+  LPSTR multiByteStr,
+  int multiByteLength,
+  LPCSTR defaultChar,
+  BOOL* usedDefaultChar);
+
+///// CRT /////
+
+int _stricmp(const char*, const char*);
+int _wcsnicmp(const wchar_t*, const wchar_t*, std::size_t);
+
+inline std::size_t wcsnlen_s(const wchar_t* str, std::size_t count) {
+  return str ? wcsnlen(str, count) : 0;
+}
+
+template <std::size_t N>
+int wcsncpy_s(
+  wchar_t (&dest)[N],
+  const wchar_t* src,
+  std::size_t count) {
+  if (count >= N) {
+    dest[0] = L'\0';
+    return 34 /* ERANGE */;
+  }
+  const auto length = wcsnlen(src, count);
+  wmemcpy(dest, src, length);
+  dest[length] = L'\0';
+  return 0;
+}
@@ -0,0 +1,26 @@
+// Copyright 2024, Fred Emmott
+// SPDX-License-Identifier: ISC
+#pragma once
+
+// The DXGI types that the library uses, for other platforms
+
+#include <Windows.h>
+
+enum DXGI_ADAPTER_FLAG : uint32_t {
+  DXGI_ADAPTER_FLAG_NONE = 0,
+  DXGI_ADAPTER_FLAG_REMOTE = 1,
+  DXGI_ADAPTER_FLAG_SOFTWARE = 2,
+};
+
+struct DXGI_ADAPTER_DESC1 {
+  WCHAR Description[128];
+  UINT VendorId;
+  UINT DeviceId;
+  UINT SubSysId;
+  UINT Revision;
+  SIZE_T DedicatedVideoMemory;
+  SIZE_T DedicatedSystemMemory;
+  SIZE_T SharedSystemMemory;
+  LUID AdapterLuid;
+  UINT Flags;
+};
@@ -0,0 +1,187 @@
+// Copyright 2024, Fred Emmott
+// SPDX-License-Identifier: ISC
+#pragma once
+
+/* The parts of C++/WinRT's base.h that the library uses, for other platforms.
+ *
+ * These behave as in C++/WinRT; in particular, `hresult_error` is not a
+ * `std::exception`. */
+
+#include <Windows.h>
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+namespace winrt {
+
+struct guid {
+  uint32_t Data1;
+  uint16_t Data2;
+  uint16_t Data3;
+  uint8_t Data4[8];
+
+  guid() noexcept = default;
+  guid(const GUID& value) noexcept;
+
+  /// Throws `std::invalid_argument`; braces are optional
+  explicit guid(std::string_view value);
+  explicit guid(std::wstring_view value);
+
+  operator GUID() const noexcept;
+};
+
+bool operator==(const guid&, const guid&) noexcept;
+bool operator!=(const guid&, const guid&) noexcept;
+bool operator<(const guid&, const guid&) noexcept;
+
+class hstring {
+ public:
+  hstring() = default;
+  hstring(std::wstring_view value) : mValue(value) {
+  }
+  hstring(const wchar_t* value) : mValue(value) {
+  }
+
+  const wchar_t* c_str() const noexcept {
+    return mValue.c_str();
+  }
+  const wchar_t* data() const noexcept {
+    return mValue.data();
+  }
+  std::size_t size() const noexcept {
+    return mValue.size();
+  }
+  bool empty() const noexcept {
+    return mValue.empty();
+  }
+  auto begin() const noexcept {
+    return mValue.begin();
+  }
+  auto end() const noexcept {
+    return mValue.end();
+  }
+
+  operator std::wstring_view() const noexcept {
+    return mValue;
+  }
+
+  bool operator==(const hstring&) const noexcept = default;
+
+ private:
+  std::wstring mValue;
+};
+
+std::string to_string(std::wstring_view);
+hstring to_hstring(std::string_view);
+/// `{xxxxxxxx-xxxx-xxxx-xxxx-xxxxxxxxxxxx}`, lowercase
+hstring to_hstring(const guid&);
+
+class hresult_error {
+ public:
+  hresult_error() noexcept = default;
+  explicit hresult_error(HRESULT code) noexcept;
+
+  HRESULT code() const noexcept;
+  hstring message() const;
+
+ private:
+  HRESULT mCode {E_FAIL};
+};
+
+void check_hresult(HRESULT);
+[[noreturn]] void throw_last_error();
+
+template <class T>
+void check_bool(const T result) {
+  if (!result) {
+    throw_last_error();
+  }
+}
+
+/** Owns a handle; `T` provides `type`, `close()`, and `invalid()`.
+ *
+ * Also useful for native handles, such as file descriptors.
+ */
+template <class T>
+class handle_type {
+ public:
+  using type = typename T::type;
+
+  handle_type() noexcept = default;
+  explicit handle_type(const type value) noexcept : mValue(value) {
+  }
+  handle_type(handle_type&& other) noexcept : mValue(other.detach()) {
+  }
+  handle_type& operator=(handle_type&& other) noexcept {
+    if (this != &other) {
+      this->attach(other.detach());
+    }
+    return *this;
+  }
+  ~handle_type() noexcept {
+    this->close();
+  }
+
+  void close() noexcept {
+    if (*this) {
+      T::close(mValue);
+      mValue = T::invalid();
+    }
+  }
+
+  explicit operator bool() const noexcept {
+    return mValue != T::invalid();
+  }
+
+  type get() const noexcept {
+    return mValue;
+  }
+
+  type* put() noexcept {
+    this->close();
+    return &mValue;
+  }
+
+  void attach(const type value) noexcept {
+    this->close();
+    mValue = value;
+  }
+
+  type detach() noexcept {
+    const auto value = mValue;
+    mValue = T::invalid();
+    return value;
+  }
+
+ private:
+  type mValue {T::invalid()};
+};
+
+struct handle_traits {
+  using type = HANDLE;
+
+  static void close(const type value) noexcept {
+    CloseHandle(value);
+  }
+
+  static type invalid() noexcept {
+    return nullptr;
+  }
+};
+using handle = handle_type<handle_traits>;
+
+struct file_handle_traits {
+  using type = HANDLE;
+
+  static void close(const type value) noexcept {
+    CloseHandle(value);
+  }
+
+  static type invalid() noexcept {
+    return INVALID_HANDLE_VALUE;
+  }
+};
+using file_handle = handle_type<file_handle_traits>;
+
+}// namespace winrt
@@ -0,0 +1,45 @@
+// Copyright 2024, Fred Emmott
+// SPDX-License-Identifier: ISC
+
+#include <FredEmmott/MonitorTool/ActiveProfile.hpp>
+#include <FredEmmott/MonitorTool/ProfileIndex.hpp>
+#include <FredEmmott/MonitorTool/ProfileStore.hpp>
+#include <FredEmmott/MonitorTool/QueryDisplayConfig.hpp>
+
+#include <algorithm>
+
+namespace FredEmmott::MonitorTool {
+
+std::vector<ProfileSummary> FindProfilesByFingerprint(
+  const DisplayConfigFingerprint& fingerprint) {
+  return GetProfileStore().FindByFingerprint(fingerprint);
+}
+
+std::vector<ProfileSummary> FindActiveProfiles() {
+  return FindProfilesByFingerprint(
+    GetDisplayConfigFingerprint(QueryDisplayConfig()));
+}
+
+std::string GetNextProfileName(
+  const std::vector<std::string>& names,
+  const std::vector<ProfileSummary>& active) {
+  const auto isActive = [&active](std::string_view name) {
+    if (
+      std::ranges::find(active, name, &ProfileSummary::mName)
+      != active.end()) {
+      return true;
+    }
+    const auto folded = ProfileIndex::FoldCase(name);
+    return std::ranges::any_of(active, [&folded](const auto& summary) {
+      return ProfileIndex::FoldCase(summary.mName) == folded;
+    });
+  };
+
+  const auto it = std::ranges::find_if(names, isActive);
+  if (it == names.end() || std::next(it) == names.end()) {
+    return names.front();
+  }
+  return *std::next(it);
+}
+
+}// namespace FredEmmott::MonitorTool
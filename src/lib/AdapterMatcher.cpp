@@ -0,0 +1,379 @@
+// Copyright 2024, Fred Emmott
+// SPDX-License-Identifier: ISC
+
+#include <FredEmmott/MonitorTool/AdapterMatcher.hpp>
+#include <FredEmmott/MonitorTool/DisplayConfigSchema.hpp>
+#include <FredEmmott/MonitorTool/ProfileCache.hpp>
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <limits>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+namespace FredEmmott::MonitorTool {
+
+namespace {
+
+constexpr auto KindFlags
+  = DXGI_ADAPTER_FLAG_REMOTE | DXGI_ADAPTER_FLAG_SOFTWARE;
+
+// Each point of score is worth more than any positional tie-break
+constexpr int32_t PositionScale = 128;
+constexpr std::size_t MaxAdapters = PositionScale - 1;
+
+constexpr int32_t SameLUIDScore = 32;
+constexpr int32_t SameDeviceScore = 16;
+constexpr int32_t SameSubSysScore = 8;
+constexpr int32_t SameMemoryScore = 4;
+constexpr int32_t SameFlagsScore = 2;
+constexpr int32_t MaxScore = PositionScale
+  * (1 + SameLUIDScore + SameDeviceScore + SameSubSysScore + SameMemoryScore
+     + SameFlagsScore);
+
+constexpr std::size_t MaxCachedTables = 64;
+
+uint64_t ToUInt64(const LUID& luid) {
+  return std::bit_cast<uint64_t>(luid);
+}
+
+/// Adapters that are indistinguishable apart from their LUIDs
+struct ModelKey {
+  UINT mVendorId {};
+  UINT mDeviceId {};
+  UINT mSubSysId {};
+  SIZE_T mDedicatedVideoMemory {};
+  UINT mFlags {};
+
+  explicit ModelKey(const DXGI_ADAPTER_DESC1& desc)
+    : mVendorId(desc.VendorId),
+      mDeviceId(desc.DeviceId),
+      mSubSysId(desc.SubSysId),
+      mDedicatedVideoMemory(desc.DedicatedVideoMemory),
+      mFlags(desc.Flags) {
+  }
+
+  bool operator==(const ModelKey&) const = default;
+};
+
+struct ModelKeyHash {
+  std::size_t operator()(const ModelKey& key) const noexcept {
+    // Field by field, as `ModelKey` has uninitialized padding
+    const std::array<uint64_t, 5> values {
+      key.mVendorId,
+      key.mDeviceId,
+      key.mSubSysId,
+      key.mDedicatedVideoMemory,
+      key.mFlags,
+    };
+    return static_cast<std::size_t>(HashProfileContents(
+      {reinterpret_cast<const char*>(values.data()),
+       values.size() * sizeof(values.front())}));
+  }
+};
+
+/// Indices into an adapter list, grouped by model, in order
+using ModelIndex
+  = std::unordered_map<ModelKey, std::vector<std::size_t>, ModelKeyHash>;
+
+ModelIndex CreateModelIndex(const std::vector<DXGI_ADAPTER_DESC1>& adapters) {
+  ModelIndex ret;
+  for (std::size_t i = 0; i < adapters.size(); ++i) {
+    ret[ModelKey {adapters.at(i)}].push_back(i);
+  }
+  return ret;
+}
+
+/// Nothing if the adapters can't be the same device
+std::optional<int32_t> GetBaseScore(
+  const DXGI_ADAPTER_DESC1& saved,
+  const DXGI_ADAPTER_DESC1& current) {
+  if (
+    saved.VendorId != current.VendorId
+    || (saved.Flags & KindFlags) != (current.Flags & KindFlags)) {
+    return {};
+  }
+  int32_t ret = 1;
+  if (ToUInt64(saved.AdapterLuid) == ToUInt64(current.AdapterLuid)) {
+    ret += SameLUIDScore;
+  }
+  if (saved.DeviceId == current.DeviceId) {
+    ret += SameDeviceScore;
+  }
+  if (saved.SubSysId == current.SubSysId) {
+    ret += SameSubSysScore;
+  }
+  if (saved.DedicatedVideoMemory == current.DedicatedVideoMemory) {
+    ret += SameMemoryScore;
+  }
+  if (saved.Flags == current.Flags) {
+    ret += SameFlagsScore;
+  }
+  return ret * PositionScale;
+}
+
+/** Minimum-cost assignment of rows to columns (Hungarian algorithm).
+ *
+ * `costs` is square; returns the column for each row. O(n^3).
+ */
+std::vector<std::size_t> SolveAssignment(
+  const std::vector<std::vector<int64_t>>& costs) {
+  const auto n = costs.size();
+  constexpr auto Infinity = std::numeric_limits<int64_t>::max() / 2;
+
+  // 1-indexed, with row/column 0 as a sentinel
+  std::vector<int64_t> rowPotential(n + 1), columnPotential(n + 1);
+  std::vector<std::size_t> rowForColumn(n + 1), previousColumn(n + 1);
+  for (std::size_t row = 1; row <= n; ++row) {
+    rowForColumn[0] = row;
+    std::size_t column = 0;
+    std::vector<int64_t> minSlack(n + 1, Infinity);
+    std::vector<bool> used(n + 1, false);
+    do {
+      used[column] = true;
+      const auto currentRow = rowForColumn[column];
+      int64_t delta = Infinity;
+      std::size_t nextColumn = 0;
+      for (std::size_t j = 1; j <= n; ++j) {
+        if (used[j]) {
+          continue;
+        }
+        const auto slack = costs[currentRow - 1][j - 1]
+          - rowPotential[currentRow] - columnPotential[j];
+        if (slack < minSlack[j]) {
+          minSlack[j] = slack;
+          previousColumn[j] = column;
+        }
+        if (minSlack[j] < delta) {
+          delta = minSlack[j];
+          nextColumn = j;
+        }
+      }
+      for (std::size_t j = 0; j <= n; ++j) {
+        if (used[j]) {
+          rowPotential[rowForColumn[j]] += delta;
+          columnPotential[j] -= delta;
+        } else {
+          minSlack[j] -= delta;
+        }
+      }
+      column = nextColumn;
+    } while (rowForColumn[column] != 0);
+
+    do {
+      const auto previous = previousColumn[column];
+      rowForColumn[column] = rowForColumn[previous];
+      column = previous;
+    } while (column != 0);
+  }
+
+  std::vector<std::size_t> ret(n);
+  for (std::size_t j = 1; j <= n; ++j) {
+    ret[rowForColumn[j] - 1] = j - 1;
+  }
+  return ret;
+}
+
+AdapterRemapTable CreateRemapTable(
+  const std::vector<DXGI_ADAPTER_DESC1>& saved,
+  const std::vector<DXGI_ADAPTER_DESC1>& current) {
+  std::vector<AdapterRemapTable::Entry> entries;
+  std::vector<bool> savedDone(saved.size(), false);
+  std::vector<bool> currentDone(current.size(), false);
+  const auto assign = [&](std::size_t i, std::size_t j, int32_t score) {
+    entries.push_back({
+      .mSaved = saved.at(i).AdapterLuid,
+      .mCurrent = current.at(j).AdapterLuid,
+      .mScore = score,
+    });
+    savedDone.at(i) = true;
+    currentDone.at(j) = true;
+  };
+
+  // Fast path: if a model has as many adapters as before, keep the adapters
+  // whose LUIDs haven't changed, then pair off the rest in order
+  const auto savedModels = CreateModelIndex(saved);
+  const auto currentModels = CreateModelIndex(current);
+  for (const auto& [model, savedIndices]: savedModels) {
+    const auto it = currentModels.find(model);
+    if (it == currentModels.end() || it->second.size() != savedIndices.size()) {
+      continue;
+    }
+    const auto& currentIndices = it->second;
+    for (const auto i: savedIndices) {
+      for (const auto j: currentIndices) {
+        if (
+          (!currentDone.at(j))
+          && ToUInt64(saved.at(i).AdapterLuid)
+            == ToUInt64(current.at(j).AdapterLuid)) {
+          assign(i, j, *GetBaseScore(saved.at(i), current.at(j)));
+          break;
+        }
+      }
+    }
+    auto next = currentIndices.begin();
+    for (const auto i: savedIndices) {
+      if (savedDone.at(i)) {
+        continue;
+      }
+      while (currentDone.at(*next)) {
+        ++next;
+      }
+      assign(i, *next, *GetBaseScore(saved.at(i), current.at(*next)));
+    }
+  }
+
+  // Everything else is scored, and assigned as a whole
+  std::vector<std::size_t> rows;
+  std::vector<std::size_t> columns;
+  for (std::size_t i = 0; i < saved.size(); ++i) {
+    if (!savedDone.at(i)) {
+      rows.push_back(i);
+    }
+  }
+  for (std::size_t j = 0; j < current.size(); ++j) {
+    if (!currentDone.at(j)) {
+      columns.push_back(j);
+    }
+  }
+  if (rows.empty() || columns.empty()) {
+    return AdapterRemapTable {std::move(entries)};
+  }
+
+  // Leaving an adapter unmatched costs `MaxScore`, so it's better than any
+  // incompatible match, and worse than any compatible one
+  const auto size = std::max(rows.size(), columns.size());
+  std::vector<std::vector<int64_t>> costs(
+    size, std::vector<int64_t>(size, MaxScore));
+  std::vector<std::vector<std::optional<int32_t>>> scores(
+    rows.size(), std::vector<std::optional<int32_t>>(columns.size()));
+  for (std::size_t r = 0; r < rows.size(); ++r) {
+    for (std::size_t c = 0; c < columns.size(); ++c) {
+      const auto base = GetBaseScore(saved.at(rows[r]), current.at(columns[c]));
+      if (!base) {
+        costs[r][c] = MaxScore + 1;
+        continue;
+      }
+      // Prefer keeping the relative order
+      const auto distance = static_cast<int32_t>(
+        (r > c) ? (r - c) : (c - r));
+      const auto score
+        = *base - std::min<int32_t>(distance, PositionScale - 1);
+      scores[r][c] = score;
+      costs[r][c] = MaxScore - score;
+    }
+  }
+
+  const auto assignment = SolveAssignment(costs);
+  for (std::size_t r = 0; r < rows.size(); ++r) {
+    const auto c = assignment.at(r);
+    if (c < columns.size() && scores[r][c]) {
+      assign(rows[r], columns[c], *scores[r][c]);
+    }
+  }
+  return AdapterRemapTable {std::move(entries)};
+}
+
+bool IsSameAdapters(
+  const std::vector<DXGI_ADAPTER_DESC1>& a,
+  const std::vector<DXGI_ADAPTER_DESC1>& b) {
+  // Not `memcmp()`, as `DXGI_ADAPTER_DESC1` has padding
+  return std::ranges::equal(a, b, &FieldsEqual<DXGI_ADAPTER_DESC1>);
+}
+
+struct CachedTable {
+  std::vector<DXGI_ADAPTER_DESC1> mSaved;
+  std::vector<DXGI_ADAPTER_DESC1> mCurrent;
+  AdapterRemapTable mTable;
+};
+
+std::mutex sCacheMutex;
+
+/// Constructed on first use, as MSVC's `unordered_map` allocates even when
+/// it's empty
+std::unordered_map<uint64_t, CachedTable>& GetCache() {
+  static std::unordered_map<uint64_t, CachedTable> sCache;
+  return sCache;
+}
+
+uint64_t GetAdapterSetFingerprint(
+  const std::vector<DXGI_ADAPTER_DESC1>& saved,
+  const std::vector<DXGI_ADAPTER_DESC1>& current) {
+  // `HashFields()` rather than the raw structs, which have padding
+  std::string buffer;
+  const auto append = [&buffer](const auto& adapters) {
+    const uint64_t count = adapters.size();
+    buffer.append(reinterpret_cast<const char*>(&count), sizeof(count));
+    for (const auto& it: adapters) {
+      const auto hash = HashFields(it);
+      buffer.append(reinterpret_cast<const char*>(&hash), sizeof(hash));
+    }
+  };
+  append(saved);
+  append(current);
+  return HashProfileContents(buffer);
+}
+
+}// namespace
+
+AdapterRemapTable::AdapterRemapTable(std::vector<Entry> entries)
+  : mEntries(std::move(entries)) {
+  std::ranges::sort(mEntries, {}, [](const Entry& entry) {
+    return ToUInt64(entry.mSaved);
+  });
+}
+
+std::optional<LUID> AdapterRemapTable::Find(const LUID& saved) const noexcept {
+  const auto key = ToUInt64(saved);
+  const auto it = std::ranges::lower_bound(
+    mEntries, key, {}, [](const Entry& entry) {
+      return ToUInt64(entry.mSaved);
+    });
+  if (it == mEntries.end() || ToUInt64(it->mSaved) != key) {
+    return {};
+  }
+  return it->mCurrent;
+}
+
+const std::vector<AdapterRemapTable::Entry>& AdapterRemapTable::GetEntries()
+  const noexcept {
+  return mEntries;
+}
+
+AdapterRemapTable CreateAdapterRemapTable(
+  const std::vector<DXGI_ADAPTER_DESC1>& saved,
+  const std::vector<DXGI_ADAPTER_DESC1>& current) {
+  if (saved.size() > MaxAdapters || current.size() > MaxAdapters) {
+    return {};
+  }
+  return CreateRemapTable(saved, current);
+}
+
+AdapterRemapTable MatchAdapters(
+  const std::vector<DXGI_ADAPTER_DESC1>& saved,
+  const std::vector<DXGI_ADAPTER_DESC1>& current) {
+  const auto fingerprint = GetAdapterSetFingerprint(saved, current);
+  auto& cache = GetCache();
+  {
+    std::unique_lock lock(sCacheMutex);
+    const auto it = cache.find(fingerprint);
+    if (
+      it != cache.end() && IsSameAdapters(it->second.mSaved, saved)
+      && IsSameAdapters(it->second.mCurrent, current)) {
+      return it->second.mTable;
+    }
+  }
+
+  auto table = CreateAdapterRemapTable(saved, current);
+
+  std::unique_lock lock(sCacheMutex);
+  if (cache.size() >= MaxCachedTables) {
+    cache.clear();
+  }
+  cache.insert_or_assign(fingerprint, CachedTable {saved, current, table});
+  return table;
+}
+
+}// namespace FredEmmott::MonitorTool
@@ -0,0 +1,362 @@
+// Copyright 2024, Fred Emmott
+// SPDX-License-Identifier: ISC
+
+#include <FredEmmott/MonitorTool/AdapterMatcher.hpp>
+#include <FredEmmott/MonitorTool/ApplyProfile.hpp>
+#include <FredEmmott/MonitorTool/ApplyStats.hpp>
+#include <FredEmmott/MonitorTool/DisplayConfigDiff.hpp>
+#include <FredEmmott/MonitorTool/EnumAdapterDescs.hpp>
+#include <FredEmmott/MonitorTool/QueryDisplayConfig.hpp>
+#include <FredEmmott/MonitorTool/SetDisplayConfig.hpp>
+#include <FredEmmott/MonitorTool/Trace.hpp>
+#include <FredEmmott/MonitorTool/ValidationCache.hpp>
+
+#include <algorithm>
+#include <cstring>
+#include <future>
+#include <mutex>
+#include <optional>
+#include <utility>
+
+#include <Windows.h>
+
+inline bool operator==(const LUID& a, const LUID& b) {
+  return memcmp(&a, &b, sizeof(LUID)) == 0;
+}
+
+namespace FredEmmott::MonitorTool {
+
+namespace {
+
+std::optional<Profile> UpdateLUIDs(
+  const Profile& in,
+  const std::vector<DXGI_ADAPTER_DESC1>& currentAdapters) {
+  TraceSpan span {"UpdateLUIDs"};
+  const auto remap = MatchAdapters(in.mAdapters, currentAdapters);
+  Profile ret {in};
+  ret.mAdapters = currentAdapters;
+
+  bool mappedAll = true;
+  ret.mDisplayConfig.VisitLUIDs([&](LUID& luid) {
+    if (!mappedAll) {
+      return;
+    }
+    if (const auto it = remap.Find(luid)) {
+      luid = *it;
+      return;
+    }
+    // Not in the saved adapter list, but still present
+    if (
+      std::ranges::find(currentAdapters, luid, &DXGI_ADAPTER_DESC1::AdapterLuid)
+      != currentAdapters.end()) {
+      return;
+    }
+    mappedAll = false;
+  });
+  if (!mappedAll) {
+    return {};
+  }
+
+  return ret;
+}
+
+std::optional<Profile> MoveAdapterlessProfileToSingleGPU(
+  const Profile& in,
+  const std::vector<DXGI_ADAPTER_DESC1>& allAdapters) {
+  if (!in.mAdapters.empty()) {
+    return {};
+  }
+  const auto badFlags = DXGI_ADAPTER_FLAG_REMOTE | DXGI_ADAPTER_FLAG_SOFTWARE;
+  std::vector<DXGI_ADAPTER_DESC1> realAdapters;
+  for (const auto& it: allAdapters) {
+    if ((it.Flags & badFlags) == 0) {
+      realAdapters.push_back(it);
+    }
+  }
+  if (realAdapters.size() != 1) {
+    return {};
+  }
+
+  const auto replacement = realAdapters.front().AdapterLuid;
+  Profile ret {in};
+  ret.mDisplayConfig.VisitLUIDs([&](LUID& luid) { luid = replacement; });
+  ret.mAdapters = allAdapters;
+  return ret;
+}
+
+template <class T>
+bool IsSameBytes(const std::vector<T>& a, const std::vector<T>& b) {
+  return a.size() == b.size()
+    && (a.empty() || memcmp(a.data(), b.data(), a.size() * sizeof(T)) == 0);
+}
+
+bool IsSameDisplayConfig(const DisplayConfig& a, const DisplayConfig& b) {
+  return IsSameBytes(a.mPaths, b.mPaths) && IsSameBytes(a.mModes, b.mModes);
+}
+
+}// namespace
+
+std::string_view ToString(ApplyPlan::Strategy strategy) {
+  switch (strategy) {
+    case ApplyPlan::Strategy::None:
+      return "none";
+    case ApplyPlan::Strategy::AsSaved:
+      return "as saved";
+    case ApplyPlan::Strategy::SingleGPU:
+      return "moved to the only GPU";
+    case ApplyPlan::Strategy::RemappedLUIDs:
+      return "remapped adapters";
+  }
+  return "unknown";
+}
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+// Validation is a driver call; there's nothing to gain from making several
+// at once, but planning around it can run in parallel
+std::mutex sValidationMutex;
+
+bool Validate(ApplyPlan::Strategy strategy, const Profile& candidate) {
+  TraceSpan span {"Validate", ToString(strategy)};
+  std::unique_lock lock(sValidationMutex);
+  return candidate.CanApply();
+}
+
+ApplyPlan CreatePlan(
+  const Profile& profile,
+  const ApplySystemState& system,
+  bool useCache) {
+  TraceSpan span {"PlanApply"};
+  ApplyPlan plan {
+    .mSource = profile,
+    .mCurrent = system.mCurrent,
+    .mDriverVersionHash = GetDriverVersionHash(system.mAdapters),
+  };
+  for (const auto& it: system.mAdapters) {
+    plan.mAdapters.push_back(it.mDesc);
+  }
+  auto start = Clock::now();
+
+  std::vector<std::pair<ApplyPlan::Strategy, Profile>> candidates;
+  candidates.emplace_back(ApplyPlan::Strategy::AsSaved, profile);
+  if (auto it = MoveAdapterlessProfileToSingleGPU(profile, plan.mAdapters)) {
+    candidates.emplace_back(ApplyPlan::Strategy::SingleGPU, std::move(*it));
+  }
+  if (auto it = UpdateLUIDs(profile, plan.mAdapters)) {
+    candidates.emplace_back(ApplyPlan::Strategy::RemappedLUIDs, std::move(*it));
+  }
+
+  const auto choose = [&plan](auto& candidate) {
+    plan.mDifferences
+      = DiffDisplayConfig(plan.mCurrent, candidate.second.mDisplayConfig);
+    plan.mStrategy = candidate.first;
+    plan.mProfile = std::move(candidate.second);
+  };
+
+  // An active candidate wins without needing validation
+  for (auto& candidate: candidates) {
+    if (DiffDisplayConfig(plan.mCurrent, candidate.second.mDisplayConfig)
+          .empty()) {
+      choose(candidate);
+      plan.mTimings.mPlan = Clock::now() - start;
+      return plan;
+    }
+  }
+
+  plan.mCacheKey
+    = GetValidationCacheKey(profile, system.mAdapters, system.mAllPaths);
+  if (const auto cached
+      = useCache ? LoadCachedValidation(plan.mCacheKey) : std::nullopt) {
+    const auto it
+      = std::ranges::find(candidates, *cached, [](const auto& candidate) {
+          return candidate.first;
+        });
+    if (it != candidates.end()) {
+      choose(*it);
+      plan.mFromCache = true;
+      plan.mTimings.mPlan = Clock::now() - start;
+      return plan;
+    }
+  }
+  auto now = Clock::now();
+  plan.mTimings.mPlan = now - start;
+  start = now;
+
+  std::vector<const DisplayConfig*> validated;
+  for (auto& candidate: candidates) {
+    const auto& config = candidate.second.mDisplayConfig;
+    // e.g. remapping didn't change anything, as the LUIDs were current
+    const auto isDuplicate
+      = std::ranges::any_of(validated, [&config](const DisplayConfig* it) {
+          return IsSameDisplayConfig(*it, config);
+        });
+    if (isDuplicate) {
+      continue;
+    }
+    validated.push_back(&config);
+
+    ++plan.mValidationCount;
+    if (!Validate(candidate.first, candidate.second)) {
+      continue;
+    }
+    StoreCachedValidation(plan.mCacheKey, candidate.first);
+    choose(candidate);
+    break;
+  }
+  plan.mTimings.mValidate = Clock::now() - start;
+
+  return plan;
+}
+
+}// namespace
+
+ApplySystemState ApplySystemState::GetCurrent() {
+  TraceSpan span {"ApplySystemState::GetCurrent"};
+  // DXGI factory creation is slow enough to be worth overlapping with
+  // `QueryDisplayConfig()`
+  auto adapters = std::async(std::launch::async, &EnumAdapters);
+  auto allPaths = std::async(
+    std::launch::async, [] { return QueryDisplayConfig(QDC_ALL_PATHS); });
+  ApplySystemState ret {.mCurrent = QueryDisplayConfig()};
+  ret.mAllPaths = allPaths.get();
+  ret.mAdapters = adapters.get();
+  return ret;
+}
+
+ApplySystemState ApplySystemState::GetCurrent(
+  std::vector<AdapterInfo> adapters) {
+  TraceSpan span {"ApplySystemState::GetCurrent", "known adapters"};
+  auto allPaths = std::async(
+    std::launch::async, [] { return QueryDisplayConfig(QDC_ALL_PATHS); });
+  ApplySystemState ret {
+    .mCurrent = QueryDisplayConfig(),
+    .mAdapters = std::move(adapters),
+  };
+  ret.mAllPaths = allPaths.get();
+  return ret;
+}
+
+ApplyPlan PlanApply(const Profile& profile, bool useValidationCache) {
+  const auto start = Clock::now();
+  const auto system = ApplySystemState::GetCurrent();
+  const auto gather = Clock::now() - start;
+
+  auto plan = CreatePlan(profile, system, useValidationCache);
+  plan.mTimings.mGather = gather;
+  return plan;
+}
+
+ApplyPlan PlanApply(
+  const Profile& profile,
+  const ApplySystemState& system,
+  bool useValidationCache) {
+  return CreatePlan(profile, system, useValidationCache);
+}
+
+ApplyPlan ApplySession::Plan(const Profile& profile) {
+  const auto start = Clock::now();
+  const auto haveAdapters = mAdapters.has_value();
+  auto system = haveAdapters ? ApplySystemState::GetCurrent(*mAdapters)
+                             : ApplySystemState::GetCurrent();
+  const auto gather = Clock::now() - start;
+
+  auto plan = CreatePlan(profile, system, true);
+  plan.mTimings.mGather = gather;
+  if (haveAdapters && !plan.mProfile) {
+    mAdapters.reset();
+    return this->Plan(profile);
+  }
+  mAdapters = std::move(system.mAdapters);
+  return plan;
+}
+
+namespace {
+
+/// Whether Windows will restore `config` for these displays, e.g. after a
+/// reboot
+bool IsSavedToDatabase(const DisplayConfig& config) {
+  try {
+    return DiffDisplayConfig(
+             QueryDisplayConfig(QDC_DATABASE_CURRENT | QDC_VIRTUAL_MODE_AWARE),
+             config)
+      .empty();
+  } catch (const RuntimeError&) {
+    // Save it to find out
+    return false;
+  }
+}
+
+std::optional<ApplyResult>
+Execute(ApplyPlan& plan, ApplyMode applyMode, bool saveUpdates) {
+  if (!plan.mProfile) {
+    return {};
+  }
+  TraceSpan span {"ExecuteApplyPlan", ToString(plan.mStrategy)};
+
+  const auto start = std::chrono::steady_clock::now();
+  ApplyResult ret {
+    .mChanged = !plan.mDifferences.empty(),
+    .mDifferences = plan.mDifferences,
+  };
+  if (
+    (!ret.mChanged) && applyMode == ApplyMode::Persistent
+    && !IsSavedToDatabase(plan.mProfile->mDisplayConfig)) {
+    // Already active, but e.g. a temporary apply left something else saved
+    ret.mChanged = true;
+    ret.mDifferences.push_back("saved as the persistent configuration");
+  }
+  if (ret.mChanged) {
+    auto flags = SetDisplayConfigApplyFlags;
+    if (applyMode == ApplyMode::Persistent) {
+      flags |= SDC_SAVE_TO_DATABASE;
+    }
+    try {
+      SetDisplayConfig(plan.mProfile->mDisplayConfig, flags);
+    } catch (const RuntimeError&) {
+      if (!plan.mFromCache) {
+        throw;
+      }
+      // Something the cache key doesn't cover changed; find out what works
+      // now, the slow way
+      RemoveCachedValidation(plan.mCacheKey);
+      plan = PlanApply(plan.mSource, ApplySystemState::GetCurrent(), false);
+      return Execute(plan, applyMode, saveUpdates);
+    }
+  }
+  if (saveUpdates && plan.mStrategy != ApplyPlan::Strategy::AsSaved) {
+    plan.mProfile->Save();
+  }
+  plan.mTimings.mApply = std::chrono::steady_clock::now() - start;
+  return ret;
+}
+
+}// namespace
+
+std::optional<ApplyResult>
+ExecuteApplyPlan(ApplyPlan& plan, ApplyMode applyMode, bool saveUpdates) {
+  try {
+    auto ret = Execute(plan, applyMode, saveUpdates);
+    if (!ret) {
+      RecordApplyStats(plan, ApplyOutcome::CannotApply);
+    } else {
+      RecordApplyStats(
+        plan, ret->mChanged ? ApplyOutcome::Applied : ApplyOutcome::Unchanged);
+    }
+    return ret;
+  } catch (...) {
+    RecordApplyStats(plan, ApplyOutcome::Failed);
+    throw;
+  }
+}
+
+std::optional<ApplyResult> ApplyProfileWithAdapterFixups(
+  const Profile& profile,
+  ApplyMode applyMode,
+  bool saveUpdates) {
+  auto plan = PlanApply(profile);
+  return ExecuteApplyPlan(plan, applyMode, saveUpdates);
+}
+
+}// namespace FredEmmott::MonitorTool
@@ -0,0 +1,327 @@
+// Copyright 2024, Fred Emmott
+// SPDX-License-Identifier: ISC
+
+#include <FredEmmott/MonitorTool/ApplyStats.hpp>
+#include <FredEmmott/MonitorTool/Paths.hpp>
+
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <cmath>
+#include <filesystem>
+#include <fstream>
+#include <memory>
+#include <numeric>
+#include <type_traits>
+
+#include <Windows.h>
+
+namespace FredEmmott::MonitorTool {
+
+namespace {
+
+// 'FMTS'
+constexpr uint32_t StatsMagic = 0x53544d46;
+// Increment if the layout or the bucketing changes
+constexpr uint32_t StatsVersion = 1;
+// Driver versions per profile; the least recently used is replaced
+constexpr std::size_t EpochCount = 4;
+
+struct StatsEpoch {
+  /// Zero if unused
+  uint64_t mDriverVersionHash;
+  /// Seconds since the Unix epoch
+  uint64_t mFirstApplied;
+  uint64_t mLastApplied;
+  std::array<uint32_t, ApplyOutcomeCount> mOutcomes;
+  std::array<
+    std::array<uint32_t, LatencyHistogram::BucketCount>,
+    ApplyPhaseCount>
+    mBuckets;
+};
+
+struct StatsFile {
+  uint32_t mMagic;
+  uint32_t mVersion;
+  std::array<StatsEpoch, EpochCount> mEpochs;
+};
+static_assert(std::is_trivially_copyable_v<StatsFile>);
+
+// The file is shared memory between processes; these must not fall back to
+// locks, as a lock wouldn't be shared
+static_assert(std::atomic_ref<uint32_t>::is_always_lock_free);
+static_assert(std::atomic_ref<uint64_t>::is_always_lock_free);
+
+template <class T>
+std::atomic_ref<T> Atomic(T& value) {
+  return std::atomic_ref<T> {value};
+}
+
+std::filesystem::path GetStatsRoot() {
+  return GetDataPath() / "Stats";
+}
+
+std::filesystem::path GetStatsPath(const winrt::guid& guid) {
+  // Strip the braces
+  const auto guidStr = winrt::to_string(winrt::to_hstring(guid));
+  return GetStatsRoot() / (guidStr.substr(1, guidStr.size() - 2) + ".fmts");
+}
+
+uint64_t GetUnixTime() {
+  return std::chrono::duration_cast<std::chrono::seconds>(
+           std::chrono::system_clock::now().time_since_epoch())
+    .count();
+}
+
+ApplyStats::TimePoint FromUnixTime(uint64_t seconds) {
+  return ApplyStats::TimePoint {std::chrono::seconds {seconds}};
+}
+
+/// Claim the header of a new file, or check an existing one
+bool CheckHeader(StatsFile& stats) {
+  uint32_t magic = 0;
+  Atomic(stats.mMagic).compare_exchange_strong(magic, StatsMagic);
+  if (magic != 0 && magic != StatsMagic) {
+    return false;
+  }
+  uint32_t version = 0;
+  Atomic(stats.mVersion).compare_exchange_strong(version, StatsVersion);
+  return version == 0 || version == StatsVersion;
+}
+
+void ResetEpoch(StatsEpoch& epoch, uint64_t now) {
+  Atomic(epoch.mFirstApplied).store(now);
+  for (auto& it: epoch.mOutcomes) {
+    Atomic(it).store(0);
+  }
+  for (auto& phase: epoch.mBuckets) {
+    for (auto& it: phase) {
+      Atomic(it).store(0);
+    }
+  }
+}
+
+/** The epoch for `hash`, claiming or replacing one if needed.
+ *
+ * Returns null if another process replaced the same epoch at the same time;
+ * losing one sample is fine.
+ */
+StatsEpoch* GetEpoch(StatsFile& stats, uint64_t hash, uint64_t now) {
+  for (auto& it: stats.mEpochs) {
+    if (Atomic(it.mDriverVersionHash).load() == hash) {
+      return &it;
+    }
+  }
+  for (auto& it: stats.mEpochs) {
+    uint64_t previous = 0;
+    auto claimed = Atomic(it.mDriverVersionHash);
+    if (claimed.compare_exchange_strong(previous, hash)) {
+      Atomic(it.mFirstApplied).store(now);
+      return &it;
+    }
+    if (previous == hash) {
+      return &it;
+    }
+  }
+
+  auto& oldest = *std::ranges::min_element(
+    stats.mEpochs,
+    {},
+    [](StatsEpoch& it) { return Atomic(it.mLastApplied).load(); });
+  auto previous = Atomic(oldest.mDriverVersionHash).load();
+  if (previous == hash) {
+    return &oldest;
+  }
+  if (!Atomic(oldest.mDriverVersionHash)
+         .compare_exchange_strong(previous, hash)) {
+    return (previous == hash) ? &oldest : nullptr;
+  }
+  ResetEpoch(oldest, now);
+  return &oldest;
+}
+
+}// namespace
+
+std::string_view ToString(ApplyOutcome outcome) {
+  switch (outcome) {
+    case ApplyOutcome::Unchanged:
+      return "unchanged";
+    case ApplyOutcome::Applied:
+      return "applied";
+    case ApplyOutcome::CannotApply:
+      return "can't apply";
+    case ApplyOutcome::Failed:
+      return "failed";
+  }
+  return "unknown";
+}
+
+std::string_view ToString(ApplyPhase phase) {
+  switch (phase) {
+    case ApplyPhase::Gather:
+      return "gather";
+    case ApplyPhase::Plan:
+      return "plan";
+    case ApplyPhase::Validate:
+      return "validate";
+    case ApplyPhase::Apply:
+      return "apply";
+    case ApplyPhase::Total:
+      return "total";
+  }
+  return "unknown";
+}
+
+std::size_t LatencyHistogram::GetBucket(Duration duration) noexcept {
+  const auto us
+    = static_cast<uint64_t>(std::max<int64_t>(duration.count(), 0));
+  if (us < 4) {
+    return static_cast<std::size_t>(us);
+  }
+  // At least 2; the top two bits below the leading one pick the sub-bucket
+  const auto exponent = static_cast<std::size_t>(std::bit_width(us) - 1);
+  const auto sub = static_cast<std::size_t>((us >> (exponent - 2)) & 3);
+  const auto bucket = (4 * (exponent - 1)) + sub;
+  return std::min(bucket, BucketCount - 1);
+}
+
+LatencyHistogram::Duration LatencyHistogram::GetBucketUpperBound(
+  std::size_t bucket) noexcept {
+  if (bucket < 4) {
+    return Duration {bucket + 1};
+  }
+  const auto exponent = (bucket / 4) + 1;
+  const auto sub = bucket % 4;
+  return Duration {static_cast<int64_t>((5 + sub) << (exponent - 2))};
+}
+
+uint64_t LatencyHistogram::GetCount() const noexcept {
+  return std::accumulate(mBuckets.begin(), mBuckets.end(), uint64_t {0});
+}
+
+LatencyHistogram::Duration LatencyHistogram::GetPercentile(
+  double percentile) const noexcept {
+  const auto count = this->GetCount();
+  if (count == 0) {
+    return {};
+  }
+  const auto rank = std::max<uint64_t>(
+    1, static_cast<uint64_t>(std::ceil(count * (percentile / 100))));
+  uint64_t seen = 0;
+  for (std::size_t i = 0; i < BucketCount; ++i) {
+    seen += mBuckets[i];
+    if (seen >= rank) {
+      return GetBucketUpperBound(i);
+    }
+  }
+  return GetBucketUpperBound(BucketCount - 1);
+}
+
+void RecordApplyStats(const ApplyPlan& plan, ApplyOutcome outcome) noexcept {
+  try {
+    const auto path = GetStatsPath(plan.mSource.mGuid);
+    std::error_code ec;
+    std::filesystem::create_directories(path.parent_path(), ec);
+
+    winrt::file_handle file {CreateFileW(
+      path.c_str(),
+      GENERIC_READ | GENERIC_WRITE,
+      FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
+      nullptr,
+      OPEN_ALWAYS,
+      FILE_ATTRIBUTE_NORMAL,
+      NULL)};
+    if (!file) {
+      return;
+    }
+    // Extends new files to the full size, filled with zeroes
+    winrt::handle mapping {CreateFileMappingW(
+      file.get(), nullptr, PAGE_READWRITE, 0, sizeof(StatsFile), nullptr)};
+    if (!mapping) {
+      return;
+    }
+    const std::unique_ptr<void, decltype(&UnmapViewOfFile)> view {
+      MapViewOfFile(mapping.get(), FILE_MAP_WRITE, 0, 0, sizeof(StatsFile)),
+      &UnmapViewOfFile};
+    if (!view) {
+      return;
+    }
+
+    auto& stats = *static_cast<StatsFile*>(view.get());
+    if (!CheckHeader(stats)) {
+      return;
+    }
+    const auto now = GetUnixTime();
+    const auto epoch = GetEpoch(stats, plan.mDriverVersionHash, now);
+    if (!epoch) {
+      return;
+    }
+
+    Atomic(epoch->mOutcomes.at(static_cast<std::size_t>(outcome)))
+      .fetch_add(1);
+    const auto& timings = plan.mTimings;
+    const std::array<ApplyTimings::Duration, ApplyPhaseCount> durations {
+      timings.mGather,
+      timings.mPlan,
+      timings.mValidate,
+      timings.mApply,
+      timings.mGather + timings.mPlan + timings.mValidate + timings.mApply,
+    };
+    for (std::size_t i = 0; i < ApplyPhaseCount; ++i) {
+      const auto bucket = LatencyHistogram::GetBucket(
+        std::chrono::duration_cast<LatencyHistogram::Duration>(durations[i]));
+      Atomic(epoch->mBuckets[i][bucket]).fetch_add(1);
+    }
+    Atomic(epoch->mLastApplied).store(now);
+  } catch (...) {
+  }
+}
+
+std::vector<ApplyStats> LoadApplyStats() {
+  std::vector<ApplyStats> ret;
+  std::error_code ec;
+  for (const auto& entry:
+       std::filesystem::directory_iterator(GetStatsRoot(), ec)) {
+    const auto& path = entry.path();
+    if (path.extension() != ".fmts") {
+      continue;
+    }
+    winrt::guid guid;
+    try {
+      guid = winrt::guid {path.stem().string()};
+    } catch (const std::invalid_argument&) {
+      continue;
+    }
+
+    // Not atomic, but a torn read only skews a count by one
+    auto stats = std::make_unique<StatsFile>();
+    std::ifstream f {path, std::ios::binary};
+    f.read(reinterpret_cast<char*>(stats.get()), sizeof(StatsFile));
+    if (
+      f.gcount() != sizeof(StatsFile) || stats->mMagic != StatsMagic
+      || stats->mVersion != StatsVersion) {
+      continue;
+    }
+
+    for (const auto& epoch: stats->mEpochs) {
+      if (epoch.mDriverVersionHash == 0) {
+        continue;
+      }
+      ApplyStats it {
+        .mGuid = guid,
+        .mDriverVersionHash = epoch.mDriverVersionHash,
+        .mFirstApplied = FromUnixTime(epoch.mFirstApplied),
+        .mLastApplied = FromUnixTime(epoch.mLastApplied),
+        .mOutcomes = epoch.mOutcomes,
+      };
+      for (std::size_t i = 0; i < ApplyPhaseCount; ++i) {
+        it.mPhases[i].mBuckets = epoch.mBuckets[i];
+      }
+      ret.push_back(std::move(it));
+    }
+  }
+  std::ranges::sort(ret, {}, &ApplyStats::mFirstApplied);
+  return ret;
+}
+
+}// namespace FredEmmott::MonitorTool
@@ -0,0 +1,1043 @@
+// Copyright 2024, Fred Emmott
+// SPDX-License-Identifier: ISC
+
+#include <FredEmmott/MonitorTool/DisplayConfigSchema.hpp>
+#include <FredEmmott/MonitorTool/ParallelTransform.hpp>
+#include <FredEmmott/MonitorTool/Paths.hpp>
+#include <FredEmmott/MonitorTool/ProfileCache.hpp>
+#include <FredEmmott/MonitorTool/ProfileIndex.hpp>
+#include <FredEmmott/MonitorTool/ProfileStore.hpp>
+#include <FredEmmott/MonitorTool/json.hpp>
+#include <winrt/base.h>
+
+#include <algorithm>
+#include <cstring>
+#include <format>
+#include <memory>
+#include <stdexcept>
+#include <type_traits>
+#include <unordered_map>
+
+#include <Windows.h>
+
+namespace FredEmmott::MonitorTool {
+
+namespace {
+
+// 'FMTB'
+constexpr uint32_t BundleMagic = 0x42544d46;
+// 'FMTR'
+constexpr uint32_t RecordMagic = 0x52544d46;
+// 'FMTI'
+constexpr uint32_t IndexMagic = 0x49544d46;
+// Increment if the layout changes
+constexpr uint32_t BundleVersion = 3;
+// Pooled, but the index doesn't have fingerprints
+constexpr uint32_t PooledBundleVersion = 2;
+// Every profile was JSON, and there was no pool
+constexpr uint32_t LegacyBundleVersion = 1;
+
+enum RecordKind : uint32_t {
+  /// Profile JSON
+  PutRecord = 1,
+  RemoveRecord = 2,
+  /** A `PooledRecordType`, then the record as-is.
+   *
+   * Identified by `RecordHeader::mPayloadHash`, and shared by any number of
+   * profiles.
+   */
+  PoolRecord = 3,
+  /** A `PooledProfileHeader`, the name, then the hash of the `PoolRecord` for
+   * each adapter, path, and mode.
+   */
+  PutPooledRecord = 4,
+};
+
+enum PooledRecordType : uint32_t {
+  PooledAdapter = 1,
+  PooledPath = 2,
+  PooledMode = 3,
+};
+
+struct PooledProfileHeader {
+  uint32_t mNameLength {};
+  uint32_t mAdapterCount {};
+  uint32_t mPathCount {};
+  uint32_t mModeCount {};
+};
+
+// Compact when the garbage is at least this large, and larger than the live
+// records
+constexpr uint64_t AutoCompactThreshold = 1024 * 1024;
+
+struct FileHeader {
+  uint32_t mMagic {BundleMagic};
+  uint32_t mVersion {BundleVersion};
+};
+
+// Followed by `mPayloadSize` bytes, as described by `mKind`
+struct RecordHeader {
+  uint32_t mMagic {RecordMagic};
+  uint32_t mKind {};
+  GUID mGuid {};
+  uint64_t mPayloadSize {};
+  uint64_t mPayloadHash {};
+};
+
+// Followed by `mNameLength` bytes of UTF-8, then a `DisplayConfigFingerprint`
+// unless it's from an older version
+struct IndexEntry {
+  GUID mGuid {};
+  uint64_t mPayloadOffset {};
+  uint64_t mPayloadSize {};
+  uint32_t mNameLength {};
+  /// `PutRecord` or `PutPooledRecord`; zero in legacy bundles
+  uint32_t mKind {};
+};
+
+// Follows the `IndexEntry`s
+struct PoolIndexEntry {
+  uint64_t mHash {};
+  uint64_t mPayloadOffset {};
+  uint64_t mPayloadSize {};
+};
+
+// The last bytes of the file
+struct Footer {
+  uint64_t mIndexOffset {};
+  uint64_t mEntryCount {};
+  uint64_t mPoolEntryCount {};
+  uint32_t mMagic {IndexMagic};
+  uint32_t mVersion {BundleVersion};
+};
+
+struct LegacyFooter {
+  uint64_t mIndexOffset {};
+  uint64_t mEntryCount {};
+  uint32_t mMagic {IndexMagic};
+  uint32_t mVersion {LegacyBundleVersion};
+};
+
+static_assert(std::is_trivially_copyable_v<RecordHeader>);
+static_assert(std::is_trivially_copyable_v<PooledProfileHeader>);
+static_assert(std::is_trivially_copyable_v<IndexEntry>);
+static_assert(std::is_trivially_copyable_v<DisplayConfigFingerprint>);
+static_assert(std::is_trivially_copyable_v<PoolIndexEntry>);
+static_assert(std::is_trivially_copyable_v<Footer>);
+static_assert(std::is_trivially_copyable_v<LegacyFooter>);
+
+// Windows byte-range locks are mandatory, so lock a byte far beyond any data
+// instead of the data itself
+constexpr DWORD LockOffsetHigh = 0xffffffff;
+
+template <class T>
+void AppendBytes(std::string& buffer, const T& value) {
+  buffer.append(reinterpret_cast<const char*>(&value), sizeof(T));
+}
+
+/** Canonicalized, so that records which only differ in padding or inactive
+ * union members have the same bytes, and so share a pool entry.
+ */
+template <class T>
+std::string EncodePooledRecord(PooledRecordType type, const T& record) {
+  std::string ret;
+  AppendBytes(ret, type);
+  AppendBytes(ret, CanonicalizeFields(record));
+  return ret;
+}
+
+template <class T>
+bool DecodePooledRecord(
+  std::string_view payload,
+  PooledRecordType type,
+  T& record) {
+  uint32_t actualType {};
+  if (payload.size() != sizeof(actualType) + sizeof(T)) {
+    return false;
+  }
+  memcpy(&actualType, payload.data(), sizeof(actualType));
+  if (actualType != type) {
+    return false;
+  }
+  memcpy(&record, payload.data() + sizeof(actualType), sizeof(T));
+  return true;
+}
+
+template <class TFooter, class TView>
+bool HasFooter(const TView& view, uint64_t indexOffset) {
+  const auto footer = view.template ReadAt<TFooter>(
+    view.GetSize() - sizeof(TFooter));
+  return footer && footer->mMagic == IndexMagic
+    && footer->mIndexOffset == indexOffset;
+}
+
+std::filesystem::path GetJournalPath(const std::filesystem::path& bundle) {
+  auto ret = bundle;
+  ret += ".compact";
+  return ret;
+}
+
+}// namespace
+
+class BundleProfileStore::FileLock final {
+ public:
+  FileLock(HANDLE file, bool exclusive) : mFile(file) {
+    OVERLAPPED overlapped {};
+    overlapped.OffsetHigh = LockOffsetHigh;
+    if (!LockFileEx(
+          mFile,
+          exclusive ? LOCKFILE_EXCLUSIVE_LOCK : 0,
+          0,
+          1,
+          0,
+          &overlapped)) {
+      throw FileOpenError(
+        std::format("Failed to lock profile bundle: {}", GetLastError()));
+    }
+  }
+
+  ~FileLock() {
+    OVERLAPPED overlapped {};
+    overlapped.OffsetHigh = LockOffsetHigh;
+    UnlockFileEx(mFile, 0, 1, 0, &overlapped);
+  }
+
+  FileLock(const FileLock&) = delete;
+  FileLock& operator=(const FileLock&) = delete;
+
+ private:
+  HANDLE mFile {};
+};
+
+class BundleProfileStore::View final {
+ public:
+  explicit View(HANDLE file) {
+    LARGE_INTEGER size {};
+    if (!GetFileSizeEx(file, &size)) {
+      throw FileReadError(
+        std::format("Failed to get profile bundle size: {}", GetLastError()));
+    }
+    mSize = static_cast<uint64_t>(size.QuadPart);
+    if (mSize == 0) {
+      // Can't map empty files
+      return;
+    }
+
+    mMapping = winrt::handle {
+      CreateFileMappingW(file, nullptr, PAGE_READONLY, 0, 0, nullptr)};
+    if (!mMapping) {
+      throw FileReadError(
+        std::format("Failed to map profile bundle: {}", GetLastError()));
+    }
+    mData = static_cast<const std::byte*>(
+      MapViewOfFile(mMapping.get(), FILE_MAP_READ, 0, 0, 0));
+    if (!mData) {
+      throw FileReadError(
+        std::format("Failed to map profile bundle: {}", GetLastError()));
+    }
+  }
+
+  ~View() {
+    if (mData) {
+      UnmapViewOfFile(mData);
+    }
+  }
+
+  View(const View&) = delete;
+  View& operator=(const View&) = delete;
+
+  uint64_t GetSize() const noexcept {
+    return mSize;
+  }
+
+  template <class T>
+  std::optional<T> ReadAt(uint64_t offset) const noexcept {
+    if (offset > mSize || mSize - offset < sizeof(T)) {
+      return {};
+    }
+    T ret;
+    memcpy(&ret, mData + offset, sizeof(T));
+    return ret;
+  }
+
+  std::optional<std::string_view> GetString(uint64_t offset, uint64_t size)
+    const noexcept {
+    if (offset > mSize || mSize - offset < size) {
+      return {};
+    }
+    return std::string_view {
+      reinterpret_cast<const char*>(mData + offset),
+      static_cast<std::size_t>(size)};
+  }
+
+ private:
+  uint64_t mSize {};
+  winrt::handle mMapping;
+  const std::byte* mData {nullptr};
+};
+
+BundleProfileStore::BundleProfileStore(const std::filesystem::path& path)
+  : mPath(path) {
+  const auto fullPath = GetFileAPIPath(path);
+  mFile = winrt::file_handle {CreateFileW(
+    fullPath.c_str(),
+    GENERIC_READ | GENERIC_WRITE,
+    FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
+    nullptr,
+    OPEN_ALWAYS,
+    FILE_ATTRIBUTE_NORMAL,
+    NULL)};
+  if (!mFile) {
+    const auto ec = GetLastError();
+    throw FileOpenError(
+      std::format("Failed to open `{}`: {}", winrt::to_string(fullPath), ec));
+  }
+}
+
+BundleProfileStore::~BundleProfileStore() = default;
+
+BundleProfileStore::State BundleProfileStore::ReadState(
+  const View& view) const {
+  State ret;
+  const auto size = view.GetSize();
+  if (size == 0) {
+    return ret;
+  }
+
+  const auto header = view.ReadAt<FileHeader>(0);
+  if (
+    (!header) || header->mMagic != BundleMagic
+    || (header->mVersion != BundleVersion
+        && header->mVersion != PooledBundleVersion
+        && header->mVersion != LegacyBundleVersion)) {
+    throw BundleFormatError(std::format(
+      "`{}` is not a supported profile bundle",
+      winrt::to_string(mPath.wstring())));
+  }
+  const auto isLegacy = (header->mVersion == LegacyBundleVersion);
+
+  const auto footerSize = isLegacy ? sizeof(LegacyFooter) : sizeof(Footer);
+  const auto footer = [&]() -> std::optional<Footer> {
+    if (!isLegacy) {
+      return view.ReadAt<Footer>(size - footerSize);
+    }
+    const auto legacy = view.ReadAt<LegacyFooter>(size - footerSize);
+    if (!legacy) {
+      return {};
+    }
+    return Footer {
+      .mIndexOffset = legacy->mIndexOffset,
+      .mEntryCount = legacy->mEntryCount,
+      .mMagic = legacy->mMagic,
+      .mVersion = legacy->mVersion,
+    };
+  }();
+  if (
+    footer && footer->mMagic == IndexMagic
+    && footer->mVersion == header->mVersion
+    && footer->mIndexOffset >= sizeof(FileHeader)
+    && footer->mIndexOffset <= size - footerSize) {
+    ret.mVersion = header->mVersion;
+    ret.mIndexOffset = footer->mIndexOffset;
+    const auto isInLog = [&ret](uint64_t offset, uint64_t size) {
+      return offset >= sizeof(FileHeader) && offset <= ret.mIndexOffset
+        && ret.mIndexOffset - offset >= size;
+    };
+    auto offset = footer->mIndexOffset;
+    bool valid = true;
+    for (uint64_t i = 0; valid && i < footer->mEntryCount; ++i) {
+      const auto entry = view.ReadAt<IndexEntry>(offset);
+      if (!entry) {
+        valid = false;
+        break;
+      }
+      offset += sizeof(IndexEntry);
+      const auto name = view.GetString(offset, entry->mNameLength);
+      const auto kind = isLegacy ? PutRecord : entry->mKind;
+      if (
+        (!name) || (kind != PutRecord && kind != PutPooledRecord)
+        || !isInLog(entry->mPayloadOffset, entry->mPayloadSize)) {
+        valid = false;
+        break;
+      }
+      offset += entry->mNameLength;
+      std::optional<DisplayConfigFingerprint> fingerprint;
+      if (header->mVersion == BundleVersion) {
+        fingerprint = view.ReadAt<DisplayConfigFingerprint>(offset);
+        if (!fingerprint) {
+          valid = false;
+          break;
+        }
+        offset += sizeof(DisplayConfigFingerprint);
+      }
+      ret.mEntries.push_back({
+        .mGuid = entry->mGuid,
+        .mName = std::string {*name},
+        .mKind = kind,
+        .mPayloadOffset = entry->mPayloadOffset,
+        .mPayloadSize = entry->mPayloadSize,
+        .mFingerprint = fingerprint,
+      });
+    }
+    for (uint64_t i = 0; valid && i < footer->mPoolEntryCount; ++i) {
+      const auto entry = view.ReadAt<PoolIndexEntry>(offset);
+      if (!(entry && isInLog(entry->mPayloadOffset, entry->mPayloadSize))) {
+        valid = false;
+        break;
+      }
+      offset += sizeof(PoolIndexEntry);
+      ret.mPool.emplace(
+        entry->mHash,
+        PoolEntry {
+          .mPayloadOffset = entry->mPayloadOffset,
+          .mPayloadSize = entry->mPayloadSize,
+        });
+    }
+    if (valid && offset == size - footerSize) {
+      return ret;
+    }
+  }
+
+  // The index is damaged, e.g. due to a crash while appending; rebuild it from
+  // the log, stopping at the first incomplete record
+  ret = {.mVersion = header->mVersion};
+  uint64_t offset = sizeof(FileHeader);
+  while (true) {
+    const auto record = view.ReadAt<RecordHeader>(offset);
+    if (!record || record->mMagic != RecordMagic) {
+      break;
+    }
+    const auto payloadOffset = offset + sizeof(RecordHeader);
+    const auto payload = view.GetString(payloadOffset, record->mPayloadSize);
+    if ((!payload) || HashProfileContents(*payload) != record->mPayloadHash) {
+      break;
+    }
+
+    const winrt::guid guid {record->mGuid};
+    const auto it = std::ranges::find(ret.mEntries, guid, &Entry::mGuid);
+    if (record->mKind == PutRecord || record->mKind == PutPooledRecord) {
+      std::string name;
+      std::optional<DisplayConfigFingerprint> fingerprint;
+      if (record->mKind == PutRecord) {
+        try {
+          const auto profile = Profile::FromJSON(*payload);
+          name = profile.mName;
+          fingerprint = profile.GetFingerprint();
+        } catch (const nlohmann::json::exception&) {
+          break;
+        } catch (const std::invalid_argument&) {
+          // Bad GUID
+          break;
+        }
+      } else {
+        PooledProfileHeader profile;
+        if (payload->size() < sizeof(profile)) {
+          break;
+        }
+        memcpy(&profile, payload->data(), sizeof(profile));
+        if (payload->size() - sizeof(profile) < profile.mNameLength) {
+          break;
+        }
+        name = payload->substr(sizeof(profile), profile.mNameLength);
+      }
+      Entry entry {
+        .mGuid = guid,
+        .mName = std::move(name),
+        .mKind = record->mKind,
+        .mPayloadOffset = payloadOffset,
+        .mPayloadSize = record->mPayloadSize,
+        .mFingerprint = fingerprint,
+      };
+      if (record->mKind == PutPooledRecord) {
+        // Its pooled records precede it, so they're already in `ret.mPool`
+        try {
+          entry.mFingerprint
+            = this->ReadProfile(view, ret, entry).GetFingerprint();
+        } catch (const BundleFormatError&) {
+          break;
+        }
+      }
+      if (it == ret.mEntries.end()) {
+        ret.mEntries.push_back(std::move(entry));
+      } else {
+        *it = std::move(entry);
+      }
+    } else if (record->mKind == RemoveRecord) {
+      if (it != ret.mEntries.end()) {
+        ret.mEntries.erase(it);
+      }
+    } else if (record->mKind == PoolRecord) {
+      ret.mPool.try_emplace(
+        record->mPayloadHash,
+        PoolEntry {
+          .mPayloadOffset = payloadOffset,
+          .mPayloadSize = record->mPayloadSize,
+        });
+    } else {
+      break;
+    }
+    offset = payloadOffset + record->mPayloadSize;
+  }
+  ret.mIndexOffset = offset;
+  return ret;
+}
+
+Profile BundleProfileStore::ReadProfile(
+  const View& view,
+  const State& state,
+  const Entry& entry) const {
+  const auto payload
+    = view.GetString(entry.mPayloadOffset, entry.mPayloadSize);
+  if (!payload) {
+    throw BundleFormatError(std::format(
+      "Profile `{}` is outside of the bundle `{}`",
+      entry.mName,
+      winrt::to_string(mPath.wstring())));
+  }
+  if (entry.mKind == PutRecord) {
+    return Profile::FromJSON(*payload);
+  }
+
+  const auto invalid = [&]() {
+    return BundleFormatError(std::format(
+      "Profile `{}` in the bundle `{}` is damaged",
+      entry.mName,
+      winrt::to_string(mPath.wstring())));
+  };
+  PooledProfileHeader header;
+  if (payload->size() < sizeof(header)) {
+    throw invalid();
+  }
+  memcpy(&header, payload->data(), sizeof(header));
+  const uint64_t recordCount = uint64_t {header.mAdapterCount}
+    + header.mPathCount + header.mModeCount;
+  if (
+    payload->size()
+    != sizeof(header) + header.mNameLength + (recordCount * sizeof(uint64_t))) {
+    throw invalid();
+  }
+
+  Profile ret {
+    .mName = std::string {payload->substr(sizeof(header), header.mNameLength)},
+    .mGuid = entry.mGuid,
+  };
+  ret.mAdapters.resize(header.mAdapterCount);
+  ret.mDisplayConfig.mPaths.resize(header.mPathCount);
+  ret.mDisplayConfig.mModes.resize(header.mModeCount);
+
+  auto hashOffset = sizeof(header) + header.mNameLength;
+  const auto readAll
+    = [&]<class T>(PooledRecordType type, std::vector<T>& out) {
+        for (auto& it: out) {
+          uint64_t hash {};
+          memcpy(&hash, payload->data() + hashOffset, sizeof(hash));
+          hashOffset += sizeof(hash);
+
+          const auto pooled = state.mPool.find(hash);
+          if (pooled == state.mPool.end()) {
+            throw invalid();
+          }
+          const auto record = view.GetString(
+            pooled->second.mPayloadOffset, pooled->second.mPayloadSize);
+          if (!(record && DecodePooledRecord(*record, type, it))) {
+            throw invalid();
+          }
+        }
+      };
+  readAll(PooledAdapter, ret.mAdapters);
+  readAll(PooledPath, ret.mDisplayConfig.mPaths);
+  readAll(PooledMode, ret.mDisplayConfig.mModes);
+  return ret;
+}
+
+std::vector<Profile> BundleProfileStore::Enumerate(std::size_t maxThreads) {
+  std::unique_lock lock(mMutex);
+  const auto fileLock = this->LockForReading();
+  const View view {mFile.get()};
+  const auto state = this->ReadState(view);
+  return ParallelTransform(
+    state.mEntries,
+    [this, &view, &state](const Entry& entry) {
+      return this->ReadProfile(view, state, entry);
+    },
+    maxThreads);
+}
+
+std::vector<ProfileSummary> BundleProfileStore::EnumerateSummaries(
+  std::size_t) {
+  std::unique_lock lock(mMutex);
+  const auto fileLock = this->LockForReading();
+  const View view {mFile.get()};
+  std::vector<ProfileSummary> ret;
+  for (auto&& entry: this->ReadState(view).mEntries) {
+    ret.push_back({
+      .mName = std::move(entry.mName),
+      .mGuid = entry.mGuid,
+      .mFingerprint = entry.mFingerprint,
+    });
+  }
+  return ret;
+}
+
+std::optional<Profile> BundleProfileStore::FindByName(std::string_view name) {
+  std::unique_lock lock(mMutex);
+  const auto fileLock = this->LockForReading();
+  const View view {mFile.get()};
+  const auto state = this->ReadState(view);
+
+  auto it = std::ranges::find(state.mEntries, name, &Entry::mName);
+  if (it == state.mEntries.end()) {
+    const auto folded = ProfileIndex::FoldCase(name);
+    it = std::ranges::find_if(state.mEntries, [&folded](const Entry& entry) {
+      return ProfileIndex::FoldCase(entry.mName) == folded;
+    });
+  }
+  if (it == state.mEntries.end()) {
+    return {};
+  }
+  return this->ReadProfile(view, state, *it);
+}
+
+std::optional<Profile> BundleProfileStore::FindByGUID(const winrt::guid& guid) {
+  std::unique_lock lock(mMutex);
+  const auto fileLock = this->LockForReading();
+  const View view {mFile.get()};
+  const auto state = this->ReadState(view);
+
+  const auto it = std::ranges::find(state.mEntries, guid, &Entry::mGuid);
+  if (it == state.mEntries.end()) {
+    return {};
+  }
+  return this->ReadProfile(view, state, *it);
+}
+
+std::vector<ProfileSummary> BundleProfileStore::FindByFingerprint(
+  const DisplayConfigFingerprint& fingerprint) {
+  std::unique_lock lock(mMutex);
+  const auto fileLock = this->LockForReading();
+  const View view {mFile.get()};
+  const auto state = this->ReadState(view);
+
+  std::vector<ProfileSummary> ret;
+  for (const auto& entry: state.mEntries) {
+    // Only missing in bundles from before version 3, until they're upgraded
+    const auto entryFingerprint = entry.mFingerprint
+      ? *entry.mFingerprint
+      : this->ReadProfile(view, state, entry).GetFingerprint();
+    if (entryFingerprint == fingerprint) {
+      ret.push_back({
+        .mName = entry.mName,
+        .mGuid = entry.mGuid,
+        .mFingerprint = entryFingerprint,
+      });
+    }
+  }
+  return ret;
+}
+
+void BundleProfileStore::Save(const Profile& profile) {
+  std::unique_lock lock(mMutex);
+  const FileLock fileLock {mFile.get(), true};
+  this->ReplayCompactionJournal();
+  this->UpgradeLocked();
+  const auto state = this->Append(profile.mGuid, &profile);
+  if (
+    state
+    && this->GetGarbageSize(*state)
+      > std::max(AutoCompactThreshold, this->GetLiveSize(*state))) {
+    this->CompactLocked();
+  }
+}
+
+bool BundleProfileStore::Remove(const winrt::guid& guid) {
+  std::unique_lock lock(mMutex);
+  const FileLock fileLock {mFile.get(), true};
+  this->ReplayCompactionJournal();
+  this->UpgradeLocked();
+  return this->Append(guid, nullptr).has_value();
+}
+
+std::optional<BundleProfileStore::State> BundleProfileStore::Append(
+  const winrt::guid& guid,
+  const Profile* profile) {
+  std::string buffer;
+  uint64_t writeOffset {};
+  State state;
+  {
+    // Must be unmapped before writing, as mapped files can't be truncated
+    const View view {mFile.get()};
+    state = this->ReadState(view);
+
+    const auto it = std::ranges::find(state.mEntries, guid, &Entry::mGuid);
+    if (!profile && it == state.mEntries.end()) {
+      return {};
+    }
+
+    // Overwrite the old index
+    writeOffset = state.mIndexOffset;
+    if (writeOffset == 0) {
+      AppendBytes(buffer, FileHeader {});
+    }
+
+    if (profile) {
+      this->AppendProfile(&view, writeOffset, buffer, state, guid, *profile);
+    } else {
+      AppendBytes(
+        buffer,
+        RecordHeader {
+          .mKind = RemoveRecord,
+          .mGuid = guid,
+          .mPayloadHash = HashProfileContents({}),
+        });
+      state.mEntries.erase(it);
+    }
+  }
+  state.mVersion = BundleVersion;
+  state.mIndexOffset = writeOffset + buffer.size();
+  this->AppendIndex(buffer, state);
+
+  this->Write(writeOffset, buffer);
+  return state;
+}
+
+void BundleProfileStore::AppendProfile(
+  const View* view,
+  uint64_t bufferOffset,
+  std::string& buffer,
+  State& state,
+  const winrt::guid& guid,
+  const Profile& profile) const {
+  const auto appendRecord = [&](uint32_t kind, std::string_view payload) {
+    AppendBytes(
+      buffer,
+      RecordHeader {
+        .mKind = kind,
+        .mGuid = guid,
+        .mPayloadSize = payload.size(),
+        .mPayloadHash = HashProfileContents(payload),
+      });
+    const auto offset = bufferOffset + buffer.size();
+    buffer.append(payload);
+    return offset;
+  };
+  const auto getPooled = [&](const PoolEntry& entry) {
+    if (entry.mPayloadOffset >= bufferOffset) {
+      return std::optional<std::string_view> {std::string_view {buffer}.substr(
+        entry.mPayloadOffset - bufferOffset, entry.mPayloadSize)};
+    }
+    return view ? view->GetString(entry.mPayloadOffset, entry.mPayloadSize)
+                : std::nullopt;
+  };
+
+  std::vector<std::string> records;
+  records.reserve(
+    profile.mAdapters.size() + profile.mDisplayConfig.mPaths.size()
+    + profile.mDisplayConfig.mModes.size());
+  for (const auto& it: profile.mAdapters) {
+    records.push_back(EncodePooledRecord(PooledAdapter, it));
+  }
+  for (const auto& it: profile.mDisplayConfig.mPaths) {
+    records.push_back(EncodePooledRecord(PooledPath, it));
+  }
+  for (const auto& it: profile.mDisplayConfig.mModes) {
+    records.push_back(EncodePooledRecord(PooledMode, it));
+  }
+
+  // 64-bit hashes of a few hundred bytes shouldn't collide, but if they do,
+  // fall back to JSON rather than returning the wrong record
+  std::unordered_map<uint64_t, std::string_view> seen;
+  const auto collides
+    = std::ranges::any_of(records, [&](const std::string& record) {
+        const auto hash = HashProfileContents(record);
+        const auto [it, inserted] = seen.emplace(hash, record);
+        if (!inserted) {
+          return it->second != record;
+        }
+        const auto pooled = state.mPool.find(hash);
+        return pooled != state.mPool.end()
+          && getPooled(pooled->second)
+          != std::optional<std::string_view> {record};
+      });
+
+  std::string payload;
+  uint32_t kind {};
+  if (collides) {
+    kind = PutRecord;
+    payload = profile.ToJSON();
+  } else {
+    kind = PutPooledRecord;
+    AppendBytes(
+      payload,
+      PooledProfileHeader {
+        .mNameLength = static_cast<uint32_t>(profile.mName.size()),
+        .mAdapterCount = static_cast<uint32_t>(profile.mAdapters.size()),
+        .mPathCount
+        = static_cast<uint32_t>(profile.mDisplayConfig.mPaths.size()),
+        .mModeCount
+        = static_cast<uint32_t>(profile.mDisplayConfig.mModes.size()),
+      });
+    payload.append(profile.mName);
+    for (const auto& record: records) {
+      const auto hash = HashProfileContents(record);
+      AppendBytes(payload, hash);
+      if (!state.mPool.contains(hash)) {
+        state.mPool.emplace(
+          hash,
+          PoolEntry {
+            .mPayloadOffset = appendRecord(PoolRecord, record),
+            .mPayloadSize = record.size(),
+          });
+      }
+    }
+  }
+
+  Entry entry {
+    .mGuid = guid,
+    .mName = profile.mName,
+    .mKind = kind,
+    .mPayloadOffset = appendRecord(kind, payload),
+    .mPayloadSize = payload.size(),
+    .mFingerprint = profile.GetFingerprint(),
+  };
+  const auto it = std::ranges::find(state.mEntries, guid, &Entry::mGuid);
+  if (it == state.mEntries.end()) {
+    state.mEntries.push_back(std::move(entry));
+  } else {
+    *it = std::move(entry);
+  }
+}
+
+void BundleProfileStore::AppendIndex(std::string& buffer, const State& state)
+  const {
+  for (const auto& entry: state.mEntries) {
+    AppendBytes(
+      buffer,
+      IndexEntry {
+        .mGuid = entry.mGuid,
+        .mPayloadOffset = entry.mPayloadOffset,
+        .mPayloadSize = entry.mPayloadSize,
+        .mNameLength = static_cast<uint32_t>(entry.mName.size()),
+        .mKind = entry.mKind,
+      });
+    buffer.append(entry.mName);
+    // Only missing in older versions, which are re-encoded before writing
+    AppendBytes(
+      buffer, entry.mFingerprint.value_or(DisplayConfigFingerprint {}));
+  }
+  for (const auto& [hash, entry]: state.mPool) {
+    AppendBytes(
+      buffer,
+      PoolIndexEntry {
+        .mHash = hash,
+        .mPayloadOffset = entry.mPayloadOffset,
+        .mPayloadSize = entry.mPayloadSize,
+      });
+  }
+  AppendBytes(
+    buffer,
+    Footer {
+      .mIndexOffset = state.mIndexOffset,
+      .mEntryCount = state.mEntries.size(),
+      .mPoolEntryCount = state.mPool.size(),
+    });
+}
+
+void BundleProfileStore::Write(uint64_t offset, std::string_view data) {
+  LARGE_INTEGER position {};
+  position.QuadPart = static_cast<LONGLONG>(offset);
+  if (!SetFilePointerEx(mFile.get(), position, nullptr, FILE_BEGIN)) {
+    throw FileWriteError(
+      std::format("Failed to seek in profile bundle: {}", GetLastError()));
+  }
+
+  std::size_t bytesWritten = 0;
+  while (bytesWritten < data.size()) {
+    DWORD bytesThisLoop = 0;
+    if (!WriteFile(
+          mFile.get(),
+          data.data() + bytesWritten,
+          static_cast<DWORD>(data.size() - bytesWritten),
+          &bytesThisLoop,
+          nullptr)) {
+      throw FileWriteError(
+        std::format("Failed to write to profile bundle: {}", GetLastError()));
+    }
+    bytesWritten += bytesThisLoop;
+  }
+
+  // The index must be at the end of the file, even if we've shrunk it
+  if (!SetEndOfFile(mFile.get())) {
+    throw FileWriteError(
+      std::format("Failed to truncate profile bundle: {}", GetLastError()));
+  }
+  FlushFileBuffers(mFile.get());
+}
+
+uint64_t BundleProfileStore::GetLiveSize(const State& state) const {
+  uint64_t ret = 0;
+  for (const auto& entry: state.mEntries) {
+    ret += sizeof(RecordHeader) + entry.mPayloadSize;
+  }
+  // Finding unreferenced records would mean reading every profile, so they're
+  // only found by compaction
+  for (const auto& [hash, entry]: state.mPool) {
+    ret += sizeof(RecordHeader) + entry.mPayloadSize;
+  }
+  return ret;
+}
+
+uint64_t BundleProfileStore::GetGarbageSize(const State& state) const {
+  if (state.mIndexOffset < sizeof(FileHeader)) {
+    return 0;
+  }
+  return (state.mIndexOffset - sizeof(FileHeader)) - this->GetLiveSize(state);
+}
+
+uint64_t BundleProfileStore::GetGarbageSize() {
+  std::unique_lock lock(mMutex);
+  const auto fileLock = this->LockForReading();
+  const View view {mFile.get()};
+  return this->GetGarbageSize(this->ReadState(view));
+}
+
+void BundleProfileStore::Compact() {
+  std::unique_lock lock(mMutex);
+  const FileLock fileLock {mFile.get(), true};
+  this->ReplayCompactionJournal();
+  this->CompactLocked();
+}
+
+void BundleProfileStore::UpgradeLocked() {
+  {
+    const View view {mFile.get()};
+    const auto header = view.ReadAt<FileHeader>(0);
+    if (!header || header->mVersion == BundleVersion) {
+      return;
+    }
+  }
+  this->CompactLocked();
+}
+
+void BundleProfileStore::CompactLocked() {
+  std::string buffer;
+  {
+    const View view {mFile.get()};
+    const auto state = this->ReadState(view);
+    if (state.mIndexOffset == 0) {
+      return;
+    }
+
+    // Re-encoding drops unreferenced pooled records, and pools any JSON
+    // profiles
+    State compacted {.mVersion = BundleVersion};
+    AppendBytes(buffer, FileHeader {});
+    for (const auto& entry: state.mEntries) {
+      this->AppendProfile(
+        nullptr,
+        0,
+        buffer,
+        compacted,
+        entry.mGuid,
+        this->ReadProfile(view, state, entry));
+    }
+    compacted.mIndexOffset = buffer.size();
+    this->AppendIndex(buffer, compacted);
+  }
+
+  // The bundle is rewritten in place so that other processes can keep it open;
+  // write a journal first, so that we can finish the job if we crash part way
+  // through
+  const auto journalPath = GetJournalPath(mPath);
+  {
+    winrt::file_handle journal {CreateFileW(
+      journalPath.c_str(),
+      GENERIC_WRITE,
+      0,
+      nullptr,
+      CREATE_ALWAYS,
+      FILE_ATTRIBUTE_NORMAL,
+      NULL)};
+    if (!journal) {
+      throw FileOpenError(std::format(
+        "Failed to create compaction journal: {}", GetLastError()));
+    }
+    DWORD bytesWritten {};
+    if (
+      (!WriteFile(
+        journal.get(),
+        buffer.data(),
+        static_cast<DWORD>(buffer.size()),
+        &bytesWritten,
+        nullptr))
+      || bytesWritten != buffer.size() || !FlushFileBuffers(journal.get())) {
+      const auto ec = GetLastError();
+      journal.close();
+      DeleteFileW(journalPath.c_str());
+      throw FileWriteError(
+        std::format("Failed to write compaction journal: {}", ec));
+    }
+  }
+
+  this->Write(0, buffer);
+  DeleteFileW(journalPath.c_str());
+}
+
+std::unique_ptr<BundleProfileStore::FileLock>
+BundleProfileStore::LockForReading() {
+  auto lock = std::make_unique<FileLock>(mFile.get(), false);
+  std::error_code ec;
+  if (!std::filesystem::exists(GetJournalPath(mPath), ec)) {
+    return lock;
+  }
+
+  // A compaction was interrupted, so the bundle may be partially overwritten
+  lock.reset();
+  lock = std::make_unique<FileLock>(mFile.get(), true);
+  this->ReplayCompactionJournal();
+  return lock;
+}
+
+void BundleProfileStore::ReplayCompactionJournal() {
+  const auto journalPath = GetJournalPath(mPath);
+  winrt::file_handle journal {CreateFileW(
+    journalPath.c_str(),
+    GENERIC_READ,
+    0,
+    nullptr,
+    OPEN_EXISTING,
+    FILE_ATTRIBUTE_NORMAL,
+    NULL)};
+  if (!journal) {
+    return;
+  }
+
+  // Only complete journals are replayed; if we crashed while writing the
+  // journal itself, the bundle hasn't been touched yet
+  std::optional<State> state;
+  {
+    const View view {journal.get()};
+    try {
+      if (view.GetSize() > 0) {
+        state = this->ReadState(view);
+      }
+    } catch (const BundleFormatError&) {
+    }
+    if (state) {
+      // Journals from before the pool have the legacy footer
+      const auto isComplete = (state->mVersion == LegacyBundleVersion)
+        ? HasFooter<LegacyFooter>(view, state->mIndexOffset)
+        : HasFooter<Footer>(view, state->mIndexOffset);
+      if (!isComplete) {
+        state.reset();
+      }
+    }
+    if (state) {
+      const auto contents = view.GetString(0, view.GetSize());
+      this->Write(0, *contents);
+    }
+  }
+  journal.close();
+  DeleteFileW(journalPath.c_str());
+}
+
+}// namespace FredEmmott::MonitorTool
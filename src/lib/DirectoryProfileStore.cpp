@@ -0,0 +1,164 @@
+// Copyright 2024, Fred Emmott
+// SPDX-License-Identifier: ISC
+
+#include <FredEmmott/MonitorTool/ParallelTransform.hpp>
+#include <FredEmmott/MonitorTool/Paths.hpp>
+#include <FredEmmott/MonitorTool/ProfileCache.hpp>
+#include <FredEmmott/MonitorTool/ProfileIndex.hpp>
+#include <FredEmmott/MonitorTool/ProfileStore.hpp>
+#include <winrt/base.h>
+
+#include <algorithm>
+#include <format>
+#include <limits>
+
+#include <Windows.h>
+
+namespace FredEmmott::MonitorTool {
+
+namespace {
+
+/* Atomically create an empty file if it doesn't already exist.
+ *
+ * Used to claim a filename, instead of checking if it exists then writing it,
+ * which races with other processes doing the same. */
+bool TryCreateNewFile(const std::filesystem::path& path) {
+  const auto fullPath = GetFileAPIPath(path);
+  winrt::file_handle file {CreateFileW(
+    fullPath.c_str(),
+    GENERIC_WRITE,
+    0,
+    nullptr,
+    CREATE_NEW,
+    FILE_ATTRIBUTE_NORMAL,
+    NULL)};
+  if (file) {
+    return true;
+  }
+  const auto ec = GetLastError();
+  if (ec == ERROR_FILE_EXISTS) {
+    return false;
+  }
+  throw FileOpenError(
+    std::format("Failed to create `{}`: {}", winrt::to_string(fullPath), ec));
+}
+
+}// namespace
+
+DirectoryProfileStore::DirectoryProfileStore()
+  : DirectoryProfileStore(GetProfilesPath()) {
+}
+
+DirectoryProfileStore::DirectoryProfileStore(
+  const std::filesystem::path& root)
+  : mRoot(root) {
+}
+
+// Sorted, so that enumeration order doesn't depend on the filesystem
+std::vector<std::filesystem::path> DirectoryProfileStore::GetProfilePaths()
+  const {
+  if (!std::filesystem::is_directory(mRoot)) {
+    return {};
+  }
+
+  std::vector<std::filesystem::path> ret;
+  for (auto&& entry: std::filesystem::directory_iterator(mRoot)) {
+    if (!entry.is_regular_file()) {
+      continue;
+    }
+    if (entry.path().extension() != ".json") {
+      continue;
+    }
+    ret.push_back(entry.path());
+  }
+  std::ranges::sort(ret);
+  return ret;
+}
+
+std::vector<Profile> DirectoryProfileStore::Enumerate(std::size_t maxThreads) {
+  const auto paths = this->GetProfilePaths();
+  // Entries for renamed or removed profiles would otherwise stay forever
+  PruneCachedProfiles(paths);
+  return ParallelTransform(
+    paths,
+    [](const std::filesystem::path& path) { return Profile::Load(path); },
+    maxThreads);
+}
+
+std::vector<ProfileSummary> DirectoryProfileStore::EnumerateSummaries(
+  std::size_t maxThreads) {
+  return ParallelTransform(
+    this->GetProfilePaths(),
+    [](const std::filesystem::path& path) {
+      return ProfileSummary::Load(path);
+    },
+    maxThreads);
+}
+
+std::optional<Profile> DirectoryProfileStore::FindByName(
+  std::string_view name) {
+  return ProfileIndex::Open(mRoot).FindByName(name);
+}
+
+std::optional<Profile> DirectoryProfileStore::FindByGUID(
+  const winrt::guid& guid) {
+  return ProfileIndex::Open(mRoot).FindByGUID(guid);
+}
+
+std::vector<ProfileSummary> DirectoryProfileStore::FindByFingerprint(
+  const DisplayConfigFingerprint& fingerprint) {
+  std::vector<ProfileSummary> ret;
+  for (auto&& entry:
+       ProfileIndex::Open(mRoot).FindEntriesByFingerprint(fingerprint)) {
+    ret.push_back({
+      .mName = std::move(entry.mName),
+      .mGuid = entry.mGuid,
+      .mPath = std::move(entry.mPath),
+      .mFingerprint = entry.mFingerprint,
+    });
+  }
+  return ret;
+}
+
+void DirectoryProfileStore::Save(const Profile& profile) {
+  const auto existing
+    = ProfileIndex::Open(mRoot).FindEntryByGUID(profile.mGuid);
+  if (existing) {
+    profile.Save(existing->mPath);
+    return;
+  }
+
+  // Pick absolutely known-safe chars only
+  std::string basename;
+  for (const char it: profile.mName) {
+    if (
+      (it >= 'a' && it <= 'z') || (it >= 'A' && it <= 'Z')
+      || (it >= '0' && it <= '9') || (it == ' ') || (it == '-')
+      || (it == '_')) {
+      basename += it;
+    }
+  }
+
+  std::filesystem::create_directories(mRoot);
+
+  auto path = mRoot / (basename + ".json");
+  for (uint16_t i = 1; !TryCreateNewFile(path); ++i) {
+    if (i == std::numeric_limits<uint16_t>::max()) {
+      throw FileOpenError(
+        std::format("Couldn't find a free filename for `{}`", profile.mName));
+    }
+    path = mRoot / std::format("{}-{:04x}.json", basename, i);
+  }
+  profile.Save(path);
+}
+
+bool DirectoryProfileStore::Remove(const winrt::guid& guid) {
+  const auto existing = ProfileIndex::Open(mRoot).FindEntryByGUID(guid);
+  if (!existing) {
+    return false;
+  }
+  RemoveCachedProfile(existing->mPath);
+  return std::filesystem::remove(existing->mPath);
+}
+
+}// namespace FredEmmott::MonitorTool
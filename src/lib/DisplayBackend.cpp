@@ -0,0 +1,35 @@
+// Copyright 2024, Fred Emmott
+// SPDX-License-Identifier: ISC
+
+#include <FredEmmott/MonitorTool/DisplayBackend.hpp>
+
+#include <mutex>
+#include <stdexcept>
+
+namespace FredEmmott::MonitorTool {
+
+namespace {
+std::mutex sBackendMutex;
+std::shared_ptr<DisplayBackend> sBackend;
+}// namespace
+
+std::shared_ptr<DisplayBackend> GetDisplayBackend() {
+  std::unique_lock lock(sBackendMutex);
+  if (!sBackend) {
+#ifdef _WIN32
+    sBackend = std::make_shared<Win32DisplayBackend>();
+#else
+    throw std::logic_error(
+      "There is no default display backend on this platform; call "
+      "SetDisplayBackend() first");
+#endif
+  }
+  return sBackend;
+}
+
+void SetDisplayBackend(std::shared_ptr<DisplayBackend> backend) {
+  std::unique_lock lock(sBackendMutex);
+  sBackend = std::move(backend);
+}
+
+}// namespace FredEmmott::MonitorTool
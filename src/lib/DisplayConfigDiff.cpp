@@ -0,0 +1,101 @@
+// Copyright 2024, Fred Emmott
+// SPDX-License-Identifier: ISC
+
+#include <FredEmmott/MonitorTool/DisplayConfigDiff.hpp>
+#include <FredEmmott/MonitorTool/NormalizedDisplayPath.hpp>
+
+#include <bit>
+#include <format>
+#include <map>
+#include <optional>
+#include <tuple>
+
+namespace FredEmmott::MonitorTool {
+
+namespace {
+
+using PathKey = std::tuple<uint64_t, UINT32, uint64_t, UINT32>;
+
+PathKey GetPathKey(const DISPLAYCONFIG_PATH_INFO& path) {
+  return {
+    std::bit_cast<uint64_t>(path.sourceInfo.adapterId),
+    path.sourceInfo.id,
+    std::bit_cast<uint64_t>(path.targetInfo.adapterId),
+    path.targetInfo.id,
+  };
+}
+
+template <class T>
+void DiffOptionalFields(
+  const std::optional<T>& a,
+  const std::optional<T>& b,
+  std::vector<std::string>& differences,
+  std::string_view name) {
+  if (a.has_value() != b.has_value()) {
+    differences.emplace_back(name);
+    return;
+  }
+  if (a) {
+    DiffFields(*a, *b, differences, name);
+  }
+}
+
+std::vector<std::string> DiffPaths(
+  const NormalizedDisplayPath& a,
+  const NormalizedDisplayPath& b) {
+  std::vector<std::string> ret;
+  DiffFields(a.mPath, b.mPath, ret);
+  DiffOptionalFields(a.mSourceMode, b.mSourceMode, ret, "sourceMode");
+  DiffOptionalFields(a.mTargetMode, b.mTargetMode, ret, "targetMode");
+  DiffOptionalFields(a.mDesktopImage, b.mDesktopImage, ret, "desktopImage");
+  return ret;
+}
+
+}// namespace
+
+std::vector<std::string> DiffDisplayConfig(
+  const DisplayConfig& current,
+  const DisplayConfig& target) {
+  std::map<PathKey, const DISPLAYCONFIG_PATH_INFO*> currentPaths;
+  for (const auto& path: current.mPaths) {
+    currentPaths.emplace(GetPathKey(path), &path);
+  }
+
+  std::vector<std::string> ret;
+  for (std::size_t i = 0; i < target.mPaths.size(); ++i) {
+    const auto& path = target.mPaths.at(i);
+    const auto label
+      = std::format("Paths[{}] (target {})", i, path.targetInfo.id);
+
+    const auto it = currentPaths.find(GetPathKey(path));
+    if (it == currentPaths.end()) {
+      ret.push_back(std::format("{}: not active", label));
+      continue;
+    }
+    const auto currentPath = it->second;
+    currentPaths.erase(it);
+
+    const auto fields = DiffPaths(
+      NormalizeDisplayPath(current, *currentPath),
+      NormalizeDisplayPath(target, path));
+    if (fields.empty()) {
+      continue;
+    }
+    auto message = std::format("{}: {}", label, fields.front());
+    for (std::size_t j = 1; j < fields.size(); ++j) {
+      message += ", ";
+      message += fields.at(j);
+    }
+    ret.push_back(std::move(message));
+  }
+
+  for (const auto& [key, path]: currentPaths) {
+    ret.push_back(std::format(
+      "active path to target {}: not in the new configuration",
+      path->targetInfo.id));
+  }
+
+  return ret;
+}
+
+}// namespace FredEmmott::MonitorTool
@@ -0,0 +1,218 @@
+// Copyright 2024, Fred Emmott
+// SPDX-License-Identifier: ISC
+
+#include <FredEmmott/MonitorTool/DisplayConfigFingerprint.hpp>
+#include <FredEmmott/MonitorTool/NormalizedDisplayPath.hpp>
+
+#include <algorithm>
+#include <bit>
+#include <charconv>
+#include <format>
+#include <vector>
+
+namespace FredEmmott::MonitorTool {
+
+namespace {
+
+void AppendUInt64(std::string& buffer, uint64_t value) {
+  for (std::size_t i = 0; i < sizeof(value); ++i) {
+    buffer.push_back(static_cast<char>(value >> (i * 8)));
+  }
+}
+
+template <HasFieldSchema T>
+void AppendFields(std::string& buffer, const T& value) {
+  VisitFieldValues(value, [&buffer]<class V>(const V& leaf) {
+    static_assert(
+      std::same_as<V, uint64_t>, "Display configs don't contain strings");
+    AppendUInt64(buffer, leaf);
+  });
+}
+
+template <HasFieldSchema T>
+void AppendFields(std::string& buffer, const std::optional<T>& value) {
+  buffer.push_back(value.has_value());
+  if (value) {
+    AppendFields(buffer, *value);
+  }
+}
+
+/// Little-endian, so that the fingerprint doesn't depend on the platform
+std::string GetCanonicalBytes(
+  const DisplayConfig& config,
+  const DISPLAYCONFIG_PATH_INFO& path) {
+  auto normalized = NormalizeDisplayPath(config, path);
+  VisitLUIDs(normalized.mPath, [](LUID& luid) { luid = {}; });
+
+  std::string ret;
+  AppendFields(ret, normalized.mPath);
+  AppendFields(ret, normalized.mSourceMode);
+  AppendFields(ret, normalized.mTargetMode);
+  AppendFields(ret, normalized.mDesktopImage);
+  return ret;
+}
+
+uint64_t FinalMix(uint64_t k) {
+  k ^= k >> 33;
+  k *= 0xff51afd7ed558ccdull;
+  k ^= k >> 33;
+  k *= 0xc4ceb9fe1a85ec53ull;
+  k ^= k >> 33;
+  return k;
+}
+
+uint64_t ReadUInt64(const unsigned char* data) {
+  uint64_t ret = 0;
+  for (std::size_t i = 0; i < sizeof(ret); ++i) {
+    ret |= static_cast<uint64_t>(data[i]) << (i * 8);
+  }
+  return ret;
+}
+
+// Austin Appleby's MurmurHash3_x64_128, which is in the public domain
+DisplayConfigFingerprint MurmurHash3(std::string_view bytes, uint64_t seed) {
+  const auto data = reinterpret_cast<const unsigned char*>(bytes.data());
+  const auto length = bytes.size();
+  const auto blockCount = length / 16;
+
+  uint64_t h1 = seed;
+  uint64_t h2 = seed;
+  constexpr uint64_t c1 = 0x87c37b91114253d5ull;
+  constexpr uint64_t c2 = 0x4cf5ad432745937full;
+
+  for (std::size_t i = 0; i < blockCount; ++i) {
+    auto k1 = ReadUInt64(data + (i * 16));
+    auto k2 = ReadUInt64(data + (i * 16) + 8);
+
+    k1 *= c1;
+    k1 = std::rotl(k1, 31);
+    k1 *= c2;
+    h1 ^= k1;
+    h1 = std::rotl(h1, 27);
+    h1 += h2;
+    h1 = (h1 * 5) + 0x52dce729;
+
+    k2 *= c2;
+    k2 = std::rotl(k2, 33);
+    k2 *= c1;
+    h2 ^= k2;
+    h2 = std::rotl(h2, 31);
+    h2 += h1;
+    h2 = (h2 * 5) + 0x38495ab5;
+  }
+
+  const auto tail = data + (blockCount * 16);
+  uint64_t k1 = 0;
+  uint64_t k2 = 0;
+  switch (length & 15) {
+    case 15:
+      k2 ^= static_cast<uint64_t>(tail[14]) << 48;
+      [[fallthrough]];
+    case 14:
+      k2 ^= static_cast<uint64_t>(tail[13]) << 40;
+      [[fallthrough]];
+    case 13:
+      k2 ^= static_cast<uint64_t>(tail[12]) << 32;
+      [[fallthrough]];
+    case 12:
+      k2 ^= static_cast<uint64_t>(tail[11]) << 24;
+      [[fallthrough]];
+    case 11:
+      k2 ^= static_cast<uint64_t>(tail[10]) << 16;
+      [[fallthrough]];
+    case 10:
+      k2 ^= static_cast<uint64_t>(tail[9]) << 8;
+      [[fallthrough]];
+    case 9:
+      k2 ^= static_cast<uint64_t>(tail[8]);
+      k2 *= c2;
+      k2 = std::rotl(k2, 33);
+      k2 *= c1;
+      h2 ^= k2;
+      [[fallthrough]];
+    case 8:
+      k1 ^= static_cast<uint64_t>(tail[7]) << 56;
+      [[fallthrough]];
+    case 7:
+      k1 ^= static_cast<uint64_t>(tail[6]) << 48;
+      [[fallthrough]];
+    case 6:
+      k1 ^= static_cast<uint64_t>(tail[5]) << 40;
+      [[fallthrough]];
+    case 5:
+      k1 ^= static_cast<uint64_t>(tail[4]) << 32;
+      [[fallthrough]];
+    case 4:
+      k1 ^= static_cast<uint64_t>(tail[3]) << 24;
+      [[fallthrough]];
+    case 3:
+      k1 ^= static_cast<uint64_t>(tail[2]) << 16;
+      [[fallthrough]];
+    case 2:
+      k1 ^= static_cast<uint64_t>(tail[1]) << 8;
+      [[fallthrough]];
+    case 1:
+      k1 ^= static_cast<uint64_t>(tail[0]);
+      k1 *= c1;
+      k1 = std::rotl(k1, 31);
+      k1 *= c2;
+      h1 ^= k1;
+  }
+
+  h1 ^= length;
+  h2 ^= length;
+  h1 += h2;
+  h2 += h1;
+  h1 = FinalMix(h1);
+  h2 = FinalMix(h2);
+  h1 += h2;
+  h2 += h1;
+
+  return {.mHigh = h2, .mLow = h1};
+}
+
+}// namespace
+
+std::string DisplayConfigFingerprint::ToString() const {
+  return std::format("{:016x}{:016x}", mHigh, mLow);
+}
+
+std::optional<DisplayConfigFingerprint> DisplayConfigFingerprint::FromString(
+  std::string_view str) {
+  if (str.size() != 32) {
+    return {};
+  }
+  DisplayConfigFingerprint ret;
+  for (auto [half, out]: {
+         std::pair {str.substr(0, 16), &ret.mHigh},
+         std::pair {str.substr(16), &ret.mLow},
+       }) {
+    const auto end = half.data() + half.size();
+    const auto [ptr, ec] = std::from_chars(half.data(), end, *out, 16);
+    if (ec != std::errc {} || ptr != end) {
+      return {};
+    }
+  }
+  return ret;
+}
+
+DisplayConfigFingerprint GetDisplayConfigFingerprint(
+  const DisplayConfig& config) {
+  std::vector<std::string> paths;
+  paths.reserve(config.mPaths.size());
+  for (const auto& path: config.mPaths) {
+    paths.push_back(GetCanonicalBytes(config, path));
+  }
+  // Canonical order, independent of the order Windows returned them in
+  std::ranges::sort(paths);
+
+  std::string bytes;
+  AppendUInt64(bytes, paths.size());
+  for (const auto& path: paths) {
+    AppendUInt64(bytes, path.size());
+    bytes += path;
+  }
+  return MurmurHash3(bytes, 0);
+}
+
+}// namespace FredEmmott::MonitorTool
@@ -0,0 +1,428 @@
+// Copyright 2024, Fred Emmott
+// SPDX-License-Identifier: ISC
+
+#include <FredEmmott/MonitorTool/DisplayRecording.hpp>
+#include <FredEmmott/MonitorTool/QueryDisplayConfig.hpp>
+#include <FredEmmott/MonitorTool/SetDisplayConfig.hpp>
+
+#include <cstring>
+#include <format>
+#include <iterator>
+#include <optional>
+#include <string_view>
+#include <thread>
+#include <type_traits>
+
+namespace FredEmmott::MonitorTool {
+
+namespace {
+
+// 'FMTR'
+constexpr uint32_t RecordingMagic = 0x52544d46;
+// Increment if the layout changes
+constexpr uint32_t RecordingVersion = 2;
+
+struct FileHeader {
+  uint32_t mMagic {RecordingMagic};
+  uint32_t mVersion {RecordingVersion};
+};
+
+/// Followed by the paths, modes, adapters, and string
+struct RecordHeader {
+  DisplayCall::Kind mKind {};
+  uint32_t mFlags {};
+  int64_t mDurationNS {};
+  DisplayCall::Error mError {};
+  uint32_t mPathCount {};
+  uint32_t mModeCount {};
+  uint32_t mAdapterCount {};
+  uint32_t mStringSize {};
+};
+static_assert(std::is_trivially_copyable_v<RecordHeader>);
+static_assert(sizeof(DISPLAYCONFIG_PATH_INFO) == 72);
+static_assert(sizeof(DISPLAYCONFIG_MODE_INFO) == 64);
+
+/// `AdapterInfo`, with the same layout whatever the size of `WCHAR`
+struct AdapterRecord {
+  /// UTF-16, as on Windows
+  char16_t mDescription[128] {};
+  uint32_t mVendorId {};
+  uint32_t mDeviceId {};
+  uint32_t mSubSysId {};
+  uint32_t mRevision {};
+  uint64_t mDedicatedVideoMemory {};
+  uint64_t mDedicatedSystemMemory {};
+  uint64_t mSharedSystemMemory {};
+  uint32_t mLuidLowPart {};
+  int32_t mLuidHighPart {};
+  uint32_t mFlags {};
+  uint32_t mPadding {};
+  uint64_t mDriverVersion {};
+};
+static_assert(sizeof(AdapterRecord) == 320);
+
+AdapterRecord ToRecord(const AdapterInfo& info) {
+  const auto& desc = info.mDesc;
+  AdapterRecord ret {
+    .mVendorId = desc.VendorId,
+    .mDeviceId = desc.DeviceId,
+    .mSubSysId = desc.SubSysId,
+    .mRevision = desc.Revision,
+    .mDedicatedVideoMemory = desc.DedicatedVideoMemory,
+    .mDedicatedSystemMemory = desc.DedicatedSystemMemory,
+    .mSharedSystemMemory = desc.SharedSystemMemory,
+    .mLuidLowPart = desc.AdapterLuid.LowPart,
+    .mLuidHighPart = desc.AdapterLuid.HighPart,
+    .mFlags = desc.Flags,
+    .mDriverVersion = info.mDriverVersion,
+  };
+
+  std::size_t out = 0;
+  for (const auto c: desc.Description) {
+    if (c == 0) {
+      break;
+    }
+    const auto codePoint = static_cast<char32_t>(c);
+    if (codePoint < 0x10000) {
+      ret.mDescription[out++] = static_cast<char16_t>(codePoint);
+    } else if (out + 2 < std::size(ret.mDescription)) {
+      // Only possible if `WCHAR` is UTF-32
+      const auto offset = codePoint - 0x10000;
+      ret.mDescription[out++] = static_cast<char16_t>(0xd800 + (offset >> 10));
+      ret.mDescription[out++]
+        = static_cast<char16_t>(0xdc00 + (offset & 0x3ff));
+    } else {
+      break;
+    }
+    if (out + 1 >= std::size(ret.mDescription)) {
+      break;
+    }
+  }
+  return ret;
+}
+
+AdapterInfo FromRecord(const AdapterRecord& record) {
+  AdapterInfo ret {
+    .mDesc = {
+      .VendorId = record.mVendorId,
+      .DeviceId = record.mDeviceId,
+      .SubSysId = record.mSubSysId,
+      .Revision = record.mRevision,
+      .DedicatedVideoMemory = static_cast<SIZE_T>(record.mDedicatedVideoMemory),
+      .DedicatedSystemMemory
+      = static_cast<SIZE_T>(record.mDedicatedSystemMemory),
+      .SharedSystemMemory = static_cast<SIZE_T>(record.mSharedSystemMemory),
+      .AdapterLuid = {
+        .LowPart = record.mLuidLowPart,
+        .HighPart = record.mLuidHighPart,
+      },
+      .Flags = record.mFlags,
+    },
+    .mDriverVersion = record.mDriverVersion,
+  };
+
+  auto& description = ret.mDesc.Description;
+  std::size_t out = 0;
+  for (std::size_t i = 0; i < std::size(record.mDescription); ++i) {
+    const char32_t c = record.mDescription[i];
+    if (c == 0 || out + 1 >= std::size(description)) {
+      break;
+    }
+    if constexpr (sizeof(WCHAR) == sizeof(char16_t)) {
+      description[out++] = static_cast<WCHAR>(c);
+      continue;
+    }
+    // Combine surrogate pairs if `WCHAR` is UTF-32
+    if (
+      c >= 0xd800 && c < 0xdc00 && i + 1 < std::size(record.mDescription)
+      && record.mDescription[i + 1] >= 0xdc00
+      && record.mDescription[i + 1] < 0xe000) {
+      const char32_t low = record.mDescription[++i];
+      description[out++]
+        = static_cast<WCHAR>(0x10000 + ((c - 0xd800) << 10) + (low - 0xdc00));
+      continue;
+    }
+    description[out++] = static_cast<WCHAR>(c);
+  }
+  return ret;
+}
+
+template <class T>
+void Append(std::string& buffer, const T* data, std::size_t count = 1) {
+  buffer.append(reinterpret_cast<const char*>(data), sizeof(T) * count);
+}
+
+/// Reads from a loaded recording, failing once it's exhausted
+class Reader final {
+ public:
+  explicit Reader(std::string_view buffer) : mBuffer(buffer) {
+  }
+
+  bool empty() const noexcept {
+    return mBuffer.empty();
+  }
+
+  template <class T>
+  bool Read(T* out, std::size_t count = 1) {
+    const auto size = sizeof(T) * count;
+    if (mBuffer.size() < size) {
+      return false;
+    }
+    std::memcpy(out, mBuffer.data(), size);
+    mBuffer.remove_prefix(size);
+    return true;
+  }
+
+  template <class T>
+  bool Read(std::vector<T>& out, std::size_t count) {
+    if (mBuffer.size() < sizeof(T) * count) {
+      return false;
+    }
+    out.resize(count);
+    return this->Read(out.data(), count);
+  }
+
+ private:
+  std::string_view mBuffer;
+};
+
+}// namespace
+
+DisplayRecording DisplayRecording::Load(const std::filesystem::path& path) {
+  std::ifstream f(path, std::ios::binary);
+  if (!f) {
+    throw DisplayRecordingError(
+      std::format("Couldn't open recording '{}'", path.string()));
+  }
+  const std::string buffer {
+    std::istreambuf_iterator<char>(f), std::istreambuf_iterator<char>()};
+  Reader reader {buffer};
+
+  FileHeader header;
+  if (
+    !reader.Read(&header) || header.mMagic != RecordingMagic
+    || header.mVersion != RecordingVersion) {
+    throw DisplayRecordingError(std::format(
+      "'{}' is not a display recording, or is from a different version",
+      path.string()));
+  }
+
+  DisplayRecording ret;
+  while (!reader.empty()) {
+    RecordHeader record;
+    DisplayCall call;
+    std::vector<AdapterRecord> adapters;
+    if (!(reader.Read(&record)
+          && reader.Read(call.mConfig.mPaths, record.mPathCount)
+          && reader.Read(call.mConfig.mModes, record.mModeCount)
+          && reader.Read(adapters, record.mAdapterCount))) {
+      break;
+    }
+    call.mAdapters.reserve(adapters.size());
+    for (const auto& adapter: adapters) {
+      call.mAdapters.push_back(FromRecord(adapter));
+    }
+    call.mString.resize(record.mStringSize);
+    if (!reader.Read(call.mString.data(), call.mString.size())) {
+      break;
+    }
+    call.mKind = record.mKind;
+    call.mFlags = record.mFlags;
+    call.mDuration = DisplayCall::Duration {record.mDurationNS};
+    call.mError = record.mError;
+    ret.mCalls.push_back(std::move(call));
+  }
+  return ret;
+}
+
+RecordingDisplayBackend::RecordingDisplayBackend(
+  std::shared_ptr<DisplayBackend> inner,
+  const std::filesystem::path& path)
+  : mInner(std::move(inner)),
+    mStream(path, std::ios::binary | std::ios::trunc) {
+  const FileHeader header;
+  mStream.write(reinterpret_cast<const char*>(&header), sizeof(header));
+  mStream.flush();
+  if (!mStream) {
+    throw DisplayRecordingError(
+      std::format("Couldn't create recording '{}'", path.string()));
+  }
+}
+
+void RecordingDisplayBackend::Write(const DisplayCall& call) {
+  const auto& [paths, modes] = call.mConfig;
+  const RecordHeader header {
+    .mKind = call.mKind,
+    .mFlags = call.mFlags,
+    .mDurationNS = call.mDuration.count(),
+    .mError = call.mError,
+    .mPathCount = static_cast<uint32_t>(paths.size()),
+    .mModeCount = static_cast<uint32_t>(modes.size()),
+    .mAdapterCount = static_cast<uint32_t>(call.mAdapters.size()),
+    .mStringSize = static_cast<uint32_t>(call.mString.size()),
+  };
+  std::string buffer;
+  Append(buffer, &header);
+  Append(buffer, paths.data(), paths.size());
+  Append(buffer, modes.data(), modes.size());
+  for (const auto& adapter: call.mAdapters) {
+    const auto record = ToRecord(adapter);
+    Append(buffer, &record);
+  }
+  Append(buffer, call.mString.data(), call.mString.size());
+
+  std::unique_lock lock(mMutex);
+  mStream.write(buffer.data(), buffer.size());
+  mStream.flush();
+}
+
+template <class F>
+void RecordingDisplayBackend::Record(DisplayCall& call, F&& fn) {
+  const auto start = std::chrono::steady_clock::now();
+  const auto finish = [&](DisplayCall::Error error, const char* message) {
+    call.mDuration = std::chrono::duration_cast<DisplayCall::Duration>(
+      std::chrono::steady_clock::now() - start);
+    call.mError = error;
+    if (message) {
+      call.mString = message;
+    }
+    this->Write(call);
+  };
+
+  try {
+    fn();
+  } catch (const GetDisplayConfigBufferSizesError& e) {
+    finish(DisplayCall::Error::GetDisplayConfigBufferSizes, e.what());
+    throw;
+  } catch (const QueryDisplayConfigError& e) {
+    finish(DisplayCall::Error::QueryDisplayConfig, e.what());
+    throw;
+  } catch (const SetDisplayConfigError& e) {
+    finish(DisplayCall::Error::SetDisplayConfig, e.what());
+    throw;
+  }
+  finish(DisplayCall::Error::None, nullptr);
+}
+
+DisplayConfig RecordingDisplayBackend::QueryDisplayConfig(uint32_t flags) {
+  DisplayCall call {
+    .mKind = DisplayCall::Kind::QueryDisplayConfig,
+    .mFlags = flags,
+  };
+  this->Record(
+    call, [&] { call.mConfig = mInner->QueryDisplayConfig(flags); });
+  return std::move(call.mConfig);
+}
+
+void RecordingDisplayBackend::SetDisplayConfig(
+  const DisplayConfig& config,
+  uint32_t flags) {
+  DisplayCall call {
+    .mKind = DisplayCall::Kind::SetDisplayConfig,
+    .mFlags = flags,
+    .mConfig = config,
+  };
+  this->Record(call, [&] { mInner->SetDisplayConfig(config, flags); });
+}
+
+std::vector<AdapterInfo> RecordingDisplayBackend::EnumAdapters() {
+  DisplayCall call {.mKind = DisplayCall::Kind::EnumAdapters};
+  this->Record(call, [&] { call.mAdapters = mInner->EnumAdapters(); });
+  return std::move(call.mAdapters);
+}
+
+std::string RecordingDisplayBackend::GetOSVersion() {
+  DisplayCall call {.mKind = DisplayCall::Kind::GetOSVersion};
+  this->Record(call, [&] { call.mString = mInner->GetOSVersion(); });
+  return std::move(call.mString);
+}
+
+ReplayDisplayBackend::ReplayDisplayBackend(
+  std::shared_ptr<const DisplayRecording> recording,
+  ReplayTiming timing)
+  : mRecording(std::move(recording)),
+    mTiming(timing),
+    mUsed(mRecording->mCalls.size(), false) {
+}
+
+const DisplayCall& ReplayDisplayBackend::Find(
+  DisplayCall::Kind kind,
+  uint32_t flags,
+  const DisplayConfig* config) {
+  const auto& calls = mRecording->mCalls;
+  const auto matches = [&](const DisplayCall& call) {
+    return call.mKind == kind && call.mFlags == flags
+      && (!config || call.mConfig == *config);
+  };
+
+  std::unique_lock lock(mMutex);
+  std::optional<std::size_t> last;
+  for (std::size_t i = 0; i < calls.size(); ++i) {
+    if (!matches(calls[i])) {
+      continue;
+    }
+    if (!mUsed[i]) {
+      mUsed[i] = true;
+      return calls[i];
+    }
+    last = i;
+  }
+  if (last) {
+    return calls[*last];
+  }
+
+  throw DisplayReplayError(std::format(
+    "The recording has no {} call with flags {:#x}{}",
+    (kind == DisplayCall::Kind::QueryDisplayConfig) ? "QueryDisplayConfig()"
+      : (kind == DisplayCall::Kind::SetDisplayConfig) ? "SetDisplayConfig()"
+      : (kind == DisplayCall::Kind::EnumAdapters)     ? "EnumAdapters()"
+                                                      : "GetOSVersion()",
+    flags,
+    config ? " and this configuration" : ""));
+}
+
+void ReplayDisplayBackend::Replay(const DisplayCall& call) const {
+  if (mTiming == ReplayTiming::Recorded) {
+    std::this_thread::sleep_for(call.mDuration);
+  }
+  switch (call.mError) {
+    case DisplayCall::Error::None:
+      return;
+    case DisplayCall::Error::GetDisplayConfigBufferSizes:
+      throw GetDisplayConfigBufferSizesError(call.mString);
+    case DisplayCall::Error::QueryDisplayConfig:
+      throw QueryDisplayConfigError(call.mString);
+    case DisplayCall::Error::SetDisplayConfig:
+      throw SetDisplayConfigError(call.mString);
+  }
+  throw DisplayReplayError(std::format(
+    "The recording has an unknown error kind {}",
+    static_cast<uint32_t>(call.mError)));
+}
+
+DisplayConfig ReplayDisplayBackend::QueryDisplayConfig(uint32_t flags) {
+  const auto& call = this->Find(DisplayCall::Kind::QueryDisplayConfig, flags);
+  this->Replay(call);
+  return call.mConfig;
+}
+
+void ReplayDisplayBackend::SetDisplayConfig(
+  const DisplayConfig& config,
+  uint32_t flags) {
+  this->Replay(
+    this->Find(DisplayCall::Kind::SetDisplayConfig, flags, &config));
+}
+
+std::vector<AdapterInfo> ReplayDisplayBackend::EnumAdapters() {
+  const auto& call = this->Find(DisplayCall::Kind::EnumAdapters, 0);
+  this->Replay(call);
+  return call.mAdapters;
+}
+
+std::string ReplayDisplayBackend::GetOSVersion() {
+  const auto& call = this->Find(DisplayCall::Kind::GetOSVersion, 0);
+  this->Replay(call);
+  return call.mString;
+}
+
+}// namespace FredEmmott::MonitorTool
@@ -0,0 +1,147 @@
+// Copyright 2024, Fred Emmott
+// SPDX-License-Identifier: ISC
+
+#include <FredEmmott/MonitorTool/JSONWriter.hpp>
+
+#include <charconv>
+#include <stdexcept>
+
+namespace FredEmmott::MonitorTool {
+
+JSONWriter::JSONWriter(std::size_t reserve) {
+  mBuffer.reserve(reserve);
+}
+
+void JSONWriter::BeginValue() {
+  if (mDepth == 0) {
+    return;
+  }
+  const auto bit = uint64_t {1} << (mDepth - 1);
+  if (!(mIsArray & bit)) {
+    // Already handled by `Key()`
+    return;
+  }
+  mBuffer += (mHasElements & bit) ? ",\n" : "\n";
+  mHasElements |= bit;
+  mBuffer.append(mDepth * IndentWidth, ' ');
+}
+
+void JSONWriter::BeginContainer(char open, bool isArray) {
+  this->BeginValue();
+  if (mDepth == MaxDepth) {
+    throw std::logic_error("JSON nested too deeply");
+  }
+  mBuffer += open;
+  const auto bit = uint64_t {1} << mDepth;
+  mHasElements &= ~bit;
+  if (isArray) {
+    mIsArray |= bit;
+  } else {
+    mIsArray &= ~bit;
+  }
+  ++mDepth;
+}
+
+void JSONWriter::EndContainer(char close) {
+  --mDepth;
+  // Empty containers are `{}` or `[]`, without any whitespace
+  if (mHasElements & (uint64_t {1} << mDepth)) {
+    mBuffer += '\n';
+    mBuffer.append(mDepth * IndentWidth, ' ');
+  }
+  mBuffer += close;
+}
+
+void JSONWriter::BeginObject() {
+  this->BeginContainer('{', false);
+}
+
+void JSONWriter::EndObject() {
+  this->EndContainer('}');
+}
+
+void JSONWriter::BeginArray() {
+  this->BeginContainer('[', true);
+}
+
+void JSONWriter::EndArray() {
+  this->EndContainer(']');
+}
+
+void JSONWriter::Key(std::string_view key) {
+  const auto bit = uint64_t {1} << (mDepth - 1);
+  mBuffer += (mHasElements & bit) ? ",\n" : "\n";
+  mHasElements |= bit;
+  mBuffer.append(mDepth * IndentWidth, ' ');
+  this->WriteString(key);
+  mBuffer += ": ";
+}
+
+void JSONWriter::Write(std::string_view value) {
+  this->BeginValue();
+  this->WriteString(value);
+}
+
+void JSONWriter::WriteString(std::string_view value) {
+  mBuffer += '"';
+  for (const char c: value) {
+    // Matches `nlohmann::json`'s escaping with `ensure_ascii = false`
+    switch (c) {
+      case '"':
+        mBuffer += "\\\"";
+        break;
+      case '\\':
+        mBuffer += "\\\\";
+        break;
+      case '\b':
+        mBuffer += "\\b";
+        break;
+      case '\f':
+        mBuffer += "\\f";
+        break;
+      case '\n':
+        mBuffer += "\\n";
+        break;
+      case '\r':
+        mBuffer += "\\r";
+        break;
+      case '\t':
+        mBuffer += "\\t";
+        break;
+      default:
+        if (static_cast<unsigned char>(c) < 0x20) {
+          constexpr std::string_view hex {"0123456789abcdef"};
+          mBuffer += "\\u00";
+          mBuffer += hex[(c >> 4) & 0xf];
+          mBuffer += hex[c & 0xf];
+        } else {
+          mBuffer += c;
+        }
+        break;
+    }
+  }
+  mBuffer += '"';
+}
+
+void JSONWriter::Write(bool value) {
+  this->BeginValue();
+  mBuffer += value ? "true" : "false";
+}
+
+void JSONWriter::WriteInteger(int64_t value) {
+  this->BeginValue();
+  char buffer[24];
+  const auto result
+    = std::to_chars(std::begin(buffer), std::end(buffer), value);
+  mBuffer.append(buffer, result.ptr);
+}
+
+void JSONWriter::WriteInteger(uint64_t value) {
+  this->BeginValue();
+  char buffer[24];
+  const auto result
+    = std::to_chars(std::begin(buffer), std::end(buffer), value);
+  mBuffer.append(buffer, result.ptr);
+}
+
+}// namespace FredEmmott::MonitorTool
@@ -0,0 +1,63 @@
+// Copyright 2024, Fred Emmott
+// SPDX-License-Identifier: ISC
+
+#include <FredEmmott/MonitorTool/NormalizedDisplayPath.hpp>
+
+namespace FredEmmott::MonitorTool {
+
+namespace {
+
+const DISPLAYCONFIG_MODE_INFO* GetMode(
+  const DisplayConfig& config,
+  UINT32 index,
+  UINT32 invalidIndex,
+  DISPLAYCONFIG_MODE_INFO_TYPE infoType) {
+  if (index == invalidIndex || index >= config.mModes.size()) {
+    return nullptr;
+  }
+  const auto& mode = config.mModes.at(index);
+  return (mode.infoType == infoType) ? &mode : nullptr;
+}
+
+}// namespace
+
+NormalizedDisplayPath NormalizeDisplayPath(
+  const DisplayConfig& config,
+  const DISPLAYCONFIG_PATH_INFO& path) {
+  NormalizedDisplayPath ret {.mPath = path};
+
+  if (const auto mode = GetMode(
+        config,
+        path.sourceInfo.sourceModeInfoIdx,
+        DISPLAYCONFIG_PATH_SOURCE_MODE_IDX_INVALID,
+        DISPLAYCONFIG_MODE_INFO_TYPE_SOURCE)) {
+    ret.mSourceMode = mode->sourceMode;
+  }
+  if (const auto mode = GetMode(
+        config,
+        path.targetInfo.targetModeInfoIdx,
+        DISPLAYCONFIG_PATH_TARGET_MODE_IDX_INVALID,
+        DISPLAYCONFIG_MODE_INFO_TYPE_TARGET)) {
+    ret.mTargetMode = mode->targetMode;
+  }
+  if (const auto mode = GetMode(
+        config,
+        path.targetInfo.desktopModeInfoIdx,
+        DISPLAYCONFIG_PATH_DESKTOP_IMAGE_IDX_INVALID,
+        DISPLAYCONFIG_MODE_INFO_TYPE_DESKTOP_IMAGE)) {
+    ret.mDesktopImage = mode->desktopImageInfo;
+  }
+
+  auto& source = ret.mPath.sourceInfo;
+  auto& target = ret.mPath.targetInfo;
+  source.sourceModeInfoIdx = 0;
+  source.statusFlags = 0;
+  target.desktopModeInfoIdx = 0;
+  target.targetModeInfoIdx = 0;
+  target.targetAvailable = 0;
+  target.statusFlags = 0;
+
+  return ret;
+}
+
+}// namespace FredEmmott::MonitorTool
@@ -0,0 +1,67 @@
+// Copyright 2024, Fred Emmott
+// SPDX-License-Identifier: ISC
+
+#include <FredEmmott/MonitorTool/Paths.hpp>
+
+#ifdef _WIN32
+#include <winrt/base.h>
+
+#include <ShlObj.h>
+#include <Windows.h>
+#else
+#include <cstdlib>
+#endif
+
+namespace FredEmmott::MonitorTool {
+
+namespace {
+#ifdef _WIN32
+std::filesystem::path RunOnce_GetDataPath() {
+  PWSTR pathStr {nullptr};
+
+  winrt::check_hresult(SHGetKnownFolderPath(
+    FOLDERID_LocalAppData, KF_FLAG_DEFAULT | KF_FLAG_CREATE, NULL, &pathStr));
+  if (!pathStr) {
+    return {};
+  }
+  const auto path = std::filesystem::path(pathStr) / "Freds Monitor Tool";
+  CoTaskMemFree(pathStr);
+  return path;
+}
+#else
+std::filesystem::path RunOnce_GetDataPath() {
+  // XDG Base Directory Specification
+  if (const auto xdg = std::getenv("XDG_DATA_HOME"); xdg && *xdg) {
+    return std::filesystem::path(xdg) / "freds-monitor-tool";
+  }
+  if (const auto home = std::getenv("HOME"); home && *home) {
+    return std::filesystem::path(home) / ".local" / "share"
+      / "freds-monitor-tool";
+  }
+  return {};
+}
+#endif
+}// namespace
+
+std::filesystem::path GetDataPath() {
+  static const auto sPath = RunOnce_GetDataPath();
+  return sPath;
+}
+
+std::filesystem::path GetProfilesPath() {
+  static const auto sPath = [] {
+    const auto root = GetDataPath();
+    return root.empty() ? root : (root / "Profiles");
+  }();
+  return sPath;
+}
+
+std::wstring GetFileAPIPath(const std::filesystem::path& path) {
+#ifdef _WIN32
+  return L"\\\\?\\" + std::filesystem::absolute(path).wstring();
+#else
+  return std::filesystem::absolute(path).wstring();
+#endif
+}
+
+}// namespace FredEmmott::MonitorTool
@@ -2,51 +2,26 @@
 // SPDX-License-Identifier: ISC
 
 #include <FredEmmott/MonitorTool/EnumAdapterDescs.hpp>
+#include <FredEmmott/MonitorTool/Paths.hpp>
 #include <FredEmmott/MonitorTool/Profile.hpp>
+#include <FredEmmott/MonitorTool/ProfileCache.hpp>
+#include <FredEmmott/MonitorTool/ProfileStore.hpp>
 #include <FredEmmott/MonitorTool/QueryDisplayConfig.hpp>
 #include <FredEmmott/MonitorTool/SetDisplayConfig.hpp>
+#include <FredEmmott/MonitorTool/SimdJSONProfileParser.hpp>
+#include <FredEmmott/MonitorTool/Trace.hpp>
 #include <FredEmmott/MonitorTool/json.hpp>
 #include <winrt/base.h>
 
-#include <ShlObj.h>
-#include <Windows.h>
-
-NLOHMANN_JSON_NAMESPACE_BEGIN
-template <>
-struct adl_serializer<winrt::guid> {
-  static void from_json(const nlohmann::json& j, winrt::guid& v) {
-    auto s = j.get<std::string_view>();
-    if (s.size() == 38 && (s.front() == '{') && (s.back() == '}')) {
-      s.remove_prefix(1);
-      s.remove_suffix(1);
-    }
-    v = winrt::guid {s};
-  }
+#include <bit>
+#include <format>
+#include <optional>
 
-  static void to_json(nlohmann::json& j, const winrt::guid& v) {
-    j = winrt::to_string(winrt::to_hstring(v));
-  }
-};
-NLOHMANN_JSON_NAMESPACE_END
+#include <Windows.h>
 
 namespace FredEmmott::MonitorTool {
 
 namespace {
-std::filesystem::path RunOnce_GetProfilesPath() {
-  PWSTR pathStr {nullptr};
-
-  winrt::check_hresult(SHGetKnownFolderPath(
-    FOLDERID_LocalAppData, KF_FLAG_DEFAULT | KF_FLAG_CREATE, NULL, &pathStr));
-  if (!pathStr) {
-    return {};
-  }
-  const auto path
-    = std::filesystem::path(pathStr) / "Freds Monitor Tool" / "Profiles";
-  CoTaskMemFree(pathStr);
-  return path;
-}
-const auto ProfilesPath = RunOnce_GetProfilesPath();
-
 winrt::guid CreateRandomGUID() {
   GUID ret;
   winrt::check_hresult(CoCreateGuid(&ret));
@@ -60,18 +35,9 @@ void Profile::Save(const std::filesystem::path& path) const {
     std::filesystem::create_directories(parent);
   }
 
-  const nlohmann::json j {
-    {"GUID", mGuid},
-    {"Name", mName},
-    {"Adapters", mAdapters},
-    {"Paths", mDisplayConfig.mPaths},
-    {"Modes", mDisplayConfig.mModes},
-  };
-
-  const auto json = j.dump(2);
+  const auto json = this->ToJSON();
 
-  // Remove MAX_PATH limitation
-  const auto fullPath = L"\\\\?\\" + std::filesystem::absolute(path).wstring();
+  const auto fullPath = GetFileAPIPath(path);
 
   winrt::file_handle file {CreateFileW(
     fullPath.c_str(),
@@ -105,8 +71,8 @@ void Profile::Save(const std::filesystem::path& path) const {
 }
 
 Profile Profile::Load(const std::filesystem::path& path) {
-  // Remove MAX_PATH limitation
-  const auto fullPath = L"\\\\?\\" + std::filesystem::absolute(path).wstring();
+  TraceSpan span {"Profile::Load"};
+  const auto fullPath = GetFileAPIPath(path);
   winrt::file_handle file {CreateFileW(
     fullPath.c_str(),
     GENERIC_READ,
@@ -120,23 +86,66 @@ Profile Profile::Load(const std::filesystem::path& path) {
     throw FileOpenError(
       std::format("Failed to open `{}`: {}", winrt::to_string(fullPath), ec));
   }
-  const auto fileSize = GetFileSize(file.get(), nullptr);
-  std::string buffer(fileSize, '\0');
-  DWORD bytesRead = 0;
-  while (bytesRead < fileSize) {
-    DWORD bytesThisLoop = 0;
-    if (!ReadFile(
-          file.get(),
-          buffer.data() + bytesRead,
-          fileSize - bytesRead,
-          &bytesThisLoop,
-          nullptr)) {
-      throw FileReadError(
-        std::format("Failed to read from file: {}", GetLastError()));
+  BY_HANDLE_FILE_INFORMATION fileInfo {};
+  if (!GetFileInformationByHandle(file.get(), &fileInfo)) {
+    throw FileReadError(
+      std::format("Failed to get file information: {}", GetLastError()));
+  }
+  const auto fileSize = fileInfo.nFileSizeLow;
+  const auto& lastWrite = fileInfo.ftLastWriteTime;
+  ProfileSourceInfo source {
+    .mSize = (static_cast<uint64_t>(fileInfo.nFileSizeHigh) << 32)
+      | fileInfo.nFileSizeLow,
+    .mLastWriteTime = (static_cast<uint64_t>(lastWrite.dwHighDateTime) << 32)
+      | lastWrite.dwLowDateTime,
+  };
+
+  std::string buffer;
+  std::optional<uint64_t> contentHash;
+  const auto getContentHash = [&]() {
+    if (contentHash) {
+      return *contentHash;
+    }
+    buffer.resize(fileSize);
+    DWORD bytesRead = 0;
+    while (bytesRead < fileSize) {
+      DWORD bytesThisLoop = 0;
+      if (!ReadFile(
+            file.get(),
+            buffer.data() + bytesRead,
+            fileSize - bytesRead,
+            &bytesThisLoop,
+            nullptr)) {
+        throw FileReadError(
+          std::format("Failed to read from file: {}", GetLastError()));
+      }
+      bytesRead += bytesThisLoop;
     }
-    bytesRead += bytesThisLoop;
+    contentHash = HashProfileContents(buffer);
+    return *contentHash;
+  };
+
+  if (auto cached = LoadCachedProfile(
+        path, source.mSize, source.mLastWriteTime, getContentHash)) {
+    return std::move(*cached);
+  }
+
+  source.mContentHash = getContentHash();
+  auto ret = Profile::FromJSON(buffer);
+  ret.mPath = path;
+  StoreCachedProfile(path, source, ret);
+  return ret;
+}
+
+Profile Profile::FromJSON(std::string_view json) {
+  TraceSpan span {"Profile::FromJSON"};
+#ifdef FMT_WITH_SIMDJSON
+  if (auto ret = ParseProfileWithSimdJSON(json)) {
+    return std::move(*ret);
   }
-  const auto j = nlohmann::json::parse(buffer);
+#endif
+
+  const auto j = nlohmann::json::parse(json);
   return {
         .mName = j.at("Name"),
         .mAdapters = j.value("Adapters", std::vector<DXGI_ADAPTER_DESC1>{}),
@@ -145,10 +154,37 @@ Profile Profile::Load(const std::filesystem::path& path) {
             .mModes = j.at("Modes"),
         },
         .mGuid = j.at("GUID"),
-        .mPath = path,
     };
 }
 
+std::string Profile::ToJSON() const {
+  // Rough upper bound, so that we don't need to reallocate
+  JSONWriter w {
+    1024
+    + (1024
+       * (mAdapters.size() + mDisplayConfig.mModes.size()
+          + mDisplayConfig.mPaths.size()))};
+
+  // Ordered so that `ProfileSummary::Load()` can stop after the first three
+  // keys; everything below the top level is sorted, as with `nlohmann::json`
+  w.BeginObject();
+  w.Key("Name");
+  w.Write(mName);
+  w.Key("GUID");
+  w.Write(winrt::to_string(winrt::to_hstring(mGuid)));
+  w.Key("Fingerprint");
+  w.Write(GetFingerprint().ToString());
+  w.Key("Adapters");
+  w.Write(mAdapters);
+  w.Key("Modes");
+  w.Write(mDisplayConfig.mModes);
+  w.Key("Paths");
+  w.Write(mDisplayConfig.mPaths);
+  w.EndObject();
+
+  return std::move(w).GetString();
+}
+
 Profile Profile::CreateFromActiveConfiguration(const std::string& name) {
   return {
     .mName = name,
@@ -158,22 +194,19 @@ Profile Profile::CreateFromActiveConfiguration(const std::string& name) {
   };
 }
 
-std::vector<Profile> Profile::Enumerate() {
-  if (!std::filesystem::is_directory(ProfilesPath)) {
-    return {};
-  }
+std::vector<Profile> Profile::Enumerate(std::size_t maxThreads) {
+  TraceSpan span {"Profile::Enumerate"};
+  return GetProfileStore().Enumerate(maxThreads);
+}
 
-  std::vector<Profile> ret;
-  for (auto&& entry: std::filesystem::directory_iterator(ProfilesPath)) {
-    if (!entry.is_regular_file()) {
-      continue;
-    }
-    if (entry.path().extension() != ".json") {
-      continue;
-    }
-    ret.push_back(Profile::Load(entry.path()));
-  }
-  return ret;
+std::vector<ProfileSummary> Profile::EnumerateSummaries(
+  std::size_t maxThreads) {
+  TraceSpan span {"Profile::EnumerateSummaries"};
+  return GetProfileStore().EnumerateSummaries(maxThreads);
+}
+
+DisplayConfigFingerprint Profile::GetFingerprint() const {
+  return GetDisplayConfigFingerprint(mDisplayConfig);
 }
 
 bool Profile::CanApply() const {
@@ -185,60 +218,12 @@ bool Profile::CanApply() const {
   }
 }
 
-void Profile::Apply(ApplyMode mode) const {
-  try {
-    SetDisplayConfig(mDisplayConfig, SetDisplayConfigValidateFlags);
-  } catch (const RuntimeError& e) {
-    throw DisplayConfigValidationError(
-      std::format("Validation failed: {}", e.what()));
-  }
-
-  auto flags = SetDisplayConfigApplyFlags;
-  if (mode == ApplyMode::Persistent) {
-    flags |= SDC_SAVE_TO_DATABASE;
-  }
-  SetDisplayConfig(mDisplayConfig, flags);
-}
-
 void Profile::Save() const {
   if (!mPath.empty()) {
     this->Save(mPath);
     return;
   }
-
-  const auto profiles = Profile::Enumerate();
-  const auto matching = std::ranges::find(profiles, mGuid, &Profile::mGuid);
-  if (matching != profiles.end()) {
-    this->Save(matching->mPath);
-    return;
-  }
-
-  // Pick absolutely known-safe chars only
-  std::string basename;
-  for (const char it: mName) {
-    if (
-      (it >= 'a' && it <= 'z') || (it >= 'A' && it <= 'Z')
-      || (it >= '0' && it <= '9') || (it == ' ') || (it == '-')
-      || (it == '_')) {
-      basename += it;
-    }
-  }
-
-  const auto path = ProfilesPath / (basename + ".json");
-  if (!std::filesystem::exists(path)) {
-    this->Save(path);
-    return;
-  }
-
-  uint16_t i = 1;
-  while (true) {
-    const auto path = ProfilesPath / std::format("{}-{:04x}.json", basename, i);
-    if (std::filesystem::exists(path)) {
-      continue;
-    }
-    this->Save(path);
-    return;
-  }
+  GetProfileStore().Save(*this);
 }
 
-}// namespace FredEmmott::MonitorTool
\ No newline at end of file
+}// namespace FredEmmott::MonitorTool
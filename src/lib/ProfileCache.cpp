@@ -0,0 +1,386 @@
+// Copyright 2024, Fred Emmott
+// SPDX-License-Identifier: ISC
+
+#include <FredEmmott/MonitorTool/Paths.hpp>
+#include <FredEmmott/MonitorTool/ProfileCache.hpp>
+#include <winrt/base.h>
+
+#include <cwctype>
+#include <format>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <type_traits>
+#include <unordered_set>
+#include <vector>
+
+#include <Windows.h>
+
+namespace FredEmmott::MonitorTool {
+
+namespace {
+
+// 'FMTC'
+constexpr uint32_t CacheMagic = 0x43544d46;
+// Increment if the layout changes
+constexpr uint32_t CacheVersion = 1;
+
+struct CacheHeader {
+  uint32_t mMagic {CacheMagic};
+  uint32_t mVersion {CacheVersion};
+  // Guard against a cache written by a build with different struct layouts
+  uint32_t mPathInfoSize {sizeof(DISPLAYCONFIG_PATH_INFO)};
+  uint32_t mModeInfoSize {sizeof(DISPLAYCONFIG_MODE_INFO)};
+  uint32_t mAdapterDescSize {sizeof(DXGI_ADAPTER_DESC1)};
+
+  // Number of `wchar_t`s
+  uint32_t mSourcePathLength {};
+  ProfileSourceInfo mSource {};
+
+  GUID mGuid {};
+  // Number of `char`s
+  uint32_t mNameLength {};
+  uint32_t mPathCount {};
+  uint32_t mModeCount {};
+  uint32_t mAdapterCount {};
+};
+static_assert(std::is_trivially_copyable_v<CacheHeader>);
+static_assert(std::is_trivially_copyable_v<DISPLAYCONFIG_PATH_INFO>);
+static_assert(std::is_trivially_copyable_v<DISPLAYCONFIG_MODE_INFO>);
+static_assert(std::is_trivially_copyable_v<DXGI_ADAPTER_DESC1>);
+
+std::mutex sCacheRootMutex;
+std::filesystem::path sCacheRoot;
+
+std::filesystem::path GetCacheRoot() {
+  std::unique_lock lock(sCacheRootMutex);
+  if (sCacheRoot.empty()) {
+    return GetDataPath() / "Cache";
+  }
+  return sCacheRoot;
+}
+
+// The cache is keyed by path, and Windows paths are case-insensitive
+std::wstring NormalizeSourcePath(const std::filesystem::path& path) {
+  auto ret = std::filesystem::absolute(path).lexically_normal().wstring();
+#ifdef _WIN32
+  for (auto& c: ret) {
+    c = std::towlower(c);
+  }
+#endif
+  return ret;
+}
+
+std::filesystem::path GetCachePath(std::wstring_view normalizedSourcePath) {
+  const auto key = HashProfileContents(
+    {reinterpret_cast<const char*>(normalizedSourcePath.data()),
+     normalizedSourcePath.size() * sizeof(wchar_t)});
+  return GetCacheRoot() / std::format("{:016x}.fmtc", key);
+}
+
+struct ViewDeleter {
+  void operator()(const void* p) const noexcept {
+    UnmapViewOfFile(p);
+  }
+};
+
+class Reader {
+ public:
+  Reader(const std::byte* begin, const std::byte* end)
+    : mIt(begin), mEnd(end) {
+  }
+
+  template <class T>
+  bool Read(T* out, std::size_t count = 1) noexcept {
+    const auto bytes = sizeof(T) * count;
+    if (static_cast<std::size_t>(mEnd - mIt) < bytes) {
+      return false;
+    }
+    memcpy(out, mIt, bytes);
+    mIt += bytes;
+    return true;
+  }
+
+  // These check the count before resizing, so that a damaged count can't make
+  // us allocate gigabytes
+
+  template <class T>
+  bool Read(std::vector<T>& out, std::size_t count) {
+    if (static_cast<std::size_t>(mEnd - mIt) / sizeof(T) < count) {
+      return false;
+    }
+    out.resize(count);
+    return this->Read(out.data(), count);
+  }
+
+  bool Read(std::string& out, std::size_t count) {
+    if (static_cast<std::size_t>(mEnd - mIt) < count) {
+      return false;
+    }
+    out.resize(count);
+    return this->Read(out.data(), count);
+  }
+
+  bool AtEnd() const noexcept {
+    return mIt == mEnd;
+  }
+
+ private:
+  const std::byte* mIt {nullptr};
+  const std::byte* mEnd {nullptr};
+};
+
+template <class T>
+void Append(std::string& buffer, const T* data, std::size_t count = 1) {
+  buffer.append(reinterpret_cast<const char*>(data), sizeof(T) * count);
+}
+
+}// namespace
+
+uint64_t HashProfileContents(std::string_view data) {
+  uint64_t ret = 0xcbf29ce484222325ull;
+  for (const auto c: data) {
+    ret ^= static_cast<uint8_t>(c);
+    ret *= 0x100000001b3ull;
+  }
+  return ret;
+}
+
+std::optional<Profile> LoadCachedProfile(
+  const std::filesystem::path& path,
+  uint64_t size,
+  uint64_t lastWriteTime,
+  const std::function<uint64_t()>& getContentHash) {
+  const auto sourcePath = NormalizeSourcePath(path);
+  const auto cachePath = GetCachePath(sourcePath);
+
+  Profile ret;
+  ProfileSourceInfo source {};
+  {
+    winrt::file_handle file {CreateFileW(
+      cachePath.c_str(),
+      GENERIC_READ,
+      FILE_SHARE_READ | FILE_SHARE_DELETE,
+      nullptr,
+      OPEN_EXISTING,
+      FILE_ATTRIBUTE_NORMAL,
+      NULL)};
+    if (!file) {
+      return {};
+    }
+    LARGE_INTEGER fileSize {};
+    if (
+      (!GetFileSizeEx(file.get(), &fileSize))
+      || fileSize.QuadPart < static_cast<LONGLONG>(sizeof(CacheHeader))) {
+      return {};
+    }
+
+    winrt::handle mapping {
+      CreateFileMappingW(file.get(), nullptr, PAGE_READONLY, 0, 0, nullptr)};
+    if (!mapping) {
+      return {};
+    }
+    const std::unique_ptr<const void, ViewDeleter> view {
+      MapViewOfFile(mapping.get(), FILE_MAP_READ, 0, 0, 0)};
+    if (!view) {
+      return {};
+    }
+
+    const auto begin = static_cast<const std::byte*>(view.get());
+    Reader reader {begin, begin + fileSize.QuadPart};
+
+    CacheHeader header;
+    if (!reader.Read(&header)) {
+      return {};
+    }
+    {
+      // Everything we know in advance must match
+      CacheHeader expected = header;
+      expected.mMagic = CacheMagic;
+      expected.mVersion = CacheVersion;
+      expected.mPathInfoSize = sizeof(DISPLAYCONFIG_PATH_INFO);
+      expected.mModeInfoSize = sizeof(DISPLAYCONFIG_MODE_INFO);
+      expected.mAdapterDescSize = sizeof(DXGI_ADAPTER_DESC1);
+      expected.mSourcePathLength = static_cast<uint32_t>(sourcePath.size());
+      expected.mSource.mSize = size;
+      if (memcmp(&header, &expected, sizeof(header)) != 0) {
+        return {};
+      }
+    }
+    source = header.mSource;
+    // Only read and hash the JSON file if the cheap check fails
+    if (
+      source.mLastWriteTime != lastWriteTime
+      && source.mContentHash != getContentHash()) {
+      return {};
+    }
+
+    std::wstring cachedSourcePath(header.mSourcePathLength, L'\0');
+    if (
+      (!reader.Read(cachedSourcePath.data(), cachedSourcePath.size()))
+      || cachedSourcePath != sourcePath) {
+      // Hash collision
+      return {};
+    }
+
+    if (!(reader.Read(ret.mName, header.mNameLength)
+          && reader.Read(ret.mDisplayConfig.mPaths, header.mPathCount)
+          && reader.Read(ret.mDisplayConfig.mModes, header.mModeCount)
+          && reader.Read(ret.mAdapters, header.mAdapterCount)
+          && reader.AtEnd())) {
+      return {};
+    }
+    ret.mGuid = header.mGuid;
+  }
+
+  if (source.mLastWriteTime != lastWriteTime) {
+    // Unchanged, but touched; update the entry so that next time, we don't
+    // need to read the JSON file. Not while it's mapped, as it's replaced
+    source.mLastWriteTime = lastWriteTime;
+    StoreCachedProfile(path, source, ret);
+  }
+
+  ret.mPath = path;
+  return ret;
+}
+
+void StoreCachedProfile(
+  const std::filesystem::path& path,
+  const ProfileSourceInfo& source,
+  const Profile& profile) noexcept {
+  try {
+    const auto sourcePath = NormalizeSourcePath(path);
+    const auto cachePath = GetCachePath(sourcePath);
+
+    const auto& paths = profile.mDisplayConfig.mPaths;
+    const auto& modes = profile.mDisplayConfig.mModes;
+    const auto& adapters = profile.mAdapters;
+
+    const CacheHeader header {
+      .mSourcePathLength = static_cast<uint32_t>(sourcePath.size()),
+      .mSource = source,
+      .mGuid = profile.mGuid,
+      .mNameLength = static_cast<uint32_t>(profile.mName.size()),
+      .mPathCount = static_cast<uint32_t>(paths.size()),
+      .mModeCount = static_cast<uint32_t>(modes.size()),
+      .mAdapterCount = static_cast<uint32_t>(adapters.size()),
+    };
+
+    std::string buffer;
+    buffer.reserve(
+      sizeof(header) + (sourcePath.size() * sizeof(wchar_t))
+      + profile.mName.size() + (paths.size() * sizeof(paths.front()))
+      + (modes.size() * sizeof(modes.front()))
+      + (adapters.size() * sizeof(DXGI_ADAPTER_DESC1)));
+    Append(buffer, &header);
+    Append(buffer, sourcePath.data(), sourcePath.size());
+    Append(buffer, profile.mName.data(), profile.mName.size());
+    Append(buffer, paths.data(), paths.size());
+    Append(buffer, modes.data(), modes.size());
+    Append(buffer, adapters.data(), adapters.size());
+
+    std::error_code ec;
+    std::filesystem::create_directories(cachePath.parent_path(), ec);
+
+    // Write then rename, so that concurrent readers never see a partial file
+    auto tempPath = cachePath;
+    tempPath += std::format(
+      L".{}-{}.tmp", GetCurrentProcessId(), GetCurrentThreadId());
+    {
+      winrt::file_handle file {CreateFileW(
+        tempPath.c_str(),
+        GENERIC_WRITE,
+        0,
+        nullptr,
+        CREATE_ALWAYS,
+        FILE_ATTRIBUTE_NORMAL,
+        NULL)};
+      if (!file) {
+        return;
+      }
+      DWORD bytesWritten {};
+      if (
+        (!WriteFile(
+          file.get(),
+          buffer.data(),
+          static_cast<DWORD>(buffer.size()),
+          &bytesWritten,
+          nullptr))
+        || bytesWritten != buffer.size()) {
+        file.close();
+        DeleteFileW(tempPath.c_str());
+        return;
+      }
+    }
+    if (!MoveFileExW(
+          tempPath.c_str(), cachePath.c_str(), MOVEFILE_REPLACE_EXISTING)) {
+      DeleteFileW(tempPath.c_str());
+    }
+  } catch (...) {
+    // Just a cache
+  }
+}
+
+void RemoveCachedProfile(const std::filesystem::path& path) noexcept {
+  try {
+    DeleteFileW(GetCachePath(NormalizeSourcePath(path)).c_str());
+  } catch (...) {
+    // Just a cache
+  }
+}
+
+void PruneCachedProfiles(
+  const std::vector<std::filesystem::path>& livePaths) noexcept {
+  try {
+    // Entries are named by a hash of their source path, so live entries can
+    // be skipped without opening them
+    std::unordered_set<std::filesystem::path::string_type> live;
+    for (const auto& it: livePaths) {
+      live.emplace(GetCachePath(NormalizeSourcePath(it)).filename().native());
+    }
+
+    std::error_code ec;
+    for (const auto& entry:
+         std::filesystem::directory_iterator(GetCacheRoot(), ec)) {
+      const auto& cachePath = entry.path();
+      if (
+        cachePath.extension() != ".fmtc"
+        || live.contains(cachePath.filename().native())) {
+        continue;
+      }
+
+      // Not one of `livePaths`, but it might be from another store, or a
+      // profile loaded by path, so check if its source still exists
+      std::ifstream f(cachePath, std::ios::binary);
+      CacheHeader header;
+      if (!f.read(reinterpret_cast<char*>(&header), sizeof(header))) {
+        continue;
+      }
+      if (header.mMagic != CacheMagic || header.mVersion != CacheVersion) {
+        f.close();
+        std::filesystem::remove(cachePath, ec);
+        continue;
+      }
+      std::wstring sourcePath(header.mSourcePathLength, L'\0');
+      if (!f.read(
+            reinterpret_cast<char*>(sourcePath.data()),
+            sourcePath.size() * sizeof(wchar_t))) {
+        continue;
+      }
+      f.close();
+      if (!std::filesystem::exists(std::filesystem::path {sourcePath}, ec)) {
+        std::filesystem::remove(cachePath, ec);
+      }
+    }
+  } catch (...) {
+    // Just a cache
+  }
+}
+
+void SetProfileCacheRoot(std::filesystem::path root) {
+  std::unique_lock lock(sCacheRootMutex);
+  sCacheRoot = std::move(root);
+}
+
+}// namespace FredEmmott::MonitorTool
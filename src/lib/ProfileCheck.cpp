@@ -0,0 +1,126 @@
+// Copyright 2024, Fred Emmott
+// SPDX-License-Identifier: ISC
+
+#include <FredEmmott/MonitorTool/ParallelTransform.hpp>
+#include <FredEmmott/MonitorTool/ProfileCheck.hpp>
+#include <FredEmmott/MonitorTool/ProfileStore.hpp>
+
+#include <format>
+
+namespace FredEmmott::MonitorTool {
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+using Status = ProfileCheckResult::Status;
+
+/// Bundles don't have per-profile paths
+Profile LoadProfile(const ProfileSummary& summary) {
+  if (!summary.mPath.empty()) {
+    return Profile::Load(summary.mPath);
+  }
+  auto ret = GetProfileStore().FindByGUID(summary.mGuid);
+  if (!ret) {
+    throw FileReadError("Profile was removed while checking");
+  }
+  return std::move(*ret);
+}
+
+void CheckProfile(
+  const Profile& profile,
+  const ApplySystemState& system,
+  ProfileCheckResult& result) {
+  const auto plan = PlanApply(profile, system, false);
+
+  result.mActive = plan.mProfile && plan.mDifferences.empty();
+  switch (plan.mStrategy) {
+    case ApplyPlan::Strategy::AsSaved:
+      result.mStatus = Status::OK;
+      return;
+    case ApplyPlan::Strategy::SingleGPU:
+    case ApplyPlan::Strategy::RemappedLUIDs:
+      result.mStatus = Status::NeedsRemap;
+      result.mReason = std::string {ToString(plan.mStrategy)};
+      return;
+    case ApplyPlan::Strategy::None:
+      result.mStatus = Status::Invalid;
+      result.mReason = std::format(
+        "Windows rejected {} candidate configuration(s)",
+        plan.mValidationCount);
+      return;
+  }
+}
+
+/// `load()` returns the profile, or throws if it can't be loaded
+template <class F>
+ProfileCheckResult CheckProfile(
+  std::string_view name,
+  const winrt::guid& guid,
+  const ApplySystemState& system,
+  F&& load) {
+  const auto start = Clock::now();
+  ProfileCheckResult ret {
+    .mName = std::string {name},
+    .mGuid = guid,
+  };
+  try {
+    CheckProfile(load(), system, ret);
+  } catch (const std::exception& e) {
+    ret.mStatus = Status::Error;
+    ret.mReason = e.what();
+  }
+  ret.mDuration = Clock::now() - start;
+  return ret;
+}
+
+}// namespace
+
+std::string_view ToString(ProfileCheckResult::Status status) {
+  switch (status) {
+    case Status::OK:
+      return "OK";
+    case Status::NeedsRemap:
+      return "needs remap";
+    case Status::Invalid:
+      return "invalid";
+    case Status::Error:
+      return "error";
+  }
+  return "unknown";
+}
+
+std::vector<ProfileCheckResult> CheckProfiles(std::size_t maxThreads) {
+  // Queried once; every profile is checked against the same state
+  const auto system = ApplySystemState::GetCurrent();
+
+  auto& store = GetProfileStore();
+  std::vector<Profile> profiles;
+  try {
+    // Loaded in one pass, as looking each profile up separately re-reads the
+    // index, or for bundles, the whole file
+    profiles = store.Enumerate(maxThreads);
+  } catch (const std::exception&) {
+    // At least one is damaged; load them separately, so the others are still
+    // checked, and the error is reported against the right profile
+    return ParallelTransform(
+      store.EnumerateSummaries(maxThreads),
+      [&system](const ProfileSummary& summary) {
+        return CheckProfile(summary.mName, summary.mGuid, system, [&summary] {
+          return LoadProfile(summary);
+        });
+      },
+      maxThreads);
+  }
+
+  return ParallelTransform(
+    profiles,
+    [&system](const Profile& profile) {
+      return CheckProfile(
+        profile.mName, profile.mGuid, system, [&profile]() -> const Profile& {
+          return profile;
+        });
+    },
+    maxThreads);
+}
+
+}// namespace FredEmmott::MonitorTool
@@ -0,0 +1,380 @@
+// Copyright 2024, Fred Emmott
+// SPDX-License-Identifier: ISC
+
+#include <FredEmmott/MonitorTool/ParallelTransform.hpp>
+#include <FredEmmott/MonitorTool/Paths.hpp>
+#include <FredEmmott/MonitorTool/ProfileIndex.hpp>
+#include <FredEmmott/MonitorTool/json.hpp>
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <format>
+#include <fstream>
+
+#include <Windows.h>
+
+namespace FredEmmott::MonitorTool {
+
+namespace {
+// Increment if the format changes; older indices are discarded and rebuilt
+constexpr uint32_t IndexVersion = 2;
+
+int64_t GetLastWriteTime(const std::filesystem::path& path) {
+  std::error_code ec;
+  const auto ret = std::filesystem::last_write_time(path, ec);
+  if (ec) {
+    return 0;
+  }
+  return ret.time_since_epoch().count();
+}
+
+std::string ToUTF8(const std::filesystem::path& path) {
+  return winrt::to_string(path.wstring());
+}
+
+std::filesystem::path FromUTF8(const std::string& path) {
+  return std::filesystem::path {std::wstring {winrt::to_hstring(path)}};
+}
+
+bool IsCurrent(const ProfileIndexEntry& entry) {
+  std::error_code ec;
+  const auto size = std::filesystem::file_size(entry.mPath, ec);
+  if (ec || size != entry.mSize) {
+    return false;
+  }
+  return GetLastWriteTime(entry.mPath) == entry.mLastWriteTime;
+}
+
+}// namespace
+
+std::size_t ProfileIndex::GuidHash::operator()(
+  const winrt::guid& guid) const noexcept {
+  static_assert(sizeof(winrt::guid) == sizeof(std::array<uint64_t, 2>));
+  const auto [a, b] = std::bit_cast<std::array<uint64_t, 2>>(guid);
+  return std::hash<uint64_t> {}(a ^ (b * 0x9e3779b97f4a7c15ull));
+}
+
+std::string ProfileIndex::FoldCase(std::string_view in) {
+  // ASCII-only to match `_stricmp()` in the "C" locale
+  std::string ret {in};
+  for (auto& c: ret) {
+    if (c >= 'A' && c <= 'Z') {
+      c += 'a' - 'A';
+    }
+  }
+  return ret;
+}
+
+ProfileIndex ProfileIndex::Open() {
+  return Open(GetProfilesPath());
+}
+
+ProfileIndex ProfileIndex::Open(const std::filesystem::path& profilesPath) {
+  ProfileIndex ret;
+  ret.mProfilesPath = profilesPath;
+  // e.g. `Profiles` -> `Profiles.index.json`
+  ret.mIndexPath = profilesPath.parent_path()
+    / (profilesPath.filename().wstring() + L".index.json");
+
+  bool loaded = false;
+  try {
+    std::ifstream f(ret.mIndexPath, std::ios::binary);
+    if (f) {
+      const auto j = nlohmann::json::parse(f);
+      if (
+        j.at("Version").get<uint32_t>() == IndexVersion
+        && FromUTF8(j.at("ProfilesPath").get<std::string>())
+          == ret.mProfilesPath) {
+        ret.mDirectoryLastWriteTime = j.at("DirectoryLastWriteTime");
+        for (const auto& it: j.at("Profiles")) {
+          std::optional<DisplayConfigFingerprint> fingerprint;
+          if (const auto f = it.find("Fingerprint"); f != it.end()) {
+            fingerprint
+              = DisplayConfigFingerprint::FromString(f->get<std::string>());
+          }
+          ret.mEntries.push_back({
+            .mName = it.at("Name"),
+            .mFoldedName = it.at("FoldedName"),
+            .mGuid = it.at("GUID"),
+            .mPath = FromUTF8(it.at("Path").get<std::string>()),
+            .mFingerprint = fingerprint,
+            .mLastWriteTime = it.at("LastWriteTime"),
+            .mSize = it.at("Size"),
+          });
+        }
+        loaded = true;
+      }
+    }
+  } catch (...) {
+    // Not just JSON errors; e.g. a bad GUID throws `std::invalid_argument`.
+    // It's only an index, so rebuild it
+    ret.mEntries.clear();
+    loaded = false;
+  }
+
+  if (
+    (!loaded)
+    || GetLastWriteTime(ret.mProfilesPath) != ret.mDirectoryLastWriteTime) {
+    ret.Refresh();
+  } else {
+    ret.RebuildMaps();
+  }
+  return ret;
+}
+
+void ProfileIndex::Refresh() {
+  mIsFresh = true;
+
+  // Fetch this before enumerating, so that if anything is added while we're
+  // enumerating, the next `Open()` will refresh again
+  const auto directoryLastWriteTime = GetLastWriteTime(mProfilesPath);
+  bool changed = (directoryLastWriteTime != mDirectoryLastWriteTime);
+
+  std::unordered_map<
+    std::filesystem::path::string_type,
+    const ProfileIndexEntry*>
+    previous;
+  for (const auto& it: mEntries) {
+    previous.emplace(it.mPath.native(), &it);
+  }
+
+  std::vector<ProfileIndexEntry> entries;
+  // Only the path and file info are filled in until they're re-read
+  std::vector<ProfileIndexEntry> stale;
+  std::error_code ec;
+  for (auto&& entry: std::filesystem::directory_iterator(mProfilesPath, ec)) {
+    if (!entry.is_regular_file(ec)) {
+      continue;
+    }
+    if (entry.path().extension() != ".json") {
+      continue;
+    }
+
+    const auto lastWriteTime
+      = entry.last_write_time(ec).time_since_epoch().count();
+    const auto size = entry.file_size(ec);
+    if (ec) {
+      continue;
+    }
+
+    const auto it = previous.find(entry.path().native());
+    if (
+      it != previous.end() && it->second->mLastWriteTime == lastWriteTime
+      && it->second->mSize == size) {
+      entries.push_back(*it->second);
+      continue;
+    }
+
+    changed = true;
+    stale.push_back({
+      .mPath = entry.path(),
+      .mLastWriteTime = lastWriteTime,
+      .mSize = size,
+    });
+  }
+
+  const auto reindexed = ParallelTransform(
+    stale,
+    [](const ProfileIndexEntry& in) -> std::optional<ProfileIndexEntry> {
+      try {
+        const auto summary = ProfileSummary::Load(in.mPath);
+        auto ret = in;
+        ret.mName = summary.mName;
+        ret.mFoldedName = FoldCase(summary.mName);
+        ret.mGuid = summary.mGuid;
+        ret.mFingerprint = summary.mFingerprint;
+        if (!ret.mFingerprint) {
+          // Saved before profiles had fingerprints; this only happens when
+          // the file changes, rather than on every lookup
+          try {
+            ret.mFingerprint = Profile::Load(in.mPath).GetFingerprint();
+          } catch (const RuntimeError&) {
+            // Still findable by name and GUID
+          } catch (const nlohmann::json::exception&) {
+            // Still findable by name and GUID
+          }
+        }
+        return ret;
+      } catch (const RuntimeError&) {
+        // Unreadable; leave it out of the index
+      } catch (const std::invalid_argument&) {
+        // Invalid GUID; leave it out of the index
+      }
+      return std::nullopt;
+    });
+  for (auto&& it: reindexed) {
+    if (it) {
+      entries.push_back(std::move(*it));
+    }
+  }
+
+  if (entries.size() != mEntries.size()) {
+    changed = true;
+  }
+
+  std::ranges::sort(entries, {}, &ProfileIndexEntry::mPath);
+  mEntries = std::move(entries);
+  mDirectoryLastWriteTime = directoryLastWriteTime;
+  this->RebuildMaps();
+
+  if (changed) {
+    this->WriteIndexFile();
+  }
+}
+
+void ProfileIndex::RebuildMaps() {
+  mByName.clear();
+  mByFoldedName.clear();
+  mByGuid.clear();
+  mByFingerprint.clear();
+  // `try_emplace()` so that if there are duplicates, the first wins
+  for (std::size_t i = 0; i < mEntries.size(); ++i) {
+    const auto& it = mEntries.at(i);
+    mByName.try_emplace(it.mName, i);
+    mByFoldedName.try_emplace(it.mFoldedName, i);
+    mByGuid.try_emplace(it.mGuid, i);
+    if (it.mFingerprint) {
+      mByFingerprint.emplace(*it.mFingerprint, i);
+    }
+  }
+}
+
+void ProfileIndex::WriteIndexFile() const {
+  nlohmann::json profiles = nlohmann::json::array();
+  for (const auto& it: mEntries) {
+    nlohmann::json entry {
+      {"Name", it.mName},
+      {"FoldedName", it.mFoldedName},
+      {"GUID", it.mGuid},
+      {"Path", ToUTF8(it.mPath)},
+      {"LastWriteTime", it.mLastWriteTime},
+      {"Size", it.mSize},
+    };
+    if (it.mFingerprint) {
+      entry["Fingerprint"] = it.mFingerprint->ToString();
+    }
+    profiles.push_back(std::move(entry));
+  }
+  const nlohmann::json j {
+    {"Version", IndexVersion},
+    {"ProfilesPath", ToUTF8(mProfilesPath)},
+    {"DirectoryLastWriteTime", mDirectoryLastWriteTime},
+    {"Profiles", std::move(profiles)},
+  };
+
+  // The index is just a cache, so failing to write it is not an error.
+  //
+  // Write then rename so that concurrent readers never see a partial file
+  std::error_code ec;
+  std::filesystem::create_directories(mIndexPath.parent_path(), ec);
+  auto tempPath = mIndexPath;
+  tempPath += std::format(L".{}.tmp", GetCurrentProcessId());
+  {
+    std::ofstream f(tempPath, std::ios::binary | std::ios::trunc);
+    if (!f) {
+      return;
+    }
+    f << j.dump();
+    if (!f) {
+      f.close();
+      std::filesystem::remove(tempPath, ec);
+      return;
+    }
+  }
+  std::filesystem::rename(tempPath, mIndexPath, ec);
+  if (ec) {
+    std::filesystem::remove(tempPath, ec);
+  }
+}
+
+template <class F>
+std::optional<ProfileIndexEntry> ProfileIndex::FindEntry(F&& lookup) {
+  while (true) {
+    const std::optional<std::size_t> idx = lookup();
+    if (idx && (mIsFresh || IsCurrent(mEntries.at(*idx)))) {
+      return mEntries.at(*idx);
+    }
+    if (mIsFresh) {
+      return {};
+    }
+    this->Refresh();
+  }
+}
+
+std::optional<ProfileIndexEntry> ProfileIndex::FindEntryByName(
+  std::string_view name) {
+  const std::string exact {name};
+  const auto folded = FoldCase(name);
+  return this->FindEntry([&]() -> std::optional<std::size_t> {
+    if (const auto it = mByName.find(exact); it != mByName.end()) {
+      return it->second;
+    }
+    if (const auto it = mByFoldedName.find(folded);
+        it != mByFoldedName.end()) {
+      return it->second;
+    }
+    return {};
+  });
+}
+
+std::optional<ProfileIndexEntry> ProfileIndex::FindEntryByGUID(
+  const winrt::guid& guid) {
+  return this->FindEntry([&]() -> std::optional<std::size_t> {
+    if (const auto it = mByGuid.find(guid); it != mByGuid.end()) {
+      return it->second;
+    }
+    return {};
+  });
+}
+
+std::vector<ProfileIndexEntry> ProfileIndex::FindEntriesByFingerprint(
+  const DisplayConfigFingerprint& fingerprint) {
+  while (true) {
+    std::vector<std::size_t> indices;
+    const auto [first, last] = mByFingerprint.equal_range(fingerprint);
+    for (auto it = first; it != last; ++it) {
+      indices.push_back(it->second);
+    }
+    // As with `FindEntry()`, a miss or a changed file means the index might
+    // be out of date
+    const bool current = (!indices.empty())
+      && std::ranges::all_of(indices, [this](const std::size_t idx) {
+           return IsCurrent(mEntries.at(idx));
+         });
+    if (mIsFresh || current) {
+      // `mEntries` is sorted by path
+      std::ranges::sort(indices);
+      std::vector<ProfileIndexEntry> ret;
+      ret.reserve(indices.size());
+      for (const auto idx: indices) {
+        ret.push_back(mEntries.at(idx));
+      }
+      return ret;
+    }
+    this->Refresh();
+  }
+}
+
+std::optional<Profile> ProfileIndex::FindByName(std::string_view name) {
+  const auto entry = this->FindEntryByName(name);
+  if (!entry) {
+    return {};
+  }
+  return Profile::Load(entry->mPath);
+}
+
+std::optional<Profile> ProfileIndex::FindByGUID(const winrt::guid& guid) {
+  const auto entry = this->FindEntryByGUID(guid);
+  if (!entry) {
+    return {};
+  }
+  return Profile::Load(entry->mPath);
+}
+
+const std::vector<ProfileIndexEntry>& ProfileIndex::GetEntries()
+  const noexcept {
+  return mEntries;
+}
+
+}// namespace FredEmmott::MonitorTool
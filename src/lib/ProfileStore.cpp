@@ -0,0 +1,26 @@
+// Copyright 2024, Fred Emmott
+// SPDX-License-Identifier: ISC
+
+#include <FredEmmott/MonitorTool/Paths.hpp>
+#include <FredEmmott/MonitorTool/ProfileStore.hpp>
+
+#include <memory>
+
+namespace FredEmmott::MonitorTool {
+
+ProfileStore& GetProfileStore() {
+  static const std::unique_ptr<ProfileStore> sStore
+    = []() -> std::unique_ptr<ProfileStore> {
+    const auto dataPath = GetDataPath();
+    if (!dataPath.empty()) {
+      const auto bundle = dataPath / "Profiles.fmtbundle";
+      if (std::filesystem::exists(bundle)) {
+        return std::make_unique<BundleProfileStore>(bundle);
+      }
+    }
+    return std::make_unique<DirectoryProfileStore>();
+  }();
+  return *sStore;
+}
+
+}// namespace FredEmmott::MonitorTool
@@ -0,0 +1,412 @@
+// Copyright 2024, Fred Emmott
+// SPDX-License-Identifier: ISC
+
+#include <FredEmmott/MonitorTool/Paths.hpp>
+#include <FredEmmott/MonitorTool/ProfileIndex.hpp>
+#include <FredEmmott/MonitorTool/ProfileStore.hpp>
+#include <FredEmmott/MonitorTool/ProfileStoreWatcher.hpp>
+
+#include <algorithm>
+#include <exception>
+#include <optional>
+
+#ifdef _WIN32
+#include <Windows.h>
+#else
+#include <cerrno>
+#include <system_error>
+
+#include <poll.h>
+#include <sys/eventfd.h>
+#include <sys/inotify.h>
+#endif
+
+namespace FredEmmott::MonitorTool {
+
+const Profile* ProfileStoreSnapshot::FindByName(std::string_view name) const {
+  auto it = std::ranges::find(mProfiles, name, &Profile::mName);
+  if (it != mProfiles.end()) {
+    return &*it;
+  }
+  const auto folded = ProfileIndex::FoldCase(name);
+  it = std::ranges::find_if(mProfiles, [&folded](const Profile& profile) {
+    return ProfileIndex::FoldCase(profile.mName) == folded;
+  });
+  return (it == mProfiles.end()) ? nullptr : &*it;
+}
+
+const Profile* ProfileStoreSnapshot::FindByGUID(
+  const winrt::guid& guid) const {
+  const auto it = std::ranges::find(mProfiles, guid, &Profile::mGuid);
+  return (it == mProfiles.end()) ? nullptr : &*it;
+}
+
+std::vector<const Profile*> ProfileStoreSnapshot::FindByFingerprint(
+  const DisplayConfigFingerprint& fingerprint) const {
+  std::vector<std::size_t> indices;
+  const auto [begin, end] = mIndicesByFingerprint.equal_range(fingerprint);
+  for (auto it = begin; it != end; ++it) {
+    indices.push_back(it->second);
+  }
+  std::ranges::sort(indices);
+
+  std::vector<const Profile*> ret;
+  ret.reserve(indices.size());
+  for (const auto i: indices) {
+    ret.push_back(&mProfiles.at(i));
+  }
+  return ret;
+}
+
+ProfileStoreWatcher::ProfileStoreWatcher() {
+  if (dynamic_cast<BundleProfileStore*>(&GetProfileStore())) {
+    mDirectory = GetDataPath();
+    mBundleFileName = "Profiles.fmtbundle";
+  } else {
+    mDirectory = GetProfilesPath();
+    std::filesystem::create_directories(mDirectory);
+  }
+
+#ifdef _WIN32
+  // Open the directory before the initial load, so that changes made while
+  // we're loading aren't missed
+  winrt::file_handle directory {CreateFileW(
+    mDirectory.c_str(),
+    FILE_LIST_DIRECTORY,
+    FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
+    nullptr,
+    OPEN_EXISTING,
+    FILE_FLAG_BACKUP_SEMANTICS | FILE_FLAG_OVERLAPPED,
+    NULL)};
+  if (!directory) {
+    winrt::throw_last_error();
+  }
+
+  Reload();
+
+  mStopEvent = winrt::handle {CreateEventW(nullptr, TRUE, FALSE, nullptr)};
+  winrt::check_bool(static_cast<bool>(mStopEvent));
+  mThread = std::jthread {
+    [this, directory = std::move(directory)]() mutable {
+      this->Run(std::move(directory));
+    }};
+#else
+  // Watch before the initial load, so that changes made while we're loading
+  // aren't missed
+  FileDescriptor inotify {inotify_init1(IN_CLOEXEC | IN_NONBLOCK)};
+  if (!inotify) {
+    throw std::system_error(errno, std::generic_category(), "inotify_init1");
+  }
+  if (
+    inotify_add_watch(
+      inotify.get(),
+      mDirectory.c_str(),
+      IN_CREATE | IN_DELETE | IN_MOVED_FROM | IN_MOVED_TO | IN_CLOSE_WRITE
+        | IN_MODIFY | IN_ONLYDIR)
+    == -1) {
+    throw std::system_error(
+      errno, std::generic_category(), "inotify_add_watch");
+  }
+
+  Reload();
+
+  mStopEvent = FileDescriptor {eventfd(0, EFD_CLOEXEC)};
+  if (!mStopEvent) {
+    throw std::system_error(errno, std::generic_category(), "eventfd");
+  }
+  mThread = std::jthread {[this, inotify = std::move(inotify)]() mutable {
+    this->Run(std::move(inotify));
+  }};
+#endif
+}
+
+ProfileStoreWatcher::~ProfileStoreWatcher() {
+#ifdef _WIN32
+  SetEvent(mStopEvent.get());
+#else
+  const uint64_t one {1};
+  [[maybe_unused]] const auto written
+    = write(mStopEvent.get(), &one, sizeof(one));
+#endif
+  mThread.join();
+}
+
+std::shared_ptr<const ProfileStoreSnapshot> ProfileStoreWatcher::GetSnapshot()
+  const noexcept {
+  return mSnapshot.load();
+}
+
+#ifdef _WIN32
+void ProfileStoreWatcher::Run(winrt::file_handle directory) noexcept {
+  using Clock = std::chrono::steady_clock;
+
+  const winrt::handle readEvent {CreateEventW(nullptr, TRUE, FALSE, nullptr)};
+  const HANDLE handles[] = {mStopEvent.get(), readEvent.get()};
+
+  // DWORD-aligned, as required by `ReadDirectoryChangesW()`
+  alignas(FILE_NOTIFY_INFORMATION) std::byte buffer[64 * 1024];
+  OVERLAPPED overlapped {};
+  bool readPending = false;
+
+  std::set<std::filesystem::path> changed;
+  bool needFullReload = false;
+  std::optional<Clock::time_point> firstChange;
+
+  while (true) {
+    if (!readPending) {
+      overlapped = {};
+      overlapped.hEvent = readEvent.get();
+      if (!ReadDirectoryChangesW(
+            directory.get(),
+            buffer,
+            sizeof(buffer),
+            /* bWatchSubtree = */ FALSE,
+            FILE_NOTIFY_CHANGE_FILE_NAME | FILE_NOTIFY_CHANGE_LAST_WRITE
+              | FILE_NOTIFY_CHANGE_SIZE,
+            nullptr,
+            &overlapped,
+            nullptr)) {
+        // The directory is gone; nothing more to watch
+        return;
+      }
+      readPending = true;
+    }
+
+    const auto reload = [&]() {
+      try {
+        if (needFullReload) {
+          Reload();
+        } else {
+          ReloadChanged(changed);
+        }
+      } catch (...) {
+        // Keep the previous snapshot; the next change will try again
+      }
+      changed.clear();
+      needFullReload = false;
+      firstChange = {};
+    };
+
+    DWORD timeout = INFINITE;
+    if (firstChange) {
+      const auto sinceFirst = std::chrono::duration_cast<
+        std::chrono::milliseconds>(Clock::now() - *firstChange);
+      if (sinceFirst >= MaxDebounceInterval) {
+        // Don't wait at all: under continuous writes, even a zero timeout
+        // returns the read event instead of timing out
+        reload();
+        continue;
+      }
+      timeout = static_cast<DWORD>(
+        std::min(MaxDebounceInterval - sinceFirst, DebounceInterval).count());
+    }
+
+    const auto waitResult
+      = WaitForMultipleObjects(std::size(handles), handles, FALSE, timeout);
+
+    if (waitResult == WAIT_OBJECT_0) {
+      CancelIoEx(directory.get(), &overlapped);
+      DWORD ignored {};
+      GetOverlappedResult(directory.get(), &overlapped, &ignored, TRUE);
+      return;
+    }
+
+    if (waitResult == WAIT_TIMEOUT) {
+      reload();
+      continue;
+    }
+
+    if (waitResult != WAIT_OBJECT_0 + 1) {
+      return;
+    }
+
+    readPending = false;
+    DWORD bytes {};
+    if (!GetOverlappedResult(directory.get(), &overlapped, &bytes, FALSE)) {
+      return;
+    }
+    if (!firstChange) {
+      firstChange = Clock::now();
+    }
+    if (bytes == 0) {
+      // The buffer overflowed, so we don't know what changed
+      needFullReload = true;
+      continue;
+    }
+
+    for (std::size_t offset = 0;;) {
+      const auto info
+        = reinterpret_cast<const FILE_NOTIFY_INFORMATION*>(buffer + offset);
+      const std::filesystem::path name {std::wstring_view {
+        info->FileName, info->FileNameLength / sizeof(WCHAR)}};
+      if (mBundleFileName.empty()) {
+        if (name.extension() == ".json") {
+          changed.insert(mDirectory / name);
+        }
+      } else if (name == mBundleFileName) {
+        needFullReload = true;
+      }
+
+      if (info->NextEntryOffset == 0) {
+        break;
+      }
+      offset += info->NextEntryOffset;
+    }
+  }
+}
+#else
+void ProfileStoreWatcher::Run(FileDescriptor inotify) noexcept {
+  using Clock = std::chrono::steady_clock;
+
+  pollfd fds[] = {
+    {mStopEvent.get(), POLLIN, 0},
+    {inotify.get(), POLLIN, 0},
+  };
+
+  alignas(inotify_event) std::byte buffer[64 * 1024];
+
+  std::set<std::filesystem::path> changed;
+  bool needFullReload = false;
+  std::optional<Clock::time_point> firstChange;
+
+  while (true) {
+    const auto reload = [&]() {
+      try {
+        if (needFullReload) {
+          Reload();
+        } else {
+          ReloadChanged(changed);
+        }
+      } catch (...) {
+        // Keep the previous snapshot; the next change will try again
+      }
+      changed.clear();
+      needFullReload = false;
+      firstChange = {};
+    };
+
+    int timeout = -1;
+    if (firstChange) {
+      const auto sinceFirst = std::chrono::duration_cast<
+        std::chrono::milliseconds>(Clock::now() - *firstChange);
+      if (sinceFirst >= MaxDebounceInterval) {
+        reload();
+        continue;
+      }
+      timeout = static_cast<int>(
+        std::min(MaxDebounceInterval - sinceFirst, DebounceInterval).count());
+    }
+
+    const auto ready = poll(fds, std::size(fds), timeout);
+    if (ready == -1) {
+      if (errno == EINTR) {
+        continue;
+      }
+      return;
+    }
+
+    if (fds[0].revents) {
+      return;
+    }
+
+    if (ready == 0) {
+      reload();
+      continue;
+    }
+
+    // Drain every queued event, as `IN_NONBLOCK` is set
+    while (true) {
+      const auto bytes = read(inotify.get(), buffer, sizeof(buffer));
+      if (bytes <= 0) {
+        break;
+      }
+      if (!firstChange) {
+        firstChange = Clock::now();
+      }
+
+      for (std::size_t offset = 0; offset < static_cast<std::size_t>(bytes);) {
+        const auto event
+          = reinterpret_cast<const inotify_event*>(buffer + offset);
+        offset += sizeof(inotify_event) + event->len;
+
+        if (event->mask & IN_IGNORED) {
+          // The directory is gone; nothing more to watch
+          return;
+        }
+        if (event->mask & IN_Q_OVERFLOW) {
+          // The queue overflowed, so we don't know what changed
+          needFullReload = true;
+          continue;
+        }
+        if (event->len == 0) {
+          continue;
+        }
+
+        const std::filesystem::path name {event->name};
+        if (mBundleFileName.empty()) {
+          if (name.extension() == ".json") {
+            changed.insert(mDirectory / name);
+          }
+        } else if (name == mBundleFileName) {
+          needFullReload = true;
+        }
+      }
+    }
+  }
+}
+#endif
+
+void ProfileStoreWatcher::Reload() {
+  auto profiles = GetProfileStore().Enumerate();
+  if (!mBundleFileName.empty()) {
+    Publish(std::move(profiles));
+    return;
+  }
+
+  mProfilesByPath.clear();
+  for (auto&& profile: profiles) {
+    auto path = profile.mPath;
+    mProfilesByPath.insert_or_assign(std::move(path), std::move(profile));
+  }
+  ReloadChanged({});
+}
+
+void ProfileStoreWatcher::ReloadChanged(
+  const std::set<std::filesystem::path>& changed) {
+  for (const auto& path: changed) {
+    std::error_code ec;
+    if (!std::filesystem::is_regular_file(path, ec)) {
+      mProfilesByPath.erase(path);
+      continue;
+    }
+    try {
+      mProfilesByPath.insert_or_assign(path, Profile::Load(path));
+    } catch (const std::exception&) {
+      // Probably still being written; we'll get another notification when
+      // it's done, so keep the previous version until then
+    }
+  }
+
+  // Sorted by path, like `DirectoryProfileStore::Enumerate()`
+  std::vector<Profile> profiles;
+  profiles.reserve(mProfilesByPath.size());
+  for (const auto& [path, profile]: mProfilesByPath) {
+    profiles.push_back(profile);
+  }
+  Publish(std::move(profiles));
+}
+
+void ProfileStoreWatcher::Publish(std::vector<Profile> profiles) {
+  // Fingerprinting is cheap compared to loading, so keep it off the
+  // request path
+  ProfileStoreSnapshot snapshot {std::move(profiles)};
+  snapshot.mIndicesByFingerprint.reserve(snapshot.mProfiles.size());
+  for (std::size_t i = 0; i < snapshot.mProfiles.size(); ++i) {
+    snapshot.mIndicesByFingerprint.emplace(
+      snapshot.mProfiles.at(i).GetFingerprint(), i);
+  }
+  mSnapshot.store(
+    std::make_shared<const ProfileStoreSnapshot>(std::move(snapshot)));
+}
+
+}// namespace FredEmmott::MonitorTool
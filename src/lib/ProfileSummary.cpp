@@ -0,0 +1,179 @@
+// Copyright 2024, Fred Emmott
+// SPDX-License-Identifier: ISC
+
+#include <FredEmmott/MonitorTool/Paths.hpp>
+#include <FredEmmott/MonitorTool/Profile.hpp>
+#include <FredEmmott/MonitorTool/json.hpp>
+
+#include <format>
+#include <fstream>
+#include <optional>
+
+namespace FredEmmott::MonitorTool {
+
+namespace {
+
+/* Collects the top-level `Name`, `GUID`, and `Fingerprint`, and aborts the
+ * parse once it has them all.
+ *
+ * Profiles saved by current versions put these first; older profiles have
+ * `Name` and `GUID` after `Modes`, so are read further, but still aren't turned
+ * into a DOM. If `Fingerprint` isn't one of the first three keys, the profile
+ * predates it, so we don't wait for it. */
+class SummaryReader final : public nlohmann::json_sax<nlohmann::json> {
+ public:
+  std::optional<std::string> mName;
+  std::optional<std::string> mGuid;
+  std::optional<std::string> mFingerprint;
+  std::optional<std::string> mError;
+
+  bool IsComplete() const noexcept {
+    return mName && mGuid && (mFingerprint || mKeyCount >= 3);
+  }
+
+  bool HasNameAndGUID() const noexcept {
+    return mName && mGuid;
+  }
+
+  bool null() override {
+    return this->Value();
+  }
+
+  bool boolean(bool) override {
+    return this->Value();
+  }
+
+  bool number_integer(number_integer_t) override {
+    return this->Value();
+  }
+
+  bool number_unsigned(number_unsigned_t) override {
+    return this->Value();
+  }
+
+  bool number_float(number_float_t, const string_t&) override {
+    return this->Value();
+  }
+
+  bool string(string_t& value) override {
+    if (mDepth == 1) {
+      switch (mPendingKey) {
+        case Key::Name:
+          mName = std::move(value);
+          break;
+        case Key::GUID:
+          mGuid = std::move(value);
+          break;
+        case Key::Fingerprint:
+          mFingerprint = std::move(value);
+          break;
+        case Key::Other:
+          break;
+      }
+    }
+    return this->Value();
+  }
+
+  bool binary(binary_t&) override {
+    return this->Value();
+  }
+
+  bool start_object(std::size_t) override {
+    ++mDepth;
+    return true;
+  }
+
+  bool end_object() override {
+    --mDepth;
+    return this->Value();
+  }
+
+  bool start_array(std::size_t) override {
+    ++mDepth;
+    return true;
+  }
+
+  bool end_array() override {
+    --mDepth;
+    return this->Value();
+  }
+
+  bool key(string_t& key) override {
+    if (mDepth != 1) {
+      return true;
+    }
+    ++mKeyCount;
+    if (key == "Name") {
+      mPendingKey = Key::Name;
+    } else if (key == "GUID") {
+      mPendingKey = Key::GUID;
+    } else if (key == "Fingerprint") {
+      mPendingKey = Key::Fingerprint;
+    } else {
+      mPendingKey = Key::Other;
+    }
+    return true;
+  }
+
+  bool parse_error(
+    std::size_t,
+    const std::string&,
+    const nlohmann::detail::exception& ex) override {
+    mError = ex.what();
+    return false;
+  }
+
+ private:
+  enum class Key {
+    Other,
+    Name,
+    GUID,
+    Fingerprint,
+  };
+
+  std::size_t mDepth {0};
+  std::size_t mKeyCount {0};
+  Key mPendingKey {Key::Other};
+
+  // Called after every complete value; returning false stops the parser
+  bool Value() {
+    if (mDepth == 1) {
+      mPendingKey = Key::Other;
+    }
+    return !this->IsComplete();
+  }
+};
+
+}// namespace
+
+ProfileSummary ProfileSummary::Load(const std::filesystem::path& path) {
+  const auto fullPath = GetFileAPIPath(path);
+  std::ifstream file(std::filesystem::path {fullPath}, std::ios::binary);
+  if (!file) {
+    throw FileOpenError(
+      std::format("Failed to open `{}`", winrt::to_string(fullPath)));
+  }
+
+  SummaryReader reader;
+  nlohmann::json::sax_parse(file, &reader);
+  if (reader.mError) {
+    throw FileReadError(std::format(
+      "Failed to parse `{}`: {}", winrt::to_string(fullPath), *reader.mError));
+  }
+  if (!reader.HasNameAndGUID()) {
+    throw FileReadError(std::format(
+      "`{}` does not contain a profile name and GUID",
+      winrt::to_string(fullPath)));
+  }
+
+  return {
+    .mName = std::move(*reader.mName),
+    .mGuid = nlohmann::json(*reader.mGuid).get<winrt::guid>(),
+    .mPath = path,
+    .mFingerprint = reader.mFingerprint
+      ? DisplayConfigFingerprint::FromString(*reader.mFingerprint)
+      : std::nullopt,
+  };
+}
+
+}// namespace FredEmmott::MonitorTool
@@ -0,0 +1,381 @@
+// Copyright 2024, Fred Emmott
+// SPDX-License-Identifier: ISC
+
+#include <FredEmmott/MonitorTool/ApplyProfile.hpp>
+#include <FredEmmott/MonitorTool/ProfileStoreWatcher.hpp>
+#include <FredEmmott/MonitorTool/QueryDisplayConfig.hpp>
+#include <FredEmmott/MonitorTool/Service.hpp>
+#include <FredEmmott/MonitorTool/Trace.hpp>
+#include <FredEmmott/MonitorTool/json.hpp>
+#include <winrt/base.h>
+
+#include <chrono>
+#include <format>
+
+#ifdef _WIN32
+#include <Windows.h>
+#else
+#include <FredEmmott/MonitorTool/FileDescriptor.hpp>
+
+#include <cerrno>
+#include <system_error>
+
+#include <fcntl.h>
+#include <sys/file.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#endif
+
+namespace FredEmmott::MonitorTool {
+
+namespace {
+
+#ifdef _WIN32
+constexpr DWORD PipeBufferSize = 64 * 1024;
+#endif
+
+nlohmann::json MakeError(std::string_view message) {
+  return {
+    {"Status", "Error"},
+    {"Message", message},
+  };
+}
+
+/// Returns nullptr with `response` set if the request doesn't match a profile
+const Profile* FindProfile(
+  const ProfileStoreSnapshot& snapshot,
+  const nlohmann::json& request,
+  nlohmann::json& response) {
+  const Profile* ret = nullptr;
+  if (request.contains("Name")) {
+    ret = snapshot.FindByName(request.at("Name").get<std::string>());
+  } else if (request.contains("GUID")) {
+    ret = snapshot.FindByGUID(request.at("GUID").get<winrt::guid>());
+  } else {
+    response = MakeError("Request has neither a `Name` nor a `GUID`");
+    return nullptr;
+  }
+
+  if (!ret) {
+    response = {{"Status", "NotFound"}};
+  }
+  return ret;
+}
+
+nlohmann::json HandleList(const ProfileStoreSnapshot& snapshot) {
+  auto profiles = nlohmann::json::array();
+  for (const auto& profile: snapshot.mProfiles) {
+    profiles.push_back({
+      {"Name", profile.mName},
+      {"GUID", profile.mGuid},
+    });
+  }
+  return {
+    {"Status", "OK"},
+    {"Profiles", std::move(profiles)},
+  };
+}
+
+nlohmann::json HandleCurrent(const ProfileStoreSnapshot& snapshot) {
+  const auto fingerprint = GetDisplayConfigFingerprint(QueryDisplayConfig());
+  auto profiles = nlohmann::json::array();
+  for (const auto profile: snapshot.FindByFingerprint(fingerprint)) {
+    profiles.push_back({
+      {"Name", profile->mName},
+      {"GUID", profile->mGuid},
+    });
+  }
+  return {
+    {"Status", "OK"},
+    {"Fingerprint", fingerprint.ToString()},
+    {"Profiles", std::move(profiles)},
+  };
+}
+
+nlohmann::json HandleQuery(
+  const ProfileStoreSnapshot& snapshot,
+  const nlohmann::json& request) {
+  nlohmann::json response;
+  const auto profile = FindProfile(snapshot, request, response);
+  if (!profile) {
+    return response;
+  }
+  return {
+    {"Status", "OK"},
+    {"Profile", nlohmann::json::parse(profile->ToJSON())},
+  };
+}
+
+nlohmann::json HandleApply(
+  const ProfileStoreSnapshot& snapshot,
+  const nlohmann::json& request) {
+  nlohmann::json response;
+  const auto profile = FindProfile(snapshot, request, response);
+  if (!profile) {
+    return response;
+  }
+
+  const auto applyMode = request.value("Temporary", false)
+    ? ApplyMode::Temporary
+    : ApplyMode::Persistent;
+  auto plan = PlanApply(*profile);
+  const auto result
+    = ExecuteApplyPlan(plan, applyMode, request.value("Update", false));
+  if (!result) {
+    return {{"Status", "CannotApply"}};
+  }
+
+  using std::chrono::microseconds;
+  const auto us = [](ApplyTimings::Duration duration) {
+    return std::chrono::duration_cast<microseconds>(duration).count();
+  };
+  return {
+    {"Status", "OK"},
+    {"Changed", result->mChanged},
+    {"Differences", result->mDifferences},
+    {"Strategy", ToString(plan.mStrategy)},
+    {"Cached", plan.mFromCache},
+    {"Validations", plan.mValidationCount},
+    {
+      "TimingsUS",
+      {
+        {"Gather", us(plan.mTimings.mGather)},
+        {"Plan", us(plan.mTimings.mPlan)},
+        {"Validate", us(plan.mTimings.mValidate)},
+        {"Apply", us(plan.mTimings.mApply)},
+      },
+    },
+  };
+}
+
+nlohmann::json HandleRequest(
+  const ProfileStoreSnapshot& snapshot,
+  std::string_view requestBytes) {
+  const auto request = nlohmann::json::parse(requestBytes, nullptr, false);
+  if (request.is_discarded() || !request.is_object()) {
+    return MakeError("Request is not a JSON object");
+  }
+  if (request.value("Version", 0u) != ServiceProtocolVersion) {
+    return {{"Status", "UnsupportedVersion"}};
+  }
+
+  try {
+    const auto command = request.value("Command", "");
+    TraceSpan span {"Service request", command};
+    if (command == "List") {
+      return HandleList(snapshot);
+    }
+    if (command == "Current") {
+      return HandleCurrent(snapshot);
+    }
+    if (command == "Query") {
+      return HandleQuery(snapshot, request);
+    }
+    if (command == "Apply") {
+      return HandleApply(snapshot, request);
+    }
+    return MakeError(std::format("Unrecognized command '{}'", command));
+  } catch (const RuntimeError& e) {
+    return MakeError(e.what());
+  } catch (const nlohmann::json::exception& e) {
+    return MakeError(e.what());
+  } catch (const std::invalid_argument& e) {
+    // Invalid GUID
+    return MakeError(e.what());
+  } catch (const winrt::hresult_error& e) {
+    return MakeError(winrt::to_string(e.message()));
+  } catch (const std::exception& e) {
+    // Keep serving other clients
+    return MakeError(e.what());
+  }
+}
+
+#ifdef _WIN32
+/// Returns false if the client went away
+bool ReadRequest(HANDLE pipe, std::string& request) {
+  request.resize(4096);
+  std::size_t size = 0;
+  while (true) {
+    DWORD bytesRead {};
+    const auto ok = ReadFile(
+      pipe,
+      request.data() + size,
+      static_cast<DWORD>(request.size() - size),
+      &bytesRead,
+      nullptr);
+    size += bytesRead;
+    if (ok) {
+      request.resize(size);
+      return true;
+    }
+    if (GetLastError() != ERROR_MORE_DATA) {
+      return false;
+    }
+    request.resize(request.size() * 2);
+  }
+}
+#else
+/// Returns false if the client went away
+bool ReadRequest(const int socket, std::string& request) {
+  request.clear();
+  char buffer[4096];
+  while (true) {
+    const auto bytesRead = recv(socket, buffer, sizeof(buffer), 0);
+    if (bytesRead == 0) {
+      // The client has shut down writing
+      return true;
+    }
+    if (bytesRead < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      return false;
+    }
+    request.append(buffer, static_cast<std::size_t>(bytesRead));
+  }
+}
+
+void WriteResponse(const int socket, std::string_view response) {
+  while (!response.empty()) {
+    // Don't raise `SIGPIPE` if the client went away
+    const auto bytesWritten
+      = send(socket, response.data(), response.size(), MSG_NOSIGNAL);
+    if (bytesWritten < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      return;
+    }
+    response.remove_prefix(static_cast<std::size_t>(bytesWritten));
+  }
+}
+
+[[noreturn]] void ThrowErrno(const char* what) {
+  throw std::system_error(errno, std::generic_category(), what);
+}
+#endif
+
+}// namespace
+
+#ifdef _WIN32
+[[noreturn]] void RunService() {
+  const auto pipeName = GetServicePipeName();
+  // A single instance: requests are handled in order, and applying two
+  // profiles at once wouldn't be meaningful anyway
+  const winrt::file_handle pipe {CreateNamedPipeW(
+    pipeName.c_str(),
+    PIPE_ACCESS_DUPLEX | FILE_FLAG_FIRST_PIPE_INSTANCE,
+    PIPE_TYPE_MESSAGE | PIPE_READMODE_MESSAGE | PIPE_WAIT
+      | PIPE_REJECT_REMOTE_CLIENTS,
+    1,
+    PipeBufferSize,
+    PipeBufferSize,
+    0,
+    nullptr)};
+  if (!pipe) {
+    const auto error = GetLastError();
+    if (error == ERROR_ACCESS_DENIED || error == ERROR_PIPE_BUSY) {
+      throw ServiceAlreadyRunningError(
+        "fmt-service is already running in this session");
+    }
+    winrt::throw_last_error();
+  }
+
+  const ProfileStoreWatcher watcher;
+
+  std::string request;
+  while (true) {
+    if (
+      !ConnectNamedPipe(pipe.get(), nullptr)
+      && GetLastError() != ERROR_PIPE_CONNECTED) {
+      DisconnectNamedPipe(pipe.get());
+      continue;
+    }
+
+    if (ReadRequest(pipe.get(), request)) {
+      const auto response
+        = HandleRequest(*watcher.GetSnapshot(), request).dump();
+      DWORD bytesWritten {};
+      if (WriteFile(
+            pipe.get(),
+            response.data(),
+            static_cast<DWORD>(response.size()),
+            &bytesWritten,
+            nullptr)) {
+        FlushFileBuffers(pipe.get());
+      }
+    }
+    DisconnectNamedPipe(pipe.get());
+  }
+}
+#else
+[[noreturn]] void RunService() {
+  const auto path = GetServiceSocketPath();
+  std::filesystem::create_directories(path.parent_path());
+
+  // A stale socket is left behind if the service is killed, so a lock is
+  // needed to tell whether another instance is running
+  auto lockPath = path;
+  lockPath += ".lock";
+  const FileDescriptor lock {
+    open(lockPath.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0600)};
+  if (!lock) {
+    ThrowErrno("open");
+  }
+  if (flock(lock.get(), LOCK_EX | LOCK_NB) == -1) {
+    if (errno == EWOULDBLOCK) {
+      throw ServiceAlreadyRunningError(
+        "fmt-service is already running for this user");
+    }
+    ThrowErrno("flock");
+  }
+
+  sockaddr_un address {};
+  address.sun_family = AF_UNIX;
+  const auto pathString = path.string();
+  if (pathString.size() >= sizeof(address.sun_path)) {
+    throw std::system_error(
+      ENAMETOOLONG, std::generic_category(), pathString);
+  }
+  pathString.copy(address.sun_path, pathString.size());
+
+  const FileDescriptor listener {
+    socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0)};
+  if (!listener) {
+    ThrowErrno("socket");
+  }
+  unlink(pathString.c_str());
+  if (
+    bind(
+      listener.get(),
+      reinterpret_cast<const sockaddr*>(&address),
+      sizeof(address))
+    == -1) {
+    ThrowErrno("bind");
+  }
+  // Requests are handled one at a time, as with the single pipe instance;
+  // clients give up if they can't connect promptly
+  if (listen(listener.get(), 1) == -1) {
+    ThrowErrno("listen");
+  }
+
+  const ProfileStoreWatcher watcher;
+
+  std::string request;
+  while (true) {
+    const FileDescriptor client {
+      accept4(listener.get(), nullptr, nullptr, SOCK_CLOEXEC)};
+    if (!client) {
+      continue;
+    }
+
+    if (ReadRequest(client.get(), request)) {
+      const auto response
+        = HandleRequest(*watcher.GetSnapshot(), request).dump();
+      WriteResponse(client.get(), response);
+    }
+  }
+}
+#endif
+
+}// namespace FredEmmott::MonitorTool
@@ -0,0 +1,207 @@
+// Copyright 2024, Fred Emmott
+// SPDX-License-Identifier: ISC
+
+#include <FredEmmott/MonitorTool/Service.hpp>
+#include <FredEmmott/MonitorTool/Trace.hpp>
+#include <winrt/base.h>
+
+#include <format>
+
+#ifdef _WIN32
+#include <Windows.h>
+#else
+#include <FredEmmott/MonitorTool/FileDescriptor.hpp>
+
+#include <cerrno>
+#include <cstdlib>
+
+#include <sys/socket.h>
+#include <sys/un.h>
+#endif
+
+namespace FredEmmott::MonitorTool {
+
+namespace {
+
+// The service handles one request at a time; if it's still busy after this,
+// it's quicker to do the work in-process
+constexpr DWORD BusyTimeoutMilliseconds = 1000;
+
+#ifndef _WIN32
+/// Returns false if the service went away
+bool WriteRequest(const int socket, std::string_view request) {
+  while (!request.empty()) {
+    // Don't raise `SIGPIPE` if the service went away
+    const auto bytesWritten
+      = send(socket, request.data(), request.size(), MSG_NOSIGNAL);
+    if (bytesWritten < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      return false;
+    }
+    request.remove_prefix(static_cast<std::size_t>(bytesWritten));
+  }
+  return true;
+}
+
+/// Returns false if the service went away
+bool ReadResponse(const int socket, std::string& response) {
+  char buffer[4096];
+  while (true) {
+    const auto bytesRead = recv(socket, buffer, sizeof(buffer), 0);
+    if (bytesRead == 0) {
+      return true;
+    }
+    if (bytesRead < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      return false;
+    }
+    response.append(buffer, static_cast<std::size_t>(bytesRead));
+  }
+}
+#endif
+
+}// namespace
+
+#ifdef _WIN32
+std::wstring GetServicePipeName() {
+  DWORD sessionID {};
+  ProcessIdToSessionId(GetCurrentProcessId(), &sessionID);
+  return std::format(
+    L"\\\\.\\pipe\\FredEmmott.MonitorTool.Service.{}", sessionID);
+}
+
+#else
+std::filesystem::path GetServiceSocketPath() {
+  constexpr auto name = "freds-monitor-tool.sock";
+  if (const auto runtime = std::getenv("XDG_RUNTIME_DIR");
+      runtime && *runtime) {
+    return std::filesystem::path(runtime) / name;
+  }
+  // `XDG_RUNTIME_DIR` is unset outside of a login session, e.g. in
+  // containers
+  return std::filesystem::temp_directory_path()
+    / std::format("freds-monitor-tool-{}", getuid()) / name;
+}
+#endif
+
+std::optional<nlohmann::json> SendServiceRequest(nlohmann::json request) {
+  TraceSpan span {"SendServiceRequest"};
+#ifdef _WIN32
+  const auto pipeName = GetServicePipeName();
+
+  winrt::file_handle pipe;
+  while (true) {
+    pipe.attach(CreateFileW(
+      pipeName.c_str(),
+      GENERIC_READ | GENERIC_WRITE,
+      0,
+      nullptr,
+      OPEN_EXISTING,
+      0,
+      NULL));
+    if (pipe) {
+      break;
+    }
+    if (GetLastError() != ERROR_PIPE_BUSY) {
+      // Usually `ERROR_FILE_NOT_FOUND`: the service isn't running
+      return {};
+    }
+    if (!WaitNamedPipeW(pipeName.c_str(), BusyTimeoutMilliseconds)) {
+      return {};
+    }
+  }
+
+  DWORD mode = PIPE_READMODE_MESSAGE;
+  if (!SetNamedPipeHandleState(pipe.get(), &mode, nullptr, nullptr)) {
+    return {};
+  }
+
+  request["Version"] = ServiceProtocolVersion;
+  const auto requestBytes = request.dump();
+
+  std::string response;
+  response.resize(4096);
+  DWORD bytesRead {};
+  auto ok = TransactNamedPipe(
+    pipe.get(),
+    const_cast<char*>(requestBytes.data()),
+    static_cast<DWORD>(requestBytes.size()),
+    response.data(),
+    static_cast<DWORD>(response.size()),
+    &bytesRead,
+    nullptr);
+  std::size_t responseSize = bytesRead;
+  while (!ok && GetLastError() == ERROR_MORE_DATA) {
+    response.resize(response.size() * 2);
+    ok = ReadFile(
+      pipe.get(),
+      response.data() + responseSize,
+      static_cast<DWORD>(response.size() - responseSize),
+      &bytesRead,
+      nullptr);
+    responseSize += bytesRead;
+  }
+  if (!ok) {
+    return {};
+  }
+  response.resize(responseSize);
+#else
+  sockaddr_un address {};
+  address.sun_family = AF_UNIX;
+  const auto path = GetServiceSocketPath().string();
+  if (path.size() >= sizeof(address.sun_path)) {
+    return {};
+  }
+  path.copy(address.sun_path, path.size());
+
+  const FileDescriptor socket {
+    ::socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0)};
+  if (!socket) {
+    return {};
+  }
+
+  // `connect()` waits for up to the send timeout if the service's backlog is
+  // full, i.e. it's busy
+  timeval timeout {
+    .tv_sec = BusyTimeoutMilliseconds / 1000,
+    .tv_usec = (BusyTimeoutMilliseconds % 1000) * 1000,
+  };
+  setsockopt(
+    socket.get(), SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout));
+  if (
+    connect(
+      socket.get(),
+      reinterpret_cast<const sockaddr*>(&address),
+      sizeof(address))
+    == -1) {
+    // Usually `ENOENT` or `ECONNREFUSED`: the service isn't running
+    return {};
+  }
+  timeout = {};
+  setsockopt(
+    socket.get(), SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout));
+
+  request["Version"] = ServiceProtocolVersion;
+  if (!WriteRequest(socket.get(), request.dump())) {
+    return {};
+  }
+  shutdown(socket.get(), SHUT_WR);
+
+  std::string response;
+  if (!ReadResponse(socket.get(), response)) {
+    return {};
+  }
+#endif
+
+  auto ret = nlohmann::json::parse(response, nullptr, false);
+  if (ret.is_discarded() || ret.value("Status", "") == "UnsupportedVersion") {
+    return {};
+  }
+  return ret;
+}
+
+}// namespace FredEmmott::MonitorTool
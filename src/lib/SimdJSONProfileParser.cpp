@@ -0,0 +1,287 @@
+// Copyright 2024, Fred Emmott
+// SPDX-License-Identifier: ISC
+
+#include <FredEmmott/MonitorTool/DisplayConfigSchema.hpp>
+#include <FredEmmott/MonitorTool/SimdJSONProfileParser.hpp>
+#include <FredEmmott/MonitorTool/json.hpp>
+#include <winrt/base.h>
+
+#include <algorithm>
+#include <bit>
+#include <limits>
+#include <string_view>
+#include <vector>
+
+#include <Windows.h>
+#include <simdjson.h>
+
+namespace FredEmmott::MonitorTool {
+
+namespace {
+
+using simdjson::error_code;
+using simdjson::SUCCESS;
+namespace ondemand = simdjson::ondemand;
+
+template <class V>
+error_code ReadValue(ondemand::value value, V& out);
+
+template <HasFieldSchema T>
+error_code ReadFields(ondemand::object object, T& out) {
+  error_code ret = SUCCESS;
+  // In declaration order, so that union selectors are read before the unions
+  ForEachField<T>([&](const auto& field) {
+    if (ret != SUCCESS || !field.IsPresent(out)) {
+      return;
+    }
+    ondemand::value value;
+    ret = object.find_field_unordered(field.mName).get(value);
+    if (ret != SUCCESS) {
+      return;
+    }
+
+    using V = typename std::remove_cvref_t<decltype(field)>::Value;
+    if constexpr (std::same_as<V, std::wstring_view>) {
+      std::string_view utf8;
+      ret = value.get_string().get(utf8);
+      if (ret != SUCCESS) {
+        return;
+      }
+      // Same conversion as `winrt::to_hstring()`
+      wchar_t buffer[256];
+      if (utf8.size() > std::size(buffer)) {
+        ret = simdjson::CAPACITY;
+        return;
+      }
+      const auto length = MultiByteToWideChar(
+        CP_UTF8,
+        0,
+        utf8.data(),
+        static_cast<int>(utf8.size()),
+        buffer,
+        static_cast<int>(std::size(buffer)));
+      field.Set(out, std::wstring_view {buffer, static_cast<size_t>(length)});
+    } else {
+      V parsed {};
+      ret = ReadValue(value, parsed);
+      if (ret == SUCCESS) {
+        field.Set(out, parsed);
+      }
+    }
+  });
+  return ret;
+}
+
+template <class V>
+error_code ReadValue(ondemand::value value, V& out) {
+  if constexpr (HasFieldSchema<V>) {
+    ondemand::object object;
+    if (const auto ec = value.get_object().get(object)) {
+      return ec;
+    }
+    return ReadFields(object, out);
+  } else if constexpr (std::same_as<V, LUID>) {
+    uint64_t raw {};
+    if (const auto ec = value.get_uint64().get(raw)) {
+      return ec;
+    }
+    out = std::bit_cast<LUID>(raw);
+    return SUCCESS;
+  } else if constexpr (std::is_enum_v<V>) {
+    std::underlying_type_t<V> raw {};
+    if (const auto ec = ReadValue(value, raw)) {
+      return ec;
+    }
+    out = static_cast<V>(raw);
+    return SUCCESS;
+  } else if constexpr (std::is_signed_v<V>) {
+    int64_t raw {};
+    if (const auto ec = value.get_int64().get(raw)) {
+      return ec;
+    }
+    // `nlohmann::json` would silently truncate; let it
+    if (
+      raw < std::numeric_limits<V>::min()
+      || raw > std::numeric_limits<V>::max()) {
+      return simdjson::NUMBER_OUT_OF_RANGE;
+    }
+    out = static_cast<V>(raw);
+    return SUCCESS;
+  } else {
+    static_assert(std::is_unsigned_v<V>);
+    uint64_t raw {};
+    if (const auto ec = value.get_uint64().get(raw)) {
+      return ec;
+    }
+    if (raw > std::numeric_limits<V>::max()) {
+      return simdjson::NUMBER_OUT_OF_RANGE;
+    }
+    out = static_cast<V>(raw);
+    return SUCCESS;
+  }
+}
+
+template <class T>
+error_code ReadArray(ondemand::value value, std::vector<T>& out) {
+  ondemand::array array;
+  if (const auto ec = value.get_array().get(array)) {
+    return ec;
+  }
+  for (auto element: array) {
+    ondemand::value elementValue;
+    if (const auto ec = element.get(elementValue)) {
+      return ec;
+    }
+    if (const auto ec = ReadValue(elementValue, out.emplace_back())) {
+      return ec;
+    }
+  }
+  return SUCCESS;
+}
+
+error_code
+ReadString(ondemand::object& object, const char* key, std::string& out) {
+  std::string_view value;
+  if (const auto ec
+      = object.find_field_unordered(key).get_string().get(value)) {
+    return ec;
+  }
+  out = std::string {value};
+  return SUCCESS;
+}
+
+/** Check every value, including the ones we didn't read.
+ *
+ * On-demand parsing only validates what it's asked for, so a syntax error in a
+ * skipped value would otherwise be accepted. Duplicate keys are rejected too,
+ * as `find_field_unordered()` finds the first, but `nlohmann::json` keeps the
+ * last.
+ */
+bool IsWellFormed(ondemand::value value) {
+  ondemand::json_type type;
+  if (value.type().get(type)) {
+    return false;
+  }
+  switch (type) {
+    case ondemand::json_type::array: {
+      ondemand::array array;
+      if (value.get_array().get(array)) {
+        return false;
+      }
+      for (auto element: array) {
+        ondemand::value elementValue;
+        if (element.get(elementValue) || !IsWellFormed(elementValue)) {
+          return false;
+        }
+      }
+      return true;
+    }
+    case ondemand::json_type::object: {
+      ondemand::object object;
+      if (value.get_object().get(object)) {
+        return false;
+      }
+      // Views into the parser's string buffer, which outlives this
+      std::vector<std::string_view> keys;
+      for (auto field: object) {
+        std::string_view key;
+        if (
+          field.unescaped_key().get(key)
+          || std::ranges::find(keys, key) != keys.end()) {
+          return false;
+        }
+        keys.push_back(key);
+        if (!IsWellFormed(field.value())) {
+          return false;
+        }
+      }
+      return true;
+    }
+    case ondemand::json_type::number: {
+      ondemand::number number;
+      return !value.get_number().get(number);
+    }
+    case ondemand::json_type::string: {
+      std::string_view string;
+      return !value.get_string().get(string);
+    }
+    case ondemand::json_type::boolean: {
+      bool boolean {};
+      return !value.get_bool().get(boolean);
+    }
+    case ondemand::json_type::null: {
+      bool isNull {};
+      return !value.is_null().get(isNull) && isNull;
+    }
+  }
+  return false;
+}
+
+}// namespace
+
+std::optional<Profile> ParseProfileWithSimdJSON(std::string_view json) {
+  // Reused, as the parser's internal buffers are the main allocation; one per
+  // thread, as `Enumerate()` loads profiles in parallel
+  thread_local ondemand::parser parser;
+
+  const simdjson::padded_string padded {json};
+  ondemand::document document;
+  if (parser.iterate(padded).get(document)) {
+    return {};
+  }
+  ondemand::object root;
+  if (document.get_object().get(root)) {
+    return {};
+  }
+
+  Profile ret;
+  std::string guid;
+  if (
+    ReadString(root, "Name", ret.mName) || ReadString(root, "GUID", guid)) {
+    return {};
+  }
+  try {
+    // Share the brace-handling with the `nlohmann::json` path
+    ret.mGuid = nlohmann::json(guid).get<winrt::guid>();
+  } catch (...) {
+    return {};
+  }
+
+  // Optional, as in `Profile::FromJSON()`'s `nlohmann::json` path
+  ondemand::value adapters;
+  switch (root.find_field_unordered("Adapters").get(adapters)) {
+    case SUCCESS:
+      if (ReadArray(adapters, ret.mAdapters)) {
+        return {};
+      }
+      break;
+    case simdjson::NO_SUCH_FIELD:
+      break;
+    default:
+      return {};
+  }
+
+  ondemand::value modes;
+  ondemand::value paths;
+  if (
+    root.find_field_unordered("Modes").get(modes)
+    || ReadArray(modes, ret.mDisplayConfig.mModes)
+    || root.find_field_unordered("Paths").get(paths)
+    || ReadArray(paths, ret.mDisplayConfig.mPaths)) {
+    return {};
+  }
+
+  // Go through it all again, checking everything; still much cheaper than
+  // building a DOM, and anything unusual falls back to `nlohmann::json`
+  document.rewind();
+  ondemand::value whole;
+  if (
+    document.get_value().get(whole) || !IsWellFormed(whole)
+    || !document.at_end()) {
+    return {};
+  }
+
+  return ret;
+}
+
+}// namespace FredEmmott::MonitorTool
@@ -0,0 +1,307 @@
+// Copyright 2024, Fred Emmott
+// SPDX-License-Identifier: ISC
+
+#include <FredEmmott/MonitorTool/SetDisplayConfig.hpp>
+#include <FredEmmott/MonitorTool/SimulatedDisplayBackend.hpp>
+
+#include <algorithm>
+#include <format>
+#include <iterator>
+#include <thread>
+
+namespace FredEmmott::MonitorTool {
+
+namespace {
+
+// 31.0.15.2000, in the same layout as `CheckInterfaceSupport()`
+constexpr uint64_t InitialDriverVersion
+  = (31ull << 48) | (0ull << 32) | (15ull << 16) | 2000ull;
+
+bool IsSameLUID(const LUID& a, const LUID& b) {
+  return a.LowPart == b.LowPart && a.HighPart == b.HighPart;
+}
+
+std::string ToString(const LUID& luid) {
+  return std::format("{:#x}:{:#x}", luid.HighPart, luid.LowPart);
+}
+
+void SimulateLatency(SimulatedDisplayOptions::Duration latency) {
+  if (latency > SimulatedDisplayOptions::Duration::zero()) {
+    std::this_thread::sleep_for(latency);
+  }
+}
+
+std::optional<std::string> CheckModeIndex(
+  const DisplayConfig& config,
+  UINT32 index,
+  UINT32 invalidIndex,
+  DISPLAYCONFIG_MODE_INFO_TYPE type,
+  const LUID& adapter) {
+  if (index == invalidIndex) {
+    return {};
+  }
+  if (index >= config.mModes.size()) {
+    return std::format("mode index {} is out of range", index);
+  }
+  const auto& mode = config.mModes.at(index);
+  if (mode.infoType != type) {
+    return std::format(
+      "mode {} has type {}, expected {}",
+      index,
+      static_cast<int>(mode.infoType),
+      static_cast<int>(type));
+  }
+  if (!IsSameLUID(mode.adapterId, adapter)) {
+    return std::format("mode {} is for a different adapter", index);
+  }
+  return {};
+}
+
+/// A source's area of the desktop
+struct SourceArea {
+  LUID mAdapter;
+  UINT32 mSourceID;
+  LONG mLeft;
+  LONG mTop;
+  LONG mRight;
+  LONG mBottom;
+
+  bool Overlaps(const SourceArea& other) const {
+    return mLeft < other.mRight && other.mLeft < mRight
+      && mTop < other.mBottom && other.mTop < mBottom;
+  }
+};
+
+}// namespace
+
+SimulatedDisplayBackend::SimulatedDisplayBackend(
+  const SimulatedDisplayOptions& options)
+  : mOptions(options),
+    mActive(CreateSyntheticDisplayConfig(options.mTopology)),
+    mDatabase(mActive) {
+  for (const auto& desc: CreateSyntheticAdapters(options.mTopology)) {
+    mAdapters.push_back({
+      .mDesc = desc,
+      .mDriverVersion = InitialDriverVersion,
+    });
+  }
+  for (const auto& path: mActive.mPaths) {
+    mTargets.push_back({path.targetInfo.adapterId, path.targetInfo.id});
+  }
+}
+
+DisplayConfig SimulatedDisplayBackend::QueryDisplayConfig(uint32_t flags) {
+  SimulateLatency(mOptions.mQueryLatency);
+
+  std::unique_lock lock(mMutex);
+  ++mCounters.mQueries;
+  if (flags & QDC_DATABASE_CURRENT) {
+    return mDatabase;
+  }
+  auto ret = mActive;
+  if ((flags & QDC_ALL_PATHS) == 0) {
+    return ret;
+  }
+
+  for (const auto& target: mTargets) {
+    const auto isActive
+      = std::ranges::any_of(mActive.mPaths, [&target](const auto& path) {
+          return IsSameLUID(path.targetInfo.adapterId, target.mAdapter)
+            && path.targetInfo.id == target.mID;
+        });
+    if (isActive) {
+      continue;
+    }
+    DISPLAYCONFIG_PATH_INFO path {};
+    path.sourceInfo.adapterId = target.mAdapter;
+    path.sourceInfo.sourceModeInfoIdx
+      = DISPLAYCONFIG_PATH_SOURCE_MODE_IDX_INVALID;
+    path.targetInfo.adapterId = target.mAdapter;
+    path.targetInfo.id = target.mID;
+    path.targetInfo.targetModeInfoIdx
+      = DISPLAYCONFIG_PATH_TARGET_MODE_IDX_INVALID;
+    path.targetInfo.desktopModeInfoIdx
+      = DISPLAYCONFIG_PATH_DESKTOP_IMAGE_IDX_INVALID;
+    path.targetInfo.targetAvailable = TRUE;
+    ret.mPaths.push_back(path);
+  }
+  return ret;
+}
+
+void SimulatedDisplayBackend::SetDisplayConfig(
+  const DisplayConfig& config,
+  uint32_t flags) {
+  const auto validateOnly = (flags & SDC_VALIDATE) != 0;
+  SimulateLatency(
+    validateOnly ? mOptions.mValidateLatency : mOptions.mApplyLatency);
+
+  std::unique_lock lock(mMutex);
+  ++(validateOnly ? mCounters.mValidations : mCounters.mApplies);
+
+  auto error = ((flags & SDC_USE_SUPPLIED_DISPLAY_CONFIG) == 0)
+    ? std::optional<std::string> {"only supplied configurations are simulated"}
+    : this->Check(config);
+  if (error) {
+    ++mCounters.mRejections;
+    throw SetDisplayConfigError(
+      std::format("SetDisplayConfig() failed: {}", *error));
+  }
+  if (validateOnly) {
+    return;
+  }
+
+  mActive.mModes = config.mModes;
+  mActive.mPaths.clear();
+  std::ranges::copy_if(
+    config.mPaths, std::back_inserter(mActive.mPaths), [](const auto& path) {
+      return (path.flags & DISPLAYCONFIG_PATH_ACTIVE) != 0;
+    });
+  if (flags & SDC_SAVE_TO_DATABASE) {
+    mDatabase = mActive;
+  }
+}
+
+std::vector<AdapterInfo> SimulatedDisplayBackend::EnumAdapters() {
+  SimulateLatency(mOptions.mEnumAdaptersLatency);
+  std::unique_lock lock(mMutex);
+  return mAdapters;
+}
+
+std::string SimulatedDisplayBackend::GetOSVersion() {
+  std::unique_lock lock(mMutex);
+  return mOptions.mOSVersion;
+}
+
+void SimulatedDisplayBackend::Reboot() {
+  std::unique_lock lock(mMutex);
+  const auto next = [](LUID luid) {
+    ++luid.HighPart;
+    return luid;
+  };
+  for (auto& it: mAdapters) {
+    it.mDesc.AdapterLuid = next(it.mDesc.AdapterLuid);
+  }
+  for (auto& it: mTargets) {
+    it.mAdapter = next(it.mAdapter);
+  }
+  mActive.VisitLUIDs([&next](LUID& luid) { luid = next(luid); });
+  mDatabase.VisitLUIDs([&next](LUID& luid) { luid = next(luid); });
+}
+
+void SimulatedDisplayBackend::UpdateDrivers() {
+  std::unique_lock lock(mMutex);
+  for (auto& it: mAdapters) {
+    ++it.mDriverVersion;
+  }
+}
+
+SimulatedDisplayBackend::Counters SimulatedDisplayBackend::GetCounters()
+  const {
+  std::unique_lock lock(mMutex);
+  return mCounters;
+}
+
+std::optional<std::string> SimulatedDisplayBackend::Check(
+  const DisplayConfig& config) const {
+  const auto isAdapter = [this](const LUID& luid) {
+    return std::ranges::any_of(mAdapters, [&luid](const auto& it) {
+      return IsSameLUID(it.mDesc.AdapterLuid, luid);
+    });
+  };
+  const auto findTarget = [](const auto& targets, const auto& info) {
+    return std::ranges::find_if(targets, [&info](const Target& it) {
+      return IsSameLUID(it.mAdapter, info.adapterId) && it.mID == info.id;
+    });
+  };
+
+  std::vector<Target> usedTargets;
+  std::vector<SourceArea> areas;
+  for (const auto& path: config.mPaths) {
+    if ((path.flags & DISPLAYCONFIG_PATH_ACTIVE) == 0) {
+      continue;
+    }
+    const auto& source = path.sourceInfo;
+    const auto& target = path.targetInfo;
+    if (!isAdapter(source.adapterId)) {
+      return std::format(
+        "source adapter {} is not present", ToString(source.adapterId));
+    }
+    if (findTarget(mTargets, target) == mTargets.end()) {
+      return std::format(
+        "target {:#x} on adapter {} is not connected",
+        target.id,
+        ToString(target.adapterId));
+    }
+    if (findTarget(usedTargets, target) != usedTargets.end()) {
+      return std::format(
+        "target {:#x} is used by more than one path", target.id);
+    }
+    usedTargets.push_back({target.adapterId, target.id});
+
+    for (auto&& error: {
+           CheckModeIndex(
+             config,
+             source.sourceModeInfoIdx,
+             DISPLAYCONFIG_PATH_SOURCE_MODE_IDX_INVALID,
+             DISPLAYCONFIG_MODE_INFO_TYPE_SOURCE,
+             source.adapterId),
+           CheckModeIndex(
+             config,
+             target.targetModeInfoIdx,
+             DISPLAYCONFIG_PATH_TARGET_MODE_IDX_INVALID,
+             DISPLAYCONFIG_MODE_INFO_TYPE_TARGET,
+             target.adapterId),
+           CheckModeIndex(
+             config,
+             target.desktopModeInfoIdx,
+             DISPLAYCONFIG_PATH_DESKTOP_IMAGE_IDX_INVALID,
+             DISPLAYCONFIG_MODE_INFO_TYPE_DESKTOP_IMAGE,
+             target.adapterId),
+         }) {
+      if (error) {
+        return error;
+      }
+    }
+
+    const auto sourceModeIndex = source.sourceModeInfoIdx;
+    if (sourceModeIndex == DISPLAYCONFIG_PATH_SOURCE_MODE_IDX_INVALID) {
+      continue;
+    }
+    // Clones share a source, and its area
+    const auto isKnownSource
+      = std::ranges::any_of(areas, [&source](const SourceArea& it) {
+          return IsSameLUID(it.mAdapter, source.adapterId)
+            && it.mSourceID == source.id;
+        });
+    if (isKnownSource) {
+      continue;
+    }
+    const auto& mode = config.mModes.at(sourceModeIndex).sourceMode;
+    const SourceArea area {
+      .mAdapter = source.adapterId,
+      .mSourceID = source.id,
+      .mLeft = mode.position.x,
+      .mTop = mode.position.y,
+      .mRight = mode.position.x + static_cast<LONG>(mode.width),
+      .mBottom = mode.position.y + static_cast<LONG>(mode.height),
+    };
+    for (const auto& other: areas) {
+      if (area.Overlaps(other)) {
+        return std::format(
+          "source {} on adapter {} overlaps source {} on adapter {}",
+          source.id,
+          ToString(source.adapterId),
+          other.mSourceID,
+          ToString(other.mAdapter));
+      }
+    }
+    areas.push_back(area);
+  }
+
+  if (usedTargets.empty()) {
+    return "there are no active paths";
+  }
+  return {};
+}
+
+}// namespace FredEmmott::MonitorTool
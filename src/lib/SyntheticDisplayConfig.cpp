@@ -0,0 +1,231 @@
+// Copyright 2024, Fred Emmott
+// SPDX-License-Identifier: ISC
+
+#include <FredEmmott/MonitorTool/ProfileCache.hpp>
+#include <FredEmmott/MonitorTool/SyntheticDisplayConfig.hpp>
+
+#include <array>
+#include <format>
+#include <random>
+
+namespace FredEmmott::MonitorTool {
+
+namespace {
+
+struct SyntheticModel {
+  UINT mVendorId;
+  UINT mDeviceId;
+  SIZE_T mDedicatedVideoMemory;
+  const wchar_t* mDescription;
+};
+
+constexpr std::array SyntheticModels {
+  SyntheticModel {0x10de, 0x2684, 24ull << 30, L"Synthetic NVIDIA Adapter"},
+  SyntheticModel {0x1002, 0x744c, 20ull << 30, L"Synthetic AMD Adapter"},
+  SyntheticModel {0x8086, 0xa780, 128ull << 20, L"Synthetic Intel Adapter"},
+};
+
+struct SyntheticResolution {
+  UINT32 mWidth;
+  UINT32 mHeight;
+};
+
+constexpr std::array SyntheticResolutions {
+  SyntheticResolution {1920, 1080},
+  SyntheticResolution {2560, 1440},
+  SyntheticResolution {3840, 2160},
+  SyntheticResolution {3440, 1440},
+};
+
+constexpr std::array SyntheticRefreshRates {60u, 120u, 144u, 165u};
+
+// Not `std::uniform_int_distribution`, as its output isn't specified by the
+// standard, so would vary between standard libraries
+class Generator {
+ public:
+  explicit Generator(uint32_t seed) : mEngine(seed) {
+  }
+
+  template <class T, std::size_t N>
+  const T& Pick(const std::array<T, N>& values) {
+    return values.at(mEngine() % N);
+  }
+
+ private:
+  std::mt19937 mEngine;
+};
+
+LUID GetSyntheticLUID(std::size_t adapterIndex) {
+  return {
+    .LowPart = static_cast<DWORD>(0x1000 + adapterIndex),
+    .HighPart = 0,
+  };
+}
+
+}// namespace
+
+std::vector<DXGI_ADAPTER_DESC1> CreateSyntheticAdapters(
+  const SyntheticTopologyOptions& options) {
+  std::vector<DXGI_ADAPTER_DESC1> ret;
+  ret.reserve(options.mAdapterCount);
+  for (std::size_t i = 0; i < options.mAdapterCount; ++i) {
+    const auto& model = SyntheticModels.at(i % SyntheticModels.size());
+    DXGI_ADAPTER_DESC1 desc {};
+    std::format_to_n(
+      desc.Description,
+      std::size(desc.Description) - 1,
+      L"{} {}",
+      model.mDescription,
+      i);
+    desc.VendorId = model.mVendorId;
+    desc.DeviceId = model.mDeviceId;
+    desc.SubSysId = static_cast<UINT>(0x1000 + (i / SyntheticModels.size()));
+    desc.DedicatedVideoMemory = model.mDedicatedVideoMemory;
+    desc.AdapterLuid = GetSyntheticLUID(i);
+    ret.push_back(desc);
+  }
+  return ret;
+}
+
+DisplayConfig CreateSyntheticDisplayConfig(
+  const SyntheticTopologyOptions& options) {
+  Generator generator {options.mSeed};
+  DisplayConfig ret;
+  if (options.mAdapterCount == 0) {
+    return ret;
+  }
+
+  const auto targetsPerSource = std::max<std::size_t>(
+    options.mTargetsPerSource, 1);
+  std::vector<UINT32> sourcesPerAdapter(options.mAdapterCount, 0);
+  LONG nextX = 0;
+
+  for (std::size_t first = 0; first < options.mTargetCount;
+       first += targetsPerSource) {
+    const auto sourceIndex = first / targetsPerSource;
+    const auto adapterIndex = sourceIndex % options.mAdapterCount;
+    const auto adapter = GetSyntheticLUID(adapterIndex);
+    const auto sourceId = sourcesPerAdapter.at(adapterIndex)++;
+
+    const auto& resolution = generator.Pick(SyntheticResolutions);
+    const auto sourceModeIndex = static_cast<UINT32>(ret.mModes.size());
+    {
+      DISPLAYCONFIG_MODE_INFO mode {};
+      mode.infoType = DISPLAYCONFIG_MODE_INFO_TYPE_SOURCE;
+      mode.id = sourceId;
+      mode.adapterId = adapter;
+      mode.sourceMode.width = resolution.mWidth;
+      mode.sourceMode.height = resolution.mHeight;
+      mode.sourceMode.pixelFormat = DISPLAYCONFIG_PIXELFORMAT_32BPP;
+      mode.sourceMode.position = {nextX, 0};
+      ret.mModes.push_back(mode);
+    }
+    const POINTL size {
+      static_cast<LONG>(resolution.mWidth),
+      static_cast<LONG>(resolution.mHeight),
+    };
+    const RECTL region {0, 0, size.x, size.y};
+    nextX += size.x;
+
+    const auto last = std::min(first + targetsPerSource, options.mTargetCount);
+    for (auto targetIndex = first; targetIndex < last; ++targetIndex) {
+      const auto targetId = static_cast<UINT32>(0x1100 + targetIndex);
+      const auto refreshRate = generator.Pick(SyntheticRefreshRates);
+      const auto outputTechnology = (targetIndex % 2)
+        ? DISPLAYCONFIG_OUTPUT_TECHNOLOGY_HDMI
+        : DISPLAYCONFIG_OUTPUT_TECHNOLOGY_DISPLAYPORT_EXTERNAL;
+
+      const auto targetModeIndex = static_cast<UINT32>(ret.mModes.size());
+      {
+        DISPLAYCONFIG_MODE_INFO mode {};
+        mode.infoType = DISPLAYCONFIG_MODE_INFO_TYPE_TARGET;
+        mode.id = targetId;
+        mode.adapterId = adapter;
+        auto& signal = mode.targetMode.targetVideoSignalInfo;
+        signal.activeSize = {resolution.mWidth, resolution.mHeight};
+        // Typical reduced-blanking totals
+        signal.totalSize = {resolution.mWidth + 160, resolution.mHeight + 41};
+        signal.vSyncFreq = {refreshRate, 1};
+        signal.hSyncFreq = {refreshRate * signal.totalSize.cy, 1};
+        signal.pixelRate = static_cast<UINT64>(signal.hSyncFreq.Numerator)
+          * signal.totalSize.cx;
+        signal.scanLineOrdering = DISPLAYCONFIG_SCANLINE_ORDERING_PROGRESSIVE;
+        ret.mModes.push_back(mode);
+      }
+      const auto desktopModeIndex = static_cast<UINT32>(ret.mModes.size());
+      {
+        DISPLAYCONFIG_MODE_INFO mode {};
+        mode.infoType = DISPLAYCONFIG_MODE_INFO_TYPE_DESKTOP_IMAGE;
+        mode.id = targetId;
+        mode.adapterId = adapter;
+        mode.desktopImageInfo.PathSourceSize = size;
+        mode.desktopImageInfo.DesktopImageRegion = region;
+        mode.desktopImageInfo.DesktopImageClip = region;
+        ret.mModes.push_back(mode);
+      }
+
+      DISPLAYCONFIG_PATH_INFO path {};
+      path.sourceInfo.adapterId = adapter;
+      path.sourceInfo.id = sourceId;
+      path.sourceInfo.cloneGroupId = static_cast<UINT32>(sourceIndex);
+      path.sourceInfo.sourceModeInfoIdx = sourceModeIndex;
+      path.targetInfo.adapterId = adapter;
+      path.targetInfo.id = targetId;
+      path.targetInfo.desktopModeInfoIdx = desktopModeIndex;
+      path.targetInfo.targetModeInfoIdx = targetModeIndex;
+      path.targetInfo.outputTechnology = outputTechnology;
+      path.targetInfo.rotation = DISPLAYCONFIG_ROTATION_IDENTITY;
+      path.targetInfo.scaling = DISPLAYCONFIG_SCALING_IDENTITY;
+      path.targetInfo.refreshRate = {refreshRate, 1};
+      path.targetInfo.scanLineOrdering
+        = DISPLAYCONFIG_SCANLINE_ORDERING_PROGRESSIVE;
+      path.targetInfo.targetAvailable = TRUE;
+      path.flags
+        = DISPLAYCONFIG_PATH_ACTIVE | DISPLAYCONFIG_PATH_SUPPORT_VIRTUAL_MODE;
+      ret.mPaths.push_back(path);
+    }
+  }
+  return ret;
+}
+
+Profile CreateSyntheticProfile(
+  const SyntheticTopologyOptions& options,
+  const std::string& name) {
+  Profile ret {
+    .mName = name,
+    .mAdapters = CreateSyntheticAdapters(options),
+    .mDisplayConfig = CreateSyntheticDisplayConfig(options),
+  };
+
+  // Deterministic, unlike `CoCreateGuid()`
+  const auto key = std::format("{}\n{}", options.mSeed, name);
+  const auto high = HashProfileContents(key);
+  const auto low = HashProfileContents(key + "\n");
+  GUID guid {
+    .Data1 = static_cast<uint32_t>(high >> 32),
+    .Data2 = static_cast<uint16_t>(high >> 16),
+    // Version 8 (custom)
+    .Data3 = static_cast<uint16_t>((high & 0x0fff) | 0x8000),
+  };
+  for (std::size_t i = 0; i < std::size(guid.Data4); ++i) {
+    guid.Data4[i] = static_cast<uint8_t>(low >> (i * 8));
+  }
+  // RFC 9562 variant
+  guid.Data4[0] = (guid.Data4[0] & 0x3f) | 0x80;
+  ret.mGuid = guid;
+  return ret;
+}
+
+void PopulateSyntheticProfileStore(
+  ProfileStore& store,
+  std::size_t count,
+  const SyntheticTopologyOptions& options) {
+  for (std::size_t i = 0; i < count; ++i) {
+    auto profileOptions = options;
+    profileOptions.mSeed = options.mSeed + static_cast<uint32_t>(i);
+    store.Save(
+      CreateSyntheticProfile(profileOptions, std::format("Synthetic {}", i)));
+  }
+}
+
+}// namespace FredEmmott::MonitorTool
@@ -0,0 +1,99 @@
+// Copyright 2024, Fred Emmott
+// SPDX-License-Identifier: ISC
+
+#include <FredEmmott/MonitorTool/EnumAdapterDescs.hpp>
+#include <FredEmmott/MonitorTool/QueryDisplayConfig.hpp>
+#include <FredEmmott/MonitorTool/Topology.hpp>
+
+#include <algorithm>
+#include <bit>
+#include <format>
+
+namespace FredEmmott::MonitorTool {
+
+namespace {
+
+template <class T>
+void SortAndDeduplicate(std::vector<T>& v) {
+  std::ranges::sort(v);
+  const auto [first, last] = std::ranges::unique(v);
+  v.erase(first, last);
+}
+
+}// namespace
+
+Topology Topology::GetCurrent() {
+  return Create(QueryDisplayConfig(QDC_ALL_PATHS), EnumAdapterDescs());
+}
+
+Topology Topology::Create(
+  const DisplayConfig& allPaths,
+  const std::vector<DXGI_ADAPTER_DESC1>& adapters) {
+  Topology ret;
+
+  const auto badFlags = DXGI_ADAPTER_FLAG_REMOTE | DXGI_ADAPTER_FLAG_SOFTWARE;
+  for (const auto& it: adapters) {
+    if ((it.Flags & badFlags) == 0) {
+      ret.mAdapters.push_back({it.VendorId, it.DeviceId, it.SubSysId});
+    }
+  }
+
+  for (const auto& path: allPaths.mPaths) {
+    const auto& target = path.targetInfo;
+    if (!target.targetAvailable) {
+      continue;
+    }
+    const auto adapter = std::ranges::find_if(adapters, [&](const auto& it) {
+      return std::bit_cast<uint64_t>(it.AdapterLuid)
+        == std::bit_cast<uint64_t>(target.adapterId);
+    });
+    if (adapter == adapters.end()) {
+      continue;
+    }
+    // `QDC_ALL_PATHS` has a path for every source/target combination, so
+    // each target appears several times
+    ret.mTargets.push_back({
+      .mAdapter = {adapter->VendorId, adapter->DeviceId, adapter->SubSysId},
+      .mTargetId = target.id,
+      .mOutputTechnology = target.outputTechnology,
+    });
+  }
+
+  SortAndDeduplicate(ret.mAdapters);
+  SortAndDeduplicate(ret.mTargets);
+  return ret;
+}
+
+uint64_t Topology::GetFingerprint() const noexcept {
+  // 64-bit FNV-1a
+  uint64_t ret = 0xcbf29ce484222325ull;
+  const auto hash = [&ret](uint32_t value) {
+    for (std::size_t i = 0; i < sizeof(value); ++i) {
+      ret ^= static_cast<uint8_t>(value >> (i * 8));
+      ret *= 0x100000001b3ull;
+    }
+  };
+  const auto hashAdapter = [&hash](const TopologyAdapter& it) {
+    hash(it.mVendorId);
+    hash(it.mDeviceId);
+    hash(it.mSubSysId);
+  };
+
+  hash(static_cast<uint32_t>(mAdapters.size()));
+  for (const auto& it: mAdapters) {
+    hashAdapter(it);
+  }
+  hash(static_cast<uint32_t>(mTargets.size()));
+  for (const auto& it: mTargets) {
+    hashAdapter(it.mAdapter);
+    hash(it.mTargetId);
+    hash(static_cast<uint32_t>(it.mOutputTechnology));
+  }
+  return ret;
+}
+
+std::string Topology::GetFingerprintString() const {
+  return std::format("{:016x}", GetFingerprint());
+}
+
+}// namespace FredEmmott::MonitorTool
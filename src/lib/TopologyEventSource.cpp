@@ -0,0 +1,144 @@
+// Copyright 2024, Fred Emmott
+// SPDX-License-Identifier: ISC
+
+#include <FredEmmott/MonitorTool/TopologyEventSource.hpp>
+#include <winrt/base.h>
+
+#include <algorithm>
+#include <thread>
+
+namespace FredEmmott::MonitorTool {
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+#ifdef _WIN32
+constexpr auto WindowClassName = L"FredEmmott.MonitorTool.TopologyEvents";
+#endif
+
+/// Empty if there's no timeout
+std::optional<Clock::time_point> GetDeadline(
+  std::optional<std::chrono::milliseconds> timeout) {
+  if (!timeout) {
+    return {};
+  }
+  return Clock::now() + *timeout;
+}
+
+}// namespace
+
+#ifdef _WIN32
+WindowMessageTopologyEventSource::WindowMessageTopologyEventSource() {
+  const auto instance = GetModuleHandleW(nullptr);
+  static const auto sWindowClass = [instance] {
+    WNDCLASSEXW windowClass {
+      .cbSize = sizeof(WNDCLASSEXW),
+      .lpfnWndProc = &WindowProc,
+      .hInstance = instance,
+      .lpszClassName = WindowClassName,
+    };
+    return RegisterClassExW(&windowClass);
+  }();
+  winrt::check_bool(sWindowClass != 0);
+
+  // Not a message-only window, as they don't receive broadcasts like
+  // `WM_DISPLAYCHANGE`; it's never shown
+  mWindow = CreateWindowExW(
+    0,
+    WindowClassName,
+    L"",
+    0,
+    0,
+    0,
+    0,
+    0,
+    nullptr,
+    nullptr,
+    instance,
+    nullptr);
+  winrt::check_bool(mWindow != nullptr);
+  SetWindowLongPtrW(mWindow, GWLP_USERDATA, reinterpret_cast<LONG_PTR>(this));
+}
+
+WindowMessageTopologyEventSource::~WindowMessageTopologyEventSource() {
+  DestroyWindow(mWindow);
+}
+
+LRESULT CALLBACK WindowMessageTopologyEventSource::WindowProc(
+  HWND hwnd,
+  UINT message,
+  WPARAM wParam,
+  LPARAM lParam) noexcept {
+  if (message == WM_DISPLAYCHANGE || message == WM_DEVICECHANGE) {
+    const auto self = reinterpret_cast<WindowMessageTopologyEventSource*>(
+      GetWindowLongPtrW(hwnd, GWLP_USERDATA));
+    if (self) {
+      self->mChanged = true;
+    }
+  }
+  return DefWindowProcW(hwnd, message, wParam, lParam);
+}
+
+bool WindowMessageTopologyEventSource::WaitForChange(
+  std::optional<std::chrono::milliseconds> timeout) {
+  const auto deadline = GetDeadline(timeout);
+  while (true) {
+    MSG msg {};
+    while (PeekMessageW(&msg, nullptr, 0, 0, PM_REMOVE)) {
+      TranslateMessage(&msg);
+      DispatchMessageW(&msg);
+    }
+    if (mChanged) {
+      mChanged = false;
+      return true;
+    }
+
+    DWORD waitMilliseconds = INFINITE;
+    if (deadline) {
+      const auto remaining = std::chrono::ceil<std::chrono::milliseconds>(
+        *deadline - Clock::now());
+      if (remaining.count() <= 0) {
+        return false;
+      }
+      waitMilliseconds = static_cast<DWORD>(remaining.count());
+    }
+    MsgWaitForMultipleObjects(
+      0, nullptr, FALSE, waitMilliseconds, QS_ALLINPUT);
+  }
+}
+#endif
+
+PollingTopologyEventSource::PollingTopologyEventSource(
+  std::chrono::milliseconds interval,
+  std::function<Topology()> getTopology)
+  : mInterval(interval), mGetTopology(std::move(getTopology)) {
+}
+
+bool PollingTopologyEventSource::WaitForChange(
+  std::optional<std::chrono::milliseconds> timeout) {
+  const auto deadline = GetDeadline(timeout);
+  if (!mLastTopology) {
+    mLastTopology = mGetTopology();
+  }
+
+  while (true) {
+    Clock::duration sleep = mInterval;
+    if (deadline) {
+      const auto now = Clock::now();
+      if (now >= *deadline) {
+        return false;
+      }
+      sleep = std::min<Clock::duration>(sleep, *deadline - now);
+    }
+    std::this_thread::sleep_for(sleep);
+
+    auto topology = mGetTopology();
+    if (topology != *mLastTopology) {
+      mLastTopology = std::move(topology);
+      return true;
+    }
+  }
+}
+
+}// namespace FredEmmott::MonitorTool
@@ -0,0 +1,123 @@
+// Copyright 2024, Fred Emmott
+// SPDX-License-Identifier: ISC
+
+#include <FredEmmott/MonitorTool/Paths.hpp>
+#include <FredEmmott/MonitorTool/Profile.hpp>
+#include <FredEmmott/MonitorTool/TopologyRules.hpp>
+#include <nlohmann/json.hpp>
+
+#include <charconv>
+#include <format>
+#include <fstream>
+#include <iterator>
+
+namespace FredEmmott::MonitorTool {
+
+namespace {
+
+uint64_t ParseFingerprint(std::string_view str) {
+  uint64_t ret {};
+  const auto end = str.data() + str.size();
+  const auto [ptr, ec] = std::from_chars(str.data(), end, ret, 16);
+  if (ec != std::errc {} || ptr != end) {
+    throw TopologyRulesError(std::format("Invalid fingerprint '{}'", str));
+  }
+  return ret;
+}
+
+TopologyRule ParseRule(const nlohmann::json& j) {
+  TopologyRule ret {
+    .mProfileName = j.at("Profile").get<std::string>(),
+  };
+  if (j.contains("Fingerprint")) {
+    ret.mFingerprint
+      = ParseFingerprint(j.at("Fingerprint").get<std::string>());
+  }
+  if (j.contains("MinTargets")) {
+    ret.mMinTargets = j.at("MinTargets").get<std::size_t>();
+  }
+  if (j.contains("MaxTargets")) {
+    ret.mMaxTargets = j.at("MaxTargets").get<std::size_t>();
+  }
+  return ret;
+}
+
+}// namespace
+
+bool TopologyRule::Matches(const Topology& topology, uint64_t fingerprint)
+  const noexcept {
+  if (mFingerprint && *mFingerprint != fingerprint) {
+    return false;
+  }
+  const auto targets = topology.mTargets.size();
+  if (mMinTargets && targets < *mMinTargets) {
+    return false;
+  }
+  if (mMaxTargets && targets > *mMaxTargets) {
+    return false;
+  }
+  return true;
+}
+
+std::filesystem::path TopologyRules::GetDefaultPath() {
+  return GetDataPath() / "Rules.json";
+}
+
+TopologyRules TopologyRules::Load(const std::filesystem::path& path) {
+  std::ifstream f(path, std::ios::binary);
+  if (!f) {
+    throw FileOpenError(std::format("Failed to open `{}`", path.string()));
+  }
+  const std::string json {
+    std::istreambuf_iterator<char>(f), std::istreambuf_iterator<char>()};
+  return FromJSON(json);
+}
+
+TopologyRules TopologyRules::FromJSON(std::string_view json) {
+  TopologyRules ret;
+  try {
+    for (const auto& it: nlohmann::json::parse(json).at("Rules")) {
+      ret.mRules.push_back(ParseRule(it));
+    }
+  } catch (const nlohmann::json::exception& e) {
+    throw TopologyRulesError(std::format("Invalid rules: {}", e.what()));
+  }
+
+  for (std::size_t i = 0; i < ret.mRules.size(); ++i) {
+    const auto& rule = ret.mRules.at(i);
+    if (rule.mFingerprint && !(rule.mMinTargets || rule.mMaxTargets)) {
+      // Keeps the first, as that's the one that would match
+      ret.mFingerprintOnlyRules.try_emplace(*rule.mFingerprint, i);
+    } else {
+      ret.mOtherRules.push_back(i);
+    }
+  }
+  return ret;
+}
+
+const TopologyRule* TopologyRules::Match(
+  const Topology& topology) const noexcept {
+  const auto fingerprint = topology.GetFingerprint();
+
+  auto first = mRules.size();
+  if (const auto it = mFingerprintOnlyRules.find(fingerprint);
+      it != mFingerprintOnlyRules.end()) {
+    first = it->second;
+  }
+  // Only rules before the fingerprint match can take priority over it
+  for (const auto i: mOtherRules) {
+    if (i > first) {
+      break;
+    }
+    if (mRules.at(i).Matches(topology, fingerprint)) {
+      return &mRules.at(i);
+    }
+  }
+  return (first < mRules.size()) ? &mRules.at(first) : nullptr;
+}
+
+const std::vector<TopologyRule>& TopologyRules::GetRules() const noexcept {
+  return mRules;
+}
+
+}// namespace FredEmmott::MonitorTool
@@ -0,0 +1,81 @@
+// Copyright 2024, Fred Emmott
+// SPDX-License-Identifier: ISC
+
+#include <FredEmmott/MonitorTool/ApplyProfile.hpp>
+#include <FredEmmott/MonitorTool/TopologyRulesEngine.hpp>
+#include <winrt/base.h>
+
+#include <exception>
+#include <format>
+
+namespace FredEmmott::MonitorTool {
+
+namespace {
+using Clock = std::chrono::steady_clock;
+}
+
+TopologyRulesEngine::TopologyRulesEngine(
+  TopologyRules rules,
+  std::unique_ptr<TopologyEventSource> events,
+  ResultCallback onResult)
+  : mRules(std::move(rules)),
+    mEvents(std::move(events)),
+    mOnResult(std::move(onResult)) {
+}
+
+[[noreturn]] void TopologyRulesEngine::Run() {
+  Evaluate(Clock::now());
+  while (true) {
+    if (!mEvents->WaitForChange(std::nullopt)) {
+      continue;
+    }
+    const auto triggeredAt = Clock::now();
+    while (Clock::now() - triggeredAt < MaxDebounceInterval
+           && mEvents->WaitForChange(DebounceInterval)) {
+      // Coalesce the burst
+    }
+    Evaluate(triggeredAt);
+  }
+}
+
+void TopologyRulesEngine::Evaluate(Clock::time_point triggeredAt) {
+  TopologyRulesEngineResult result;
+  try {
+    result.mTopology = Topology::GetCurrent();
+    if (mLastTopology == result.mTopology) {
+      return;
+    }
+    mLastTopology = result.mTopology;
+
+    result.mRule = mRules.Match(result.mTopology);
+    if (result.mRule) {
+      const auto snapshot = mProfiles.GetSnapshot();
+      const auto& name = result.mRule->mProfileName;
+      const auto profile = snapshot->FindByName(name);
+      if (!profile) {
+        result.mError
+          = std::format("Couldn't find a profile called '{}'", name);
+      } else {
+        result.mApplyResult = ApplyProfileWithAdapterFixups(
+          *profile, ApplyMode::Persistent, false);
+        if (!result.mApplyResult) {
+          result.mError
+            = "Profile can't be applied due to a configuration change";
+        }
+      }
+    }
+  } catch (const winrt::hresult_error& e) {
+    result.mError = winrt::to_string(e.message());
+  } catch (const std::exception& e) {
+    // Not just `RuntimeError`; e.g. a bad allocation or a standard library
+    // error shouldn't stop the engine from handling later changes
+    result.mError = e.what();
+  }
+
+  result.mLatency = Clock::now() - triggeredAt;
+  if (mOnResult) {
+    mOnResult(result);
+  }
+}
+
+}// namespace FredEmmott::MonitorTool
@@ -0,0 +1,122 @@
+// Copyright 2024, Fred Emmott
+// SPDX-License-Identifier: ISC
+
+#include <FredEmmott/MonitorTool/JSONWriter.hpp>
+#include <FredEmmott/MonitorTool/Trace.hpp>
+
+#include <atomic>
+#include <format>
+#include <fstream>
+#include <mutex>
+
+#include <Windows.h>
+
+namespace FredEmmott::MonitorTool {
+
+namespace {
+
+std::atomic_bool sEnabled {false};
+
+struct TraceFile {
+  std::mutex mMutex;
+  std::ofstream mStream;
+  bool mHaveEvents {false};
+
+  void Close() {
+    if (!mStream.is_open()) {
+      return;
+    }
+    mStream << "\n]\n";
+    mStream.close();
+  }
+
+  ~TraceFile() {
+    sEnabled = false;
+    this->Close();
+  }
+};
+
+/// Constructed on first use, so tools that don't trace don't open a stream
+TraceFile& GetTraceFile() {
+  static TraceFile sTraceFile;
+  return sTraceFile;
+}
+
+std::string ToJSONString(std::string_view value) {
+  JSONWriter w;
+  w.Write(value);
+  return std::move(w).GetString();
+}
+
+/// Chrome traces use microseconds; steady_clock is QPC, so traces from
+/// several processes can be merged
+double ToMicroseconds(std::chrono::steady_clock::duration duration) {
+  return std::chrono::duration<double, std::micro>(duration).count();
+}
+
+}// namespace
+
+void StartTracing(const std::filesystem::path& path) {
+  auto& traceFile = GetTraceFile();
+  std::unique_lock lock(traceFile.mMutex);
+  traceFile.Close();
+  traceFile.mStream.open(path, std::ios::binary | std::ios::trunc);
+  if (!traceFile.mStream) {
+    throw TraceFileError(
+      std::format("Failed to create trace file `{}`", path.string()));
+  }
+  traceFile.mStream << "[";
+  traceFile.mHaveEvents = false;
+  sEnabled = true;
+}
+
+void StopTracing() noexcept {
+  sEnabled = false;
+  auto& traceFile = GetTraceFile();
+  std::unique_lock lock(traceFile.mMutex);
+  traceFile.Close();
+}
+
+bool IsTracingEnabled() noexcept {
+  return sEnabled.load(std::memory_order_relaxed);
+}
+
+TraceSpan::TraceSpan(std::string_view name, std::string_view detail) {
+  if (!IsTracingEnabled()) {
+    return;
+  }
+  mName = name;
+  mDetail = detail;
+  mStart = Clock::now();
+}
+
+TraceSpan::~TraceSpan() {
+  if (mName.empty() || !IsTracingEnabled()) {
+    return;
+  }
+  const auto end = Clock::now();
+
+  auto event = std::format(
+    "{{\"name\":{},\"cat\":\"fmt\",\"ph\":\"X\",\"ts\":{:.3f},\"dur\":{:.3f},"
+    "\"pid\":{},\"tid\":{}",
+    ToJSONString(mName),
+    ToMicroseconds(mStart.time_since_epoch()),
+    ToMicroseconds(end - mStart),
+    GetCurrentProcessId(),
+    GetCurrentThreadId());
+  if (!mDetail.empty()) {
+    event += std::format(",\"args\":{{\"detail\":{}}}", ToJSONString(mDetail));
+  }
+  event += "}";
+
+  auto& traceFile = GetTraceFile();
+  std::unique_lock lock(traceFile.mMutex);
+  if (!traceFile.mStream.is_open()) {
+    return;
+  }
+  traceFile.mStream << (traceFile.mHaveEvents ? ",\n" : "\n") << event;
+  traceFile.mStream.flush();
+  traceFile.mHaveEvents = true;
+}
+
+}// namespace FredEmmott::MonitorTool
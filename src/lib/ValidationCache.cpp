@@ -0,0 +1,298 @@
+// Copyright 2024, Fred Emmott
+// SPDX-License-Identifier: ISC
+
+#include <FredEmmott/MonitorTool/DisplayBackend.hpp>
+#include <FredEmmott/MonitorTool/DisplayConfigSchema.hpp>
+#include <FredEmmott/MonitorTool/Paths.hpp>
+#include <FredEmmott/MonitorTool/ProfileCache.hpp>
+#include <FredEmmott/MonitorTool/ValidationCache.hpp>
+#include <winrt/base.h>
+
+#include <algorithm>
+#include <format>
+#include <fstream>
+#include <string>
+#include <tuple>
+#include <vector>
+#include <type_traits>
+
+#include <Windows.h>
+
+namespace FredEmmott::MonitorTool {
+
+namespace {
+
+// 'FMTV'
+constexpr uint32_t CacheMagic = 0x56544d46;
+// Increment if the layout or the key derivation changes
+constexpr uint32_t CacheVersion = 4;
+// Enough for e.g. docked and undocked, without growing every time adapter LUIDs
+// change
+constexpr std::size_t MaxSystemsPerProfile = 4;
+
+struct CacheRecord {
+  uint32_t mMagic {CacheMagic};
+  uint32_t mVersion {CacheVersion};
+  ValidationCacheKey mKey {};
+  uint32_t mStrategy {};
+};
+static_assert(std::is_trivially_copyable_v<CacheRecord>);
+
+template <class T>
+void Append(std::string& buffer, const T* data, std::size_t count = 1) {
+  buffer.append(reinterpret_cast<const char*>(data), sizeof(T) * count);
+}
+
+/// `HashFields()` rather than the raw structs, which have padding
+template <class T>
+void AppendHashes(std::string& buffer, const std::vector<T>& values) {
+  const uint64_t count = values.size();
+  Append(buffer, &count);
+  for (const auto& it: values) {
+    const auto hash = HashFields(it);
+    Append(buffer, &hash);
+  }
+}
+
+/** One file per profile, containing a record for each of the most recently
+ * seen systems.
+ *
+ * The system hash changes on every reboot, as it includes adapter LUIDs, so
+ * keying files by it would grow the cache forever.
+ */
+std::filesystem::path GetCachePath(const ValidationCacheKey& key) {
+  return GetDataPath() / "Cache"
+    / std::format("{:016x}.fmtv", key.mProfileHash);
+}
+
+/// Most recent first
+std::vector<CacheRecord> ReadRecords(const ValidationCacheKey& key) {
+  winrt::file_handle file {CreateFileW(
+    GetCachePath(key).c_str(),
+    GENERIC_READ,
+    FILE_SHARE_READ | FILE_SHARE_DELETE,
+    nullptr,
+    OPEN_EXISTING,
+    FILE_ATTRIBUTE_NORMAL,
+    NULL)};
+  if (!file) {
+    return {};
+  }
+
+  std::vector<CacheRecord> ret(MaxSystemsPerProfile);
+  DWORD bytesRead {};
+  if (!ReadFile(
+        file.get(),
+        ret.data(),
+        static_cast<DWORD>(ret.size() * sizeof(CacheRecord)),
+        &bytesRead,
+        nullptr)) {
+    return {};
+  }
+  ret.resize(bytesRead / sizeof(CacheRecord));
+  std::erase_if(ret, [&key](const CacheRecord& record) {
+    return record.mMagic != CacheMagic || record.mVersion != CacheVersion
+      || record.mKey.mProfileHash != key.mProfileHash;
+  });
+  return ret;
+}
+
+/// Replaces the file, or removes it if `records` is empty
+void WriteRecords(
+  const ValidationCacheKey& key,
+  const std::vector<CacheRecord>& records) {
+  const auto cachePath = GetCachePath(key);
+  if (records.empty()) {
+    DeleteFileW(cachePath.c_str());
+    return;
+  }
+
+  std::error_code ec;
+  std::filesystem::create_directories(cachePath.parent_path(), ec);
+
+  // Write then rename, so that concurrent readers never see a partial file
+  auto tempPath = cachePath;
+  tempPath += std::format(
+    L".{}-{}.tmp", GetCurrentProcessId(), GetCurrentThreadId());
+  {
+    winrt::file_handle file {CreateFileW(
+      tempPath.c_str(),
+      GENERIC_WRITE,
+      0,
+      nullptr,
+      CREATE_ALWAYS,
+      FILE_ATTRIBUTE_NORMAL,
+      NULL)};
+    if (!file) {
+      return;
+    }
+    const auto size = static_cast<DWORD>(records.size() * sizeof(CacheRecord));
+    DWORD bytesWritten {};
+    if (
+      (!WriteFile(file.get(), records.data(), size, &bytesWritten, nullptr))
+      || bytesWritten != size) {
+      file.close();
+      DeleteFileW(tempPath.c_str());
+      return;
+    }
+  }
+  if (!MoveFileExW(
+        tempPath.c_str(), cachePath.c_str(), MOVEFILE_REPLACE_EXISTING)) {
+    DeleteFileW(tempPath.c_str());
+  }
+}
+
+/** Removes files from earlier versions, once per cache version.
+ *
+ * Version 2 files were keyed by profile and system, so were never reused after
+ * a reboot; version 3 files hashed raw structs, so have different names to
+ * current files and would never be read again either.
+ *
+ * Gated on a marker file so that this is a single `stat()` once the
+ * migration has happened, rather than a directory scan.
+ */
+void RemoveStaleFiles() {
+  const auto cacheDir = GetDataPath() / "Cache";
+  const auto marker = cacheDir / std::format("version-{}", CacheVersion);
+  std::error_code ec;
+  if (std::filesystem::exists(marker, ec)) {
+    return;
+  }
+
+  for (const auto& entry: std::filesystem::directory_iterator(cacheDir, ec)) {
+    const auto& path = entry.path();
+    if (
+      path.extension() == ".fmtv"
+      || path.filename().string().starts_with("version-")) {
+      std::filesystem::remove(path, ec);
+    }
+  }
+  std::filesystem::create_directories(cacheDir, ec);
+  std::ofstream(marker, std::ios::binary);
+}
+
+}// namespace
+
+ValidationCacheKey GetValidationCacheKey(
+  const Profile& profile,
+  const std::vector<AdapterInfo>& adapters,
+  const DisplayConfig& allPaths) {
+  ValidationCacheKey ret;
+  {
+    std::string buffer;
+    AppendHashes(buffer, profile.mDisplayConfig.mPaths);
+    AppendHashes(buffer, profile.mDisplayConfig.mModes);
+    // Used to remap LUIDs
+    AppendHashes(buffer, profile.mAdapters);
+    ret.mProfileHash = HashProfileContents(buffer);
+  }
+
+  std::string buffer;
+  const auto build = GetDisplayBackend()->GetOSVersion();
+  Append(buffer, build.data(), build.size());
+  for (const auto& it: adapters) {
+    Append(buffer, &it.mDesc.AdapterLuid);
+    Append(buffer, &it.mDesc.VendorId);
+    Append(buffer, &it.mDesc.DeviceId);
+    Append(buffer, &it.mDesc.SubSysId);
+    Append(buffer, &it.mDesc.Revision);
+    Append(buffer, &it.mDesc.Flags);
+    Append(buffer, &it.mDriverVersion);
+  }
+
+  // Validation depends on what's plugged in; `QDC_ALL_PATHS` has a path for
+  // every source/target combination, so deduplicate
+  std::vector<std::tuple<DWORD, LONG, UINT32>> targets;
+  for (const auto& path: allPaths.mPaths) {
+    const auto& target = path.targetInfo;
+    if (target.targetAvailable) {
+      targets.emplace_back(
+        target.adapterId.LowPart, target.adapterId.HighPart, target.id);
+    }
+  }
+  std::ranges::sort(targets);
+  const auto [first, last] = std::ranges::unique(targets);
+  targets.erase(first, last);
+  for (const auto& [low, high, id]: targets) {
+    Append(buffer, &low);
+    Append(buffer, &high);
+    Append(buffer, &id);
+  }
+  ret.mSystemHash = HashProfileContents(buffer);
+
+  return ret;
+}
+
+uint64_t GetDriverVersionHash(const std::vector<AdapterInfo>& adapters) {
+  std::string buffer;
+  const auto build = GetDisplayBackend()->GetOSVersion();
+  Append(buffer, build.data(), build.size());
+  for (const auto& it: adapters) {
+    Append(buffer, &it.mDesc.VendorId);
+    Append(buffer, &it.mDesc.DeviceId);
+    Append(buffer, &it.mDriverVersion);
+  }
+  return HashProfileContents(buffer);
+}
+
+std::optional<ApplyPlan::Strategy> LoadCachedValidation(
+  const ValidationCacheKey& key) {
+  const auto records = ReadRecords(key);
+  const auto record = std::ranges::find(records, key, &CacheRecord::mKey);
+  if (record == records.end()) {
+    return {};
+  }
+
+  const auto strategy = static_cast<ApplyPlan::Strategy>(record->mStrategy);
+  switch (strategy) {
+    case ApplyPlan::Strategy::AsSaved:
+    case ApplyPlan::Strategy::SingleGPU:
+    case ApplyPlan::Strategy::RemappedLUIDs:
+      return strategy;
+    case ApplyPlan::Strategy::None:
+      break;
+  }
+  return {};
+}
+
+void StoreCachedValidation(
+  const ValidationCacheKey& key,
+  ApplyPlan::Strategy strategy) noexcept {
+  try {
+    // Thread-safe, and only checks the marker once per process
+    [[maybe_unused]] static const bool sRemovedStaleFiles
+      = (RemoveStaleFiles(), true);
+
+    auto records = ReadRecords(key);
+    std::erase_if(records, [&key](const CacheRecord& record) {
+      return record.mKey == key;
+    });
+    records.insert(
+      records.begin(),
+      CacheRecord {
+        .mKey = key,
+        .mStrategy = static_cast<uint32_t>(strategy),
+      });
+    if (records.size() > MaxSystemsPerProfile) {
+      records.resize(MaxSystemsPerProfile);
+    }
+    WriteRecords(key, records);
+  } catch (...) {
+    // Just a cache
+  }
+}
+
+void RemoveCachedValidation(const ValidationCacheKey& key) noexcept {
+  try {
+    auto records = ReadRecords(key);
+    if (std::erase_if(records, [&key](const CacheRecord& record) {
+          return record.mKey == key;
+        })) {
+      WriteRecords(key, records);
+    }
+  } catch (...) {
+    // Just a cache
+  }
+}
+
+}// namespace FredEmmott::MonitorTool
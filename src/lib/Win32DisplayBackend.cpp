@@ -0,0 +1,128 @@
+// Copyright 2024, Fred Emmott
+// SPDX-License-Identifier: ISC
+
+#include <FredEmmott/MonitorTool/DisplayBackend.hpp>
+#include <FredEmmott/MonitorTool/QueryDisplayConfig.hpp>
+#include <FredEmmott/MonitorTool/SetDisplayConfig.hpp>
+#include <winrt/base.h>
+
+#include <format>
+
+#include <Windows.h>
+#include <dxgi1_6.h>
+
+namespace FredEmmott::MonitorTool {
+
+DisplayConfig Win32DisplayBackend::QueryDisplayConfig(uint32_t flags) {
+  std::vector<DISPLAYCONFIG_PATH_INFO> paths;
+  std::vector<DISPLAYCONFIG_MODE_INFO> modes;
+
+  // The configuration can change between getting the sizes and querying
+  unsigned int tries = 0;
+  do {
+    UINT32 numPaths {};
+    UINT32 numModes {};
+
+    auto result = GetDisplayConfigBufferSizes(flags, &numPaths, &numModes);
+    if (result != ERROR_SUCCESS) {
+      throw GetDisplayConfigBufferSizesError(std::format(
+        "GetDisplayConfigBufferSizes() failed with error {}", result));
+    }
+    paths.resize(numPaths);
+    modes.resize(numModes);
+
+    // Required for, and only allowed with, `QDC_DATABASE_CURRENT`
+    DISPLAYCONFIG_TOPOLOGY_ID topology {};
+    result = ::QueryDisplayConfig(
+      flags,
+      &numPaths,
+      paths.data(),
+      &numModes,
+      modes.data(),
+      (flags & QDC_DATABASE_CURRENT) ? &topology : nullptr);
+    if (result == ERROR_SUCCESS) {
+      paths.resize(numPaths);
+      modes.resize(numModes);
+      return {paths, modes};
+    }
+  } while (++tries < 5);
+  throw QueryDisplayConfigError("QueryDisplayConfig() failed 5 times");
+}
+
+void Win32DisplayBackend::SetDisplayConfig(
+  const DisplayConfig& config,
+  uint32_t flags) {
+  // Copy as `::SetDisplayConfig()` takes non-const pointers
+  auto paths = config.mPaths;
+  auto modes = config.mModes;
+
+  const auto result = ::SetDisplayConfig(
+    paths.size(), paths.data(), modes.size(), modes.data(), flags);
+  if (result != ERROR_SUCCESS) {
+    throw SetDisplayConfigError(
+      std::format("SetDisplayConfig() failed with {}", result));
+  }
+}
+
+std::vector<AdapterInfo> Win32DisplayBackend::EnumAdapters() {
+  winrt::com_ptr<IDXGIFactory6> dxgi;
+  winrt::check_hresult(CreateDXGIFactory2(0, IID_PPV_ARGS(dxgi.put())));
+
+  std::vector<AdapterInfo> ret;
+
+  winrt::com_ptr<IDXGIAdapter1> it;
+  // Enum by HIGH_PERFORMANCE so that for GPUs, the order does not depend on
+  // current power profile
+  for (size_t i = 0;
+       dxgi->EnumAdapterByGpuPreference(
+         i, DXGI_GPU_PREFERENCE_HIGH_PERFORMANCE, IID_PPV_ARGS(it.put()))
+       == S_OK;
+       ++i) {
+    AdapterInfo info;
+    it->GetDesc1(&info.mDesc);
+    // Only succeeds for `IDXGIDevice`, and doesn't create a device
+    LARGE_INTEGER umdVersion {};
+    if (SUCCEEDED(
+          it->CheckInterfaceSupport(__uuidof(IDXGIDevice), &umdVersion))) {
+      info.mDriverVersion = static_cast<uint64_t>(umdVersion.QuadPart);
+    }
+    it = {};
+    ret.push_back(info);
+  }
+  return ret;
+}
+
+std::string Win32DisplayBackend::GetOSVersion() {
+  // Includes the update revision, as updates can change validation behavior
+  static const auto sVersion = []() -> std::string {
+    constexpr auto key = L"SOFTWARE\\Microsoft\\Windows NT\\CurrentVersion";
+    wchar_t build[32] {};
+    DWORD buildSize = sizeof(build);
+    DWORD revision {};
+    DWORD revisionSize = sizeof(revision);
+    if (
+      RegGetValueW(
+        HKEY_LOCAL_MACHINE,
+        key,
+        L"CurrentBuildNumber",
+        RRF_RT_REG_SZ,
+        nullptr,
+        build,
+        &buildSize)
+      != ERROR_SUCCESS) {
+      return {};
+    }
+    RegGetValueW(
+      HKEY_LOCAL_MACHINE,
+      key,
+      L"UBR",
+      RRF_RT_REG_DWORD,
+      nullptr,
+      &revision,
+      &revisionSize);
+    return std::format("{}.{}", winrt::to_string(build), revision);
+  }();
+  return sVersion;
+}
+
+}// namespace FredEmmott::MonitorTool
@@ -0,0 +1,38 @@
+// Copyright 2024, Fred Emmott
+// SPDX-License-Identifier: ISC
+#pragma once
+
+#include "DisplayConfigFingerprint.hpp"
+#include "Profile.hpp"
+
+#include <string>
+#include <vector>
+
+namespace FredEmmott::MonitorTool {
+
+/** Saved profiles with this fingerprint.
+ *
+ * Looked up in the store's index, so profiles are only fully loaded if they
+ * were saved without a fingerprint; for directory stores, only when they've
+ * changed since they were last indexed.
+ */
+std::vector<ProfileSummary> FindProfilesByFingerprint(
+  const DisplayConfigFingerprint&);
+
+/** Saved profiles matching the active display configuration.
+ *
+ * Usually zero or one, but there can be several if profiles have the same
+ * configuration.
+ */
+std::vector<ProfileSummary> FindActiveProfiles();
+
+/** The name after the first active profile in `names`, wrapping around.
+ *
+ * Returns the first name if none of them are active. Names are compared as in
+ * `ProfileStore::FindByName()`.
+ */
+std::string GetNextProfileName(
+  const std::vector<std::string>& names,
+  const std::vector<ProfileSummary>& active);
+
+}// namespace FredEmmott::MonitorTool
@@ -0,0 +1,57 @@
+// Copyright 2024, Fred Emmott
+// SPDX-License-Identifier: ISC
+#pragma once
+
+#include <cstdint>
+#include <optional>
+#include <vector>
+
+#include <Windows.h>
+#include <dxgi.h>
+
+namespace FredEmmott::MonitorTool {
+
+/// Saved adapter LUIDs, and the current adapters they correspond to
+class AdapterRemapTable final {
+ public:
+  struct Entry {
+    LUID mSaved {};
+    LUID mCurrent {};
+    /// Higher is a closer match; see `MatchAdapters()`
+    int32_t mScore {};
+  };
+
+  AdapterRemapTable() = default;
+  explicit AdapterRemapTable(std::vector<Entry> entries);
+
+  /// Nothing if the saved adapter has no counterpart
+  std::optional<LUID> Find(const LUID& saved) const noexcept;
+
+  const std::vector<Entry>& GetEntries() const noexcept;
+
+ private:
+  // Sorted by `mSaved`
+  std::vector<Entry> mEntries;
+};
+
+/** Decide which current adapter each saved adapter has become.
+ *
+ * Adapters are only matched within the same vendor, and remote or software
+ * adapters only match adapters of the same kind; otherwise, matches are
+ * scored by how many of the device ID, subsystem ID, dedicated memory, flags,
+ * and LUID agree, and the assignment with the highest total score is chosen
+ * for the whole set at once. Among equally good matches, the Nth adapter of a
+ * model maps to the Nth current adapter of that model.
+ *
+ * Results are cached in memory by the fingerprint of both adapter sets.
+ */
+AdapterRemapTable MatchAdapters(
+  const std::vector<DXGI_ADAPTER_DESC1>& saved,
+  const std::vector<DXGI_ADAPTER_DESC1>& current);
+
+/// `MatchAdapters()` without the cache
+AdapterRemapTable CreateAdapterRemapTable(
+  const std::vector<DXGI_ADAPTER_DESC1>& saved,
+  const std::vector<DXGI_ADAPTER_DESC1>& current);
+
+}// namespace FredEmmott::MonitorTool
@@ -0,0 +1,166 @@
+// Copyright 2024, Fred Emmott
+// SPDX-License-Identifier: ISC
+#pragma once
+
+#include "EnumAdapterDescs.hpp"
+#include "Profile.hpp"
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <string_view>
+#include <vector>
+
+#include <dxgi.h>
+
+namespace FredEmmott::MonitorTool {
+
+/// How long each stage of applying a profile took
+struct ApplyTimings {
+  using Duration = std::chrono::steady_clock::duration;
+
+  /// Querying the active configuration and the adapters, concurrently
+  Duration mGather {};
+  /// Building candidate configurations
+  Duration mPlan {};
+  /// Validating candidates with Windows
+  Duration mValidate {};
+  /// The mode set, if any
+  Duration mApply {};
+};
+
+/** Identifies a profile on a specific system; see `ValidationCache.hpp`.
+ *
+ * The system hash covers the OS build, the adapters (including their LUIDs
+ * and driver versions), and the connected displays.
+ */
+struct ValidationCacheKey {
+  uint64_t mProfileHash {};
+  uint64_t mSystemHash {};
+
+  bool operator==(const ValidationCacheKey&) const = default;
+};
+
+/// What planning depends on, other than the profile
+struct ApplySystemState {
+  /// Queries concurrently
+  static ApplySystemState GetCurrent();
+  /// Queries the display configuration, with adapters that are already known
+  static ApplySystemState GetCurrent(std::vector<AdapterInfo> adapters);
+
+  DisplayConfig mCurrent;
+  /// Includes inactive paths, i.e. `QDC_ALL_PATHS`
+  DisplayConfig mAllPaths;
+  std::vector<AdapterInfo> mAdapters;
+};
+
+/** A profile, adapted to the current system and validated.
+ *
+ * Created by `PlanApply()`; the system is only queried while planning, so a
+ * plan should be executed promptly.
+ */
+struct ApplyPlan {
+  enum class Strategy {
+    /// The profile can't be applied due to a configuration change
+    None,
+    AsSaved,
+    /// An adapterless profile, moved to the only real GPU
+    SingleGPU,
+    /// The profile's adapter LUIDs remapped to the current adapters
+    RemappedLUIDs,
+  };
+
+  /// The profile that was planned, before any fixups
+  Profile mSource;
+  Strategy mStrategy {Strategy::None};
+  /** The winning candidate, if any.
+   *
+   * Candidates that are already active win without being validated.
+   */
+  std::optional<Profile> mProfile;
+  /// From the active configuration to `mProfile`; see `DiffDisplayConfig()`
+  std::vector<std::string> mDifferences;
+  /// The active configuration when planning
+  DisplayConfig mCurrent;
+  std::vector<DXGI_ADAPTER_DESC1> mAdapters;
+
+  ValidationCacheKey mCacheKey;
+  /// See `GetDriverVersionHash()`
+  uint64_t mDriverVersionHash {};
+  /// The winner is the last known-good candidate, and wasn't validated again
+  bool mFromCache {false};
+  /// Each candidate is validated at most once
+  std::size_t mValidationCount {0};
+  ApplyTimings mTimings;
+};
+
+std::string_view ToString(ApplyPlan::Strategy);
+
+/** Work out how to apply a profile, adapting it to the current graphics
+ * adapters if needed.
+ *
+ * Adapter LUIDs change across reboots and driver updates; if the profile can't
+ * be applied as-is, its LUIDs are remapped to the current adapters.
+ *
+ * The active configuration and adapters are queried once, concurrently;
+ * candidates are then validated in order of preference until one passes. If
+ * a candidate passed for this profile on this system before, it's used
+ * without validating anything, unless `useValidationCache` is false.
+ */
+ApplyPlan PlanApply(const Profile&, bool useValidationCache = true);
+
+/** Plan against a system state that has already been queried.
+ *
+ * Safe to call from several threads at once; only the validation calls
+ * themselves are serialized. `mTimings.mGather` is left as zero.
+ */
+ApplyPlan PlanApply(
+  const Profile&,
+  const ApplySystemState&,
+  bool useValidationCache = true);
+
+/** Plans several profiles in one process, e.g. for a script.
+ *
+ * The adapters are enumerated for the first plan, and reused by later ones;
+ * the display configuration is queried for every plan, as applying a profile
+ * changes it. If a profile can't be applied with the known adapters, they're
+ * enumerated again and the profile is planned again, in case a GPU was added
+ * or removed, or a driver was updated.
+ *
+ * Validation results are shared through the validation cache, as usual.
+ */
+class ApplySession final {
+ public:
+  ApplyPlan Plan(const Profile&);
+
+ private:
+  std::optional<std::vector<AdapterInfo>> mAdapters;
+};
+
+/** Apply the winning candidate without validating it again.
+ *
+ * The outcome and timings are recorded with `RecordApplyStats()`.
+ *
+ * If `saveUpdates` is true and the profile was remapped, the updated profile is
+ * saved.
+ *
+ * If the winner came from the validation cache and Windows rejects it, the
+ * cache entry is removed, and the profile is planned again without the cache.
+ *
+ * Returns nothing if the plan has no candidate; updates `plan`.
+ */
+std::optional<ApplyResult>
+ExecuteApplyPlan(ApplyPlan& plan, ApplyMode, bool saveUpdates);
+
+/** `PlanApply()` followed by `ExecuteApplyPlan()`.
+ *
+ * Returns nothing if the profile can't be applied due to a configuration
+ * change.
+ */
+std::optional<ApplyResult> ApplyProfileWithAdapterFixups(
+  const Profile&,
+  ApplyMode,
+  bool saveUpdates);
+
+}// namespace FredEmmott::MonitorTool
@@ -0,0 +1,93 @@
+// Copyright 2024, Fred Emmott
+// SPDX-License-Identifier: ISC
+#pragma once
+
+#include "ApplyProfile.hpp"
+
+#include <winrt/base.h>
+
+#include <array>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+#include <vector>
+
+namespace FredEmmott::MonitorTool {
+
+/** Per-profile apply latency histograms, kept in the data folder.
+ *
+ * Each profile has a fixed-size file, with a set of histograms per OS and
+ * driver version (`GetDriverVersionHash()`), so slowdowns after an update are
+ * visible; only the most recent few versions are kept.
+ *
+ * Files are memory-mapped and updated with atomic increments, so concurrent
+ * processes can record to the same file without locking.
+ */
+
+enum class ApplyOutcome : uint32_t {
+  /// The profile was already active
+  Unchanged,
+  Applied,
+  /// No candidate passed validation
+  CannotApply,
+  /// Windows rejected the mode set, or something else threw
+  Failed,
+};
+constexpr std::size_t ApplyOutcomeCount = 4;
+
+enum class ApplyPhase : uint32_t {
+  Gather,
+  Plan,
+  Validate,
+  Apply,
+  /// The sum of the other phases
+  Total,
+};
+constexpr std::size_t ApplyPhaseCount = 5;
+
+std::string_view ToString(ApplyOutcome);
+std::string_view ToString(ApplyPhase);
+
+/** Log-linear buckets: four per power of two, so within 25%.
+ *
+ * Covers up to about two hours; longer durations are counted in the last
+ * bucket.
+ */
+struct LatencyHistogram {
+  using Duration = std::chrono::microseconds;
+  static constexpr std::size_t BucketCount = 128;
+
+  static std::size_t GetBucket(Duration) noexcept;
+  /// Exclusive
+  static Duration GetBucketUpperBound(std::size_t bucket) noexcept;
+
+  uint64_t GetCount() const noexcept;
+  /** Upper bound of the bucket containing the `percentile`th duration.
+   *
+   * `percentile` is 0-100; returns zero if the histogram is empty.
+   */
+  Duration GetPercentile(double percentile) const noexcept;
+
+  std::array<uint32_t, BucketCount> mBuckets {};
+};
+
+/// Statistics for a profile on one OS and driver version
+struct ApplyStats {
+  using TimePoint = std::chrono::system_clock::time_point;
+
+  winrt::guid mGuid;
+  uint64_t mDriverVersionHash {};
+  TimePoint mFirstApplied;
+  TimePoint mLastApplied;
+  std::array<uint32_t, ApplyOutcomeCount> mOutcomes {};
+  std::array<LatencyHistogram, ApplyPhaseCount> mPhases {};
+};
+
+/// Best-effort; statistics are never worth failing an apply over
+void RecordApplyStats(const ApplyPlan&, ApplyOutcome) noexcept;
+
+/// Every recorded profile and driver version, ordered by first use
+std::vector<ApplyStats> LoadApplyStats();
+
+}// namespace FredEmmott::MonitorTool
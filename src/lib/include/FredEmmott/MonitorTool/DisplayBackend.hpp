@@ -0,0 +1,63 @@
+// Copyright 2024, Fred Emmott
+// SPDX-License-Identifier: ISC
+#pragma once
+
+#include "DisplayConfig.hpp"
+#include "EnumAdapterDescs.hpp"
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace FredEmmott::MonitorTool {
+
+/** The operating system calls that query or change displays.
+ *
+ * `QueryDisplayConfig()`, `SetDisplayConfig()`, and `EnumAdapters()` use the
+ * current backend; this is `Win32DisplayBackend` unless it's been replaced,
+ * e.g. by a `SimulatedDisplayBackend` for benchmarks and load tests.
+ *
+ * There is no default on other platforms, so one must be set before any
+ * display calls are made.
+ *
+ * Implementations must be safe to call from several threads at once.
+ */
+class DisplayBackend {
+ public:
+  virtual ~DisplayBackend() = default;
+
+  /// As `::QueryDisplayConfig()`; `flags` are `QDC_*`
+  virtual DisplayConfig QueryDisplayConfig(uint32_t flags) = 0;
+  /** As `::SetDisplayConfig()`; `flags` are `SDC_*`.
+   *
+   * Throws `SetDisplayConfigError` if the configuration is rejected, including
+   * when only validating.
+   */
+  virtual void SetDisplayConfig(const DisplayConfig&, uint32_t flags) = 0;
+  /// Ordered for high performance, so that the order is stable
+  virtual std::vector<AdapterInfo> EnumAdapters() = 0;
+  /// e.g. `22631.4169`; updates can change what configurations are valid
+  virtual std::string GetOSVersion() = 0;
+};
+
+#ifdef _WIN32
+class Win32DisplayBackend final : public DisplayBackend {
+ public:
+  DisplayConfig QueryDisplayConfig(uint32_t flags) override;
+  void SetDisplayConfig(const DisplayConfig&, uint32_t flags) override;
+  std::vector<AdapterInfo> EnumAdapters() override;
+  std::string GetOSVersion() override;
+};
+#endif
+
+std::shared_ptr<DisplayBackend> GetDisplayBackend();
+
+/** Replace the backend for the whole process.
+ *
+ * Calls that are already in progress finish with the previous backend.
+ * Passing null restores the default.
+ */
+void SetDisplayBackend(std::shared_ptr<DisplayBackend>);
+
+}// namespace FredEmmott::MonitorTool
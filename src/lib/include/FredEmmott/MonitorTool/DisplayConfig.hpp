@@ -1,8 +1,10 @@
 // Copyright 2024, Fred Emmott
 // SPDX-License-Identifier: ISC
 #pragma once
+
+#include "DisplayConfigSchema.hpp"
+
 #include <algorithm>
-#include <cstring>
 #include <vector>
 
 #include <Windows.h>
@@ -14,22 +16,22 @@ struct DisplayConfig {
   std::vector<DISPLAYCONFIG_MODE_INFO> mModes;
 
   inline bool operator==(const DisplayConfig& other) const noexcept {
+    // Not `memcmp()`, as that would compare padding and inactive union members
     return std::ranges::equal(
-             mPaths,
-             other.mPaths,
-             [](
-               const DISPLAYCONFIG_PATH_INFO& a,
-               const DISPLAYCONFIG_PATH_INFO& b) {
-               return memcmp(&a, &b, sizeof(a)) == 0;
-             })
+             mPaths, other.mPaths, &FieldsEqual<DISPLAYCONFIG_PATH_INFO>)
       && std::ranges::equal(
-             mModes,
-             other.mModes,
-             [](
-               const DISPLAYCONFIG_MODE_INFO& a,
-               const DISPLAYCONFIG_MODE_INFO& b) {
-               return memcmp(&a, &b, sizeof(a)) == 0;
-             });
+             mModes, other.mModes, &FieldsEqual<DISPLAYCONFIG_MODE_INFO>);
+  }
+
+  /// Call `fn(LUID&)` for every adapter LUID in the paths and modes
+  template <class F>
+  void VisitLUIDs(F&& fn) {
+    for (auto& path: mPaths) {
+      MonitorTool::VisitLUIDs(path, fn);
+    }
+    for (auto& mode: mModes) {
+      MonitorTool::VisitLUIDs(mode, fn);
+    }
   }
 };
 
@@ -0,0 +1,27 @@
+// Copyright 2024, Fred Emmott
+// SPDX-License-Identifier: ISC
+#pragma once
+
+#include "DisplayConfig.hpp"
+
+#include <string>
+#include <vector>
+
+namespace FredEmmott::MonitorTool {
+
+/** What would change if `target` was applied on top of `current`.
+ *
+ * Paths are matched by source and target rather than by position, and
+ * compared along with the modes they refer to. Volatile fields - status
+ * flags, target availability, and mode indices - are ignored.
+ *
+ * Each entry describes one path, e.g.
+ * `Paths[1] (target 4353): targetInfo.refreshRate, sourceMode.position.x`.
+ *
+ * Returns an empty vector if `target` is already active.
+ */
+std::vector<std::string> DiffDisplayConfig(
+  const DisplayConfig& current,
+  const DisplayConfig& target);
+
+}// namespace FredEmmott::MonitorTool
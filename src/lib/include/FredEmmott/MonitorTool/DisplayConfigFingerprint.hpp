@@ -0,0 +1,49 @@
+// Copyright 2024, Fred Emmott
+// SPDX-License-Identifier: ISC
+#pragma once
+
+#include "DisplayConfig.hpp"
+
+#include <compare>
+#include <cstdint>
+#include <functional>
+#include <optional>
+#include <string>
+#include <string_view>
+
+namespace FredEmmott::MonitorTool {
+
+/** 128-bit hash of a display configuration, for finding matching profiles.
+ *
+ * Configurations that `DiffDisplayConfig()` considers equal have the same
+ * fingerprint: paths are hashed with their modes, without volatile fields,
+ * and in a canonical order.
+ *
+ * Adapter LUIDs are excluded, as they change across reboots; a profile still
+ * matches after its LUIDs have been updated.
+ */
+struct DisplayConfigFingerprint {
+  uint64_t mHigh {};
+  uint64_t mLow {};
+
+  /// 32 hex digits
+  std::string ToString() const;
+  static std::optional<DisplayConfigFingerprint> FromString(std::string_view);
+
+  auto operator<=>(const DisplayConfigFingerprint&) const = default;
+};
+
+/// MurmurHash3 x64_128 of the canonical form
+DisplayConfigFingerprint GetDisplayConfigFingerprint(const DisplayConfig&);
+
+}// namespace FredEmmott::MonitorTool
+
+template <>
+struct std::hash<FredEmmott::MonitorTool::DisplayConfigFingerprint> {
+  std::size_t operator()(
+    const FredEmmott::MonitorTool::DisplayConfigFingerprint& v)
+    const noexcept {
+    // Already a good hash
+    return static_cast<std::size_t>(v.mLow);
+  }
+};
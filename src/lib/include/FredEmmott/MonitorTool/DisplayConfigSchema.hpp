@@ -0,0 +1,191 @@
+// Copyright 2024, Fred Emmott
+// SPDX-License-Identifier: ISC
+#pragma once
+
+#include "FieldSchema.hpp"
+
+#include <algorithm>
+#include <string_view>
+
+#include <Windows.h>
+#include <dxgi.h>
+
+/* Field schemas for every struct we persist.
+ *
+ * JSON serialization, hashing, equality, diffing and LUID remapping are all
+ * generated from these, so adding a field here is all that's needed. */
+
+namespace FredEmmott::MonitorTool {
+
+template <>
+struct FieldSchema<POINTL> {
+  using T = POINTL;
+  static constexpr std::tuple Fields {
+    FMT_SCHEMA_FIELD(x),
+    FMT_SCHEMA_FIELD(y),
+  };
+};
+
+template <>
+struct FieldSchema<RECTL> {
+  using T = RECTL;
+  static constexpr std::tuple Fields {
+    FMT_SCHEMA_FIELD(left),
+    FMT_SCHEMA_FIELD(top),
+    FMT_SCHEMA_FIELD(right),
+    FMT_SCHEMA_FIELD(bottom),
+  };
+};
+
+template <>
+struct FieldSchema<DISPLAYCONFIG_RATIONAL> {
+  using T = DISPLAYCONFIG_RATIONAL;
+  static constexpr std::tuple Fields {
+    FMT_SCHEMA_FIELD(Numerator),
+    FMT_SCHEMA_FIELD(Denominator),
+  };
+};
+
+template <>
+struct FieldSchema<DISPLAYCONFIG_2DREGION> {
+  using T = DISPLAYCONFIG_2DREGION;
+  static constexpr std::tuple Fields {
+    FMT_SCHEMA_FIELD(cx),
+    FMT_SCHEMA_FIELD(cy),
+  };
+};
+
+template <>
+struct FieldSchema<DXGI_ADAPTER_DESC1> {
+  using T = DXGI_ADAPTER_DESC1;
+  static constexpr std::tuple Fields {
+    MakeField<T>(
+      "Description",
+      [](const T& v) {
+        return std::wstring_view {
+          v.Description, wcsnlen_s(v.Description, std::size(v.Description))};
+      },
+      [](T& v, std::wstring_view value) {
+        wcsncpy_s(
+          v.Description,
+          value.data(),
+          std::min(value.size(), std::size(v.Description) - 1));
+      }),
+    FMT_SCHEMA_FIELD(VendorId),
+    FMT_SCHEMA_FIELD(DeviceId),
+    FMT_SCHEMA_FIELD(SubSysId),
+    FMT_SCHEMA_FIELD(Revision),
+    FMT_SCHEMA_FIELD(DedicatedVideoMemory),
+    FMT_SCHEMA_FIELD(AdapterLuid),
+    FMT_SCHEMA_FIELD(Flags),
+  };
+};
+
+template <>
+struct FieldSchema<DISPLAYCONFIG_PATH_SOURCE_INFO> {
+  using T = DISPLAYCONFIG_PATH_SOURCE_INFO;
+  static constexpr std::tuple Fields {
+    FMT_SCHEMA_FIELD(adapterId),
+    FMT_SCHEMA_FIELD(id),
+    // Bitfields in a union with `modeInfoIdx`
+    FMT_SCHEMA_FIELD(cloneGroupId),
+    FMT_SCHEMA_FIELD(sourceModeInfoIdx),
+    FMT_SCHEMA_FIELD(statusFlags),
+  };
+};
+
+template <>
+struct FieldSchema<DISPLAYCONFIG_PATH_TARGET_INFO> {
+  using T = DISPLAYCONFIG_PATH_TARGET_INFO;
+  static constexpr std::tuple Fields {
+    FMT_SCHEMA_FIELD(adapterId),
+    FMT_SCHEMA_FIELD(id),
+    // Bitfields in a union with `modeInfoIdx`
+    FMT_SCHEMA_FIELD(desktopModeInfoIdx),
+    FMT_SCHEMA_FIELD(targetModeInfoIdx),
+    FMT_SCHEMA_FIELD(outputTechnology),
+    FMT_SCHEMA_FIELD(rotation),
+    FMT_SCHEMA_FIELD(scaling),
+    FMT_SCHEMA_FIELD(refreshRate),
+    FMT_SCHEMA_FIELD(scanLineOrdering),
+    FMT_SCHEMA_FIELD(targetAvailable),
+    FMT_SCHEMA_FIELD(statusFlags),
+  };
+};
+
+template <>
+struct FieldSchema<DISPLAYCONFIG_PATH_INFO> {
+  using T = DISPLAYCONFIG_PATH_INFO;
+  static constexpr std::tuple Fields {
+    FMT_SCHEMA_FIELD(sourceInfo),
+    FMT_SCHEMA_FIELD(targetInfo),
+    FMT_SCHEMA_FIELD(flags),
+  };
+};
+
+static_assert(
+  sizeof(DISPLAYCONFIG_VIDEO_SIGNAL_INFO::AdditionalSignalInfo)
+  == sizeof(DISPLAYCONFIG_VIDEO_SIGNAL_INFO::videoStandard));
+template <>
+struct FieldSchema<DISPLAYCONFIG_VIDEO_SIGNAL_INFO> {
+  using T = DISPLAYCONFIG_VIDEO_SIGNAL_INFO;
+  static constexpr std::tuple Fields {
+    FMT_SCHEMA_FIELD(pixelRate),
+    FMT_SCHEMA_FIELD(hSyncFreq),
+    FMT_SCHEMA_FIELD(vSyncFreq),
+    FMT_SCHEMA_FIELD(activeSize),
+    FMT_SCHEMA_FIELD(totalSize),
+    // Covers `AdditionalSignalInfo` too
+    FMT_SCHEMA_FIELD(videoStandard),
+    FMT_SCHEMA_FIELD(scanLineOrdering),
+  };
+};
+
+template <>
+struct FieldSchema<DISPLAYCONFIG_TARGET_MODE> {
+  using T = DISPLAYCONFIG_TARGET_MODE;
+  static constexpr std::tuple Fields {
+    FMT_SCHEMA_FIELD(targetVideoSignalInfo),
+  };
+};
+
+template <>
+struct FieldSchema<DISPLAYCONFIG_SOURCE_MODE> {
+  using T = DISPLAYCONFIG_SOURCE_MODE;
+  static constexpr std::tuple Fields {
+    FMT_SCHEMA_FIELD(width),
+    FMT_SCHEMA_FIELD(height),
+    FMT_SCHEMA_FIELD(pixelFormat),
+    FMT_SCHEMA_FIELD(position),
+  };
+};
+
+template <>
+struct FieldSchema<DISPLAYCONFIG_DESKTOP_IMAGE_INFO> {
+  using T = DISPLAYCONFIG_DESKTOP_IMAGE_INFO;
+  static constexpr std::tuple Fields {
+    FMT_SCHEMA_FIELD(PathSourceSize),
+    FMT_SCHEMA_FIELD(DesktopImageRegion),
+    FMT_SCHEMA_FIELD(DesktopImageClip),
+  };
+};
+
+template <>
+struct FieldSchema<DISPLAYCONFIG_MODE_INFO> {
+  using T = DISPLAYCONFIG_MODE_INFO;
+  // `infoType` must come first, as it selects the union member
+  static constexpr std::tuple Fields {
+    FMT_SCHEMA_FIELD(infoType),
+    FMT_SCHEMA_FIELD(id),
+    FMT_SCHEMA_FIELD(adapterId),
+    FMT_SCHEMA_UNION_FIELD(
+      targetMode, v.infoType == DISPLAYCONFIG_MODE_INFO_TYPE_TARGET),
+    FMT_SCHEMA_UNION_FIELD(
+      sourceMode, v.infoType == DISPLAYCONFIG_MODE_INFO_TYPE_SOURCE),
+    FMT_SCHEMA_UNION_FIELD(
+      desktopImageInfo,
+      v.infoType == DISPLAYCONFIG_MODE_INFO_TYPE_DESKTOP_IMAGE),
+  };
+};
+
+}// namespace FredEmmott::MonitorTool
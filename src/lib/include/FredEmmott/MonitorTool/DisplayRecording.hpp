@@ -0,0 +1,159 @@
+// Copyright 2024, Fred Emmott
+// SPDX-License-Identifier: ISC
+#pragma once
+
+#include "DisplayBackend.hpp"
+#include "except.hpp"
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace FredEmmott::MonitorTool {
+
+/** Recordings of display API calls, for reproducing field issues.
+ *
+ * `RecordingDisplayBackend` captures every call on a real system, with its
+ * inputs, outputs, errors, and duration; `ReplayDisplayBackend` serves the
+ * recording back, so that planning on a specific multi-GPU system can be
+ * debugged and benchmarked without it.
+ *
+ * Recordings are a binary header followed by one record per call, in the
+ * order calls finished. Display configurations are stored as-is, as they have
+ * the same layout on Windows and other little-endian 64-bit platforms;
+ * adapters are stored with UTF-16 descriptions, whatever `WCHAR` is, so a
+ * recording from a Windows machine can be replayed on Linux.
+ */
+
+class DisplayRecordingError final : public RuntimeError {
+ public:
+  using RuntimeError::RuntimeError;
+};
+
+/// A replayed call doesn't match anything in the recording
+class DisplayReplayError final : public RuntimeError {
+ public:
+  using RuntimeError::RuntimeError;
+};
+
+struct DisplayCall {
+  using Duration = std::chrono::nanoseconds;
+
+  enum class Kind : uint32_t {
+    QueryDisplayConfig,
+    SetDisplayConfig,
+    EnumAdapters,
+    GetOSVersion,
+  };
+  /// Which exception the call threw, if any
+  enum class Error : uint32_t {
+    None,
+    GetDisplayConfigBufferSizes,
+    QueryDisplayConfig,
+    SetDisplayConfig,
+  };
+
+  Kind mKind {};
+  /// `QDC_*` or `SDC_*`
+  uint32_t mFlags {};
+  Duration mDuration {};
+  Error mError {Error::None};
+
+  /// The result of a query, or what was passed to `SetDisplayConfig()`
+  DisplayConfig mConfig;
+  std::vector<AdapterInfo> mAdapters;
+  /// The OS version, or the error message
+  std::string mString;
+};
+
+struct DisplayRecording {
+  std::vector<DisplayCall> mCalls;
+
+  /** Throws `DisplayRecordingError` if it's not a recording.
+   *
+   * A truncated final record, e.g. if the recording process crashed, is
+   * ignored.
+   */
+  static DisplayRecording Load(const std::filesystem::path&);
+};
+
+/** Forwards to another backend, appending each call to a recording.
+ *
+ * Each call is flushed as it finishes, so the recording is usable even if the
+ * process crashes or is terminated.
+ */
+class RecordingDisplayBackend final : public DisplayBackend {
+ public:
+  /// Throws `DisplayRecordingError` if the file can't be created
+  RecordingDisplayBackend(
+    std::shared_ptr<DisplayBackend> inner,
+    const std::filesystem::path& path);
+
+  DisplayConfig QueryDisplayConfig(uint32_t flags) override;
+  void SetDisplayConfig(const DisplayConfig&, uint32_t flags) override;
+  std::vector<AdapterInfo> EnumAdapters() override;
+  std::string GetOSVersion() override;
+
+ private:
+  std::shared_ptr<DisplayBackend> mInner;
+  std::mutex mMutex;
+  std::ofstream mStream;
+
+  void Write(const DisplayCall&);
+  /// Times `fn`, which fills in the outputs, then writes the call
+  template <class F>
+  void Record(DisplayCall&, F&& fn);
+};
+
+enum class ReplayTiming {
+  /// Return immediately, to measure our own overhead
+  Instant,
+  /// Sleep for as long as each call originally took
+  Recorded,
+};
+
+/** Serves the calls from a recording, deterministically.
+ *
+ * Each call is answered by the earliest unused recorded call with the same
+ * kind and flags, so queries get their answers in the order they were
+ * recorded; once they run out, the last answer is repeated, as the system
+ * was left in that state.
+ *
+ * `SetDisplayConfig()` calls must also match the configuration, so candidates
+ * can be validated in a different order than when recording. Calls that
+ * weren't recorded throw `DisplayReplayError`, as there's no way to know what
+ * Windows would have said.
+ */
+class ReplayDisplayBackend final : public DisplayBackend {
+ public:
+  ReplayDisplayBackend(
+    std::shared_ptr<const DisplayRecording>,
+    ReplayTiming = ReplayTiming::Instant);
+
+  DisplayConfig QueryDisplayConfig(uint32_t flags) override;
+  void SetDisplayConfig(const DisplayConfig&, uint32_t flags) override;
+  std::vector<AdapterInfo> EnumAdapters() override;
+  std::string GetOSVersion() override;
+
+ private:
+  std::shared_ptr<const DisplayRecording> mRecording;
+  ReplayTiming mTiming;
+  std::mutex mMutex;
+  /// Which calls have been served
+  std::vector<bool> mUsed;
+
+  /// Throws `DisplayReplayError` if nothing matches
+  const DisplayCall& Find(
+    DisplayCall::Kind,
+    uint32_t flags,
+    const DisplayConfig* config = nullptr);
+  void Replay(const DisplayCall&) const;
+};
+
+}// namespace FredEmmott::MonitorTool
@@ -2,6 +2,7 @@
 // SPDX-License-Identifier: ISC
 #pragma once
 
+#include <cstdint>
 #include <vector>
 
 #include <Windows.h>
@@ -9,6 +10,14 @@
 
 namespace FredEmmott::MonitorTool {
 
+struct AdapterInfo {
+  DXGI_ADAPTER_DESC1 mDesc {};
+  /// User-mode driver version, or 0 if unknown
+  uint64_t mDriverVersion {};
+};
+
 std::vector<DXGI_ADAPTER_DESC1> EnumAdapterDescs();
+/// `EnumAdapterDescs()`, with driver versions
+std::vector<AdapterInfo> EnumAdapters();
 
-}
\ No newline at end of file
+}
@@ -0,0 +1,305 @@
+// Copyright 2024, Fred Emmott
+// SPDX-License-Identifier: ISC
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <concepts>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <numeric>
+#include <string>
+#include <string_view>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include <Windows.h>
+
+namespace FredEmmott::MonitorTool {
+
+/** Compile-time description of the fields of a Win32 struct.
+ *
+ * Specializations have a `static constexpr std::tuple Fields`, in the order
+ * fields should be read; use `FMT_SCHEMA_FIELD()` and
+ * `FMT_SCHEMA_UNION_FIELD()` to create them.
+ *
+ * Fields are accessed through lambdas rather than member pointers, as member
+ * pointers can't refer to bitfields.
+ */
+template <class T>
+struct FieldSchema;
+
+template <class T>
+concept HasFieldSchema = requires { FieldSchema<T>::Fields; };
+
+struct AlwaysPresent {
+  constexpr bool operator()(const auto&) const noexcept {
+    return true;
+  }
+};
+
+template <class TStruct, class TGet, class TSet, class TIsPresent>
+struct Field {
+  using Struct = TStruct;
+  using Value = std::remove_cvref_t<std::invoke_result_t<TGet, const TStruct&>>;
+
+  std::string_view mName;
+  TGet mGet;
+  TSet mSet;
+  // For union members; only one member is present at a time
+  TIsPresent mIsPresent;
+
+  constexpr Value Get(const TStruct& v) const {
+    return mGet(v);
+  }
+
+  constexpr void Set(TStruct& v, const Value& value) const {
+    mSet(v, value);
+  }
+
+  constexpr bool IsPresent(const TStruct& v) const {
+    return mIsPresent(v);
+  }
+};
+
+template <class T, class TGet, class TSet, class TIsPresent = AlwaysPresent>
+constexpr auto MakeField(
+  std::string_view name,
+  TGet get,
+  TSet set,
+  TIsPresent isPresent = {}) {
+  return Field<T, TGet, TSet, TIsPresent> {name, get, set, isPresent};
+}
+
+/// Requires `T` to be an alias for the struct type
+#define FMT_SCHEMA_FIELD(FIELD) \
+  ::FredEmmott::MonitorTool::MakeField<T>( \
+    #FIELD, \
+    [](const T& v) { return v.FIELD; }, \
+    [](T& v, const auto& value) { v.FIELD = value; })
+
+/// `CONDITION` is evaluated with `v` as the struct
+#define FMT_SCHEMA_UNION_FIELD(FIELD, CONDITION) \
+  ::FredEmmott::MonitorTool::MakeField<T>( \
+    #FIELD, \
+    [](const T& v) { return v.FIELD; }, \
+    [](T& v, const auto& value) { v.FIELD = value; }, \
+    [](const T& v) { return CONDITION; })
+
+template <HasFieldSchema T>
+constexpr std::size_t FieldCount
+  = std::tuple_size_v<std::remove_cvref_t<decltype(FieldSchema<T>::Fields)>>;
+
+/// Call `fn(field)` for each field, in declaration order
+template <HasFieldSchema T, class F>
+constexpr void ForEachField(F&& fn) {
+  std::apply(
+    [&fn](const auto&... fields) { (fn(fields), ...); },
+    FieldSchema<T>::Fields);
+}
+
+/// Field indices, sorted by name
+template <HasFieldSchema T>
+constexpr auto SortedFieldOrder = [] {
+  const auto names = std::apply(
+    [](const auto&... fields) {
+      return std::array<std::string_view, FieldCount<T>> {fields.mName...};
+    },
+    FieldSchema<T>::Fields);
+  std::array<std::size_t, FieldCount<T>> ret;
+  std::iota(ret.begin(), ret.end(), 0);
+  std::ranges::sort(
+    ret, {}, [&names](std::size_t index) { return names[index]; });
+  return ret;
+}();
+
+/// Call `fn(field)` for each field, sorted by name
+template <HasFieldSchema T, class F>
+constexpr void ForEachFieldSorted(F&& fn) {
+  [&fn]<std::size_t... I>(std::index_sequence<I...>) {
+    (fn(std::get<SortedFieldOrder<T>[I]>(FieldSchema<T>::Fields)), ...);
+  }(std::make_index_sequence<FieldCount<T>> {});
+}
+
+/** Call `fn(value)` for every present leaf value, recursively.
+ *
+ * Leaves are passed as `uint64_t` (integers, enums and `LUID`s), or as
+ * `std::wstring_view`; this is the canonical form used for hashing.
+ */
+template <HasFieldSchema T, class F>
+constexpr void VisitFieldValues(const T& v, F&& fn);
+
+template <class V, class F>
+constexpr void VisitFieldValue(const V& value, F&& fn) {
+  if constexpr (HasFieldSchema<V>) {
+    VisitFieldValues(value, fn);
+  } else if constexpr (std::same_as<V, LUID>) {
+    fn(std::bit_cast<uint64_t>(value));
+  } else if constexpr (std::is_enum_v<V>) {
+    fn(static_cast<uint64_t>(static_cast<std::underlying_type_t<V>>(value)));
+  } else if constexpr (std::integral<V>) {
+    fn(static_cast<uint64_t>(value));
+  } else {
+    static_assert(std::same_as<V, std::wstring_view>);
+    fn(value);
+  }
+}
+
+template <HasFieldSchema T, class F>
+constexpr void VisitFieldValues(const T& v, F&& fn) {
+  ForEachField<T>([&](const auto& field) {
+    if (field.IsPresent(v)) {
+      VisitFieldValue(field.Get(v), fn);
+    }
+  });
+}
+
+template <HasFieldSchema T>
+constexpr bool FieldsEqual(const T& a, const T& b);
+
+template <class V>
+constexpr bool FieldValuesEqual(const V& a, const V& b) {
+  if constexpr (HasFieldSchema<V>) {
+    return FieldsEqual(a, b);
+  } else if constexpr (std::same_as<V, LUID>) {
+    return a.LowPart == b.LowPart && a.HighPart == b.HighPart;
+  } else {
+    return a == b;
+  }
+}
+
+/// Compares present fields only, ignoring padding and inactive union members
+template <HasFieldSchema T>
+constexpr bool FieldsEqual(const T& a, const T& b) {
+  bool ret = true;
+  ForEachField<T>([&](const auto& field) {
+    if (!ret) {
+      return;
+    }
+    const auto present = field.IsPresent(a);
+    if (present != field.IsPresent(b)) {
+      ret = false;
+      return;
+    }
+    if (present && !FieldValuesEqual(field.Get(a), field.Get(b))) {
+      ret = false;
+    }
+  });
+  return ret;
+}
+
+/// 64-bit FNV-1a over `VisitFieldValues()`
+template <HasFieldSchema T>
+constexpr uint64_t HashFields(
+  const T& v,
+  uint64_t seed = 0xcbf29ce484222325ull) {
+  auto ret = seed;
+  const auto hashByte = [&ret](uint8_t byte) {
+    ret ^= byte;
+    ret *= 0x100000001b3ull;
+  };
+  VisitFieldValues(v, [&]<class V>(const V& value) {
+    if constexpr (std::same_as<V, uint64_t>) {
+      for (std::size_t i = 0; i < sizeof(value); ++i) {
+        hashByte(static_cast<uint8_t>(value >> (i * 8)));
+      }
+    } else {
+      for (const auto c: value) {
+        hashByte(static_cast<uint8_t>(c));
+        hashByte(static_cast<uint8_t>(c >> 8));
+      }
+    }
+  });
+  return ret;
+}
+
+/** A copy of the present fields, with everything else zeroed.
+ *
+ * Padding and inactive union members are zero, so values that are
+ * `FieldsEqual()` have the same bytes, and can be compared or hashed as raw
+ * memory.
+ */
+template <HasFieldSchema T>
+T CanonicalizeFields(const T& v) {
+  static_assert(std::is_trivially_copyable_v<T>);
+  T ret;
+  memset(&ret, 0, sizeof(ret));
+  ForEachField<T>([&](const auto& field) {
+    if (!field.IsPresent(v)) {
+      return;
+    }
+    using V = typename std::remove_cvref_t<decltype(field)>::Value;
+    if constexpr (HasFieldSchema<V>) {
+      field.Set(ret, CanonicalizeFields(field.Get(v)));
+    } else {
+      field.Set(ret, field.Get(v));
+    }
+  });
+  return ret;
+}
+
+/// Dotted paths of the fields that differ, e.g. `targetInfo.refreshRate`
+template <HasFieldSchema T>
+void DiffFields(
+  const T& a,
+  const T& b,
+  std::vector<std::string>& differences,
+  std::string_view prefix = {}) {
+  ForEachField<T>([&](const auto& field) {
+    auto path = std::string {prefix};
+    if (!path.empty()) {
+      path += '.';
+    }
+    path += field.mName;
+
+    const auto present = field.IsPresent(a);
+    if (present != field.IsPresent(b)) {
+      differences.push_back(std::move(path));
+      return;
+    }
+    if (!present) {
+      return;
+    }
+
+    using V = typename std::remove_cvref_t<decltype(field)>::Value;
+    if constexpr (HasFieldSchema<V>) {
+      DiffFields(field.Get(a), field.Get(b), differences, path);
+    } else if (!FieldValuesEqual(field.Get(a), field.Get(b))) {
+      differences.push_back(std::move(path));
+    }
+  });
+}
+
+template <HasFieldSchema T>
+std::vector<std::string> DiffFields(const T& a, const T& b) {
+  std::vector<std::string> ret;
+  DiffFields(a, b, ret);
+  return ret;
+}
+
+/// Call `fn(LUID&)` for every present `LUID`, recursively
+template <HasFieldSchema T, class F>
+constexpr void VisitLUIDs(T& v, F&& fn) {
+  ForEachField<T>([&](const auto& field) {
+    using V = typename std::remove_cvref_t<decltype(field)>::Value;
+    if constexpr (std::same_as<V, LUID>) {
+      if (field.IsPresent(v)) {
+        auto luid = field.Get(v);
+        fn(luid);
+        field.Set(v, luid);
+      }
+    } else if constexpr (HasFieldSchema<V>) {
+      if (field.IsPresent(v)) {
+        auto value = field.Get(v);
+        VisitLUIDs(value, fn);
+        field.Set(v, value);
+      }
+    }
+  });
+}
+
+}// namespace FredEmmott::MonitorTool
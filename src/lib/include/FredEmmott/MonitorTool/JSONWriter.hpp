@@ -0,0 +1,101 @@
+// Copyright 2024, Fred Emmott
+// SPDX-License-Identifier: ISC
+#pragma once
+
+#include <concepts>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <vector>
+
+namespace FredEmmott::MonitorTool {
+
+/** Writes JSON directly to a string, without building a DOM.
+ *
+ * The output is identical to `nlohmann::json::dump(2)`; this is required as
+ * we don't want saving a profile to change files that haven't otherwise
+ * changed.
+ *
+ * Structs are written by `WriteJSON(JSONWriter&, const T&)`, found by ADL.
+ */
+class JSONWriter final {
+ public:
+  JSONWriter() = default;
+  explicit JSONWriter(std::size_t reserve);
+
+  void BeginObject();
+  void EndObject();
+  void BeginArray();
+  void EndArray();
+
+  /// Must be followed by exactly one value
+  void Key(std::string_view);
+
+  /// Must be UTF-8
+  void Write(std::string_view);
+  void Write(const std::string& value) {
+    this->Write(std::string_view {value});
+  }
+  void Write(const char* value) {
+    this->Write(std::string_view {value});
+  }
+  void Write(bool);
+
+  template <std::integral T>
+  void Write(T value) {
+    if constexpr (std::is_signed_v<T>) {
+      this->WriteInteger(static_cast<int64_t>(value));
+    } else {
+      this->WriteInteger(static_cast<uint64_t>(value));
+    }
+  }
+
+  template <class T>
+    requires std::is_enum_v<T>
+  void Write(T value) {
+    this->Write(static_cast<std::underlying_type_t<T>>(value));
+  }
+
+  template <class T>
+  void Write(const std::vector<T>& values) {
+    this->BeginArray();
+    for (auto&& value: values) {
+      this->Write(value);
+    }
+    this->EndArray();
+  }
+
+  template <class T>
+    requires std::is_class_v<T>
+  void Write(const T& value) {
+    WriteJSON(*this, value);
+  }
+
+  std::string_view GetView() const noexcept {
+    return mBuffer;
+  }
+
+  std::string GetString() && noexcept {
+    return std::move(mBuffer);
+  }
+
+ private:
+  static constexpr std::size_t IndentWidth = 2;
+  // One bit per level of nesting
+  static constexpr std::size_t MaxDepth = 64;
+
+  std::string mBuffer;
+  std::size_t mDepth {0};
+  uint64_t mIsArray {0};
+  uint64_t mHasElements {0};
+
+  void BeginValue();
+  void BeginContainer(char open, bool isArray);
+  void EndContainer(char close);
+  void WriteString(std::string_view);
+  void WriteInteger(int64_t);
+  void WriteInteger(uint64_t);
+};
+
+}// namespace FredEmmott::MonitorTool
@@ -0,0 +1,30 @@
+// Copyright 2024, Fred Emmott
+// SPDX-License-Identifier: ISC
+#pragma once
+
+#include "DisplayConfig.hpp"
+
+#include <optional>
+
+#include <Windows.h>
+
+namespace FredEmmott::MonitorTool {
+
+/** A path, with the modes it refers to inlined.
+ *
+ * Volatile fields - status flags, target availability, and mode indices - are
+ * cleared, as they depend on the order Windows returns things in, or on the
+ * state of the hardware, rather than on the configuration.
+ */
+struct NormalizedDisplayPath {
+  DISPLAYCONFIG_PATH_INFO mPath {};
+  std::optional<DISPLAYCONFIG_SOURCE_MODE> mSourceMode;
+  std::optional<DISPLAYCONFIG_TARGET_MODE> mTargetMode;
+  std::optional<DISPLAYCONFIG_DESKTOP_IMAGE_INFO> mDesktopImage;
+};
+
+NormalizedDisplayPath NormalizeDisplayPath(
+  const DisplayConfig&,
+  const DISPLAYCONFIG_PATH_INFO&);
+
+}// namespace FredEmmott::MonitorTool
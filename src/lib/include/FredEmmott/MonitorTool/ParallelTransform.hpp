@@ -0,0 +1,88 @@
+// Copyright 2024, Fred Emmott
+// SPDX-License-Identifier: ISC
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <exception>
+#include <functional>
+#include <optional>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+namespace FredEmmott::MonitorTool {
+
+/// Used when `0` is passed as a thread count
+inline std::size_t GetDefaultThreadCount() {
+  // Capped as the work we do in parallel is mostly file IO and parsing of
+  // small files; more threads just add startup cost
+  constexpr std::size_t MaxDefaultThreads = 8;
+  return std::clamp<std::size_t>(
+    std::thread::hardware_concurrency(), 1, MaxDefaultThreads);
+}
+
+/** Call `fn` for every input, using a pool of up to `maxThreads` threads.
+ *
+ * Results are in the same order as the inputs, regardless of scheduling. If
+ * any calls throw, the exception from the first failing input (in input order)
+ * is rethrown once all threads have finished.
+ */
+template <class TIn, class F>
+auto ParallelTransform(
+  const std::vector<TIn>& inputs,
+  F&& fn,
+  std::size_t maxThreads = 0) {
+  using TOut = std::invoke_result_t<F&, const TIn&>;
+
+  if (maxThreads == 0) {
+    maxThreads = GetDefaultThreadCount();
+  }
+  const auto threadCount = std::min(maxThreads, inputs.size());
+
+  std::vector<TOut> ret;
+  ret.reserve(inputs.size());
+  if (threadCount <= 1) {
+    for (const auto& it: inputs) {
+      ret.push_back(std::invoke(fn, it));
+    }
+    return ret;
+  }
+
+  std::vector<std::optional<TOut>> results(inputs.size());
+  std::vector<std::exception_ptr> errors(inputs.size());
+  std::atomic<std::size_t> next {0};
+
+  auto worker = [&]() {
+    for (auto i = next++; i < inputs.size(); i = next++) {
+      try {
+        results[i].emplace(std::invoke(fn, inputs[i]));
+      } catch (...) {
+        errors[i] = std::current_exception();
+      }
+    }
+  };
+
+  {
+    std::vector<std::jthread> threads;
+    threads.reserve(threadCount - 1);
+    for (std::size_t i = 1; i < threadCount; ++i) {
+      threads.emplace_back(worker);
+    }
+    // Use this thread too, instead of just waiting
+    worker();
+  }
+
+  for (const auto& it: errors) {
+    if (it) {
+      std::rethrow_exception(it);
+    }
+  }
+
+  for (auto&& it: results) {
+    ret.push_back(std::move(*it));
+  }
+  return ret;
+}
+
+}// namespace FredEmmott::MonitorTool
@@ -0,0 +1,25 @@
+// Copyright 2024, Fred Emmott
+// SPDX-License-Identifier: ISC
+#pragma once
+
+#include <filesystem>
+#include <string>
+
+namespace FredEmmott::MonitorTool {
+
+/// `%LOCALAPPDATA%\Freds Monitor Tool`
+///
+/// On other platforms, `$XDG_DATA_HOME/freds-monitor-tool`
+std::filesystem::path GetDataPath();
+
+/// Where profiles are saved if an explicit path is not provided
+std::filesystem::path GetProfilesPath();
+
+/** The absolute path, for passing to Win32 file APIs.
+ *
+ * On Windows, this has the `\\?\` prefix, which removes the `MAX_PATH`
+ * limitation.
+ */
+std::wstring GetFileAPIPath(const std::filesystem::path&);
+
+}// namespace FredEmmott::MonitorTool
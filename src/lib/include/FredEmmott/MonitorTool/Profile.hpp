@@ -3,12 +3,15 @@
 #pragma once
 
 #include "DisplayConfig.hpp"
+#include "DisplayConfigFingerprint.hpp"
 #include "except.hpp"
 
 #include <winrt/base.h>
 
 #include <filesystem>
+#include <optional>
 #include <string>
+#include <string_view>
 #include <vector>
 
 #include <dxgi.h>
@@ -41,6 +44,34 @@ class DisplayConfigValidationError final : public RuntimeError {
   using RuntimeError::RuntimeError;
 };
 
+struct ApplyResult {
+  /** False if nothing was applied.
+   *
+   * This is when the configuration was already active and, for persistent
+   * applies, already saved to the database.
+   */
+  bool mChanged {false};
+  /// Differences from the configuration that was active; see
+  /// `DiffDisplayConfig()`
+  std::vector<std::string> mDifferences;
+};
+
+/// Just enough of a profile to list or find it
+struct ProfileSummary final {
+  /** Reads a profile's name and GUID, without parsing the display
+   * configuration.
+   *
+   * Stops reading as soon as both have been found.
+   */
+  static ProfileSummary Load(const std::filesystem::path& path);
+
+  std::string mName;
+  winrt::guid mGuid;
+  std::filesystem::path mPath;
+  /// Only if the profile was saved with one, or is in a bundle
+  std::optional<DisplayConfigFingerprint> mFingerprint;
+};
+
 struct Profile final {
   static Profile CreateFromActiveConfiguration(const std::string& name);
 
@@ -50,11 +81,24 @@ struct Profile final {
    * it's not yet been saved. */
   void Save() const;
 
-  static std::vector<Profile> Enumerate();
+  /// Does not set `mPath`
+  static Profile FromJSON(std::string_view);
+  std::string ToJSON() const;
+
+  /** Load every profile in the user's profile store (`GetProfileStore()`).
+   *
+   * Profiles are read and parsed in parallel, using up to `maxThreads`
+   * threads; `0` picks a default based on the number of CPU cores.
+   */
+  static std::vector<Profile> Enumerate(std::size_t maxThreads = 0);
+  /// Cheaper than `Enumerate()` if only names and GUIDs are needed
+  static std::vector<ProfileSummary> EnumerateSummaries(
+    std::size_t maxThreads = 0);
 
   // Can throw DisplayConfigValidation
   bool CanApply() const;
-  void Apply(ApplyMode) const;
+  /// Saved in the profile, so that it can be found without loading it all
+  DisplayConfigFingerprint GetFingerprint() const;
 
   std::string mName;
   std::vector<DXGI_ADAPTER_DESC1> mAdapters;
@@ -63,7 +107,8 @@ struct Profile final {
   // Automatically filled
   winrt::guid mGuid;
 
-  // Automatically filled by `Load()` and `Enumerate()`
+  // Automatically filled by `Load()`, and by `Enumerate()` for directory
+  // stores
   std::filesystem::path mPath;
 };
 }// namespace FredEmmott::MonitorTool
\ No newline at end of file
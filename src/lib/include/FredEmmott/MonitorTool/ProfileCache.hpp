@@ -0,0 +1,66 @@
+// Copyright 2024, Fred Emmott
+// SPDX-License-Identifier: ISC
+#pragma once
+
+#include "Profile.hpp"
+
+#include <cstdint>
+#include <filesystem>
+#include <functional>
+#include <optional>
+#include <string_view>
+#include <vector>
+
+namespace FredEmmott::MonitorTool {
+
+/// Identifies a specific version of a profile's JSON file
+struct ProfileSourceInfo {
+  uint64_t mSize {};
+  uint64_t mLastWriteTime {};
+  uint64_t mContentHash {};
+};
+
+/// 64-bit FNV-1a
+uint64_t HashProfileContents(std::string_view);
+
+/** Load a previously-decoded profile from the binary cache.
+ *
+ * The cache is keyed by the source path, and is only used if the size
+ * matches, and either the modification time or the content hash matches; the
+ * JSON file is always the source of truth.
+ *
+ * `getContentHash()` is only called if the modification time differs, e.g.
+ * because the file was touched or copied, so usually the JSON file doesn't
+ * need to be read at all.
+ */
+std::optional<Profile> LoadCachedProfile(
+  const std::filesystem::path& path,
+  uint64_t size,
+  uint64_t lastWriteTime,
+  const std::function<uint64_t()>& getContentHash);
+
+/// Best-effort; failures are ignored, as the cache is just an optimization
+void StoreCachedProfile(
+  const std::filesystem::path& path,
+  const ProfileSourceInfo& source,
+  const Profile& profile) noexcept;
+
+/// Best-effort, as with `StoreCachedProfile()`
+void RemoveCachedProfile(const std::filesystem::path& path) noexcept;
+
+/** Remove entries for profiles that no longer exist.
+ *
+ * For example, if a profile was renamed or removed without using a
+ * `ProfileStore`. Only entries that aren't for `livePaths` are checked.
+ */
+void PruneCachedProfiles(
+  const std::vector<std::filesystem::path>& livePaths) noexcept;
+
+/** Where cache files are written; `GetDataPath() / "Cache"` by default.
+ *
+ * For benchmarks, so that they don't fill the user's cache with entries for
+ * temporary profiles. Passing an empty path restores the default.
+ */
+void SetProfileCacheRoot(std::filesystem::path);
+
+}// namespace FredEmmott::MonitorTool
@@ -0,0 +1,58 @@
+// Copyright 2024, Fred Emmott
+// SPDX-License-Identifier: ISC
+#pragma once
+
+#include "ApplyProfile.hpp"
+
+#include <winrt/base.h>
+
+#include <chrono>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace FredEmmott::MonitorTool {
+
+/// Whether a saved profile can still be applied, without applying it
+struct ProfileCheckResult {
+  enum class Status {
+    /// Can be applied as saved
+    OK,
+    /// Can be applied once its adapters are remapped; `--update` saves that
+    NeedsRemap,
+    /// Can't be applied on this system
+    Invalid,
+    /// Couldn't be loaded or checked
+    Error,
+  };
+
+  std::string mName;
+  winrt::guid mGuid;
+  Status mStatus {Status::Error};
+  /// Why, if not `OK`
+  std::string mReason;
+  /// The configuration is already active
+  bool mActive {false};
+  /** Planning, including any wait for other validations.
+   *
+   * Also loading, if the profile had to be loaded separately.
+   */
+  std::chrono::steady_clock::duration mDuration {};
+};
+
+std::string_view ToString(ProfileCheckResult::Status);
+
+/** Check every profile in the store against the current system.
+ *
+ * Profiles are loaded together, then remapped and validated in parallel, using
+ * up to `maxThreads` threads; `0` picks a default. If any profile can't be
+ * loaded, each is loaded separately, so that the error is reported for that
+ * profile.
+ *
+ * Validation always asks Windows, instead of trusting the validation cache.
+ *
+ * Results are in store order.
+ */
+std::vector<ProfileCheckResult> CheckProfiles(std::size_t maxThreads = 0);
+
+}// namespace FredEmmott::MonitorTool
@@ -0,0 +1,96 @@
+// Copyright 2024, Fred Emmott
+// SPDX-License-Identifier: ISC
+#pragma once
+
+#include "DisplayConfigFingerprint.hpp"
+#include "Profile.hpp"
+
+#include <winrt/base.h>
+
+#include <cstdint>
+#include <filesystem>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+namespace FredEmmott::MonitorTool {
+
+struct ProfileIndexEntry {
+  std::string mName;
+  // Used for case-insensitive lookups
+  std::string mFoldedName;
+  winrt::guid mGuid;
+  std::filesystem::path mPath;
+  /// Missing if the profile couldn't be fully loaded to compute it
+  std::optional<DisplayConfigFingerprint> mFingerprint;
+
+  // Used to detect changes to the profile since it was indexed
+  int64_t mLastWriteTime {};
+  uintmax_t mSize {};
+};
+
+/** Name, GUID, and fingerprint index of the user's profile store.
+ *
+ * The index is saved next to the profiles directory, and reused as long as the
+ * directory's modification time is unchanged; otherwise it is rebuilt
+ * incrementally, only re-reading profiles with a changed size or modification
+ * time.
+ *
+ * Matches are checked against the file before they're returned, and misses
+ * trigger a rebuild, so edits that don't touch the directory's modification
+ * time are still picked up.
+ *
+ * Fingerprints are taken from the profile if it was saved with one; older
+ * profiles are fully loaded once, when they're indexed.
+ */
+class ProfileIndex final {
+ public:
+  /// Load the index, rebuilding it if the profile store has changed
+  static ProfileIndex Open();
+  static ProfileIndex Open(const std::filesystem::path& profilesPath);
+
+  /// Exact match first, then case-insensitive
+  std::optional<ProfileIndexEntry> FindEntryByName(std::string_view name);
+  std::optional<ProfileIndexEntry> FindEntryByGUID(const winrt::guid& guid);
+  /// Sorted by path
+  std::vector<ProfileIndexEntry> FindEntriesByFingerprint(
+    const DisplayConfigFingerprint&);
+
+  std::optional<Profile> FindByName(std::string_view name);
+  std::optional<Profile> FindByGUID(const winrt::guid& guid);
+
+  const std::vector<ProfileIndexEntry>& GetEntries() const noexcept;
+
+  static std::string FoldCase(std::string_view);
+
+ private:
+  struct GuidHash {
+    std::size_t operator()(const winrt::guid&) const noexcept;
+  };
+
+  ProfileIndex() = default;
+
+  void Refresh();
+  void RebuildMaps();
+  void WriteIndexFile() const;
+
+  template <class F>
+  std::optional<ProfileIndexEntry> FindEntry(F&& lookup);
+
+  std::filesystem::path mProfilesPath;
+  std::filesystem::path mIndexPath;
+  int64_t mDirectoryLastWriteTime {};
+  // Set once we've checked every file in this process
+  bool mIsFresh {false};
+
+  std::vector<ProfileIndexEntry> mEntries;
+  std::unordered_map<std::string, std::size_t> mByName;
+  std::unordered_map<std::string, std::size_t> mByFoldedName;
+  std::unordered_map<winrt::guid, std::size_t, GuidHash> mByGuid;
+  std::unordered_multimap<DisplayConfigFingerprint, std::size_t>
+    mByFingerprint;
+};
+
+}// namespace FredEmmott::MonitorTool
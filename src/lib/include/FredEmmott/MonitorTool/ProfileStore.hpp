@@ -0,0 +1,188 @@
+// Copyright 2024, Fred Emmott
+// SPDX-License-Identifier: ISC
+#pragma once
+
+#include "Profile.hpp"
+
+#include <winrt/base.h>
+
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+namespace FredEmmott::MonitorTool {
+
+class BundleFormatError final : public RuntimeError {
+ public:
+  using RuntimeError::RuntimeError;
+};
+
+/// Where profiles live if they're not loaded from or saved to a specific file
+class ProfileStore {
+ public:
+  virtual ~ProfileStore() = default;
+
+  /// Sorted by path for directory stores, and by creation for bundles
+  virtual std::vector<Profile> Enumerate(std::size_t maxThreads = 0) = 0;
+  virtual std::vector<ProfileSummary> EnumerateSummaries(
+    std::size_t maxThreads = 0)
+    = 0;
+
+  /// Exact match first, then case-insensitive
+  virtual std::optional<Profile> FindByName(std::string_view name) = 0;
+  virtual std::optional<Profile> FindByGUID(const winrt::guid& guid) = 0;
+  /// In enumeration order; only loads profiles without a saved fingerprint
+  virtual std::vector<ProfileSummary> FindByFingerprint(
+    const DisplayConfigFingerprint&)
+    = 0;
+
+  /// Adds the profile, or replaces the profile with the same GUID
+  virtual void Save(const Profile&) = 0;
+  /// Returns false if there is no matching profile
+  virtual bool Remove(const winrt::guid&) = 0;
+};
+
+/** One JSON file per profile.
+ *
+ * This is the default store, in `GetProfilesPath()`.
+ */
+class DirectoryProfileStore final : public ProfileStore {
+ public:
+  DirectoryProfileStore();
+  explicit DirectoryProfileStore(const std::filesystem::path& root);
+
+  std::vector<Profile> Enumerate(std::size_t maxThreads = 0) override;
+  std::vector<ProfileSummary> EnumerateSummaries(
+    std::size_t maxThreads = 0) override;
+  std::optional<Profile> FindByName(std::string_view name) override;
+  std::optional<Profile> FindByGUID(const winrt::guid& guid) override;
+  std::vector<ProfileSummary> FindByFingerprint(
+    const DisplayConfigFingerprint&) override;
+  void Save(const Profile&) override;
+  bool Remove(const winrt::guid&) override;
+
+ private:
+  std::filesystem::path mRoot;
+
+  std::vector<std::filesystem::path> GetProfilePaths() const;
+};
+
+/** Every profile in a single file.
+ *
+ * The file is an append-only log of records, followed by an index of the
+ * latest record for each profile; each change appends a record, then rewrites
+ * the index. If the index is damaged, it is rebuilt by scanning the log.
+ *
+ * Profiles are usually variants of each other, so adapters, paths, and modes
+ * are stored once, in a pool of records identified by their content hash;
+ * each profile is its name and references to pooled records. Pooled records
+ * are only dropped by compaction, once no profile refers to them.
+ *
+ * Bundles from before the pool are upgraded by the first change.
+ *
+ * Each operation maps the file once, under a shared lock; changes are made
+ * under an exclusive lock, so the file can be compacted while other processes
+ * have it open.
+ */
+class BundleProfileStore final : public ProfileStore {
+ public:
+  explicit BundleProfileStore(const std::filesystem::path& path);
+  ~BundleProfileStore() override;
+
+  std::vector<Profile> Enumerate(std::size_t maxThreads = 0) override;
+  std::vector<ProfileSummary> EnumerateSummaries(
+    std::size_t maxThreads = 0) override;
+  std::optional<Profile> FindByName(std::string_view name) override;
+  std::optional<Profile> FindByGUID(const winrt::guid& guid) override;
+  std::vector<ProfileSummary> FindByFingerprint(
+    const DisplayConfigFingerprint&) override;
+  void Save(const Profile&) override;
+  bool Remove(const winrt::guid&) override;
+
+  /// Drop superseded and removed records
+  void Compact();
+
+  /// Bytes used by superseded and removed records
+  uint64_t GetGarbageSize();
+
+ private:
+  struct Entry {
+    winrt::guid mGuid;
+    std::string mName;
+    /// JSON or pooled
+    uint32_t mKind {};
+    uint64_t mPayloadOffset {};
+    uint64_t mPayloadSize {};
+    /// Missing in bundles from before version 3
+    std::optional<DisplayConfigFingerprint> mFingerprint;
+  };
+  struct PoolEntry {
+    uint64_t mPayloadOffset {};
+    uint64_t mPayloadSize {};
+  };
+  struct State {
+    uint32_t mVersion {};
+    std::vector<Entry> mEntries;
+    /// Keyed by content hash
+    std::unordered_map<uint64_t, PoolEntry> mPool;
+    // Where the next record will be written
+    uint64_t mIndexOffset {};
+  };
+  class FileLock;
+  class View;
+
+  std::filesystem::path mPath;
+  winrt::file_handle mFile;
+  // `LockFileEx()` only synchronizes between processes
+  std::mutex mMutex;
+
+  State ReadState(const View&) const;
+  Profile ReadProfile(const View&, const State&, const Entry&) const;
+  uint64_t GetLiveSize(const State&) const;
+  uint64_t GetGarbageSize(const State&) const;
+  /// Shared, unless an interrupted compaction needs replaying first
+  std::unique_ptr<FileLock> LockForReading();
+
+  // These require the exclusive file lock
+
+  /** Save `profile`, or remove the profile if it's null.
+   *
+   * Returns the new state, or nothing if there was nothing to remove.
+   */
+  std::optional<State> Append(const winrt::guid&, const Profile* profile);
+  /** Add the records for `profile` to `buffer`, and to `state`.
+   *
+   * `buffer` will be written at `bufferOffset`; pooled records that are
+   * already in `state` are reused, after checking their contents in `view`
+   * or `buffer`.
+   */
+  void AppendProfile(
+    const View* view,
+    uint64_t bufferOffset,
+    std::string& buffer,
+    State& state,
+    const winrt::guid&,
+    const Profile& profile) const;
+  void AppendIndex(std::string& buffer, const State&) const;
+  void CompactLocked();
+  /// Compact bundles from older versions, which also upgrades them
+  void UpgradeLocked();
+  void ReplayCompactionJournal();
+  /// Write `data` at `offset`, then truncate the file after it
+  void Write(uint64_t offset, std::string_view data);
+};
+
+/** The store used by `Profile::Enumerate()` and `Profile::Save()`.
+ *
+ * This is a `BundleProfileStore` if `Profiles.fmtbundle` exists in
+ * `GetDataPath()` - an empty file is fine - otherwise a
+ * `DirectoryProfileStore`.
+ */
+ProfileStore& GetProfileStore();
+
+}// namespace FredEmmott::MonitorTool
@@ -0,0 +1,100 @@
+// Copyright 2024, Fred Emmott
+// SPDX-License-Identifier: ISC
+#pragma once
+
+#include "Profile.hpp"
+
+#include <winrt/base.h>
+
+#include <atomic>
+#include <chrono>
+#include <filesystem>
+#include <map>
+#include <memory>
+#include <set>
+#include <string_view>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#ifndef _WIN32
+#include <FredEmmott/MonitorTool/FileDescriptor.hpp>
+#endif
+
+namespace FredEmmott::MonitorTool {
+
+/// The profile store at a point in time; never modified once published
+struct ProfileStoreSnapshot final {
+  /// In the same order as `Profile::Enumerate()`
+  std::vector<Profile> mProfiles;
+
+  /// Exact match first, then case-insensitive
+  const Profile* FindByName(std::string_view name) const;
+  const Profile* FindByGUID(const winrt::guid& guid) const;
+  /// Every profile with this configuration, in `mProfiles` order
+  std::vector<const Profile*> FindByFingerprint(
+    const DisplayConfigFingerprint&) const;
+
+  /// Indices into `mProfiles`
+  std::unordered_multimap<DisplayConfigFingerprint, std::size_t>
+    mIndicesByFingerprint;
+};
+
+/** Keeps an in-memory copy of `GetProfileStore()` up to date.
+ *
+ * A background thread watches the store for changes, with
+ * `ReadDirectoryChangesW()` or inotify; for directory stores, only the files
+ * that were added, changed, or removed are re-read. Changes are batched until
+ * the store has been quiet for `DebounceInterval`, so an editor that writes a
+ * file several times causes a single reload.
+ *
+ * Snapshots are published atomically; readers can hold one for as long as
+ * they like without blocking the watcher.
+ */
+class ProfileStoreWatcher final {
+ public:
+  static constexpr std::chrono::milliseconds DebounceInterval {100};
+  /// Reload even if the changes keep coming
+  static constexpr std::chrono::milliseconds MaxDebounceInterval {1000};
+
+  /// Loads the store, then starts watching it
+  ProfileStoreWatcher();
+  ~ProfileStoreWatcher();
+
+  ProfileStoreWatcher(const ProfileStoreWatcher&) = delete;
+  ProfileStoreWatcher& operator=(const ProfileStoreWatcher&) = delete;
+
+  std::shared_ptr<const ProfileStoreSnapshot> GetSnapshot() const noexcept;
+
+ private:
+  // A single file if the store is a bundle, otherwise the profiles directory
+  std::filesystem::path mDirectory;
+  std::filesystem::path mBundleFileName;
+
+  // Only used by the watcher thread, after construction
+  std::map<std::filesystem::path, Profile> mProfilesByPath;
+
+  std::atomic<std::shared_ptr<const ProfileStoreSnapshot>> mSnapshot;
+
+#ifdef _WIN32
+  winrt::handle mStopEvent;
+#else
+  // An eventfd
+  FileDescriptor mStopEvent;
+#endif
+  std::jthread mThread;
+
+#ifdef _WIN32
+  void Run(winrt::file_handle directory) noexcept;
+#else
+  void Run(FileDescriptor inotify) noexcept;
+#endif
+
+  /// Re-read every profile
+  void Reload();
+  /// Re-read only these profiles; directory stores only
+  void ReloadChanged(const std::set<std::filesystem::path>& changed);
+  void Publish(std::vector<Profile> profiles);
+};
+
+}// namespace FredEmmott::MonitorTool
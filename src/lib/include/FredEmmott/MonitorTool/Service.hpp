@@ -0,0 +1,72 @@
+// Copyright 2024, Fred Emmott
+// SPDX-License-Identifier: ISC
+#pragma once
+
+#include "except.hpp"
+
+#include <nlohmann/json.hpp>
+
+#include <filesystem>
+#include <optional>
+#include <string>
+
+namespace FredEmmott::MonitorTool {
+
+/* `fmt-service` keeps the profile store loaded, and handles requests from the
+ * other tools over a named pipe, so that they don't each need to load and
+ * parse every profile.
+ *
+ * Requests and responses are JSON objects, one per pipe message. Every request
+ * has a `Command` and a `Version`; every response has a `Status`, which is
+ * `OK`, `NotFound`, `Error` (with a `Message`), or `UnsupportedVersion`.
+ *
+ * - `List`: responds with `Profiles`, an array of `{Name, GUID}`
+ * - `Current`: responds with the active configuration's `Fingerprint`, and
+ *   `Profiles` with that fingerprint, as for `List`
+ * - `Query`: takes a `Name` or `GUID`, and responds with the `Profile`
+ * - `Apply`: takes a `Name` or `GUID`, `Temporary`, and `Update`; the status
+ *   is `CannotApply` if the profile can't be applied due to a configuration
+ *   change, otherwise the response has `Changed` and `Differences` from
+ *   `ApplyResult`, and the `Strategy`, `Cached`, `Validations`, and
+ *   `TimingsUS` from the `ApplyPlan`
+ *
+ * On other platforms, a Unix domain socket is used instead of the pipe; each
+ * connection carries a single request, which ends when the client shuts down
+ * writing, then the response, which ends when the service closes the
+ * connection.
+ */
+
+/// Increment when making incompatible changes to requests or responses
+constexpr uint32_t ServiceProtocolVersion = 1;
+
+class ServiceAlreadyRunningError final : public RuntimeError {
+ public:
+  using RuntimeError::RuntimeError;
+};
+
+#ifdef _WIN32
+/// Per-session, so that users don't see each others' services
+std::wstring GetServicePipeName();
+#else
+/// In `$XDG_RUNTIME_DIR`, so that users don't see each others' services
+std::filesystem::path GetServiceSocketPath();
+#endif
+
+/** Send a request to `fmt-service`.
+ *
+ * `Version` is added automatically.
+ *
+ * Returns nothing if the service isn't running, is busy for more than a
+ * moment, or doesn't support this version of the protocol; callers should do
+ * the work in-process instead.
+ */
+std::optional<nlohmann::json> SendServiceRequest(nlohmann::json request);
+
+/** Handle requests until the process is terminated.
+ *
+ * Throws `ServiceAlreadyRunningError` if another instance is running in this
+ * session.
+ */
+[[noreturn]] void RunService();
+
+}// namespace FredEmmott::MonitorTool
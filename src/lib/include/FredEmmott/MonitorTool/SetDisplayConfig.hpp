@@ -3,6 +3,7 @@
 #pragma once
 
 #include "DisplayConfig.hpp"
+#include "except.hpp"
 
 #include <Windows.h>
 
@@ -15,6 +16,10 @@ constexpr UINT32 SetDisplayConfigValidateFlags = SetDisplayConfigBaseFlags | SDC
 constexpr UINT32 SetDisplayConfigApplyFlags = SetDisplayConfigBaseFlags | SDC_APPLY;
 constexpr UINT32 SetDisplayConfigDefaultFlags = SetDisplayConfigApplyFlags;
 
+class SetDisplayConfigError final : public RuntimeError {
+  using RuntimeError::RuntimeError;
+};
+
 void SetDisplayConfig(
   const DisplayConfig& config,
   UINT32 flags = SetDisplayConfigApplyFlags);
@@ -0,0 +1,23 @@
+// Copyright 2024, Fred Emmott
+// SPDX-License-Identifier: ISC
+#pragma once
+
+#include "Profile.hpp"
+
+#include <optional>
+#include <string_view>
+
+namespace FredEmmott::MonitorTool {
+
+/** Parse a profile with simdjson's on-demand API.
+ *
+ * Decodes straight into the Win32 structs, using the `FieldSchema`s. Returns
+ * nothing if the JSON isn't exactly what we expect - e.g. missing keys,
+ * unexpected types, or values out of range - in which case the caller should
+ * fall back to `nlohmann::json`, which gives better errors.
+ *
+ * Only available if built with `WITH_SIMDJSON`.
+ */
+std::optional<Profile> ParseProfileWithSimdJSON(std::string_view json);
+
+}// namespace FredEmmott::MonitorTool
@@ -0,0 +1,92 @@
+// Copyright 2024, Fred Emmott
+// SPDX-License-Identifier: ISC
+#pragma once
+
+#include "DisplayBackend.hpp"
+#include "SyntheticDisplayConfig.hpp"
+
+#include <chrono>
+#include <cstddef>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <vector>
+
+namespace FredEmmott::MonitorTool {
+
+struct SimulatedDisplayOptions {
+  using Duration = std::chrono::microseconds;
+
+  /// The adapters and connected targets; initially all active
+  SyntheticTopologyOptions mTopology;
+
+  // Each call sleeps for this long, without holding any locks, so concurrent
+  // callers overlap as they would with a real driver
+  Duration mQueryLatency {};
+  Duration mEnumAdaptersLatency {};
+  Duration mValidateLatency {};
+  Duration mApplyLatency {};
+
+  std::string mOSVersion {"22631.0"};
+};
+
+/** An in-memory system, for benchmarks and load tests.
+ *
+ * Starts with `CreateSyntheticDisplayConfig()` active.
+ *
+ * Configurations are checked in the ways that matter for applying profiles;
+ * it's rejected if:
+ * - it has no active paths
+ * - a path's adapter or target isn't present, e.g. after `Reboot()`
+ * - a mode index is out of range, or refers to the wrong kind of mode or a
+ *   different adapter
+ * - two active paths share a target
+ * - two sources' desktop areas overlap
+ *
+ * With `QDC_ALL_PATHS`, each idle target has one inactive path, rather than
+ * one per source and target.
+ */
+class SimulatedDisplayBackend final : public DisplayBackend {
+ public:
+  struct Counters {
+    std::size_t mQueries {};
+    std::size_t mValidations {};
+    std::size_t mApplies {};
+    /// Validations or applies that threw
+    std::size_t mRejections {};
+  };
+
+  explicit SimulatedDisplayBackend(const SimulatedDisplayOptions&);
+
+  DisplayConfig QueryDisplayConfig(uint32_t flags) override;
+  void SetDisplayConfig(const DisplayConfig&, uint32_t flags) override;
+  std::vector<AdapterInfo> EnumAdapters() override;
+  std::string GetOSVersion() override;
+
+  /// Give every adapter a new LUID, as Windows does on reboot
+  void Reboot();
+  /// Change every adapter's driver version
+  void UpdateDrivers();
+
+  Counters GetCounters() const;
+
+ private:
+  struct Target {
+    LUID mAdapter;
+    UINT32 mID;
+  };
+
+  mutable std::mutex mMutex;
+  SimulatedDisplayOptions mOptions;
+  std::vector<AdapterInfo> mAdapters;
+  std::vector<Target> mTargets;
+  DisplayConfig mActive;
+  /// Returned for `QDC_DATABASE_CURRENT`; updated by `SDC_SAVE_TO_DATABASE`
+  DisplayConfig mDatabase;
+  Counters mCounters;
+
+  /// Returns the reason if it's invalid
+  std::optional<std::string> Check(const DisplayConfig&) const;
+};
+
+}// namespace FredEmmott::MonitorTool
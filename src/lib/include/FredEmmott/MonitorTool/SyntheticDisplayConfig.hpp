@@ -0,0 +1,87 @@
+// Copyright 2024, Fred Emmott
+// SPDX-License-Identifier: ISC
+#pragma once
+
+#include "DisplayConfig.hpp"
+#include "Profile.hpp"
+#include "ProfileStore.hpp"
+
+#include <algorithm>
+#include <concepts>
+#include <cstdint>
+#include <random>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include <dxgi.h>
+
+namespace FredEmmott::MonitorTool {
+
+/** Shape of a generated system.
+ *
+ * Generation is deterministic: the same options always give the same
+ * configuration, on every platform and standard library.
+ */
+struct SyntheticTopologyOptions {
+  std::size_t mAdapterCount {1};
+  /// Active targets, spread across the adapters
+  std::size_t mTargetCount {2};
+  /// Targets showing each source; more than 1 creates clone groups
+  std::size_t mTargetsPerSource {1};
+  uint32_t mSeed {0};
+};
+
+/// Plausible hardware adapters, with distinct LUIDs
+std::vector<DXGI_ADAPTER_DESC1> CreateSyntheticAdapters(
+  const SyntheticTopologyOptions&);
+
+/** Active paths with source, target, and desktop image modes.
+ *
+ * Sources are laid out left-to-right; LUIDs match
+ * `CreateSyntheticAdapters()` with the same options.
+ */
+DisplayConfig CreateSyntheticDisplayConfig(const SyntheticTopologyOptions&);
+
+/// Has a GUID derived from the seed and name, and no path
+Profile CreateSyntheticProfile(
+  const SyntheticTopologyOptions&,
+  const std::string& name);
+
+/** Save `count` profiles to `store`.
+ *
+ * Profiles are named `Synthetic N`; each uses `options` with a different
+ * seed, so their modes differ.
+ */
+void PopulateSyntheticProfileStore(
+  ProfileStore& store,
+  std::size_t count,
+  const SyntheticTopologyOptions& options);
+
+/** Every bit random, except where that wouldn't be valid input.
+ *
+ * Union members that aren't selected are still random, to check that
+ * serialization ignores them.
+ */
+template <class T>
+T CreateRandomStruct(std::mt19937_64& engine) {
+  T ret;
+  auto bytes = reinterpret_cast<unsigned char*>(&ret);
+  for (std::size_t i = 0; i < sizeof(T); ++i) {
+    bytes[i] = static_cast<unsigned char>(engine());
+  }
+
+  if constexpr (std::same_as<T, DXGI_ADAPTER_DESC1>) {
+    // Must be valid UTF-16; include characters that need escaping
+    constexpr std::wstring_view description {L"GPU \"1\" \\ \t\u00e9"};
+    std::ranges::fill(ret.Description, L'\0');
+    std::ranges::copy(description, ret.Description);
+  }
+  if constexpr (std::same_as<T, DISPLAYCONFIG_MODE_INFO>) {
+    // Include unknown types
+    ret.infoType = static_cast<DISPLAYCONFIG_MODE_INFO_TYPE>(engine() % 5);
+  }
+  return ret;
+}
+
+}// namespace FredEmmott::MonitorTool
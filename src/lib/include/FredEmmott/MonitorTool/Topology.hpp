@@ -0,0 +1,66 @@
+// Copyright 2024, Fred Emmott
+// SPDX-License-Identifier: ISC
+#pragma once
+
+#include "DisplayConfig.hpp"
+
+#include <compare>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include <Windows.h>
+#include <dxgi.h>
+
+namespace FredEmmott::MonitorTool {
+
+/** A graphics adapter, identified by model rather than LUID.
+ *
+ * LUIDs change across reboots and driver updates, so they can't be used to
+ * recognize a topology.
+ */
+struct TopologyAdapter {
+  uint32_t mVendorId {};
+  uint32_t mDeviceId {};
+  uint32_t mSubSysId {};
+
+  auto operator<=>(const TopologyAdapter&) const = default;
+};
+
+/// A connected display, whether or not it's in use
+struct TopologyTarget {
+  TopologyAdapter mAdapter;
+  uint32_t mTargetId {};
+  DISPLAYCONFIG_VIDEO_OUTPUT_TECHNOLOGY mOutputTechnology {};
+
+  auto operator<=>(const TopologyTarget&) const = default;
+};
+
+/** What's plugged in, independent of how it's configured.
+ *
+ * Applying a profile changes the display configuration, but not the topology,
+ * so this can be used to decide which profile to apply without reacting to
+ * our own changes.
+ */
+struct Topology {
+  /// Uses `QueryDisplayConfig(QDC_ALL_PATHS)` and `EnumAdapterDescs()`
+  static Topology GetCurrent();
+
+  /// `allPaths` must include inactive paths, i.e. `QDC_ALL_PATHS`
+  static Topology Create(
+    const DisplayConfig& allPaths,
+    const std::vector<DXGI_ADAPTER_DESC1>& adapters);
+
+  // Sorted, without duplicates
+  std::vector<TopologyAdapter> mAdapters;
+  std::vector<TopologyTarget> mTargets;
+
+  /// Hash of the adapters and targets
+  uint64_t GetFingerprint() const noexcept;
+  /// `GetFingerprint()` as 16 hex digits, as used in rules files
+  std::string GetFingerprintString() const;
+
+  bool operator==(const Topology&) const = default;
+};
+
+}// namespace FredEmmott::MonitorTool
@@ -0,0 +1,76 @@
+// Copyright 2024, Fred Emmott
+// SPDX-License-Identifier: ISC
+#pragma once
+
+#include "Topology.hpp"
+
+#include <chrono>
+#include <functional>
+#include <optional>
+
+#ifdef _WIN32
+#include <Windows.h>
+#endif
+
+namespace FredEmmott::MonitorTool {
+
+/// Tells `TopologyRulesEngine` that displays may have been connected or removed
+class TopologyEventSource {
+ public:
+  virtual ~TopologyEventSource() = default;
+
+  /** Block until there might have been a change, or until `timeout`.
+   *
+   * Waits indefinitely if `timeout` is empty. Returns false on timeout.
+   * Spurious wakeups are fine, as the engine compares topologies before
+   * acting.
+   */
+  virtual bool WaitForChange(
+    std::optional<std::chrono::milliseconds> timeout) = 0;
+};
+
+#ifdef _WIN32
+/** `WM_DISPLAYCHANGE` and `WM_DEVICECHANGE`, via a hidden window.
+ *
+ * Must be used on the thread that created it, as that's the thread that
+ * receives the window's messages.
+ */
+class WindowMessageTopologyEventSource final : public TopologyEventSource {
+ public:
+  WindowMessageTopologyEventSource();
+  ~WindowMessageTopologyEventSource() override;
+
+  bool WaitForChange(
+    std::optional<std::chrono::milliseconds> timeout) override;
+
+ private:
+  HWND mWindow {};
+  bool mChanged {false};
+
+  static LRESULT CALLBACK
+  WindowProc(HWND, UINT message, WPARAM, LPARAM) noexcept;
+};
+#endif
+
+/** Compares the topology every `interval`.
+ *
+ * For when window messages aren't available, e.g. when running as a service
+ * or on other platforms.
+ * `getTopology` defaults to `Topology::GetCurrent()`.
+ */
+class PollingTopologyEventSource final : public TopologyEventSource {
+ public:
+  explicit PollingTopologyEventSource(
+    std::chrono::milliseconds interval,
+    std::function<Topology()> getTopology = &Topology::GetCurrent);
+
+  bool WaitForChange(
+    std::optional<std::chrono::milliseconds> timeout) override;
+
+ private:
+  std::chrono::milliseconds mInterval;
+  std::function<Topology()> mGetTopology;
+  std::optional<Topology> mLastTopology;
+};
+
+}// namespace FredEmmott::MonitorTool
@@ -0,0 +1,73 @@
+// Copyright 2024, Fred Emmott
+// SPDX-License-Identifier: ISC
+#pragma once
+
+#include "Topology.hpp"
+#include "except.hpp"
+
+#include <cstdint>
+#include <filesystem>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+namespace FredEmmott::MonitorTool {
+
+class TopologyRulesError final : public RuntimeError {
+ public:
+  using RuntimeError::RuntimeError;
+};
+
+/// Every condition that is set must match
+struct TopologyRule {
+  std::string mProfileName;
+
+  /// `Topology::GetFingerprint()`
+  std::optional<uint64_t> mFingerprint;
+  std::optional<std::size_t> mMinTargets;
+  std::optional<std::size_t> mMaxTargets;
+
+  bool Matches(const Topology&, uint64_t fingerprint) const noexcept;
+};
+
+/** Which profile to apply for a topology.
+ *
+ * The file is JSON, for example:
+ *
+ *   {"Rules": [
+ *     {"Profile": "Docked", "Fingerprint": "0123456789abcdef"},
+ *     {"Profile": "Presenting", "MinTargets": 2},
+ *     {"Profile": "Laptop"}
+ *   ]}
+ *
+ * Rules are checked in order, and the first match wins; a rule with no
+ * conditions always matches.
+ */
+class TopologyRules final {
+ public:
+  /// `Rules.json` in `GetDataPath()`
+  static std::filesystem::path GetDefaultPath();
+
+  static TopologyRules Load(const std::filesystem::path&);
+  static TopologyRules FromJSON(std::string_view);
+
+  /** The first matching rule, or nullptr.
+   *
+   * Fingerprint-only rules - usually most of them - are found with a single
+   * lookup, so this doesn't get slower as they're added.
+   */
+  const TopologyRule* Match(const Topology&) const noexcept;
+
+  const std::vector<TopologyRule>& GetRules() const noexcept;
+
+ private:
+  std::vector<TopologyRule> mRules;
+  // Index of the first rule whose only condition is this fingerprint
+  std::unordered_map<uint64_t, std::size_t> mFingerprintOnlyRules;
+  // Indices of every other rule, in order
+  std::vector<std::size_t> mOtherRules;
+};
+
+}// namespace FredEmmott::MonitorTool
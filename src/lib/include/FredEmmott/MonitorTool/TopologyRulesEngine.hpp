@@ -0,0 +1,72 @@
+// Copyright 2024, Fred Emmott
+// SPDX-License-Identifier: ISC
+#pragma once
+
+#include "ProfileStoreWatcher.hpp"
+#include "Topology.hpp"
+#include "TopologyEventSource.hpp"
+#include "TopologyRules.hpp"
+
+#include <chrono>
+#include <functional>
+#include <memory>
+#include <optional>
+#include <string>
+
+namespace FredEmmott::MonitorTool {
+
+struct TopologyRulesEngineResult {
+  Topology mTopology;
+  /// nullptr if no rule matched
+  const TopologyRule* mRule {nullptr};
+  /// Set if the profile was applied, or was already active
+  std::optional<ApplyResult> mApplyResult;
+  /** Set if a rule matched, but its profile couldn't be applied, or if the
+   * topology couldn't be queried.
+   */
+  std::string mError;
+  /// From the first change notification to finishing
+  std::chrono::steady_clock::duration mLatency {};
+};
+
+/** Apply a profile chosen by `TopologyRules` whenever the topology changes.
+ *
+ * A burst of notifications - e.g. from connecting a dock - is coalesced into a
+ * single evaluation once the notifications have stopped for
+ * `DebounceInterval`. Profiles are kept loaded with a `ProfileStoreWatcher`,
+ * so evaluation doesn't need to read the store.
+ */
+class TopologyRulesEngine final {
+ public:
+  using ResultCallback = std::function<void(const TopologyRulesEngineResult&)>;
+
+  static constexpr std::chrono::milliseconds DebounceInterval {500};
+  /// Evaluate even if the notifications keep coming
+  static constexpr std::chrono::milliseconds MaxDebounceInterval {3000};
+
+  TopologyRulesEngine(
+    TopologyRules,
+    std::unique_ptr<TopologyEventSource>,
+    ResultCallback onResult = {});
+
+  /// Evaluate the current topology, then evaluate again after every change
+  [[noreturn]] void Run();
+
+  /** Apply the matching profile if the topology has changed since the last
+   * evaluation.
+   *
+   * Applying a profile doesn't change the topology, so this doesn't react to
+   * its own changes.
+   */
+  void Evaluate(std::chrono::steady_clock::time_point triggeredAt);
+
+ private:
+  TopologyRules mRules;
+  std::unique_ptr<TopologyEventSource> mEvents;
+  ResultCallback mOnResult;
+  ProfileStoreWatcher mProfiles;
+
+  std::optional<Topology> mLastTopology;
+};
+
+}// namespace FredEmmott::MonitorTool
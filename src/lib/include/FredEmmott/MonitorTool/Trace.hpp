@@ -0,0 +1,57 @@
+// Copyright 2024, Fred Emmott
+// SPDX-License-Identifier: ISC
+#pragma once
+
+#include "except.hpp"
+
+#include <chrono>
+#include <filesystem>
+#include <string>
+#include <string_view>
+
+namespace FredEmmott::MonitorTool {
+
+class TraceFileError final : public RuntimeError {
+ public:
+  using RuntimeError::RuntimeError;
+};
+
+/** Write every `TraceSpan` to `path`, as Chrome trace event JSON.
+ *
+ * Open the file in `chrome://tracing` or https://ui.perfetto.dev
+ *
+ * Events are written as spans end, so the file is usable even if the process
+ * is terminated; the array is closed by `StopTracing()`, or when the process
+ * exits normally.
+ *
+ * Throws `TraceFileError` if the file can't be created.
+ */
+void StartTracing(const std::filesystem::path& path);
+void StopTracing() noexcept;
+bool IsTracingEnabled() noexcept;
+
+/** Records how long it's in scope, if tracing is enabled.
+ *
+ * When tracing is disabled, this is an atomic load; nothing is allocated or
+ * copied.
+ *
+ * `name` must outlive the span; usually it's a string literal. `detail` is
+ * copied, and shown as an argument of the event.
+ */
+class TraceSpan final {
+ public:
+  explicit TraceSpan(std::string_view name, std::string_view detail = {});
+  ~TraceSpan();
+
+  TraceSpan(const TraceSpan&) = delete;
+  TraceSpan& operator=(const TraceSpan&) = delete;
+
+ private:
+  using Clock = std::chrono::steady_clock;
+
+  std::string_view mName;
+  std::string mDetail;
+  Clock::time_point mStart {};
+};
+
+}// namespace FredEmmott::MonitorTool
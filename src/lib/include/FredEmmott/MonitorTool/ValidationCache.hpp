@@ -0,0 +1,47 @@
+// Copyright 2024, Fred Emmott
+// SPDX-License-Identifier: ISC
+#pragma once
+
+#include "ApplyProfile.hpp"
+#include "EnumAdapterDescs.hpp"
+
+#include <optional>
+#include <vector>
+
+namespace FredEmmott::MonitorTool {
+
+/** Remembers which candidate passed `SDC_VALIDATE` for a profile.
+ *
+ * Validation is a driver round trip that can take hundreds of milliseconds,
+ * and for the same profile on the same system, it gives the same answer.
+ *
+ * Only successes are cached: a stale entry can make an apply fail and be
+ * retried, but never stops a profile from being applied. Entries are
+ * invalidated by changing the key, e.g. by a driver update or a reboot
+ * changing adapter LUIDs; the LUID remapping itself is cheap to redo, so
+ * only the strategy is stored.
+ */
+
+/// `allPaths` must include inactive paths, i.e. `QDC_ALL_PATHS`
+ValidationCacheKey GetValidationCacheKey(
+  const Profile&,
+  const std::vector<AdapterInfo>& adapters,
+  const DisplayConfig& allPaths);
+
+/** The OS build and graphics driver versions.
+ *
+ * Unlike the system hash in `ValidationCacheKey`, this doesn't change when
+ * adapter LUIDs or displays do, only on Windows or driver updates.
+ */
+uint64_t GetDriverVersionHash(const std::vector<AdapterInfo>& adapters);
+
+std::optional<ApplyPlan::Strategy> LoadCachedValidation(
+  const ValidationCacheKey&);
+
+/// Best-effort; failures are ignored, as the cache is just an optimization
+void StoreCachedValidation(
+  const ValidationCacheKey&,
+  ApplyPlan::Strategy) noexcept;
+void RemoveCachedValidation(const ValidationCacheKey&) noexcept;
+
+}// namespace FredEmmott::MonitorTool
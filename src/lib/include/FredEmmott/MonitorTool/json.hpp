@@ -2,66 +2,89 @@
 // SPDX-License-Identifier: ISC
 #pragma once
 
+#include "JSONWriter.hpp"
+
 #include <nlohmann/json.hpp>
+#include <winrt/base.h>
 
 #include <Windows.h>
 #include <dxgi.h>
 
+NLOHMANN_JSON_NAMESPACE_BEGIN
+template <>
+struct adl_serializer<winrt::guid> {
+  static void from_json(const nlohmann::json& j, winrt::guid& v) {
+    auto s = j.get<std::string_view>();
+    if (s.size() == 38 && (s.front() == '{') && (s.back() == '}')) {
+      s.remove_prefix(1);
+      s.remove_suffix(1);
+    }
+    v = winrt::guid {s};
+  }
+
+  static void to_json(nlohmann::json& j, const winrt::guid& v) {
+    j = winrt::to_string(winrt::to_hstring(v));
+  }
+};
+NLOHMANN_JSON_NAMESPACE_END
+
+// These are all generated from the `FieldSchema`s in DisplayConfigSchema.hpp;
+// `WriteJSON()` is for `JSONWriter`, and produces the same output as
+// `to_json()`
+using FredEmmott::MonitorTool::JSONWriter;
+
 void from_json(const nlohmann::json& j, LUID& v);
 void to_json(nlohmann::json& j, const LUID& v);
+void WriteJSON(JSONWriter&, const LUID&);
+
+void from_json(const nlohmann::json& j, POINTL& v);
+void to_json(nlohmann::json& j, const POINTL& v);
+void WriteJSON(JSONWriter&, const POINTL&);
 
-NLOHMANN_DEFINE_TYPE_NON_INTRUSIVE(POINTL, x, y)
-NLOHMANN_DEFINE_TYPE_NON_INTRUSIVE(RECTL, left, top, right, bottom);
+void from_json(const nlohmann::json& j, RECTL& v);
+void to_json(nlohmann::json& j, const RECTL& v);
+void WriteJSON(JSONWriter&, const RECTL&);
 
-NLOHMANN_DEFINE_TYPE_NON_INTRUSIVE(
-  DISPLAYCONFIG_RATIONAL,
-  Numerator,
-  Denominator)
-NLOHMANN_DEFINE_TYPE_NON_INTRUSIVE(DISPLAYCONFIG_2DREGION, cx, cy)
+void from_json(const nlohmann::json& j, DISPLAYCONFIG_RATIONAL& v);
+void to_json(nlohmann::json& j, const DISPLAYCONFIG_RATIONAL& v);
+void WriteJSON(JSONWriter&, const DISPLAYCONFIG_RATIONAL&);
+
+void from_json(const nlohmann::json& j, DISPLAYCONFIG_2DREGION& v);
+void to_json(nlohmann::json& j, const DISPLAYCONFIG_2DREGION& v);
+void WriteJSON(JSONWriter&, const DISPLAYCONFIG_2DREGION&);
 
 void from_json(const nlohmann::json& j, DISPLAYCONFIG_PATH_SOURCE_INFO& v);
 void to_json(nlohmann::json& j, const DISPLAYCONFIG_PATH_SOURCE_INFO& v);
+void WriteJSON(JSONWriter&, const DISPLAYCONFIG_PATH_SOURCE_INFO&);
 
 void from_json(const nlohmann::json& j, DISPLAYCONFIG_PATH_TARGET_INFO& v);
 void to_json(nlohmann::json& j, const DISPLAYCONFIG_PATH_TARGET_INFO& v);
+void WriteJSON(JSONWriter&, const DISPLAYCONFIG_PATH_TARGET_INFO&);
 
 void from_json(const nlohmann::json&, DXGI_ADAPTER_DESC1&);
 void to_json(nlohmann::json&, const DXGI_ADAPTER_DESC1&);
+void WriteJSON(JSONWriter&, const DXGI_ADAPTER_DESC1&);
+
+void from_json(const nlohmann::json& j, DISPLAYCONFIG_VIDEO_SIGNAL_INFO& v);
+void to_json(nlohmann::json& j, const DISPLAYCONFIG_VIDEO_SIGNAL_INFO& v);
+void WriteJSON(JSONWriter&, const DISPLAYCONFIG_VIDEO_SIGNAL_INFO&);
+
+void from_json(const nlohmann::json& j, DISPLAYCONFIG_TARGET_MODE& v);
+void to_json(nlohmann::json& j, const DISPLAYCONFIG_TARGET_MODE& v);
+void WriteJSON(JSONWriter&, const DISPLAYCONFIG_TARGET_MODE&);
+
+void from_json(const nlohmann::json& j, DISPLAYCONFIG_SOURCE_MODE& v);
+void to_json(nlohmann::json& j, const DISPLAYCONFIG_SOURCE_MODE& v);
+void WriteJSON(JSONWriter&, const DISPLAYCONFIG_SOURCE_MODE&);
 
-static_assert(
-  sizeof(DISPLAYCONFIG_VIDEO_SIGNAL_INFO::AdditionalSignalInfo)
-  == sizeof(DISPLAYCONFIG_VIDEO_SIGNAL_INFO::videoStandard));
-NLOHMANN_DEFINE_TYPE_NON_INTRUSIVE(
-  DISPLAYCONFIG_VIDEO_SIGNAL_INFO,
-  pixelRate,
-  hSyncFreq,
-  vSyncFreq,
-  activeSize,
-  totalSize,
-  videoStandard,
-  scanLineOrdering);
-NLOHMANN_DEFINE_TYPE_NON_INTRUSIVE(
-  DISPLAYCONFIG_TARGET_MODE,
-  targetVideoSignalInfo)
-
-NLOHMANN_DEFINE_TYPE_NON_INTRUSIVE(
-  DISPLAYCONFIG_SOURCE_MODE,
-  width,
-  height,
-  pixelFormat,
-  position)
-
-NLOHMANN_DEFINE_TYPE_NON_INTRUSIVE(
-  DISPLAYCONFIG_DESKTOP_IMAGE_INFO,
-  PathSourceSize,
-  DesktopImageRegion,
-  DesktopImageClip)
+void from_json(const nlohmann::json& j, DISPLAYCONFIG_DESKTOP_IMAGE_INFO& v);
+void to_json(nlohmann::json& j, const DISPLAYCONFIG_DESKTOP_IMAGE_INFO& v);
+void WriteJSON(JSONWriter&, const DISPLAYCONFIG_DESKTOP_IMAGE_INFO&);
 
 void from_json(const nlohmann::json& j, DISPLAYCONFIG_MODE_INFO& v);
 void to_json(nlohmann::json& j, const DISPLAYCONFIG_MODE_INFO& v);
+void WriteJSON(JSONWriter&, const DISPLAYCONFIG_MODE_INFO&);
 
-NLOHMANN_DEFINE_TYPE_NON_INTRUSIVE(
-  DISPLAYCONFIG_PATH_INFO,
-  sourceInfo,
-  targetInfo,
-  flags);
\ No newline at end of file
+void from_json(const nlohmann::json& j, DISPLAYCONFIG_PATH_INFO& v);
+void to_json(nlohmann::json& j, const DISPLAYCONFIG_PATH_INFO& v);
+void WriteJSON(JSONWriter&, const DISPLAYCONFIG_PATH_INFO&);
@@ -1,147 +1,125 @@
 // Copyright 2024, Fred Emmott
 // SPDX-License-Identifier: ISC
+#include <FredEmmott/MonitorTool/DisplayConfigSchema.hpp>
 #include <FredEmmott/MonitorTool/json.hpp>
 
 #include <bit>
 #include <winrt/base.h>
 
-void from_json(const nlohmann::json& j, LUID& v) {
-  static_assert(sizeof(uint64_t) == sizeof(LUID));
-  v = std::bit_cast<LUID>(j.get<uint64_t>());
+using namespace FredEmmott::MonitorTool;
+
+namespace {
+
+template <class TField>
+using FieldValue = typename std::remove_cvref_t<TField>::Value;
+
+template <HasFieldSchema T>
+void FieldsFromJSON(const nlohmann::json& j, T& v) {
+  // In declaration order, so that union selectors are read before the unions
+  ForEachField<T>([&](const auto& field) {
+    if (!field.IsPresent(v)) {
+      return;
+    }
+    using V = FieldValue<decltype(field)>;
+    const auto& value = j.at(field.mName);
+    if constexpr (std::same_as<V, std::wstring_view>) {
+      field.Set(v, winrt::to_hstring(value.template get<std::string>()));
+    } else {
+      field.Set(v, value.template get<V>());
+    }
+  });
 }
 
-void to_json(nlohmann::json& j, const LUID& v) {
-  static_assert(sizeof(uint64_t) == sizeof(LUID));
-  j = std::bit_cast<uint64_t>(v);
+template <HasFieldSchema T>
+void FieldsToJSON(nlohmann::json& j, const T& v) {
+  j = nlohmann::json::object();
+  ForEachField<T>([&](const auto& field) {
+    if (!field.IsPresent(v)) {
+      return;
+    }
+    using V = FieldValue<decltype(field)>;
+    auto& value = j[std::string {field.mName}];
+    if constexpr (std::same_as<V, std::wstring_view>) {
+      value = winrt::to_string(field.Get(v));
+    } else {
+      value = field.Get(v);
+    }
+  });
 }
 
-///// START DXGI_ADAPTER_DESC1 /////
-#define XFIELDS \
-  X(VendorId) \
-  X(DeviceId) \
-  X(SubSysId) \
-  X(Revision) \
-  X(DedicatedVideoMemory) \
-  X(AdapterLuid) \
-  X(Flags)
-  
-void from_json(const nlohmann::json& j, DXGI_ADAPTER_DESC1& v) {
-  const auto desc = winrt::to_hstring(j.at("Description"));
-  wcsncpy_s(v.Description, desc.c_str(), std::size(v.Description));
-#define X(FIELD) v.FIELD = j.at(#FIELD);
-  XFIELDS
-#undef X
+template <HasFieldSchema T>
+void FieldsToJSON(JSONWriter& w, const T& v) {
+  // Sorted, as `nlohmann::json` objects are
+  w.BeginObject();
+  ForEachFieldSorted<T>([&](const auto& field) {
+    if (!field.IsPresent(v)) {
+      return;
+    }
+    w.Key(field.mName);
+    using V = FieldValue<decltype(field)>;
+    if constexpr (std::same_as<V, std::wstring_view>) {
+      // Same conversion as `winrt::to_string()`, without the allocation for
+      // fixed-size strings like `DXGI_ADAPTER_DESC1::Description`
+      const auto wide = field.Get(v);
+      char buffer[256 * 3];
+      if (wide.size() > std::size(buffer) / 3) {
+        w.Write(winrt::to_string(wide));
+        return;
+      }
+      const auto length = WideCharToMultiByte(
+        CP_UTF8,
+        0,
+        wide.data(),
+        static_cast<int>(wide.size()),
+        buffer,
+        static_cast<int>(std::size(buffer)),
+        nullptr,
+        nullptr);
+      w.Write(std::string_view {buffer, static_cast<std::size_t>(length)});
+    } else {
+      w.Write(field.Get(v));
+    }
+  });
+  w.EndObject();
 }
 
-void to_json(nlohmann::json& j, const DXGI_ADAPTER_DESC1& v) {
-  const std::wstring_view desc { v.Description, wcsnlen_s(v.Description, std::size(v.Description)) };
-  j["Description"] = winrt::to_string(desc);
-#define X(FIELD) {#FIELD, v.FIELD},
-  j.update({XFIELDS});
-#undef X
-}
+}// namespace
 
-#undef XFIELDS
-///// END DXGI_ADAPTER_DESC1 /////
-
-///// START DISPLAYCONFIG_PATH_SOURCE_INFO /////
-// Not using the NLOHMANN macros because they take references, which aren't
-// permitted for bitfields
-#define XFIELDS \
-  X(adapterId) \
-  X(id) \
-  X(cloneGroupId) \
-  X(sourceModeInfoIdx) \
-  X(statusFlags)
-
-void from_json(const nlohmann::json& j, DISPLAYCONFIG_PATH_SOURCE_INFO& v) {
-#define X(FIELD) v.FIELD = j.at(#FIELD);
-  XFIELDS
-#undef X
-}
-
-void to_json(nlohmann::json& j, const DISPLAYCONFIG_PATH_SOURCE_INFO& v) {
-#define X(FIELD) {#FIELD, v.FIELD},
-  j.update({XFIELDS});
-#undef X
+void from_json(const nlohmann::json& j, LUID& v) {
+  static_assert(sizeof(uint64_t) == sizeof(LUID));
+  v = std::bit_cast<LUID>(j.get<uint64_t>());
 }
 
-#undef XFIELDS
-///// END DISPLAYCONFIG_PATH_SOURCE_INFO /////
-
-///// START DISPLAYCONFIG_PATH_TARGET_INFO /////
-#define XFIELDS \
-  X(adapterId) \
-  X(id) \
-  X(desktopModeInfoIdx) \
-  X(targetModeInfoIdx) \
-  X(outputTechnology) \
-  X(rotation) \
-  X(scaling) \
-  X(refreshRate) \
-  X(scanLineOrdering) \
-  X(targetAvailable) \
-  X(statusFlags)
-
-void from_json(const nlohmann::json& j, DISPLAYCONFIG_PATH_TARGET_INFO& v) {
-#define X(FIELD) v.FIELD = j.at(#FIELD);
-  XFIELDS
-#undef X
+void to_json(nlohmann::json& j, const LUID& v) {
+  static_assert(sizeof(uint64_t) == sizeof(LUID));
+  j = std::bit_cast<uint64_t>(v);
 }
 
-void to_json(nlohmann::json& j, const DISPLAYCONFIG_PATH_TARGET_INFO& v) {
-#define X(FIELD) {#FIELD, v.FIELD},
-  j.update({XFIELDS});
-#undef X
+void WriteJSON(JSONWriter& w, const LUID& v) {
+  w.Write(std::bit_cast<uint64_t>(v));
 }
 
-#undef XFIELDS
-///// END DISPLAYCONFIG_PATH_TARGET_INFO /////
-
-///// START DISPLAYCONFIG_MODE_INFO /////
-#define XFIELDS \
-  X(infoType) \
-  X(id) \
-  X(adapterId)
-
-void from_json(const nlohmann::json& j, DISPLAYCONFIG_MODE_INFO& v) {
-#define X(FIELD) v.FIELD = j.at(#FIELD);
-  XFIELDS
-#undef X
-  switch (j.at("infoType").get<DISPLAYCONFIG_MODE_INFO_TYPE>()) {
-    case DISPLAYCONFIG_MODE_INFO_TYPE_TARGET:
-      v.targetMode = j.at("targetMode");
-      break;
-    case DISPLAYCONFIG_MODE_INFO_TYPE_SOURCE:
-      v.sourceMode = j.at("sourceMode");
-      break;
-    case DISPLAYCONFIG_MODE_INFO_TYPE_DESKTOP_IMAGE:
-      v.desktopImageInfo = j.at("desktopImageInfo");
-      break;
-    default:
-      break;
+#define X(T) \
+  void from_json(const nlohmann::json& j, T& v) { \
+    FieldsFromJSON(j, v); \
+  } \
+  void to_json(nlohmann::json& j, const T& v) { \
+    FieldsToJSON(j, v); \
+  } \
+  void WriteJSON(JSONWriter& w, const T& v) { \
+    FieldsToJSON(w, v); \
   }
-}
-
-void to_json(nlohmann::json& j, const DISPLAYCONFIG_MODE_INFO& v) {
-#define X(FIELD) {#FIELD, v.FIELD},
-  j.update({XFIELDS});
+X(POINTL)
+X(RECTL)
+X(DISPLAYCONFIG_RATIONAL)
+X(DISPLAYCONFIG_2DREGION)
+X(DXGI_ADAPTER_DESC1)
+X(DISPLAYCONFIG_PATH_SOURCE_INFO)
+X(DISPLAYCONFIG_PATH_TARGET_INFO)
+X(DISPLAYCONFIG_PATH_INFO)
+X(DISPLAYCONFIG_VIDEO_SIGNAL_INFO)
+X(DISPLAYCONFIG_TARGET_MODE)
+X(DISPLAYCONFIG_SOURCE_MODE)
+X(DISPLAYCONFIG_DESKTOP_IMAGE_INFO)
+X(DISPLAYCONFIG_MODE_INFO)
 #undef X
-
-  switch (v.infoType) {
-    case DISPLAYCONFIG_MODE_INFO_TYPE_TARGET:
-      j["targetMode"] = v.targetMode;
-      break;
-    case DISPLAYCONFIG_MODE_INFO_TYPE_SOURCE:
-      j["sourceMode"] = v.sourceMode;
-      break;
-    case DISPLAYCONFIG_MODE_INFO_TYPE_DESKTOP_IMAGE:
-      j["desktopImageInfo"] = v.desktopImageInfo;
-      break;
-    default:
-      break;
-  }
-}
-
-#undef XFIELDS
-///// END DISPLAYCONFIG_MODE_INFO /////
\ No newline at end of file
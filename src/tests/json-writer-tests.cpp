@@ -0,0 +1,109 @@
+// Copyright 2024, Fred Emmott
+// SPDX-License-Identifier: ISC
+
+#include <FredEmmott/MonitorTool/SyntheticDisplayConfig.hpp>
+#include <FredEmmott/MonitorTool/json.hpp>
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <format>
+#include <iostream>
+#include <random>
+#include <string>
+#include <string_view>
+#include <vector>
+
+using namespace FredEmmott::MonitorTool;
+
+/* Check that `JSONWriter` produces exactly what `nlohmann::json::dump(2)`
+ * does, which is what profiles were saved with before `JSONWriter`.
+ *
+ * Saving a profile mustn't change files that haven't otherwise changed, so
+ * this must pass for every type. */
+
+namespace {
+
+bool Check(
+  std::string_view what,
+  std::string_view actual,
+  std::string_view expected) {
+  if (actual == expected) {
+    return true;
+  }
+  const auto mismatch = std::ranges::mismatch(actual, expected).in1;
+  std::cerr << std::format(
+    "{}: JSONWriter output differs from nlohmann::json at byte {}\n",
+    what,
+    mismatch - actual.begin());
+  return false;
+}
+
+template <class T>
+bool CheckType(std::string_view name) {
+  bool ret = true;
+  for (const std::size_t count: {1, 64}) {
+    std::mt19937_64 engine {count};
+    std::vector<T> values;
+    for (std::size_t i = 0; i < count; ++i) {
+      values.push_back(CreateRandomStruct<T>(engine));
+    }
+
+    JSONWriter writer;
+    writer.Write(values);
+    ret &= Check(
+      std::format("{} x {}", name, count),
+      writer.GetView(),
+      nlohmann::json(values).dump(2));
+  }
+  return ret;
+}
+
+/// Includes the top-level key order, which `Profile::ToJSON()` chooses
+bool CheckProfile(const SyntheticTopologyOptions& options) {
+  const auto profile = CreateSyntheticProfile(options, "Test \"profile\"");
+  const nlohmann::ordered_json expected {
+    {"Name", profile.mName},
+    {"GUID", nlohmann::json(profile.mGuid)},
+    {"Fingerprint", profile.GetFingerprint().ToString()},
+    {"Adapters", nlohmann::json(profile.mAdapters)},
+    {"Modes", nlohmann::json(profile.mDisplayConfig.mModes)},
+    {"Paths", nlohmann::json(profile.mDisplayConfig.mPaths)},
+  };
+  return Check(
+    std::format(
+      "Profile with {} adapter(s) and {} target(s)",
+      options.mAdapterCount,
+      options.mTargetCount),
+    profile.ToJSON(),
+    expected.dump(2));
+}
+
+}// namespace
+
+int main() {
+  bool ok = true;
+
+#define FMT_CHECK_TYPE(T) ok &= CheckType<T>(#T);
+  FMT_CHECK_TYPE(LUID)
+  FMT_CHECK_TYPE(POINTL)
+  FMT_CHECK_TYPE(RECTL)
+  FMT_CHECK_TYPE(DISPLAYCONFIG_RATIONAL)
+  FMT_CHECK_TYPE(DISPLAYCONFIG_2DREGION)
+  FMT_CHECK_TYPE(DISPLAYCONFIG_PATH_SOURCE_INFO)
+  FMT_CHECK_TYPE(DISPLAYCONFIG_PATH_TARGET_INFO)
+  FMT_CHECK_TYPE(DXGI_ADAPTER_DESC1)
+  FMT_CHECK_TYPE(DISPLAYCONFIG_VIDEO_SIGNAL_INFO)
+  FMT_CHECK_TYPE(DISPLAYCONFIG_TARGET_MODE)
+  FMT_CHECK_TYPE(DISPLAYCONFIG_SOURCE_MODE)
+  FMT_CHECK_TYPE(DISPLAYCONFIG_DESKTOP_IMAGE_INFO)
+  FMT_CHECK_TYPE(DISPLAYCONFIG_MODE_INFO)
+  FMT_CHECK_TYPE(DISPLAYCONFIG_PATH_INFO)
+#undef FMT_CHECK_TYPE
+
+  ok &= CheckProfile({.mAdapterCount = 1, .mTargetCount = 1});
+  ok &= CheckProfile(
+    {.mAdapterCount = 4, .mTargetCount = 16, .mTargetsPerSource = 2});
+
+  return ok ? 0 : 1;
+}